@@ -30,7 +30,7 @@
 #ifndef _GZIP_ENCODING_H_
 #define _GZIP_ENCODING_H_
 #include "net/http_client_base.h"
-#include "zlib/zlib.h"
+#include <zlib.h>
 //#include "http.h"
 
 
@@ -219,6 +219,31 @@ namespace net_utils
 		*/
 		bool		m_is_first_update_in;
 	};
+
+	/*! \brief
+	*  Function gzip_encode : Packs whole buffer into gzip stream (RFC 1952)
+	*
+	*/
+	inline
+	bool gzip_encode(const std::string& in, std::string& out, int level = Z_BEST_SPEED)
+	{
+		z_stream zstream;
+		memset(&zstream, 0, sizeof(zstream));
+		int ret = deflateInit2(&zstream, level, Z_DEFLATED, 0x1F, 8, Z_DEFAULT_STRATEGY);
+		CHECK_AND_ASSERT_MES(Z_OK == ret, false, "gzip_encode: Failed to init deflate. err = " << ret);
+
+		out.resize(deflateBound(&zstream, (uLong)in.size()));
+		zstream.next_in = (Bytef*)in.data();
+		zstream.avail_in = (uInt)in.size();
+		zstream.next_out = (Bytef*)&out[0];
+		zstream.avail_out = (uInt)out.size();
+
+		ret = deflate(&zstream, Z_FINISH);
+		out.resize(out.size() - zstream.avail_out);
+		deflateEnd(&zstream);
+		CHECK_AND_ASSERT_MES(Z_STREAM_END == ret, false, "gzip_encode: Failed to deflate. err = " << ret);
+		return true;
+	}
 }
 }
 
@@ -44,11 +44,14 @@
 #include <boost/enable_shared_from_this.hpp>
 #include <boost/interprocess/detail/atomic.hpp>
 #include <boost/thread/thread.hpp>
+#include <boost/thread/condition_variable.hpp>
 #include "net_utils_base.h"
 #include "syncobj.h"
+#include "rate_limiter.h"
 
 
 #define ABSTRACT_SERVER_SEND_QUE_MAX_COUNT 1000
+#define ABSTRACT_SERVER_SEND_QUE_WAIT_TIMEOUT 60000 //ms without any write completed, after that waiting sender gives up
 
 namespace epee
 {
@@ -76,7 +79,7 @@ namespace net_utils
     typedef typename t_protocol_handler::connection_context t_connection_context;
     /// Construct a connection with the given io_service.
     explicit connection(boost::asio::io_service& io_service,
-      typename t_protocol_handler::config_type& config, volatile uint32_t& sock_count, i_connection_filter * &pfilter);
+      typename t_protocol_handler::config_type& config, volatile uint32_t& sock_count, i_connection_filter * &pfilter, connection_rate_limits& rate_limits);
 
     virtual ~connection();
     /// Get the socket associated with the connection.
@@ -91,6 +94,9 @@ namespace net_utils
   private:
     //----------------- i_service_endpoint ---------------------
     virtual bool do_send(const void* ptr, size_t cb);
+    virtual bool do_send_bulk(const void* ptr, size_t cb);
+    virtual bool do_send_buffer(std::string& buff);
+    virtual bool wait_send_que(size_t max_count);
     virtual bool close();
     virtual bool call_run_once_service_io();
     virtual bool request_callback();
@@ -100,6 +106,12 @@ namespace net_utils
     //------------------------------------------------------
     boost::shared_ptr<connection<t_protocol_handler> > safe_shared_from_this();
     bool shutdown();
+    bool do_send_que(const void* ptr, size_t cb, bool bulk);
+    bool do_send_que(std::string& buff, bool bulk);
+    /// Start write of m_send_que front, m_send_que_lock should be locked.
+    void start_write();
+    void handle_write_timer(const boost::system::error_code& e);
+    void start_read(size_t bytes_transferred);
     /// Handle completion of a read operation.
     void handle_read(const boost::system::error_code& e,
       std::size_t bytes_transferred);
@@ -119,8 +131,22 @@ namespace net_utils
     t_connection_context context;
     volatile uint32_t m_want_close_connection;
     std::atomic<bool> m_was_shutdown;
+
+    struct send_que_entry
+    {
+      std::string m_data;
+      bool m_bulk;
+      uint64_t m_ready_time; //tick when rate limit lets packet out, 0 - not charged yet
+    };
     critical_section m_send_que_lock;
-    std::list<std::string> m_send_que;
+    std::list<send_que_entry> m_send_que;
+    boost::condition_variable_any m_send_que_cond; //signaled when front packet is written or connection shut down
+    connection_rate_limits& m_rate_limits;
+    token_bucket m_send_bucket;
+    token_bucket m_recv_bucket;
+    boost::asio::deadline_timer m_send_timer;
+    bool m_send_timer_pending;
+    boost::asio::deadline_timer m_recv_timer;
     volatile uint32_t& m_ref_sockets_count;
     i_connection_filter* &m_pfilter;
     volatile bool m_is_multithreaded;
@@ -171,6 +197,9 @@ namespace net_utils
 
     void set_connection_filter(i_connection_filter* pfilter);
 
+    /// Rates in bytes per second, 0 - unlimited. Per connection rates apply to connections started after the call.
+    void set_rate_limits(uint64_t send_global, uint64_t recv_global, uint64_t send_per_connection, uint64_t recv_per_connection);
+
     bool connect(const std::string& adr, const std::string& port, uint32_t conn_timeot, t_connection_context& cn, const std::string& bind_ip = "0.0.0.0");
     template<class t_callback>
     bool connect_async(const std::string& adr, const std::string& port, uint32_t conn_timeot, t_callback cb, const std::string& bind_ip = "0.0.0.0");
@@ -251,6 +280,8 @@ namespace net_utils
     std::unique_ptr<boost::asio::io_service> m_io_service_local_instance;
     boost::asio::io_service& io_service_;    
 
+    connection_rate_limits m_rate_limits;
+
     /// Acceptor used to listen for incoming connections.
     boost::asio::ip::tcp::acceptor acceptor_;
 
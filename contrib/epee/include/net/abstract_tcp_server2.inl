@@ -34,6 +34,7 @@
 #include <boost/chrono.hpp>
 #include <boost/utility/value_init.hpp>
 #include <boost/asio/deadline_timer.hpp>
+#include <limits>
 #include "misc_language.h"
 #include "pragma_comp_defs.h"
 
@@ -49,11 +50,15 @@ PRAGMA_WARNING_DISABLE_VS(4355)
 
   template<class t_protocol_handler>
   connection<t_protocol_handler>::connection(boost::asio::io_service& io_service,
-    typename t_protocol_handler::config_type& config, volatile uint32_t& sock_count, i_connection_filter* &pfilter)
+    typename t_protocol_handler::config_type& config, volatile uint32_t& sock_count, i_connection_filter* &pfilter, connection_rate_limits& rate_limits)
                           : strand_(io_service),
                             socket_(io_service),
                             m_want_close_connection(0), 
                             m_was_shutdown(0), 
+                            m_rate_limits(rate_limits),
+                            m_send_timer(io_service),
+                            m_send_timer_pending(false),
+                            m_recv_timer(io_service),
                             m_ref_sockets_count(sock_count), 
                             m_pfilter(pfilter),
                             m_protocol_handler(this, config, context)
@@ -106,6 +111,8 @@ PRAGMA_WARNING_DISABLE_VS(4355)
       return false;
 
     m_is_multithreaded = is_multithreaded;
+    m_send_bucket.set_rate(m_rate_limits.m_send_per_connection);
+    m_recv_bucket.set_rate(m_rate_limits.m_recv_per_connection);
 
     boost::system::error_code ec;
     auto remote_ep = socket_.remote_endpoint(ec);
@@ -234,12 +241,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
           shutdown();
       }else
       {
-        socket_.async_read_some(boost::asio::buffer(buffer_),
-          strand_.wrap(
-            boost::bind(&connection<t_protocol_handler>::handle_read, connection<t_protocol_handler>::shared_from_this(),
-              boost::asio::placeholders::error,
-              boost::asio::placeholders::bytes_transferred)));
-        LOG_PRINT_L4("[sock " << socket_.native_handle() << "]Async read requested.");
+        start_read(bytes_transferred);
       }
     }else
     {
@@ -258,6 +260,40 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   }
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
+  void connection<t_protocol_handler>::start_read(size_t bytes_transferred)
+  {
+    uint64_t delay = std::max(m_rate_limits.m_recv.consume(bytes_transferred), m_recv_bucket.consume(bytes_transferred));
+    auto self = connection<t_protocol_handler>::shared_from_this();
+    auto read = [this, self]()
+    {
+      socket_.async_read_some(boost::asio::buffer(buffer_),
+        strand_.wrap(
+          boost::bind(&connection<t_protocol_handler>::handle_read, self,
+            boost::asio::placeholders::error,
+            boost::asio::placeholders::bytes_transferred)));
+      LOG_PRINT_L4("[sock " << socket_.native_handle() << "]Async read requested.");
+    };
+    if(!delay)
+    {
+      read();
+      return;
+    }
+
+    LOG_PRINT_L4("[sock " << socket_.native_handle() << "] Read delayed by rate limit for " << delay << "ms");
+    //shutdown() cancels the timer from other threads, under the same lock
+    CRITICAL_REGION_LOCAL(m_send_que_lock);
+    if(m_was_shutdown)
+      return;
+    m_recv_timer.expires_from_now(boost::posix_time::milliseconds(delay));
+    m_recv_timer.async_wait(strand_.wrap([this, self, read](const boost::system::error_code& e)
+    {
+      if(e || m_was_shutdown)
+        return;
+      read();
+    }));
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
   bool connection<t_protocol_handler>::call_run_once_service_io()
   {
     TRY_ENTRY();
@@ -285,8 +321,81 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
   bool connection<t_protocol_handler>::do_send(const void* ptr, size_t cb)
+  {
+    return do_send_que(ptr, cb, false);
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  bool connection<t_protocol_handler>::do_send_bulk(const void* ptr, size_t cb)
+  {
+    return do_send_que(ptr, cb, true);
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  bool connection<t_protocol_handler>::do_send_buffer(std::string& buff)
+  {
+    return do_send_que(buff, false);
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  bool connection<t_protocol_handler>::wait_send_que(size_t max_count)
+  {
+    TRY_ENTRY();
+    auto self = safe_shared_from_this();
+    if(!self)
+      return false;
+
+    uint64_t progress_time = misc_utils::get_tick_count();
+    size_t progress_que_size = std::numeric_limits<size_t>::max();
+    while(!m_was_shutdown)
+    {
+      size_t que_size = 0;
+      CRITICAL_REGION_BEGIN(m_send_que_lock);
+      que_size = m_send_que.size();
+      CRITICAL_REGION_END();
+      if(que_size <= max_count)
+        return true;
+
+      uint64_t now = misc_utils::get_tick_count();
+      if(que_size < progress_que_size)
+      {
+        progress_que_size = que_size;
+        progress_time = now;
+      }else if(now - progress_time > ABSTRACT_SERVER_SEND_QUE_WAIT_TIMEOUT)
+      {
+        LOG_PRINT_L1("[sock " << socket_.native_handle() << "] Send queue is stuck for " << now - progress_time << "ms, shutting down connection");
+        shutdown();
+        return false;
+      }
+
+      if(strand_.running_in_this_thread())
+      {
+        //called from this connection's read handler, so write completions have to be run right here, like in levin invoke
+        if(!call_run_once_service_io())
+          return false;
+      }else
+      {
+        boost::unique_lock<critical_section> lock(m_send_que_lock);
+        if(m_send_que.size() > max_count && !m_was_shutdown)
+          m_send_que_cond.timed_wait(lock, boost::posix_time::milliseconds(100));
+      }
+    }
+    return false;
+    CATCH_ENTRY_L0("connection<t_protocol_handler>::wait_send_que", false);
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  bool connection<t_protocol_handler>::do_send_que(const void* ptr, size_t cb, bool bulk)
+  {
+    std::string buff((const char*)ptr, cb);
+    return do_send_que(buff, bulk);
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  bool connection<t_protocol_handler>::do_send_que(std::string& buff, bool bulk)
   {
     TRY_ENTRY();
+    size_t cb = buff.size();
     // Use safe_shared_from_this, because of this is public method and it can be called on the object being deleted
     auto self = safe_shared_from_this();
     if(!self)
@@ -309,29 +418,29 @@ PRAGMA_WARNING_DISABLE_VS(4355)
       return false;
     }
 
-    m_send_que.resize(m_send_que.size()+1);
-    m_send_que.back().assign((const char*)ptr, cb);
-    
-    if(m_send_que.size() > 1)
+    bool no_active_operation = m_send_que.empty();
+    auto it = m_send_que.end();
+    if(!bulk && m_send_timer_pending)
     {
-      //active operation should be in progress, nothing to do, just wait last operation callback
-    }else
+      //front bulk packet is still waiting for tokens, priority data goes to the wire before it
+      m_send_timer_pending = false;
+      boost::system::error_code ignored_ec;
+      m_send_timer.cancel(ignored_ec);
+      it = m_send_que.begin();
+      no_active_operation = true;
+    }else if(!bulk && m_send_que.size() > 1)
     {
-      //no active operation
-      if(m_send_que.size()!=1)
-      {
-        LOG_ERROR("Looks like no active operations, but send que size != 1!!");
-        return false;
-      }
-
-      boost::asio::async_write(socket_, boost::asio::buffer(m_send_que.front().data(), m_send_que.front().size()),
-        //strand_.wrap(
-        boost::bind(&connection<t_protocol_handler>::handle_write, self, _1, _2)
-        //)
-        );
-      
-      LOG_PRINT_L4("[sock " << socket_.native_handle() << "] Async send requested " << m_send_que.front().size());
+      //priority data overtakes queued bulk packets, but never the front one, it is on the wire already
+      it = std::find_if(++m_send_que.begin(), m_send_que.end(), [](const send_que_entry& e){return e.m_bulk;});
     }
+    it = m_send_que.insert(it, send_que_entry());
+    it->m_data.swap(buff);
+    it->m_bulk = bulk;
+    it->m_ready_time = 0;
+    
+    if(no_active_operation)
+      start_write();
+    //else active operation should be in progress, nothing to do, just wait last operation callback
 
     return true;
 
@@ -339,12 +448,61 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   }
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
+  void connection<t_protocol_handler>::start_write()
+  {
+    send_que_entry& e = m_send_que.front();
+    //every packet is charged to the buckets once, but only bulk ones wait for tokens
+    if(!e.m_ready_time)
+    {
+      uint64_t delay = std::max(m_rate_limits.m_send.consume(e.m_data.size()), m_send_bucket.consume(e.m_data.size()));
+      e.m_ready_time = misc_utils::get_tick_count() + delay;
+    }
+    uint64_t now = misc_utils::get_tick_count();
+    if(e.m_bulk && e.m_ready_time > now)
+    {
+      LOG_PRINT_L4("[sock " << socket_.native_handle() << "] Send delayed by rate limit for " << e.m_ready_time - now << "ms");
+      m_send_timer_pending = true;
+      m_send_timer.expires_from_now(boost::posix_time::milliseconds(e.m_ready_time - now));
+      m_send_timer.async_wait(boost::bind(&connection<t_protocol_handler>::handle_write_timer, connection<t_protocol_handler>::shared_from_this(), _1));
+      return;
+    }
+
+    boost::asio::async_write(socket_, boost::asio::buffer(e.m_data.data(), e.m_data.size()),
+      //strand_.wrap(
+      boost::bind(&connection<t_protocol_handler>::handle_write, connection<t_protocol_handler>::shared_from_this(), _1, _2)
+      //)
+      );
+    LOG_PRINT_L4("[sock " << socket_.native_handle() << "] Async send requested " << e.m_data.size());
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
+  void connection<t_protocol_handler>::handle_write_timer(const boost::system::error_code& e)
+  {
+    TRY_ENTRY();
+    if(e || m_was_shutdown)
+      return;
+
+    CRITICAL_REGION_LOCAL(m_send_que_lock);
+    //stale wait, priority data was put in front of the packet in the meantime
+    if(!m_send_timer_pending || m_send_que.empty())
+      return;
+    m_send_timer_pending = false;
+    start_write();
+    CATCH_ENTRY_L0("connection<t_protocol_handler>::handle_write_timer", void());
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
   bool connection<t_protocol_handler>::shutdown()
   {
     // Initiate graceful connection closure.
     boost::system::error_code ignored_ec;
     socket_.shutdown(boost::asio::ip::tcp::socket::shutdown_both, ignored_ec);
     m_was_shutdown = true;
+    CRITICAL_REGION_BEGIN(m_send_que_lock);
+    m_send_timer.cancel(ignored_ec);
+    m_recv_timer.cancel(ignored_ec);
+    m_send_que_cond.notify_all();
+    CRITICAL_REGION_END();
     m_protocol_handler.release_protocol();
     return true;
   }
@@ -390,6 +548,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     }
 
     m_send_que.pop_front();
+    m_send_que_cond.notify_all();
     if(m_send_que.empty())
     {
       if(boost::interprocess::ipcdetail::atomic_read32(&m_want_close_connection))
@@ -399,10 +558,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     }else
     {
       //have more data to send
-      boost::asio::async_write(socket_, boost::asio::buffer(m_send_que.front().data(), m_send_que.front().size()),
-        //strand_.wrap(
-          boost::bind(&connection<t_protocol_handler>::handle_write, connection<t_protocol_handler>::shared_from_this(), _1, _2));
-        //);
+      start_write();
     }
     CRITICAL_REGION_END();
 
@@ -420,7 +576,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
     m_io_service_local_instance(new boost::asio::io_service()),
     io_service_(*m_io_service_local_instance.get()),
     acceptor_(io_service_),
-    new_connection_(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter)), 
+    new_connection_(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter, m_rate_limits)), 
     m_stop_signal_sent(false), m_port(0), m_sockets_count(0), m_threads_count(0), m_pfilter(NULL), m_thread_index(0)
   {
     m_thread_name_prefix = "NET";
@@ -430,7 +586,7 @@ PRAGMA_WARNING_DISABLE_VS(4355)
   boosted_tcp_server<t_protocol_handler>::boosted_tcp_server(boost::asio::io_service& extarnal_io_service):
     io_service_(extarnal_io_service),
     acceptor_(io_service_),
-    new_connection_(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter)), 
+    new_connection_(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter, m_rate_limits)), 
     m_stop_signal_sent(false), m_port(0), m_sockets_count(0), m_threads_count(0), m_pfilter(NULL), m_thread_index(0)
   {
     m_thread_name_prefix = "NET";
@@ -524,6 +680,15 @@ POP_WARNINGS
   }
   //---------------------------------------------------------------------------------
   template<class t_protocol_handler>
+  void boosted_tcp_server<t_protocol_handler>::set_rate_limits(uint64_t send_global, uint64_t recv_global, uint64_t send_per_connection, uint64_t recv_per_connection)
+  {
+    m_rate_limits.m_send.set_rate(send_global);
+    m_rate_limits.m_recv.set_rate(recv_global);
+    m_rate_limits.m_send_per_connection = send_per_connection;
+    m_rate_limits.m_recv_per_connection = recv_per_connection;
+  }
+  //---------------------------------------------------------------------------------
+  template<class t_protocol_handler>
   bool boosted_tcp_server<t_protocol_handler>::run_server(size_t threads_count, bool wait, const boost::thread::attributes& attrs)
   {
     TRY_ENTRY();
@@ -628,7 +793,7 @@ POP_WARNINGS
     {
       connection_ptr conn(std::move(new_connection_));
 
-      new_connection_.reset(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter));
+      new_connection_.reset(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter, m_rate_limits));
       acceptor_.async_accept(new_connection_->socket(),
         boost::bind(&boosted_tcp_server<t_protocol_handler>::handle_accept, this,
         boost::asio::placeholders::error));
@@ -648,7 +813,7 @@ POP_WARNINGS
   {
     TRY_ENTRY();
 
-    connection_ptr new_connection_l(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter) );
+    connection_ptr new_connection_l(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter, m_rate_limits) );
     boost::asio::ip::tcp::socket&  sock_ = new_connection_l->socket();
     
     //////////////////////////////////////////////////////////////////////////
@@ -722,7 +887,7 @@ POP_WARNINGS
     if (r)
     {
       new_connection_l->get_context(conn_context);
-      //new_connection_l.reset(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter));
+      //new_connection_l.reset(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter, m_rate_limits));
     }
     else
     {
@@ -738,7 +903,7 @@ POP_WARNINGS
   bool boosted_tcp_server<t_protocol_handler>::connect_async(const std::string& adr, const std::string& port, uint32_t conn_timeout, t_callback cb, const std::string& bind_ip)
   {
     TRY_ENTRY();    
-    connection_ptr new_connection_l(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter) );
+    connection_ptr new_connection_l(new connection<t_protocol_handler>(io_service_, m_config, m_sockets_count, m_pfilter, m_rate_limits) );
     boost::asio::ip::tcp::socket&  sock_ = new_connection_l->socket();
     
     //////////////////////////////////////////////////////////////////////////
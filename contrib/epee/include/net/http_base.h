@@ -27,6 +27,8 @@
 
 
 #pragma once
+#include <ostream>
+#include <boost/function.hpp>
 #include <boost/lexical_cast.hpp>
 #include <boost/regex.hpp>
 
@@ -88,6 +90,40 @@ namespace net_utils
 
 
 
+		//checks "Accept-Encoding:" value, like "gzip, deflate;q=0.5, *;q=0"
+		inline
+			bool is_content_encoding_accepted(const std::string& accept_encoding, const std::string& coding)
+		{
+			bool any_accepted = false;
+			std::string::size_type pos = 0;
+			while(pos < accept_encoding.size())
+			{
+				std::string::size_type end = accept_encoding.find(',', pos);
+				if(std::string::npos == end)
+					end = accept_encoding.size();
+				std::string entry = accept_encoding.substr(pos, end - pos);
+				pos = end + 1;
+
+				std::string quality;
+				std::string::size_type params_pos = entry.find(';');
+				if(std::string::npos != params_pos)
+				{
+					quality = entry.substr(params_pos + 1);
+					entry.erase(params_pos);
+					string_tools::trim(quality);
+				}
+				string_tools::trim(entry);
+				//"q=0", "q=0.0", "q=0.000" means "not acceptable"
+				bool accepted = !(quality.size() > 2 && (quality[0] == 'q' || quality[0] == 'Q') && quality[1] == '=' &&
+					std::string::npos == quality.find_first_not_of("0.", 2));
+				if(!string_tools::compare_no_case(entry, coding))
+					return accepted;
+				if(entry == "*")
+					any_accepted = accepted;
+			}
+			return any_accepted;
+		}
+
 		struct http_header_info
 		{
 			std::string m_connection;       //"Connection:"
@@ -98,6 +134,7 @@ namespace net_utils
 			std::string m_content_encoding; //"Content-Encoding:"
 			std::string m_host;             //"Host:"
 			std::string m_cookie;			//"Cookie:"
+			std::string m_accept_encoding;  //"Accept-Encoding:"
 			fields_list m_etc_fields;
 
 			void clear()
@@ -110,6 +147,7 @@ namespace net_utils
 				m_content_encoding.clear();
 				m_host.clear();
 				m_cookie.clear();
+				m_accept_encoding.clear();
 				m_etc_fields.clear();
 			}
 		};
@@ -168,6 +206,7 @@ namespace net_utils
 			std::string			m_response_comment;
 			fields_list	        m_additional_fields;
 			std::string			m_body;
+			boost::function<bool(std::ostream&)> m_body_writer; //if set, body is written by it after header is sent, m_body is ignored
 			std::string			m_mime_tipe;
 			http_header_info    m_header_info;
 			int                 m_http_ver_hi;// OUT paramter only
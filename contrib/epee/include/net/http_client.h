@@ -308,6 +308,11 @@ using namespace std;
 					"Host: "+ m_host_buff +"\r\n" +	"Content-Length: " + boost::lexical_cast<std::string>(body.size()) + "\r\n";
 
 
+#ifdef HTTP_ENABLE_GZIP
+				if(get_value_from_fields_list("Accept-Encoding", additional_params).empty())
+					req_buff += "Accept-Encoding: gzip\r\n";
+#endif
+
 				//handle "additional_params"
 				for(fields_list::const_iterator it = additional_params.begin(); it!=additional_params.end(); it++)
 					req_buff += it->first + ": " + it->second + "\r\n";
@@ -31,9 +31,22 @@
 #define _HTTP_SERVER_H_
 
 #include <string>
+#include <list>
+#include <atomic>
+#include <memory>
+#include <sstream>
+#include <vector>
+#include <boost/function.hpp>
+#include <boost/shared_ptr.hpp>
 #include "net_utils_base.h"
 #include "to_nonconst_iterator.h"
 #include "http_base.h"
+#include "http_request_parser.h"
+
+#define HTTP_DEFAULT_COMPRESSION_THRESHOLD 1024
+#define HTTP_MAX_PENDING_INPUT             (10*1024*1024) //pipelined data buffered while request is handled by worker
+#define HTTP_RESPONSE_CHUNK_SIZE           (64*1024)
+#define HTTP_RESPONSE_MAX_QUEUED_CHUNKS    16 //streamed body generation waits while more chunks are queued for sending
 
 namespace epee
 {
@@ -48,10 +61,91 @@ namespace net_utils
 		/************************************************************************/
 		struct http_server_config
 		{
+			http_server_config():m_compression_threshold(HTTP_DEFAULT_COMPRESSION_THRESHOLD)
+			{}
+
 			std::string m_folder;
+			//responses with bigger body are gzipped if client accepts it, 0 - never
+			size_t m_compression_threshold;
 			critical_section m_lock;
 		};
 
+		enum request_dispatch
+		{
+			request_dispatch_inline,   //handle request right on network thread
+			request_dispatch_queued,   //job will be called from worker thread
+			request_dispatch_rejected  //workers are overloaded, answer "503 Service Unavailable"
+		};
+
+		//dispatched request job, true: handle request and send response, false: answer "503 Service Unavailable"
+		typedef boost::function<void(bool)> request_job;
+
+		/************************************************************************/
+		/* Sends everything written to it as chunks of "chunked" body         */
+		/************************************************************************/
+		class chunked_body_streambuf: public std::streambuf
+		{
+		public:
+			chunked_body_streambuf(i_service_endpoint* psnd_hndlr, size_t chunk_size, size_t max_queued_chunks):
+				m_psnd_hndlr(psnd_hndlr), m_chunk_size(chunk_size), m_max_queued_chunks(max_queued_chunks)
+			{
+				reset_buff();
+			}
+
+		protected:
+			virtual int_type overflow(int_type c)
+			{
+				if(!send_chunk())
+					return traits_type::eof();
+				if(!traits_type::eq_int_type(c, traits_type::eof()))
+				{
+					*pptr() = traits_type::to_char_type(c);
+					pbump(1);
+				}
+				return traits_type::not_eof(c);
+			}
+
+			virtual int sync()
+			{
+				return send_chunk() ? 0 : -1;
+			}
+
+		private:
+			//chunk is built in place as "XXXXXXXX\r\n<data>\r\n" and handed to send queue without copying,
+			//fixed width size line (leading zeros are allowed by RFC 2616) lets it be written in front of the data
+			enum { chunk_head_size = 10 };
+
+			void reset_buff()
+			{
+				m_buff.resize(chunk_head_size + m_chunk_size + 2);
+				char* data = &m_buff[chunk_head_size];
+				setp(data, data + m_chunk_size);
+			}
+
+			bool send_chunk()
+			{
+				size_t len = pptr() - pbase();
+				if(!len)
+					return true;
+				static const char hex_digits[] = "0123456789abcdef";
+				for(size_t i = 0; i != chunk_head_size - 2; ++i)
+					m_buff[chunk_head_size - 3 - i] = hex_digits[(len >> (4 * i)) & 0xf];
+				m_buff[chunk_head_size - 2] = '\r';
+				m_buff[chunk_head_size - 1] = '\n';
+				m_buff.resize(chunk_head_size + len);
+				m_buff += "\r\n";
+				bool res = m_psnd_hndlr->do_send_buffer(m_buff);
+				reset_buff();
+				//body is generated no faster than connection takes it, so only a few chunks are held in memory
+				return res && m_psnd_hndlr->wait_send_que(m_max_queued_chunks);
+			}
+
+			i_service_endpoint* m_psnd_hndlr;
+			size_t m_chunk_size;
+			size_t m_max_queued_chunks;
+			std::string m_buff;
+		};
+
 		/************************************************************************/
 		/*                                                                      */
 		/************************************************************************/
@@ -85,55 +179,54 @@ namespace net_utils
 			}
 			virtual bool handle_recv(const void* ptr, size_t cb);
 			virtual bool handle_request(const http::http_request_info& query_info, http_response_info& response);
+			//lets request be handled off the network thread, job does handle_request() and sends response
+			virtual request_dispatch dispatch_request(const http::http_request_info& query_info, const request_job& job)
+			{
+				return request_dispatch_inline;
+			}
 
 		private:
 			enum machine_state{
-				http_state_retriving_comand_line,
 				http_state_retriving_header,
 				http_state_retriving_body,
+				http_state_waiting_response,
 				http_state_connection_close,
 				http_state_error
 			};
 
-			enum body_transfer_type{
-				http_body_transfer_chunked,
-				http_body_transfer_measure,//mean "Content-Length" valid
-				http_body_transfer_chunked_instead_measure, 
-				http_body_transfer_connection_close,
-				http_body_transfer_multipart,
-				http_body_transfer_undefined
-			};
-
-			bool handle_buff_in(std::string& buf);
+			bool handle_buff_in(const char* ptr, size_t cb);
 
-			bool analize_cached_request_header_and_invoke_state(size_t pos);
+			bool analize_request_header_and_invoke_state();
 
-			bool handle_invoke_query_line();
-			bool parse_cached_header(http_header_info& body_info, const std::string& m_cache_to_process, size_t pos);
-			std::string::size_type match_end_of_header(const std::string& buf);
-			bool get_len_from_content_lenght(const std::string& str, size_t& len);
-			bool handle_retriving_query_body();
-			bool handle_query_measure();
+			bool handle_query_measure(const char*& ptr, const char* end);
 			bool set_ready_state();
+			void set_response_sent_state(bool close_after);
 			bool slash_to_back_slash(std::string& str);
 			std::string get_file_mime_tipe(const std::string& path);
-			std::string get_response_header(const http_response_info& response);
+			std::string get_response_header(const http::http_request_info& query_info, const http_response_info& response, bool& close_after);
+			bool compress_response_body(const http::http_request_info& query_info, http_response_info& response);
 
+			bool process_request();
+			void handle_dispatched_request(const boost::shared_ptr<http::http_request_info>& pquery, const std::shared_ptr<i_service_endpoint>& connection_ref, bool handle);
+			void set_unavailable_response(http_response_info& response);
+			bool send_response(const http::http_request_info& query_info, http_response_info& response, bool& close_after);
+			bool send_chunked_body(http_response_info& response);
 			//major function 
-			inline bool handle_request_and_send_response(const http::http_request_info& query_info);
+			inline bool handle_request_and_send_response(const http::http_request_info& query_info, bool& close_after);
 
 
 			std::string get_not_found_response_body(const std::string& URI);
 
 			std::string m_root_path;
-			std::string m_cache;
 			machine_state m_state;
-			body_transfer_type m_body_transfer_type;
-			bool m_is_stop_handling;
+			http_request_parser m_parser;
 			http::http_request_info m_query_info;
 			size_t m_len_summary, m_len_remain;
 			config_type& m_config;
-			bool m_want_close;
+			std::atomic<bool> m_want_close;
+			//data received while dispatched request is in progress, parsed after response is sent
+			std::string m_pending_in;
+			critical_section m_lock;
 		protected:
 			i_service_endpoint* m_psnd_hndlr; 
 		};
@@ -147,6 +240,20 @@ namespace net_utils
 																						 t_connection_context& m_conn_context) = 0;
 			virtual bool init_server_thread(){return true;}
 			virtual bool deinit_server_thread(){return true;}
+			//handler may run requests on its own worker threads by posting job there
+			virtual request_dispatch dispatch_http_request(const http_request_info& query_info,
+																						 const request_job& job,
+																						 t_connection_context& m_conn_context)
+			{
+				return request_dispatch_inline;
+			}
+			//called once per JSON-RPC batch with names of all batched methods, handler may hold
+			//its locks around run_calls() so the whole batch shares one acquisition
+			virtual void handle_json_rpc_batch(const std::list<std::string>& methods,
+																						 const boost::function<void()>& run_calls)
+			{
+				run_calls();
+			}
 		};
 
 		template<class t_connection_context>
@@ -181,6 +288,12 @@ namespace net_utils
 				return m_config.m_phandler->handle_http_request(query_info, response, m_conn_context);
 			}
 
+			virtual request_dispatch dispatch_request(const http_request_info& query_info, const request_job& job)
+			{
+				CHECK_AND_ASSERT_MES(m_config.m_phandler, request_dispatch_inline, "m_config.m_phandler is NULL!!!!");
+				return m_config.m_phandler->dispatch_http_request(query_info, job, m_conn_context);
+			}
+
 			virtual bool thread_init()
 			{
 				return m_config.m_phandler->init_server_thread();;
@@ -32,9 +32,9 @@
 #include "string_tools.h"
 #include "file_io_utils.h"
 #include "net_parse_helpers.h"
-
-#define HTTP_MAX_URI_LEN		 9000 
-#define HTTP_MAX_HEADER_LEN		 100000
+#ifdef HTTP_ENABLE_GZIP
+#include "gzip_encoding.h"
+#endif
 
 namespace epee
 {
@@ -193,9 +193,7 @@ namespace net_utils
 		//--------------------------------------------------------------------------------------------
 		template<class t_connection_context>
 		simple_http_connection_handler<t_connection_context>::simple_http_connection_handler(i_service_endpoint* psnd_hndlr, config_type& config):
-		m_state(http_state_retriving_comand_line),
-		m_body_transfer_type(http_body_transfer_undefined),
-        m_is_stop_handling(false),
+		m_state(http_state_retriving_header),
 		m_len_summary(0),
 		m_len_remain(0),
 		m_config(config), 
@@ -208,347 +206,300 @@ namespace net_utils
     template<class t_connection_context>
 	bool simple_http_connection_handler<t_connection_context>::set_ready_state()
 	{
-		m_is_stop_handling = false;
-		m_state = http_state_retriving_comand_line;
-		m_body_transfer_type = http_body_transfer_undefined;
+		m_state = http_state_retriving_header;
+		m_parser.reset();
 		m_query_info.clear();
 		m_len_summary = 0;
 		return true;
 	}
 	//--------------------------------------------------------------------------------------------
+  template<class t_connection_context>
+	void simple_http_connection_handler<t_connection_context>::set_response_sent_state(bool close_after)
+	{
+		//called with m_lock held, or from network thread while no dispatched request is in progress
+		if(close_after)
+		{
+			m_state = http_state_connection_close;
+			m_want_close = true;
+		}
+		else
+		{
+			set_ready_state();
+		}
+	}
+	//--------------------------------------------------------------------------------------------
   template<class t_connection_context>
 	bool simple_http_connection_handler<t_connection_context>::handle_recv(const void* ptr, size_t cb)
 	{
-		std::string buf((const char*)ptr, cb);
-		//LOG_PRINT_L0("HTTP_RECV: " << ptr << "\r\n" << buf);
-		//file_io_utils::save_string_to_file(string_tools::get_current_module_folder() + "/" + boost::lexical_cast<std::string>(ptr), std::string((const char*)ptr, cb));
-
-		bool res = handle_buff_in(buf);
+		//LOG_PRINT_L0("HTTP_RECV: " << ptr << "\r\n" << std::string((const char*)ptr, cb));
+		CRITICAL_REGION_LOCAL(m_lock);
+		bool res = handle_buff_in((const char*)ptr, cb);
 		if(m_want_close/*m_state == http_state_connection_close || m_state == http_state_error*/)
 			return false;
 		return res;
 	}
 	//--------------------------------------------------------------------------------------------
   template<class t_connection_context>
-	bool simple_http_connection_handler<t_connection_context>::handle_buff_in(std::string& buf)
+	bool simple_http_connection_handler<t_connection_context>::handle_buff_in(const char* ptr, size_t cb)
 	{
-
-		if(m_cache.size())
-			m_cache += buf;
-		else
-			m_cache.swap(buf);
-
-		m_is_stop_handling = false;
-		while(!m_is_stop_handling)
+		//request head is parsed as it arrives, without caching lines
+		const char* end = ptr + cb;
+		while(true)
 		{
 			switch(m_state)
 			{
-			case http_state_retriving_comand_line:
-				//The HTTP protocol does not place any a priori limit on the length of a URI.  (c)RFC2616
-				//but we forebly restirct it len to HTTP_MAX_URI_LEN to make it more safely
-				if(!m_cache.size())
-					break;
-
-				//check_and_handle_fake_response();
-				if((m_cache[0] == '\r' || m_cache[0] == '\n'))
+			case http_state_retriving_header:
+				switch(m_parser.parse(ptr, end, m_query_info))
 				{
-          //some times it could be that before query line cold be few line breaks
-          //so we have to be calm without panic with assers
-					m_cache.erase(0, 1);
+				case http_request_parser::parse_need_more:
+					return true;
+				case http_request_parser::parse_done:
+					analize_request_header_and_invoke_state();
 					break;
-				}
-
-				if(std::string::npos != m_cache.find('\n', 0))
-					handle_invoke_query_line();
-				else
-				{
-					m_is_stop_handling = true;
-					if(m_cache.size() > HTTP_MAX_URI_LEN)
-					{
-						LOG_ERROR("simple_http_connection_handler::handle_buff_out: Too long URI line");
-						m_state = http_state_error;
-						return false;
-					}
+				default:
+					LOG_ERROR("simple_http_connection_handler::handle_buff_in: Failed to parse request head: " << m_query_info.m_full_request_str);
+					m_state = http_state_error;
+					return false;
 				}
 				break;
-			case http_state_retriving_header:
+			case http_state_retriving_body:
+				if(ptr == end)
+					return true;
+				handle_query_measure(ptr, end);
+				break;
+			case http_state_waiting_response:
+				//keep pipelined requests until response to current one is sent, to keep responses ordered
+				if(m_pending_in.size() + (end - ptr) > HTTP_MAX_PENDING_INPUT)
 				{
-					std::string::size_type pos = match_end_of_header(m_cache);
-					if(std::string::npos == pos)
-					{
-						m_is_stop_handling = true;
-						if(m_cache.size() > HTTP_MAX_HEADER_LEN)
-						{
-							LOG_ERROR("simple_http_connection_handler::handle_buff_in: Too long header area");
-							m_state = http_state_error;
-							return false;
-						}	
-						break;
-					}
-					analize_cached_request_header_and_invoke_state(pos);
-					break;
+					LOG_ERROR("simple_http_connection_handler::handle_buff_in: Too much data pipelined while waiting for response");
+					m_state = http_state_error;
+					return false;
 				}
-			case http_state_retriving_body:
-				return handle_retriving_query_body();
+				m_pending_in.append(ptr, end);
+				return true;
 			case http_state_connection_close:
 				return false;
 			default:
-				LOG_ERROR("simple_http_connection_handler::handle_char_out: Wrong state: " << m_state);
+				LOG_ERROR("simple_http_connection_handler::handle_buff_in: Wrong state: " << m_state);
 				return false;
 			case http_state_error:
-				LOG_ERROR("simple_http_connection_handler::handle_char_out: Error state!!!");
+				LOG_ERROR("simple_http_connection_handler::handle_buff_in: Error state!!!");
 				return false;
 			}
-
-			if(!m_cache.size())
-				m_is_stop_handling = true;
 		}
-
-		return true;
 	}
 	//--------------------------------------------------------------------------------------------
-	inline bool analize_http_method(const boost::smatch& result, http::http_method& method, int& http_ver_major, int& http_ver_minor)
-	{
-		CHECK_AND_ASSERT_MES(result[0].matched, false, "simple_http_connection_handler::analize_http_method() assert failed...");
-		http_ver_major = boost::lexical_cast<int>(result[11]);
-		http_ver_minor = boost::lexical_cast<int>(result[12]);
-		if(result[4].matched)
-			method = http::http_method_get;
-		else if(result[5].matched)
-			method = http::http_method_head;
-		else if(result[6].matched)
-			method = http::http_method_post;
-		else if(result[7].matched)
-			method = http::http_method_put;
-		else 
-			method = http::http_method_etc;
-
-		return true;
-	}
-
-  //--------------------------------------------------------------------------------------------
   template<class t_connection_context>
-	bool simple_http_connection_handler<t_connection_context>::handle_invoke_query_line()
+	bool simple_http_connection_handler<t_connection_context>::analize_request_header_and_invoke_state()
 	{ 
-		LOG_FRAME("simple_http_connection_handler<t_connection_context>::handle_recognize_protocol_out(*)", LOG_LEVEL_3);
-
-		STATIC_REGEXP_EXPR_1(rexp_match_command_line, "^(((OPTIONS)|(GET)|(HEAD)|(POST)|(PUT)|(DELETE)|(TRACE)) (\\S+) HTTP/(\\d+).(\\d+))\r?\n", boost::regex::icase | boost::regex::normal);
-		//											    123         4     5      6      7     8        9        10          11     12    
-		//size_t match_len = 0;
-		boost::smatch result;	
-		if(boost::regex_search(m_cache, result, rexp_match_command_line, boost::match_default) && result[0].matched)
-		{
-			analize_http_method(result, m_query_info.m_http_method, m_query_info.m_http_ver_hi, m_query_info.m_http_ver_hi);
-			m_query_info.m_URI = result[10];
-      parse_uri(m_query_info.m_URI, m_query_info.m_uri_content);
-			m_query_info.m_http_method_str = result[2];
-			m_query_info.m_full_request_str = result[0];
-
-			m_cache.erase(m_cache.begin(),  to_nonsonst_iterator(m_cache, result[0].second));
-
-			m_state = http_state_retriving_header;
-
-			return true;
-		}else
-		{
-			m_state = http_state_error;
-			LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_invoke_query_line(): Failed to match first line: " << m_cache);
-			return false;
-		}
+		LOG_FRAME("simple_http_connection_handler<t_connection_context>::analize_request_header_and_invoke_state(*)", LOG_LEVEL_3);
 
-		return false;
-	}
-	//--------------------------------------------------------------------------------------------
-  template<class t_connection_context>
-	std::string::size_type simple_http_connection_handler<t_connection_context>::match_end_of_header(const std::string& buf)
-	{
-
-    //Here we returning head size, including terminating sequence (\r\n\r\n or \n\n)
-		std::string::size_type res = buf.find("\r\n\r\n");
-		if(std::string::npos != res)
-			return res+4;
-		res = buf.find("\n\n");
-		if(std::string::npos != res)
-			return res+2;
-		return res;
-	}
-	//--------------------------------------------------------------------------------------------
-  template<class t_connection_context>
-	bool simple_http_connection_handler<t_connection_context>::analize_cached_request_header_and_invoke_state(size_t pos)
-	{ 
-		//LOG_PRINT_L4("HTTP HEAD:\r\n" << m_cache.substr(0, pos));
-
-		LOG_FRAME("simple_http_connection_handler<t_connection_context>::analize_cached_request_header_and_invoke_state(*)", LOG_LEVEL_3);
-
-		m_query_info.m_full_request_buf_size = pos;
-    m_query_info.m_request_head.assign(m_cache.begin(), m_cache.begin()+pos); 
-
-		if(!parse_cached_header(m_query_info.m_header_info, m_cache, pos))
-		{
-			LOG_ERROR("simple_http_connection_handler<t_connection_context>::analize_cached_request_header_and_invoke_state(): failed to anilize request header: " << m_cache);
-			m_state = http_state_error;
-		}
-
-		m_cache.erase(0, pos);
-
-		std::string req_command_str = m_query_info.m_full_request_str;
     //if we have POST or PUT command, it is very possible tha we will get body
     //but now, we suppose than we have body only in case of we have "ContentLength" 
 		if(m_query_info.m_header_info.m_content_length.size())
 		{
-			m_state = http_state_retriving_body;
-			m_body_transfer_type = http_body_transfer_measure;
-			if(!get_len_from_content_lenght(m_query_info.m_header_info.m_content_length, m_len_summary))
+			if(!http_request_parser::get_content_length(m_query_info.m_header_info.m_content_length, m_len_summary))
 			{
-				LOG_ERROR("simple_http_connection_handler<t_connection_context>::analize_cached_request_header_and_invoke_state(): Failed to get_len_from_content_lenght();, m_query_info.m_content_length="<<m_query_info.m_header_info.m_content_length);
+				LOG_ERROR("simple_http_connection_handler<t_connection_context>::analize_request_header_and_invoke_state(): Failed to get content length, m_query_info.m_content_length="<<m_query_info.m_header_info.m_content_length);
 				m_state = http_state_error;
 				return false;
 			}
+			m_state = http_state_retriving_body;
+			m_len_remain = m_len_summary;
 			if(0 == m_len_summary)
 			{	//current query finished, next will be next query
-				if(handle_request_and_send_response(m_query_info))
-					set_ready_state();
-				else
-					m_state = http_state_error;
+				process_request();
 			}
-			m_len_remain = m_len_summary;
 		}else
 		{//current query finished, next will be next query
-			handle_request_and_send_response(m_query_info);
-			set_ready_state();
+			process_request();
 		}
 
 		return true;
 	}
 	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
-	bool simple_http_connection_handler<t_connection_context>::handle_retriving_query_body()
+	bool simple_http_connection_handler<t_connection_context>::handle_query_measure(const char*& ptr, const char* end)
 	{
-		switch(m_body_transfer_type)
-		{
-		case http_body_transfer_measure:
-			return handle_query_measure();
-		case http_body_transfer_chunked:
-		case http_body_transfer_connection_close:
-		case http_body_transfer_multipart:
-		case http_body_transfer_undefined:
-		default:
-			LOG_ERROR("simple_http_connection_handler<t_connection_context>::handle_retriving_query_body(): Unexpected m_body_query_type state:" << m_body_transfer_type);
-			m_state = http_state_error;
-			return false;
-		}
+		size_t len = std::min<size_t>(m_len_remain, end - ptr);
+		m_query_info.m_body.append(ptr, len);
+		ptr += len;
+		m_len_remain -= len;
 
+		if(!m_len_remain)
+			process_request();
 		return true;
 	}
 	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
-	bool simple_http_connection_handler<t_connection_context>::handle_query_measure()
+	bool simple_http_connection_handler<t_connection_context>::process_request()
 	{
-
-		if(m_len_remain >= m_cache.size())
-		{
-			m_len_remain -= m_cache.size();
-			m_query_info.m_body += m_cache;
-			m_cache.clear();
-		}else
+		boost::shared_ptr<http::http_request_info> pquery(new http::http_request_info());
+		std::swap(*pquery, m_query_info);
+
+		//connection is kept alive until dispatched job is done or dropped
+		std::shared_ptr<i_service_endpoint> connection_ref;
+		if(m_psnd_hndlr->add_ref())
+			connection_ref.reset(m_psnd_hndlr, [](i_service_endpoint* p){p->release();});
+		if(connection_ref)
 		{
-			m_query_info.m_body.append(m_cache.begin(), m_cache.begin() + m_len_remain);
-			m_cache.erase(0, m_len_remain);
-			m_len_remain = 0;
+			//state is set before dispatching, worker may pick the job up at once and it waits only for m_lock
+			m_state = http_state_waiting_response;
+			request_dispatch dispatch = dispatch_request(*pquery, boost::bind(&simple_http_connection_handler<t_connection_context>::handle_dispatched_request, this, pquery, connection_ref, _1));
+			if(request_dispatch_queued == dispatch)
+				return true;
+			if(request_dispatch_rejected == dispatch)
+			{
+				http_response_info response;
+				set_unavailable_response(response);
+				bool close_after = false;
+				send_response(*pquery, response, close_after);
+				set_response_sent_state(close_after);
+				return true;
+			}
 		}
 
-		if(!m_len_remain)
-		{
-			if(handle_request_and_send_response(m_query_info))
-				set_ready_state();
-			else
-				m_state = http_state_error;
-		}
-		return true;
+		bool close_after = false;
+		bool res = handle_request_and_send_response(*pquery, close_after);
+		if(res)
+			set_response_sent_state(close_after);
+		else
+			m_state = http_state_error;
+		return res;
 	}
-	//--------------------------------------------------------------------------------------------
+	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
-	bool simple_http_connection_handler<t_connection_context>::parse_cached_header(http_header_info& body_info, const std::string& m_cache_to_process, size_t pos)
-	{ 
-		LOG_FRAME("http_stream_filter::parse_cached_header(*)", LOG_LEVEL_3);
-
-		STATIC_REGEXP_EXPR_1(rexp_mach_field, 
-			"\n?((Connection)|(Referer)|(Content-Length)|(Content-Type)|(Transfer-Encoding)|(Content-Encoding)|(Host)|(Cookie)"
-			//  12            3         4                5              6                   7                  8      9    
-			"|([\\w-]+?)) ?: ?((.*?)(\r?\n))[^\t ]",	
-			//10             1112   13 
-			boost::regex::icase | boost::regex::normal);
-
-		boost::smatch		result;
-		std::string::const_iterator it_current_bound = m_cache_to_process.begin();
-		std::string::const_iterator it_end_bound = m_cache_to_process.begin()+pos;
+	void simple_http_connection_handler<t_connection_context>::handle_dispatched_request(const boost::shared_ptr<http::http_request_info>& pquery, const std::shared_ptr<i_service_endpoint>& connection_ref, bool handle)
+	{
+		//called from worker thread, network thread is not waiting for it
+		http_response_info response;
+		bool res = true;
+		if(handle)
+			res = handle_request(*pquery, response);
+		else
+			set_unavailable_response(response);
 
-		body_info.clear();
+		//m_lock is not held while response is sent: streamed body waits for the connection to take it, and
+		//network thread only buffers pipelined input in http_state_waiting_response, it never sends.
+		//connection state is left alone until m_lock is taken below
+		bool close_after = false;
+		if(!send_response(*pquery, response, close_after))
+			res = false;
 
-		//lookup all fields and fill well-known fields
-		while( boost::regex_search( it_current_bound, it_end_bound, result, rexp_mach_field, boost::match_default) && result[0].matched) 
+		CRITICAL_REGION_LOCAL(m_lock);
+		if(!res)
+			m_state = http_state_error;
+		else
+			set_response_sent_state(close_after);
+		if(!res || m_want_close)
 		{
-			const size_t field_val = 12;
-			const size_t field_etc_name = 10;
-
-			int i = 2; //start position = 2
-			if(result[i++].matched)//"Connection"
-				body_info.m_connection = result[field_val];
-			else if(result[i++].matched)//"Referer"
-				body_info.m_referer = result[field_val];
-			else if(result[i++].matched)//"Content-Length"
-				body_info.m_content_length = result[field_val];
-			else if(result[i++].matched)//"Content-Type"
-				body_info.m_content_type = result[field_val];
-			else if(result[i++].matched)//"Transfer-Encoding"
-				body_info.m_transfer_encoding = result[field_val];
-			else if(result[i++].matched)//"Content-Encoding"
-				body_info.m_content_encoding = result[field_val];
-			else if(result[i++].matched)//"Host"
-				body_info.m_host = result[field_val];
-			else if(result[i++].matched)//"Cookie"
-				body_info.m_cookie = result[field_val];
-			else if(result[i++].matched)//e.t.c (HAVE TO BE MATCHED!)
-				body_info.m_etc_fields.push_back(std::pair<std::string, std::string>(result[field_etc_name], result[field_val]));
-			else
-			{
-				LOG_ERROR("simple_http_connection_handler<t_connection_context>::parse_cached_header() not matched last entry in:"<<m_cache_to_process);
-			}
-
-			it_current_bound = result[(int)result.size()-1]. first;
+			m_psnd_hndlr->close();
+			return;
 		}
-		return  true;
+
+		std::string pending_in;
+		pending_in.swap(m_pending_in);
+		if(pending_in.size() && (!handle_buff_in(pending_in.data(), pending_in.size()) || m_want_close))
+			m_psnd_hndlr->close();
 	}
 	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
-	bool simple_http_connection_handler<t_connection_context>::get_len_from_content_lenght(const std::string& str, size_t& OUT len)
+	void simple_http_connection_handler<t_connection_context>::set_unavailable_response(http_response_info& response)
 	{
-		STATIC_REGEXP_EXPR_1(rexp_mach_field, "\\d+", boost::regex::normal);
-		std::string res;
-		boost::smatch result;
-		if(!(boost::regex_search( str, result, rexp_mach_field, boost::match_default) && result[0].matched))
-			return false;
-
-		len = boost::lexical_cast<size_t>(result[0]);
-		return true;
+		response.m_response_code = 503;
+		response.m_response_comment = "Service Unavailable";
+		response.m_mime_tipe = "text/plain";
+		response.m_body.clear();
 	}
 	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
-	bool simple_http_connection_handler<t_connection_context>::handle_request_and_send_response(const http::http_request_info& query_info)
+	bool simple_http_connection_handler<t_connection_context>::handle_request_and_send_response(const http::http_request_info& query_info, bool& close_after)
 	{
 		http_response_info response;
 		bool res = handle_request(query_info, response);
 		//CHECK_AND_ASSERT_MES(res, res, "handle_request(query_info, response) returned false" );
+		if(!send_response(query_info, response, close_after))
+			return false;
+		return res;
+	}
+	//-----------------------------------------------------------------------------------
+  template<class t_connection_context>
+	bool simple_http_connection_handler<t_connection_context>::send_response(const http::http_request_info& query_info, http_response_info& response, bool& close_after)
+	{
+		if(response.m_body_writer && (query_info.m_http_ver_hi < 1 || (query_info.m_http_ver_hi == 1 && query_info.m_http_ver_lo < 1)))
+		{
+			//HTTP/1.0 has no chunked encoding, so body is built in memory as usual
+			std::stringstream body;
+			if(!response.m_body_writer(body))
+			{
+				LOG_ERROR("Failed to write HTTP response body");
+				response.m_response_code = 500;
+				response.m_response_comment = "Internal Server Error";
+			}
+			else
+			{
+				response.m_body = body.str();
+			}
+			response.m_body_writer.clear();
+		}
 
-		std::string response_data = get_response_header(response);
+		compress_response_body(query_info, response);
+
+		std::string response_data = get_response_header(query_info, response, close_after);
 		
 		//LOG_PRINT_L0("HTTP_SEND: << \r\n" << response_data + response.m_body);
     LOG_PRINT_L3("HTTP_RESPONSE_HEAD: << \r\n" << response_data);
 		
 		m_psnd_hndlr->do_send((void*)response_data.data(), response_data.size());
+		if(response.m_body_writer)
+			return send_chunked_body(response);
 		if(response.m_body.size())
 			m_psnd_hndlr->do_send((void*)response.m_body.data(), response.m_body.size());
-		return res;
+		return true;
+	}
+	//-----------------------------------------------------------------------------------
+  template<class t_connection_context>
+	bool simple_http_connection_handler<t_connection_context>::send_chunked_body(http_response_info& response)
+	{
+		//body goes to connection piece by piece while it is generated, it is never held whole
+		chunked_body_streambuf buff(m_psnd_hndlr, HTTP_RESPONSE_CHUNK_SIZE, HTTP_RESPONSE_MAX_QUEUED_CHUNKS);
+		std::ostream body(&buff);
+		bool res = response.m_body_writer(body);
+		body.flush();
+		if(!res || !body.good())
+		{
+			//header is already sent, so the only way to tell client about failure is to break the connection
+			LOG_ERROR("Failed to write chunked HTTP response body, closing connection");
+			return false;
+		}
+		static const char last_chunk[] = "0\r\n\r\n";
+		m_psnd_hndlr->do_send((void*)last_chunk, sizeof(last_chunk) - 1);
+		return true;
+	}
+	//-----------------------------------------------------------------------------------
+  template<class t_connection_context>
+	bool simple_http_connection_handler<t_connection_context>::compress_response_body(const http::http_request_info& query_info, http_response_info& response)
+	{
+#ifdef HTTP_ENABLE_GZIP
+		if(response.m_body_writer || !m_config.m_compression_threshold || response.m_body.size() < m_config.m_compression_threshold)
+			return false;
+		if(!is_content_encoding_accepted(query_info.m_header_info.m_accept_encoding, "gzip"))
+			return false;
+		if(get_value_from_fields_list("Content-Encoding", response.m_additional_fields).size())
+			return false;
+
+		std::string packed_body;
+		if(!gzip_encode(response.m_body, packed_body) || packed_body.size() >= response.m_body.size())
+			return false;
+
+		LOG_PRINT_L3("HTTP response body gzipped: " << response.m_body.size() << " -> " << packed_body.size());
+		response.m_body.swap(packed_body);
+		response.m_additional_fields.push_back(std::make_pair(std::string("Content-Encoding"), std::string("gzip")));
+		response.m_additional_fields.push_back(std::make_pair(std::string("Vary"), std::string("Accept-Encoding")));
+		return true;
+#else
+		return false;
+#endif
 	}
 	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
@@ -583,13 +534,15 @@ namespace net_utils
 	}
 	//-----------------------------------------------------------------------------------
   template<class t_connection_context>
-	std::string simple_http_connection_handler<t_connection_context>::get_response_header(const http_response_info& response)
+	std::string simple_http_connection_handler<t_connection_context>::get_response_header(const http::http_request_info& query_info, const http_response_info& response, bool& close_after)
 	{
 		std::string buf = "HTTP/1.1 ";
 		buf += boost::lexical_cast<std::string>(response.m_response_code) + " " + response.m_response_comment + "\r\n" +
-			"Server: Epee-based\r\n"
-			"Content-Length: ";
-		buf += boost::lexical_cast<std::string>(response.m_body.size()) + "\r\n";
+			"Server: Epee-based\r\n";
+		if(response.m_body_writer)
+			buf += "Transfer-Encoding: chunked\r\n";
+		else
+			buf += "Content-Length: " + boost::lexical_cast<std::string>(response.m_body.size()) + "\r\n";
 		buf += "Content-Type: ";
 		buf += response.m_mime_tipe + "\r\n";
 
@@ -600,15 +553,14 @@ namespace net_utils
 		buf += "Accept-Ranges: bytes\r\n";
 		//Wed, 01 Dec 2010 03:27:41 GMT"
 
-		string_tools::trim(m_query_info.m_header_info.m_connection);
-		if(m_query_info.m_header_info.m_connection.size())
+		std::string connection = string_tools::trim(query_info.m_header_info.m_connection);
+		if(connection.size())
 		{
-			if(!string_tools::compare_no_case("close", m_query_info.m_header_info.m_connection))
+			if(!string_tools::compare_no_case("close", connection))
 			{
         //closing connection after sending
 				buf += "Connection: close\r\n";
-				m_state = http_state_connection_close;
-				m_want_close = true;
+				close_after = true;
 			}
 		}
 		//add additional fields, if it is
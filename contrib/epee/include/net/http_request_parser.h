@@ -0,0 +1,458 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <limits>
+#include "misc_log_ex.h"
+#include "http_base.h"
+#include "net_parse_helpers.h"
+
+#define HTTP_MAX_URI_LEN		 9000 
+#define HTTP_MAX_HEADER_LEN		 100000
+
+namespace epee
+{
+namespace net_utils
+{
+namespace http
+{
+  /************************************************************************/
+  /* Incremental HTTP/1.x request head parser (request line + fields).    */
+  /* Bytes are fed as they come from the socket and every head byte is   */
+  /* copied once into http_request_info::m_request_head. Tokens are read  */
+  /* from the receive buffer, or from the kept head when split between    */
+  /* reads, and then copied into their http_request_info fields.          */
+  /************************************************************************/
+  class http_request_parser
+  {
+  public:
+    enum parse_result
+    {
+      parse_need_more,
+      parse_done,
+      parse_error
+    };
+
+    http_request_parser()
+    {
+      reset();
+    }
+
+    void reset()
+    {
+      m_state = st_start;
+      m_line_len = 0;
+      m_tok = 0;
+      m_tok_end = 0;
+      m_name_begin = 0;
+      m_name_end = 0;
+      m_plast_value = NULL;
+      m_base = 0;
+      m_pchunk = NULL;
+      m_pflushed = NULL;
+      m_phead = NULL;
+    }
+
+    // Consumes bytes of [ptr, end) which belong to request head, ptr is moved past them.
+    // Body bytes (if any) are left untouched for the caller.
+    parse_result parse(const char*& ptr, const char* end, http_request_info& info)
+    {
+      if(m_state == st_done)
+        return parse_done;
+      if(m_state == st_error)
+        return parse_error;
+
+      m_phead = &info.m_request_head;
+      m_base = m_phead->size();
+      m_pchunk = ptr;
+      m_pflushed = ptr;
+
+      const char* p = ptr;
+      parse_result res = parse_need_more;
+      for(; p != end && res == parse_need_more; ++p)
+        res = handle_char(*p, p, info);
+
+      if(res == parse_need_more)
+      {
+        flush(p);
+        size_t limit = m_state <= st_request_line_lf ? HTTP_MAX_URI_LEN : HTTP_MAX_HEADER_LEN;
+        if(m_phead->size() > limit)
+        {
+          LOG_ERROR("http_request_parser: too long " << (m_state <= st_request_line_lf ? "request line" : "header area"));
+          m_state = st_error;
+          res = parse_error;
+        }
+      }else if(res == parse_done)
+      {
+        flush(p);
+        info.m_full_request_buf_size = m_phead->size() - m_line_len;
+        m_phead->erase(0, m_line_len);
+      }
+      ptr = p;
+      return res;
+    }
+
+    static bool get_content_length(const std::string& str, size_t& len)
+    {
+      std::string::const_iterator it = str.begin();
+      while(it != str.end() && (*it == ' ' || *it == '\t'))
+        ++it;
+      if(it == str.end() || *it < '0' || *it > '9')
+        return false;
+      len = 0;
+      for(; it != str.end() && *it >= '0' && *it <= '9'; ++it)
+      {
+        size_t d = *it - '0';
+        if(len > (std::numeric_limits<size_t>::max() - d) / 10)
+          return false;
+        len = len * 10 + d;
+      }
+      for(; it != str.end(); ++it)
+        if(*it != ' ' && *it != '\t')
+          return false;
+      return true;
+    }
+
+  private:
+    enum state
+    {
+      st_start,
+      st_method,
+      st_uri,
+      st_version,
+      st_request_line_lf,
+      st_field_start,
+      st_field_name,
+      st_field_name_ws,
+      st_field_ows,
+      st_field_value,
+      st_field_lf,
+      st_head_lf,
+      st_done,
+      st_error
+    };
+
+    static bool is_tchar(char c)
+    {
+      if((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))
+        return true;
+      switch(c)
+      {
+      case '!': case '#': case '$': case '%': case '&': case '\'': case '*':
+      case '+': case '-': case '.': case '^': case '_': case '`': case '|': case '~':
+        return true;
+      default:
+        return false;
+      }
+    }
+
+    static char lower(char c)
+    {
+      return (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+    }
+
+    static bool equals_no_case(const char* p, size_t len, const char* lit)
+    {
+      for(size_t i = 0; i != len; ++i, ++lit)
+        if(!*lit || lower(p[i]) != lower(*lit))
+          return false;
+      return !*lit;
+    }
+
+    size_t pos(const char* p) const
+    {
+      return m_base + (p - m_pchunk);
+    }
+
+    // copies pending head bytes [m_pflushed, p) into m_request_head
+    void flush(const char* p)
+    {
+      m_phead->append(m_pflushed, p);
+      m_pflushed = p;
+    }
+
+    // returns pointer to token [b, e) (absolute offsets), e is at or before p;
+    // points into the receive buffer if the token starts in it, into the kept head otherwise
+    const char* token(size_t b, const char* p)
+    {
+      if(b >= m_base)
+        return m_pchunk + (b - m_base);
+      flush(p);
+      return m_phead->data() + b;
+    }
+
+    bool parse_version(const char* v, size_t len, int& hi, int& lo)
+    {
+      if(len < 8 || !equals_no_case(v, 5, "http/"))
+        return false;
+      size_t i = 5;
+      hi = 0;
+      lo = 0;
+      size_t digits = 0;
+      for(; i != len && v[i] >= '0' && v[i] <= '9' && digits < 3; ++i, ++digits)
+        hi = hi * 10 + (v[i] - '0');
+      if(!digits || i == len || v[i] != '.')
+        return false;
+      ++i;
+      digits = 0;
+      for(; i != len && v[i] >= '0' && v[i] <= '9' && digits < 3; ++i, ++digits)
+        lo = lo * 10 + (v[i] - '0');
+      return digits && i == len;
+    }
+
+    void set_method(const char* m, size_t len, http_request_info& info)
+    {
+      info.m_http_method_str.assign(m, len);
+      if(equals_no_case(m, len, "GET"))
+        info.m_http_method = http_method_get;
+      else if(equals_no_case(m, len, "POST"))
+        info.m_http_method = http_method_post;
+      else if(equals_no_case(m, len, "HEAD"))
+        info.m_http_method = http_method_head;
+      else if(equals_no_case(m, len, "PUT"))
+        info.m_http_method = http_method_put;
+      else
+        info.m_http_method = http_method_etc;
+    }
+
+    std::string* get_field_value(const char* name, size_t len, http_header_info& hi)
+    {
+      switch(lower(name[0]))
+      {
+      case 'a':
+        if(equals_no_case(name, len, "Accept-Encoding"))
+          return &hi.m_accept_encoding;
+        break;
+      case 'c':
+        if(equals_no_case(name, len, "Content-Length"))
+          return &hi.m_content_length;
+        if(equals_no_case(name, len, "Content-Type"))
+          return &hi.m_content_type;
+        if(equals_no_case(name, len, "Connection"))
+          return &hi.m_connection;
+        if(equals_no_case(name, len, "Content-Encoding"))
+          return &hi.m_content_encoding;
+        if(equals_no_case(name, len, "Cookie"))
+          return &hi.m_cookie;
+        break;
+      case 'h':
+        if(equals_no_case(name, len, "Host"))
+          return &hi.m_host;
+        break;
+      case 'r':
+        if(equals_no_case(name, len, "Referer"))
+          return &hi.m_referer;
+        break;
+      case 't':
+        if(equals_no_case(name, len, "Transfer-Encoding"))
+          return &hi.m_transfer_encoding;
+        break;
+      }
+      hi.m_etc_fields.push_back(std::pair<std::string, std::string>(std::string(name, len), std::string()));
+      return &hi.m_etc_fields.back().second;
+    }
+
+    void on_field_end(const char* p, http_request_info& info)
+    {
+      if(!m_plast_value)
+      {
+        //name and value are taken together, both are in same line
+        const char* name = token(m_name_begin, p);
+        size_t value_offset = m_tok - m_name_begin;
+        m_plast_value = get_field_value(name, m_name_end - m_name_begin, info.m_header_info);
+        if(m_tok_end > m_tok)
+          m_plast_value->assign(token(m_name_begin, p) + value_offset, m_tok_end - m_tok);
+        else
+          m_plast_value->clear();
+      }else if(m_tok_end > m_tok)
+      {
+        //obsolete line folding: continuation is appended to previous field value
+        if(m_plast_value->size())
+          *m_plast_value += ' ';
+        m_plast_value->append(token(m_tok, p), m_tok_end - m_tok);
+      }
+    }
+
+    parse_result handle_char(char c, const char* p, http_request_info& info)
+    {
+      switch(m_state)
+      {
+      case st_start:
+        //some clients put few line breaks before request line
+        if(c == '\r' || c == '\n')
+        {
+          m_pchunk = m_pflushed = p + 1;
+          return parse_need_more;
+        }
+        m_tok = pos(p);
+        m_state = st_method;
+        //fall through
+      case st_method:
+        if(is_tchar(c))
+          return parse_need_more;
+        if(c != ' ' || pos(p) == m_tok)
+          break;
+        set_method(token(m_tok, p), pos(p) - m_tok, info);
+        m_tok = pos(p) + 1;
+        m_state = st_uri;
+        return parse_need_more;
+      case st_uri:
+        if(static_cast<unsigned char>(c) > ' ' && c != 0x7f)
+          return parse_need_more;
+        if(c != ' ' || pos(p) == m_tok)
+          break;
+        info.m_URI.assign(token(m_tok, p), pos(p) - m_tok);
+        m_tok = pos(p) + 1;
+        m_state = st_version;
+        return parse_need_more;
+      case st_version:
+        if(c != '\r' && c != '\n')
+        {
+          if(pos(p) - m_tok > 16)
+            break;
+          return parse_need_more;
+        }
+        if(!parse_version(token(m_tok, p), pos(p) - m_tok, info.m_http_ver_hi, info.m_http_ver_lo))
+          break;
+        if(c == '\r')
+        {
+          m_state = st_request_line_lf;
+          return parse_need_more;
+        }
+        //fall through
+      case st_request_line_lf:
+        if(c != '\n')
+          break;
+        m_line_len = pos(p) + 1;
+        info.m_full_request_str.assign(token(0, p + 1), m_line_len);
+        parse_uri(info.m_URI, info.m_uri_content);
+        m_state = st_field_start;
+        return parse_need_more;
+      case st_field_start:
+        if(c == '\r')
+        {
+          m_state = st_head_lf;
+          return parse_need_more;
+        }
+        if(c == '\n')
+        {
+          m_state = st_done;
+          return parse_done;
+        }
+        if(c == ' ' || c == '\t')
+        {
+          if(!m_plast_value)
+            break;
+          m_state = st_field_ows;
+          return parse_need_more;
+        }
+        if(!is_tchar(c))
+          break;
+        m_plast_value = NULL;
+        m_name_begin = pos(p);
+        m_state = st_field_name;
+        return parse_need_more;
+      case st_field_name:
+        if(is_tchar(c))
+          return parse_need_more;
+        m_name_end = pos(p);
+        if(c == ' ' || c == '\t')
+        {
+          m_state = st_field_name_ws;
+          return parse_need_more;
+        }
+        if(c != ':')
+          break;
+        m_state = st_field_ows;
+        return parse_need_more;
+      case st_field_name_ws:
+        if(c == ' ' || c == '\t')
+          return parse_need_more;
+        if(c != ':')
+          break;
+        m_state = st_field_ows;
+        return parse_need_more;
+      case st_field_ows:
+        if(c == ' ' || c == '\t')
+          return parse_need_more;
+        m_tok = pos(p);
+        m_tok_end = m_tok;
+        m_state = st_field_value;
+        //fall through
+      case st_field_value:
+        if(c == '\r')
+        {
+          m_state = st_field_lf;
+          return parse_need_more;
+        }
+        if(c != '\n')
+        {
+          if(c != ' ' && c != '\t')
+            m_tok_end = pos(p) + 1;
+          return parse_need_more;
+        }
+        //fall through
+      case st_field_lf:
+        if(c != '\n')
+          break;
+        on_field_end(p, info);
+        m_state = st_field_start;
+        return parse_need_more;
+      case st_head_lf:
+        if(c != '\n')
+          break;
+        m_state = st_done;
+        return parse_done;
+      case st_done:
+        return parse_done;
+      case st_error:
+      default:
+        break;
+      }
+      LOG_ERROR("http_request_parser: unexpected character 0x" << std::hex << (int)static_cast<unsigned char>(c) << std::dec << " at position " << pos(p) << " in state " << (int)m_state);
+      m_state = st_error;
+      return parse_error;
+    }
+
+    state m_state;
+    size_t m_line_len;
+    size_t m_tok;
+    size_t m_tok_end;
+    size_t m_name_begin;
+    size_t m_name_end;
+    std::string* m_plast_value;
+    size_t m_base;
+    const char* m_pchunk;
+    const char* m_pflushed;
+    std::string* m_phead;
+  };
+}
+}
+}
@@ -16,20 +16,23 @@ bool handle_rpc_request(const std::string& req_data, \
   bool handled = false; \
   uint64_t ticks = epee::misc_utils::get_tick_count(); \
   epee::serialization::portable_storage ps; \
-  if (!ps.load_from_json(req_data)) \
+  bool is_batch_ = epee::json_rpc::is_batch_request(req_data); \
+  if (!(is_batch_ ? epee::json_rpc::load_batch_request(req_data, ps) : ps.load_from_json(req_data))) \
   { \
     epee::net_utils::jsonrpc2::make_error_resp_json(-32700, "Parse error", resp_data); \
     return true; \
   } \
+  auto handle_jsonrpc2_call = [&](epee::serialization::portable_storage::hsection hcall, std::string& resp_data) -> bool \
+  { \
   epee::serialization::storage_entry id_; \
   id_ = epee::serialization::storage_entry(std::string()); \
-  if (!ps.get_value("id", id_, nullptr)) \
+  if (!ps.get_value("id", id_, hcall)) \
   { \
     epee::net_utils::jsonrpc2::make_error_resp_json(-32600, "Invalid Request", resp_data); \
     return true; \
   } \
   std::string callback_name; \
-  if (!ps.get_value("method", callback_name, nullptr)) \
+  if (!ps.get_value("method", callback_name, hcall)) \
   { \
     epee::net_utils::jsonrpc2::make_error_resp_json(-32600, "Invalid Request", resp_data, id_); \
     return true; \
@@ -42,7 +45,7 @@ bool handle_rpc_request(const std::string& req_data, \
   handled = true; \
   boost::value_initialized<epee::json_rpc::request<command_type::request> > req_; \
   epee::json_rpc::request<command_type::request>& req = static_cast<epee::json_rpc::request<command_type::request>&>(req_);\
-  if(!req.load(ps)) \
+  if(!req.load(ps, hcall)) \
   { \
     epee::net_utils::jsonrpc2::make_error_resp_json(-32602, "Invalid params", resp_data, req.id); \
     return true; \
@@ -81,6 +84,25 @@ bool handle_rpc_request(const std::string& req_data, \
 #define END_JSONRPC2_MAP() \
   epee::net_utils::jsonrpc2::make_error_resp_json(-32601, "Method not found", resp_data, id_); \
   return true; \
+  }; \
+  if (!is_batch_) \
+    return handle_jsonrpc2_call(nullptr, resp_data); \
+  std::list<std::string> batch_methods_; \
+  if (!epee::json_rpc::get_batch_methods(ps, batch_methods_)) \
+  { \
+    epee::net_utils::jsonrpc2::make_error_resp_json(-32600, "Invalid Request", resp_data); \
+    return true; \
+  } \
+  auto handle_batched_call_ = [&](epee::serialization::portable_storage::hsection hcall, std::string& call_resp) -> bool \
+  { \
+    bool r = handle_jsonrpc2_call(hcall, call_resp); \
+    if (!call_resp.empty() && call_resp.back() == '\n') \
+      call_resp.erase(call_resp.size() - 1); \
+    return r; \
+  }; \
+  epee::json_rpc::handle_batch_request(ps, handle_batched_call_, resp_data); \
+  resp_data += "\n"; \
+  return true; \
 }
 
 #endif	/* JSONRPC_SERVER_HANDLERS_MAP_H */
@@ -3,8 +3,13 @@
 
 #include <string>
 #include <cstdint>
+#include <list>
 #include "serialization/keyvalue_serialization.h"
 #include "storages/portable_storage_base.h"
+#include "storages/portable_storage.h"
+#include "storages/portable_storage_template_helper.h"
+
+#define JSON_RPC_MAX_BATCH_SIZE   256
 
 namespace epee 
 {
@@ -90,6 +95,77 @@ namespace epee
     };
 
     typedef response<dummy_result, error> error_response;
+
+    inline std::string& make_error_json(int64_t code, const std::string& message, std::string& response_body,
+                                        const epee::serialization::storage_entry& id = epee::serialization::storage_entry(std::string()))
+    {
+      error_response rsp;
+      rsp.jsonrpc = "2.0";
+      rsp.id = id;
+      rsp.error.code = code;
+      rsp.error.message = message;
+      epee::serialization::store_t_to_json(rsp, response_body);
+      return response_body;
+    }
+    //-----------------------------------------------------------------------------------------------------------
+    //batch is a json array of request objects (JSON-RPC 2.0, section 6)
+    inline bool is_batch_request(const std::string& body)
+    {
+      for(char c: body)
+      {
+        if(c == '[')
+          return true;
+        if(!isspace(static_cast<unsigned char>(c)))
+          return false;
+      }
+      return false;
+    }
+    //-----------------------------------------------------------------------------------------------------------
+    //portable_storage can't hold an array at the root, so batch is loaded as "batch" array of sections
+    inline bool load_batch_request(const std::string& body, epee::serialization::portable_storage& ps)
+    {
+      return ps.load_from_json("{\"batch\":" + body + "}");
+    }
+    //-----------------------------------------------------------------------------------------------------------
+    //collects method names of loaded batch, returns false if batch is empty, too big or has non-object entries
+    inline bool get_batch_methods(epee::serialization::portable_storage& ps, std::list<std::string>& methods)
+    {
+      epee::serialization::portable_storage::hsection hcall = nullptr;
+      epee::serialization::portable_storage::harray hcalls = ps.get_first_section("batch", hcall, nullptr);
+      if(!hcalls)
+        return false;
+      do
+      {
+        if(methods.size() >= JSON_RPC_MAX_BATCH_SIZE)
+          return false;
+        std::string method;
+        ps.get_value("method", method, hcall);
+        methods.push_back(method);
+      } while(ps.get_next_section(hcalls, hcall));
+      return true;
+    }
+    //-----------------------------------------------------------------------------------------------------------
+    //calls handler(hcall, call_response) for every call of loaded batch and joins responses into json array
+    template<class t_handler>
+    bool handle_batch_request(epee::serialization::portable_storage& ps, t_handler& handler, std::string& response_body)
+    {
+      epee::serialization::portable_storage::hsection hcall = nullptr;
+      epee::serialization::portable_storage::harray hcalls = ps.get_first_section("batch", hcall, nullptr);
+      CHECK_AND_ASSERT_MES(hcalls, false, "Batch request is not loaded");
+      response_body = "[";
+      bool first = true;
+      do
+      {
+        std::string call_response;
+        handler(hcall, call_response);
+        if(!first)
+          response_body += ",";
+        response_body += call_response;
+        first = false;
+      } while(ps.get_next_section(hcalls, hcall));
+      response_body += "]";
+      return true;
+    }
   }
 }
 
@@ -71,7 +71,7 @@ public:
   template<class callback_t>
   int invoke_async(int command, const std::string& in_buff, boost::uuids::uuid connection_id, callback_t cb, size_t timeout = LEVIN_DEFAULT_TIMEOUT_PRECONFIGURED);
 
-  int notify(int command, const std::string& in_buff, boost::uuids::uuid connection_id);
+  int notify(int command, const std::string& in_buff, boost::uuids::uuid connection_id, bool bulk = false);
   bool close(boost::uuids::uuid connection_id);
   bool update_connection_context(const t_connection_context& contxt);
   bool request_callback(boost::uuids::uuid connection_id);
@@ -611,7 +611,7 @@ public:
     return m_invoke_result_code;
   }
 
-  int notify(int command, const std::string& in_buff)
+  int notify(int command, const std::string& in_buff, bool bulk = false)
   {
     misc_utils::auto_scope_leave_caller scope_exit_handler = misc_utils::create_scope_leave_handler(
                           boost::bind(&async_protocol_handler::finish_outer_call, this));
@@ -633,16 +633,31 @@ public:
     head.m_protocol_version = LEVIN_PROTOCOL_VER_1;
     head.m_flags = LEVIN_PACKET_REQUEST;
     CRITICAL_REGION_BEGIN(m_send_lock);
-    if(!m_pservice_endpoint->do_send(&head, sizeof(head)))
+    if(bulk)
     {
-      LOG_ERROR_CC(m_connection_context, "Failed to do_send()");
-      return -1;
-    }
-
-    if(!m_pservice_endpoint->do_send(in_buff.data(), (int)in_buff.size()))
+      //bulk packet goes as one piece, so priority data may be queued before it but never inside it
+      std::string buff;
+      buff.reserve(sizeof(head) + in_buff.size());
+      buff.append(reinterpret_cast<const char*>(&head), sizeof(head));
+      buff.append(in_buff);
+      if(!m_pservice_endpoint->do_send_bulk(buff.data(), buff.size()))
+      {
+        LOG_ERROR_CC(m_connection_context, "Failed to do_send_bulk()");
+        return -1;
+      }
+    }else
     {
-      LOG_ERROR("Failed to do_send()");
-      return -1;
+      if(!m_pservice_endpoint->do_send(&head, sizeof(head)))
+      {
+        LOG_ERROR_CC(m_connection_context, "Failed to do_send()");
+        return -1;
+      }
+
+      if(!m_pservice_endpoint->do_send(in_buff.data(), (int)in_buff.size()))
+      {
+        LOG_ERROR("Failed to do_send()");
+        return -1;
+      }
     }
     CRITICAL_REGION_END();
     LOG_PRINT_CC_L4(m_connection_context, "LEVIN_PACKET_SENT. [len=" << head.m_cb << 
@@ -733,11 +748,11 @@ size_t async_protocol_handler_config<t_connection_context>::get_connections_coun
 }
 //------------------------------------------------------------------------------------------
 template<class t_connection_context>
-int async_protocol_handler_config<t_connection_context>::notify(int command, const std::string& in_buff, boost::uuids::uuid connection_id)
+int async_protocol_handler_config<t_connection_context>::notify(int command, const std::string& in_buff, boost::uuids::uuid connection_id, bool bulk)
 {
   async_protocol_handler<t_connection_context>* aph;
   int r = find_and_lock_connection(connection_id, aph);
-  return LEVIN_OK == r ? aph->notify(command, in_buff) : r;
+  return LEVIN_OK == r ? aph->notify(command, in_buff, bulk) : r;
 }
 //------------------------------------------------------------------------------------------
 template<class t_connection_context>
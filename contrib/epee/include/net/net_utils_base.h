@@ -105,6 +105,12 @@ namespace net_utils
 	struct i_service_endpoint
 	{
 		virtual bool do_send(const void* ptr, size_t cb)=0;
+    //low priority data (like historical blocks), may be rate limited and overtaken by do_send data
+    virtual bool do_send_bulk(const void* ptr, size_t cb){return do_send(ptr, cb);}
+    //same as do_send, but takes over buffer contents instead of copying them to send queue
+    virtual bool do_send_buffer(std::string& buff){return do_send(buff.data(), buff.size());}
+    //blocks until no more than max_count packets wait in send queue, false if connection is closed or stuck
+    virtual bool wait_send_que(size_t max_count){return true;}
     virtual bool close()=0;
     virtual bool call_run_once_service_io()=0;
     virtual bool request_callback()=0;
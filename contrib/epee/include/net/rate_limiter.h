@@ -0,0 +1,118 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <limits>
+#include "misc_log_ex.h"
+#include "syncobj.h"
+
+namespace epee
+{
+namespace net_utils
+{
+  /************************************************************************/
+  /* token bucket: rate in bytes per second, 0 means unlimited. Bucket    */
+  /* can go into debt, so packets bigger than burst are still passed and  */
+  /* the debt is paid by delaying following ones.                        */
+  /************************************************************************/
+  class token_bucket
+  {
+  public:
+    token_bucket():m_rate(0), m_burst(0), m_tokens(0), m_last_refill(0)
+    {}
+
+    void set_rate(uint64_t bytes_per_second)
+    {
+      CRITICAL_REGION_LOCAL(m_lock);
+      m_rate = bytes_per_second;
+      m_burst = static_cast<int64_t>(std::min<uint64_t>(bytes_per_second, std::numeric_limits<int64_t>::max()));
+      m_tokens = m_burst;
+      m_last_refill = misc_utils::get_tick_count();
+    }
+
+    uint64_t get_rate()
+    {
+      CRITICAL_REGION_LOCAL(m_lock);
+      return m_rate;
+    }
+
+    //takes cb bytes from bucket, returns milliseconds to wait before they may go to the wire
+    uint64_t consume(size_t cb)
+    {
+      return consume(cb, misc_utils::get_tick_count());
+    }
+
+    uint64_t consume(size_t cb, uint64_t now_ms)
+    {
+      CRITICAL_REGION_LOCAL(m_lock);
+      if(!m_rate)
+        return 0;
+      refill(now_ms);
+      m_tokens -= static_cast<int64_t>(cb);
+      if(m_tokens >= 0)
+        return 0;
+      return static_cast<uint64_t>(-m_tokens) * 1000 / m_rate + 1;
+    }
+
+  private:
+    void refill(uint64_t now_ms)
+    {
+      if(now_ms <= m_last_refill)
+        return;
+      uint64_t added = (now_ms - m_last_refill) * m_rate / 1000;
+      if(!added)
+        return; //keep remainder for next refill, so slow rates are not rounded to zero
+      m_tokens += static_cast<int64_t>(std::min<uint64_t>(added, m_burst - m_tokens));
+      m_last_refill = now_ms;
+    }
+
+    critical_section m_lock;
+    uint64_t m_rate;
+    int64_t m_burst;
+    int64_t m_tokens;
+    uint64_t m_last_refill;
+  };
+
+  /************************************************************************/
+  /* limits shared by all connections of one server                       */
+  /************************************************************************/
+  struct connection_rate_limits
+  {
+    connection_rate_limits():m_send_per_connection(0), m_recv_per_connection(0)
+    {}
+
+    token_bucket m_send;
+    token_bucket m_recv;
+    std::atomic<uint64_t> m_send_per_connection;
+    std::atomic<uint64_t> m_recv_per_connection;
+  };
+}
+}
@@ -0,0 +1,204 @@
+// Copyright (c) 2014, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <deque>
+#include <memory>
+#include <ostream>
+#include <boost/function.hpp>
+#include "misc_log_ex.h"
+#include "portable_storage_to_json.h"
+
+namespace epee
+{
+  namespace serialization
+  {
+    struct json_stream_level
+    {
+      bool   is_array;
+      bool   empty;
+      size_t indent;
+    };
+
+    /************************************************************************/
+    /* Storage with the store side of portable_storage interface that      */
+    /* writes json right away instead of building the tree. KV serialize   */
+    /* maps visit fields depth first, so the output is a plain stack walk: */
+    /* a section or array is closed when its parent gets the next field.   */
+    /* Field order is the one of the serialize map, not sorted.            */
+    /************************************************************************/
+    template<class t_stream>
+    class json_stream_writer
+    {
+    public:
+      typedef json_stream_level* hsection;
+      typedef json_stream_level* harray;
+      typedef storage_entry meta_entry;
+
+      json_stream_writer(t_stream& strm, size_t indent = 0, bool insert_newlines = true)
+        : m_strm(strm), m_newline(insert_newlines ? "\r\n" : ""), m_insert_newlines(insert_newlines)
+      {
+        open_level(false, indent);
+      }
+
+      //closes everything that is still open, stream gets complete json document
+      void finish()
+      {
+        while(m_levels.size())
+          close_level();
+      }
+
+      hsection open_section(const std::string& section_name, hsection hparent_section, bool create_if_notexist = false)
+      {
+        CHECK_AND_ASSERT_MES(create_if_notexist, nullptr, "json_stream_writer is store only");
+        json_stream_level& parent = begin_entry(section_name, hparent_section);
+        return open_level(false, parent.indent + 1);
+      }
+
+      template<class t_value>
+      bool set_value(const std::string& value_name, const t_value& target, hsection hparent_section)
+      {
+        json_stream_level& parent = begin_entry(value_name, hparent_section);
+        dump_as_json(m_strm, target, parent.indent + 1, m_insert_newlines);
+        return true;
+      }
+
+      template<class t_value>
+      harray insert_first_value(const std::string& value_name, const t_value& target, hsection hparent_section)
+      {
+        json_stream_level& parent = begin_entry(value_name, hparent_section);
+        harray harr = open_level(true, parent.indent + 1);
+        harr->empty = false;
+        dump_as_json(m_strm, target, harr->indent, m_insert_newlines);
+        return harr;
+      }
+
+      template<class t_value>
+      bool insert_next_value(harray hval_array, const t_value& target)
+      {
+        CHECK_AND_ASSERT_MES(close_to(hval_array) && hval_array->is_array, false, "insert_next_value: array is already closed");
+        m_strm << ",";
+        dump_as_json(m_strm, target, hval_array->indent, m_insert_newlines);
+        return true;
+      }
+
+      harray insert_first_section(const std::string& section_name, hsection& hinserted_childsection, hsection hparent_section)
+      {
+        json_stream_level& parent = begin_entry(section_name, hparent_section);
+        harray harr = open_level(true, parent.indent + 1);
+        harr->empty = false;
+        hinserted_childsection = open_level(false, harr->indent);
+        return harr;
+      }
+
+      bool insert_next_section(harray hsec_array, hsection& hinserted_childsection)
+      {
+        CHECK_AND_ASSERT_MES(close_to(hsec_array) && hsec_array->is_array, false, "insert_next_section: array is already closed");
+        m_strm << ",";
+        hinserted_childsection = open_level(false, hsec_array->indent);
+        return true;
+      }
+
+    private:
+      hsection open_level(bool is_array, size_t indent)
+      {
+        json_stream_level level = {is_array, true, indent};
+        m_levels.push_back(level);
+        if(is_array)
+          m_strm << "[";
+        else
+          m_strm << "{" << m_newline;
+        return &m_levels.back();
+      }
+
+      void close_level()
+      {
+        json_stream_level& level = m_levels.back();
+        if(level.is_array)
+        {
+          m_strm << "]";
+        }
+        else
+        {
+          if(!level.empty)
+            m_strm << m_newline;
+          m_strm << make_indent(level.indent) << "}";
+        }
+        m_levels.pop_back();
+      }
+
+      //closes levels opened after hlevel, nullptr stands for the root section
+      bool close_to(json_stream_level* hlevel)
+      {
+        if(!hlevel && m_levels.size())
+          hlevel = &m_levels.front();
+        while(m_levels.size() && &m_levels.back() != hlevel)
+          close_level();
+        return m_levels.size() != 0;
+      }
+
+      json_stream_level& begin_entry(const std::string& name, hsection hparent_section)
+      {
+        close_to(hparent_section);
+        CHECK_AND_ASSERT_THROW_MES(m_levels.size() && !m_levels.back().is_array, "json_stream_writer: parent section is already closed");
+        json_stream_level& parent = m_levels.back();
+        if(!parent.empty)
+          m_strm << "," << m_newline;
+        parent.empty = false;
+        m_strm << make_indent(parent.indent + 1) << "\"" << misc_utils::parse::transform_to_escape_sequence(name) << "\"" << ": ";
+        return parent;
+      }
+
+      t_stream& m_strm;
+      std::deque<json_stream_level> m_levels; //deque keeps handles valid while levels are pushed and popped
+      std::string m_newline;
+      bool m_insert_newlines;
+    };
+    //-----------------------------------------------------------------------------------------------------------
+    template<class t_struct, class t_stream>
+    bool store_t_to_json_stream(const t_struct& str_in, t_stream& strm, size_t indent = 0, bool insert_newlines = true)
+    {
+      TRY_ENTRY();
+      json_stream_writer<t_stream> writer(strm, indent, insert_newlines);
+      if(!str_in.store(writer))
+        return false;
+      writer.finish();
+      return true;
+      CATCH_ENTRY("store_t_to_json_stream", false);
+    }
+    //-----------------------------------------------------------------------------------------------------------
+    //moves str_in into the returned writer, so it can be serialized later (i.e. http_response_info::m_body_writer)
+    template<class t_struct>
+    boost::function<bool(std::ostream&)> make_json_stream_writer(t_struct& str_in)
+    {
+      std::shared_ptr<t_struct> pstruct = std::make_shared<t_struct>(std::move(str_in));
+      return [pstruct](std::ostream& strm) { return store_t_to_json_stream(*pstruct, strm); };
+    }
+  }
+}
@@ -87,6 +87,7 @@ namespace epee
       bool		  load_from_json(const std::string& source);
 
     private:
+      storage_arena m_arena;  //must outlive m_root
       section m_root;
       hsection	get_root_section() {return &m_root;}
       storage_entry* find_storage_entry(const std::string& pentry_name, hsection psection);
@@ -119,6 +120,7 @@ namespace epee
     bool portable_storage::load_from_json(const std::string& source)
     {
       TRY_ENTRY();
+      storage_arena_scope scope(m_arena);
       return json::load_from_json(source, *this);
       CATCH_ENTRY("portable_storage::load_from_json", false)
     }
@@ -167,6 +169,7 @@ namespace epee
         return false;
       }
       TRY_ENTRY();
+      storage_arena_scope scope(m_arena);
       throwable_buffer_reader buf_reader(source.data()+sizeof(storage_block_header), source.size()-sizeof(storage_block_header));
       buf_reader.read(m_root);
       return true;//TODO:
@@ -177,6 +180,7 @@ namespace epee
     hsection portable_storage::open_section(const std::string& section_name,  hsection hparent_section, bool create_if_notexist)
     {
       TRY_ENTRY();
+      storage_arena_scope scope(m_arena);
       hparent_section = hparent_section ? hparent_section:&m_root;
       storage_entry* pentry = find_storage_entry(section_name, hparent_section);
       if(!pentry)
@@ -242,6 +246,7 @@ namespace epee
     {
       BOOST_MPL_ASSERT(( boost::mpl::contains<boost::mpl::push_front<storage_entry::types, storage_entry>::type, t_value> )); 
       TRY_ENTRY();
+      storage_arena_scope scope(m_arena);
       if(!hparent_section)
         hparent_section = &m_root;
       storage_entry* pentry = find_storage_entry(value_name, hparent_section);
@@ -362,6 +367,7 @@ namespace epee
     harray portable_storage::insert_first_value(const std::string& value_name, const t_value& target, hsection hparent_section)
     {
       TRY_ENTRY();
+      storage_arena_scope scope(m_arena);
       if(!hparent_section) hparent_section = &m_root;
       storage_entry* pentry = find_storage_entry(value_name, hparent_section);
       if(!pentry)
@@ -387,6 +393,7 @@ namespace epee
     bool portable_storage::insert_next_value(harray hval_array, const t_value& target)
     {
       TRY_ENTRY();
+      storage_arena_scope scope(m_arena);
       CHECK_AND_ASSERT(hval_array, false);
 
       CHECK_AND_ASSERT_MES(hval_array->type() == typeid(array_entry_t<t_value>), 
@@ -440,6 +447,7 @@ namespace epee
     harray portable_storage::insert_first_section(const std::string& sec_name, hsection& hinserted_childsection, hsection hparent_section)
     {
       TRY_ENTRY();
+      storage_arena_scope scope(m_arena);
       if(!hparent_section) hparent_section = &m_root;
       storage_entry* pentry = find_storage_entry(sec_name, hparent_section);
       if(!pentry)
@@ -465,6 +473,7 @@ namespace epee
     bool portable_storage::insert_next_section(harray hsec_array, hsection& hinserted_childsection)
     {
       TRY_ENTRY();
+      storage_arena_scope scope(m_arena);
       CHECK_AND_ASSERT(hsec_array, false);
       CHECK_AND_ASSERT_MES(hsec_array->type() == typeid(array_entry_t<section>), 
         false, "unexpected type(not 'section') in insert_next_section, type: " << hsec_array->type().name());
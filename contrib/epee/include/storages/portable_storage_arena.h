@@ -0,0 +1,195 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <new>
+#include <limits>
+#include <utility>
+
+#if defined(_MSC_VER)
+#define EPEE_STORAGE_THREADV __declspec(thread)
+#else
+#define EPEE_STORAGE_THREADV __thread
+#endif
+
+#ifndef EPEE_STORAGE_ARENA_FIRST_CHUNK
+#define EPEE_STORAGE_ARENA_FIRST_CHUNK    4096
+#endif
+#ifndef EPEE_STORAGE_ARENA_MAX_CHUNK
+#define EPEE_STORAGE_ARENA_MAX_CHUNK      (1024*1024)
+#endif
+
+namespace epee
+{
+  namespace serialization
+  {
+    /************************************************************************/
+    /* Bump allocator owning the nodes of one portable_storage tree.        */
+    /* Memory is only given back when the arena is destroyed.               */
+    /************************************************************************/
+    class storage_arena
+    {
+    public:
+      union block_header
+      {
+        storage_arena* m_owner;  //nullptr for blocks taken from the heap
+        uint64_t m_align_u64;
+        double m_align_double;
+      };
+
+      storage_arena():m_chunks(nullptr), m_pos(nullptr), m_end(nullptr), m_next_chunk_size(EPEE_STORAGE_ARENA_FIRST_CHUNK){}
+      //a copy starts empty, nodes are never shared between arenas
+      storage_arena(const storage_arena&):m_chunks(nullptr), m_pos(nullptr), m_end(nullptr), m_next_chunk_size(EPEE_STORAGE_ARENA_FIRST_CHUNK){}
+      storage_arena& operator=(const storage_arena&){return *this;}
+      ~storage_arena()
+      {
+        while(m_chunks)
+        {
+          chunk* next = m_chunks->m_next;
+          ::operator delete(m_chunks);
+          m_chunks = next;
+        }
+      }
+
+      void* allocate(size_t size)
+      {
+        size = (size + sizeof(block_header) - 1) / sizeof(block_header) * sizeof(block_header);
+        if(size_t(m_end - m_pos) < size)
+          add_chunk(size);
+        void* p = m_pos;
+        m_pos += size;
+        return p;
+      }
+
+      static storage_arena*& current()
+      {
+        static EPEE_STORAGE_THREADV storage_arena* pcurrent = nullptr;
+        return pcurrent;
+      }
+
+    private:
+      struct chunk
+      {
+        chunk* m_next;
+        block_header m_align;
+      };
+
+      void add_chunk(size_t size)
+      {
+        size_t chunk_size = m_next_chunk_size;
+        if(chunk_size < size)
+          chunk_size = size;
+        else if(m_next_chunk_size < EPEE_STORAGE_ARENA_MAX_CHUNK)
+          m_next_chunk_size *= 2;
+        chunk* c = static_cast<chunk*>(::operator new(sizeof(chunk) + chunk_size));
+        c->m_next = m_chunks;
+        m_chunks = c;
+        m_pos = reinterpret_cast<char*>(c + 1);
+        m_end = m_pos + chunk_size;
+      }
+
+      chunk* m_chunks;
+      char* m_pos;
+      char* m_end;
+      size_t m_next_chunk_size;
+    };
+
+    //routes tree allocations made by the current thread to the given arena
+    class storage_arena_scope
+    {
+    public:
+      storage_arena_scope(storage_arena& arena):m_prev(storage_arena::current())
+      {
+        storage_arena::current() = &arena;
+      }
+      ~storage_arena_scope()
+      {
+        storage_arena::current() = m_prev;
+      }
+    private:
+      storage_arena_scope(const storage_arena_scope&);
+      storage_arena_scope& operator=(const storage_arena_scope&);
+      storage_arena* m_prev;
+    };
+
+    /************************************************************************/
+    /* Allocator for the section/array containers. Takes memory from the   */
+    /* arena installed with storage_arena_scope, or from the heap when      */
+    /* there is none. Every block remembers where it came from, so trees    */
+    /* (or parts of them) built outside of a scope are freed normally.      */
+    /************************************************************************/
+    template<class T>
+    struct storage_allocator
+    {
+      typedef T value_type;
+      typedef T* pointer;
+      typedef const T* const_pointer;
+      typedef T& reference;
+      typedef const T& const_reference;
+      typedef size_t size_type;
+      typedef ptrdiff_t difference_type;
+      template<class U> struct rebind { typedef storage_allocator<U> other; };
+
+      storage_allocator(){}
+      template<class U> storage_allocator(const storage_allocator<U>&){}
+
+      pointer address(reference r) const {return &r;}
+      const_pointer address(const_reference r) const {return &r;}
+      size_type max_size() const {return (std::numeric_limits<size_type>::max() - sizeof(storage_arena::block_header)) / sizeof(T);}
+
+      pointer allocate(size_type n, const void* = nullptr)
+      {
+        if(n > max_size())
+          throw std::bad_alloc();
+        size_t size = sizeof(storage_arena::block_header) + n * sizeof(T);
+        storage_arena* arena = storage_arena::current();
+        storage_arena::block_header* h = static_cast<storage_arena::block_header*>(arena ? arena->allocate(size) : ::operator new(size));
+        h->m_owner = arena;
+        return reinterpret_cast<pointer>(h + 1);
+      }
+      void deallocate(pointer p, size_type)
+      {
+        storage_arena::block_header* h = reinterpret_cast<storage_arena::block_header*>(p) - 1;
+        if(!h->m_owner)
+          ::operator delete(h);
+      }
+
+      template<class U, class... Args>
+      void construct(U* p, Args&&... args) {::new((void*)p) U(std::forward<Args>(args)...);}
+      template<class U>
+      void destroy(U* p) {p->~U();}
+    };
+    template<class T, class U>
+    bool operator==(const storage_allocator<T>&, const storage_allocator<U>&) {return true;}
+    template<class T, class U>
+    bool operator!=(const storage_allocator<T>&, const storage_allocator<U>&) {return false;}
+  }
+}
@@ -32,6 +32,8 @@
 #include <boost/any.hpp>
 #include <string>
 #include <list>
+#include <map>
+#include "portable_storage_arena.h"
 
 #define PORTABLE_STORAGE_SIGNATUREA 0x01011101
 #define PORTABLE_STORAGE_SIGNATUREB 0x01020101 // bender's nightmare 
@@ -119,8 +121,9 @@ namespace epee
         return m_array.back();
       }
 
-      std::list<t_entry_type> m_array;
-      mutable typename std::list<t_entry_type>::const_iterator m_it;
+      typedef std::list<t_entry_type, storage_allocator<t_entry_type> > container_type;
+      container_type m_array;
+      mutable typename container_type::const_iterator m_it;
     };
 
 
@@ -150,7 +153,8 @@ namespace epee
     /************************************************************************/
     struct section
     {
-      std::map<std::string, storage_entry> m_entries;
+      typedef std::map<std::string, storage_entry, std::less<std::string>, storage_allocator<std::pair<const std::string, storage_entry> > > container_type;
+      container_type m_entries;
     };
 
     //handle-like aliases
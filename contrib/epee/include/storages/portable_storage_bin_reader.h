@@ -0,0 +1,456 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <cstring>
+
+#include "misc_log_ex.h"
+#include "portable_storage_base.h"
+#include "portable_storage_from_bin.h"
+#include "portable_storage_val_converters.h"
+
+namespace epee
+{
+  namespace serialization
+  {
+    /************************************************************************/
+    /* Reads KV_SERIALIZE maps straight from the binary portable_storage    */
+    /* format. The blob is indexed once into flat entry/section/array       */
+    /* tables that point into the source buffer, values are decoded only    */
+    /* when a field asks for them. The source buffer must outlive the       */
+    /* reader.                                                              */
+    /************************************************************************/
+    class portable_storage_bin_reader
+    {
+    public:
+      struct section_ref
+      {
+        size_t m_first;   //first entry in m_entries
+        size_t m_count;
+      };
+      struct array_ref
+      {
+        const uint8_t* m_data;
+        const uint8_t* m_pos;
+        size_t  m_count;
+        size_t  m_index;
+        size_t  m_first_section;  //first element in m_sections, for arrays of objects
+        uint8_t m_type;
+      };
+      typedef section_ref* hsection;
+      typedef array_ref*   harray;
+      typedef storage_entry meta_entry;
+
+      portable_storage_bin_reader();
+
+      bool       load_from_binary(const binarybuffer& source);
+
+      hsection   open_section(const char* section_name, hsection hparent_section, bool create_if_notexist = false);
+      template<class t_value>
+      bool       get_value(const char* value_name, t_value& val, hsection hparent_section);
+      bool       get_value(const char* value_name, storage_entry& val, hsection hparent_section);
+
+      //serial access for arrays of values --------------------------------------
+      template<class t_value>
+      harray     get_first_value(const char* value_name, t_value& target, hsection hparent_section);
+      template<class t_value>
+      bool       get_next_value(harray hval_array, t_value& target);
+      //sections
+      harray     get_first_section(const char* sec_name, hsection& h_child_section, hsection hparent_section);
+      bool       get_next_section(harray hsec_array, hsection& h_child_section);
+
+    private:
+      struct entry_ref
+      {
+        const char*    m_name;
+        size_t         m_name_len;
+        const uint8_t* m_raw;     //points to the type byte
+        const uint8_t* m_value;
+        const uint8_t* m_end;
+        size_t         m_child;   //index in m_sections or m_arrays
+        uint8_t        m_type;
+      };
+
+      static size_t read_varint(const uint8_t*& p, const uint8_t* end);
+      static void   skip(const uint8_t*& p, const uint8_t* end, size_t count);
+      template<class t_pod_type, class t_value>
+      static void   read_pod(const uint8_t*& p, const uint8_t* end, t_value& target);
+      template<class t_value>
+      static void   assign_string(const uint8_t* p, size_t len, t_value& target){ convert_t(std::string((const char*)p, len), target); }
+      static void   assign_string(const uint8_t* p, size_t len, std::string& target){ target.assign((const char*)p, len); }
+      template<class t_value>
+      static void   read_typed(uint8_t type, const uint8_t*& p, const uint8_t* end, t_value& target);
+
+      void       index_section(size_t sec, const uint8_t*& p, const uint8_t* end, size_t depth);
+      void       index_array(size_t arr, uint8_t type, const uint8_t*& p, const uint8_t* end, size_t depth);
+      entry_ref* find_entry(const char* name, hsection hsec);
+
+      std::vector<entry_ref>   m_entries;
+      std::vector<section_ref> m_sections;
+      std::vector<array_ref>   m_arrays;
+      section_ref              m_empty_section;
+      const uint8_t*           m_end;
+    };
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_reader::portable_storage_bin_reader():m_end(nullptr)
+    {
+      m_empty_section.m_first = 0;
+      m_empty_section.m_count = 0;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    size_t portable_storage_bin_reader::read_varint(const uint8_t*& p, const uint8_t* end)
+    {
+      CHECK_AND_ASSERT_THROW_MES(p < end, "empty buff, expected place for varint");
+      uint64_t v = 0;
+      size_t size = size_t(1) << (*p & PORTABLE_RAW_SIZE_MARK_MASK);
+      CHECK_AND_ASSERT_THROW_MES(size_t(end - p) >= size, "attempt to read varint of " << size << " bytes from buffer with " << (end - p) << " bytes remained");
+      memcpy(&v, p, size);
+      p += size;
+      return static_cast<size_t>(v >> 2);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_reader::skip(const uint8_t*& p, const uint8_t* end, size_t count)
+    {
+      CHECK_AND_ASSERT_THROW_MES(size_t(end - p) >= count, " attempt to read " << count << " bytes from buffer with " << (end - p) << " bytes remained");
+      p += count;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_pod_type, class t_value>
+    void portable_storage_bin_reader::read_pod(const uint8_t*& p, const uint8_t* end, t_value& target)
+    {
+      t_pod_type v;
+      const uint8_t* pv = p;
+      skip(p, end, sizeof(t_pod_type));
+      memcpy(&v, pv, sizeof(t_pod_type));
+      convert_t(v, target);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    void portable_storage_bin_reader::read_typed(uint8_t type, const uint8_t*& p, const uint8_t* end, t_value& target)
+    {
+      switch(type)
+      {
+      case SERIALIZE_TYPE_INT64:  read_pod<int64_t>(p, end, target); break;
+      case SERIALIZE_TYPE_INT32:  read_pod<int32_t>(p, end, target); break;
+      case SERIALIZE_TYPE_INT16:  read_pod<int16_t>(p, end, target); break;
+      case SERIALIZE_TYPE_INT8:   read_pod<int8_t>(p, end, target); break;
+      case SERIALIZE_TYPE_UINT64: read_pod<uint64_t>(p, end, target); break;
+      case SERIALIZE_TYPE_UINT32: read_pod<uint32_t>(p, end, target); break;
+      case SERIALIZE_TYPE_UINT16: read_pod<uint16_t>(p, end, target); break;
+      case SERIALIZE_TYPE_UINT8:  read_pod<uint8_t>(p, end, target); break;
+      case SERIALIZE_TYPE_DUOBLE: read_pod<double>(p, end, target); break;
+      case SERIALIZE_TYPE_BOOL:   read_pod<bool>(p, end, target); break;
+      case SERIALIZE_TYPE_STRING:
+        {
+          size_t len = read_varint(p, end);
+          const uint8_t* ps = p;
+          skip(p, end, len);
+          assign_string(ps, len, target);
+          break;
+        }
+      default:
+        ASSERT_MES_AND_THROW("WRONG DATA CONVERSION: from type code=" << static_cast<uint32_t>(type) << " to type " << typeid(t_value).name());
+      }
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_reader::index_section(size_t sec, const uint8_t*& p, const uint8_t* end, size_t depth)
+    {
+      CHECK_AND_ASSERT_THROW_MES(depth < EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL, "Wrong blob data in portable storage: recursion limitation (" << EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL << ") exceeded");
+      size_t count = read_varint(p, end);
+      //every entry takes at least two bytes, don't let a forged count reserve memory
+      CHECK_AND_ASSERT_THROW_MES(count <= size_t(end - p) / 2, "section entries count " << count << " goes out of remain storage len " << (end - p));
+      size_t first = m_entries.size();
+      m_entries.resize(first + count);
+      m_sections[sec].m_first = first;
+      m_sections[sec].m_count = count;
+      for(size_t i = 0; i != count; ++i)
+      {
+        entry_ref e = AUTO_VAL_INIT(e);
+        CHECK_AND_ASSERT_THROW_MES(p < end, "empty buff, expected place for entry name");
+        e.m_name_len = *p++;
+        e.m_name = (const char*)p;
+        skip(p, end, e.m_name_len);
+        e.m_raw = p;
+        CHECK_AND_ASSERT_THROW_MES(p < end, "empty buff, expected place for entry type");
+        e.m_type = *p++;
+        if(e.m_type == SERIALIZE_TYPE_ARRAY)
+        {
+          CHECK_AND_ASSERT_THROW_MES(p < end, "empty buff, expected place for array type");
+          e.m_type = *p++;
+          CHECK_AND_ASSERT_THROW_MES(e.m_type & SERIALIZE_FLAG_ARRAY, "wrong type sequenses");
+        }
+        e.m_value = p;
+        if(e.m_type & SERIALIZE_FLAG_ARRAY)
+        {
+          e.m_child = m_arrays.size();
+          m_arrays.push_back(array_ref());
+          index_array(e.m_child, e.m_type & ~SERIALIZE_FLAG_ARRAY, p, end, depth + 1);
+        }
+        else switch(e.m_type)
+        {
+        case SERIALIZE_TYPE_INT64:
+        case SERIALIZE_TYPE_UINT64:
+        case SERIALIZE_TYPE_DUOBLE: skip(p, end, 8); break;
+        case SERIALIZE_TYPE_INT32:
+        case SERIALIZE_TYPE_UINT32: skip(p, end, 4); break;
+        case SERIALIZE_TYPE_INT16:
+        case SERIALIZE_TYPE_UINT16: skip(p, end, 2); break;
+        case SERIALIZE_TYPE_INT8:
+        case SERIALIZE_TYPE_UINT8:
+        case SERIALIZE_TYPE_BOOL:   skip(p, end, 1); break;
+        case SERIALIZE_TYPE_STRING:
+          {
+            size_t len = read_varint(p, end);
+            CHECK_AND_ASSERT_THROW_MES(len < MAX_STRING_LEN_POSSIBLE, "to big string len value in storage: " << len);
+            skip(p, end, len);
+            break;
+          }
+        case SERIALIZE_TYPE_OBJECT:
+          e.m_child = m_sections.size();
+          m_sections.push_back(section_ref());
+          index_section(e.m_child, p, end, depth + 1);
+          break;
+        default:
+          ASSERT_MES_AND_THROW("unknown entry_type code = " << static_cast<uint32_t>(e.m_type));
+        }
+        e.m_end = p;
+        m_entries[first + i] = e;
+      }
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_reader::index_array(size_t arr, uint8_t type, const uint8_t*& p, const uint8_t* end, size_t depth)
+    {
+      CHECK_AND_ASSERT_THROW_MES(depth < EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL, "Wrong blob data in portable storage: recursion limitation (" << EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL << ") exceeded");
+      array_ref a = AUTO_VAL_INIT(a);
+      a.m_type = type;
+      a.m_count = read_varint(p, end);
+      a.m_data = p;
+      a.m_pos = p;
+      size_t pod_size = 0;
+      switch(type)
+      {
+      case SERIALIZE_TYPE_INT64:
+      case SERIALIZE_TYPE_UINT64:
+      case SERIALIZE_TYPE_DUOBLE: pod_size = 8; break;
+      case SERIALIZE_TYPE_INT32:
+      case SERIALIZE_TYPE_UINT32: pod_size = 4; break;
+      case SERIALIZE_TYPE_INT16:
+      case SERIALIZE_TYPE_UINT16: pod_size = 2; break;
+      case SERIALIZE_TYPE_INT8:
+      case SERIALIZE_TYPE_UINT8:
+      case SERIALIZE_TYPE_BOOL:   pod_size = 1; break;
+      case SERIALIZE_TYPE_STRING:
+        for(size_t i = 0; i != a.m_count; ++i)
+        {
+          size_t len = read_varint(p, end);
+          CHECK_AND_ASSERT_THROW_MES(len < MAX_STRING_LEN_POSSIBLE, "to big string len value in storage: " << len);
+          skip(p, end, len);
+        }
+        break;
+      case SERIALIZE_TYPE_OBJECT:
+        {
+          CHECK_AND_ASSERT_THROW_MES(a.m_count <= size_t(end - p), "array elements count " << a.m_count << " goes out of remain storage len " << (end - p));
+          a.m_first_section = m_sections.size();
+          m_sections.resize(a.m_first_section + a.m_count);
+          for(size_t i = 0; i != a.m_count; ++i)
+            index_section(a.m_first_section + i, p, end, depth + 1);
+          break;
+        }
+      case SERIALIZE_TYPE_ARRAY:
+        {
+          //KV_SERIALIZE maps have no arrays of arrays, nested ones are only checked and skipped here,
+          //get_value() to storage_entry hands them to the tree parser
+          CHECK_AND_ASSERT_THROW_MES(a.m_count <= size_t(end - p) / 2, "array elements count " << a.m_count << " goes out of remain storage len " << (end - p));
+          for(size_t i = 0; i != a.m_count; ++i)
+          {
+            CHECK_AND_ASSERT_THROW_MES(p < end, "empty buff, expected place for array type");
+            uint8_t nested_type = *p++;
+            CHECK_AND_ASSERT_THROW_MES(nested_type & SERIALIZE_FLAG_ARRAY, "wrong type sequenses");
+            size_t nested = m_arrays.size();
+            m_arrays.push_back(array_ref());
+            index_array(nested, nested_type & ~SERIALIZE_FLAG_ARRAY, p, end, depth + 1);
+          }
+          break;
+        }
+      default:
+        ASSERT_MES_AND_THROW("unsupported array entry_type code = " << static_cast<uint32_t>(type));
+      }
+      if(pod_size)
+      {
+        CHECK_AND_ASSERT_THROW_MES(a.m_count <= size_t(end - p) / pod_size, "array of " << a.m_count << " elements goes out of remain storage len " << (end - p));
+        p += a.m_count * pod_size;
+      }
+      m_arrays[arr] = a;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_bin_reader::load_from_binary(const binarybuffer& source)
+    {
+      m_entries.clear();
+      m_sections.clear();
+      m_arrays.clear();
+      const size_t header_size = sizeof(uint32_t) * 2 + sizeof(uint8_t);
+      if(source.size() < header_size)
+      {
+        LOG_ERROR("portable_storage: wrong binary format, packet size = " << source.size() << " less than expected sizeof(storage_block_header)=" << header_size);
+        return false;
+      }
+      uint32_t signature_a = 0, signature_b = 0;
+      memcpy(&signature_a, source.data(), sizeof(signature_a));
+      memcpy(&signature_b, source.data() + sizeof(signature_a), sizeof(signature_b));
+      uint8_t ver = static_cast<uint8_t>(source[sizeof(signature_a) + sizeof(signature_b)]);
+      if(signature_a != PORTABLE_STORAGE_SIGNATUREA ||
+        signature_b != PORTABLE_STORAGE_SIGNATUREB
+        )
+      {
+        LOG_ERROR("portable_storage: wrong binary format - signature missmatch");
+        return false;
+      }
+      if(ver != PORTABLE_STORAGE_FORMAT_VER)
+      {
+        LOG_ERROR("portable_storage: wrong binary format - unknown format ver = " << ver);
+        return false;
+      }
+      TRY_ENTRY();
+      const uint8_t* p = (const uint8_t*)source.data() + header_size;
+      m_end = (const uint8_t*)source.data() + source.size();
+      m_sections.resize(1);
+      index_section(0, p, m_end, 0);
+      return true;
+      CATCH_ENTRY("portable_storage_bin_reader::load_from_binary", false);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_reader::entry_ref* portable_storage_bin_reader::find_entry(const char* name, hsection hsec)
+    {
+      CHECK_AND_ASSERT(!m_sections.empty(), nullptr);
+      const section_ref& sec = hsec ? *hsec : m_sections.front();
+      size_t len = strlen(name);
+      //names are unique in well-formed blobs, the first one wins otherwise (same as std::map::insert)
+      for(size_t i = sec.m_first; i != sec.m_first + sec.m_count; ++i)
+      {
+        entry_ref& e = m_entries[i];
+        if(e.m_name_len == len && !memcmp(e.m_name, name, len))
+          return &e;
+      }
+      return nullptr;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_reader::hsection portable_storage_bin_reader::open_section(const char* section_name, hsection hparent_section, bool create_if_notexist)
+    {
+      entry_ref* pentry = find_entry(section_name, hparent_section);
+      if(pentry && pentry->m_type == SERIALIZE_TYPE_OBJECT)
+        return &m_sections[pentry->m_child];
+      //portable_storage would create an empty section here
+      return create_if_notexist ? &m_empty_section : nullptr;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    bool portable_storage_bin_reader::get_value(const char* value_name, t_value& val, hsection hparent_section)
+    {
+      BOOST_MPL_ASSERT(( boost::mpl::contains<storage_entry::types, t_value> ));
+      entry_ref* pentry = find_entry(value_name, hparent_section);
+      if(!pentry)
+        return false;
+      const uint8_t* p = pentry->m_value;
+      read_typed(pentry->m_type, p, pentry->m_end, val);
+      return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_bin_reader::get_value(const char* value_name, storage_entry& val, hsection hparent_section)
+    {
+      entry_ref* pentry = find_entry(value_name, hparent_section);
+      if(!pentry)
+        return false;
+      throwable_buffer_reader buf_reader(pentry->m_raw, pentry->m_end - pentry->m_raw);
+      val = buf_reader.load_storage_entry();
+      return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    portable_storage_bin_reader::harray portable_storage_bin_reader::get_first_value(const char* value_name, t_value& target, hsection hparent_section)
+    {
+      BOOST_MPL_ASSERT(( boost::mpl::contains<storage_entry::types, t_value> ));
+      entry_ref* pentry = find_entry(value_name, hparent_section);
+      if(!pentry || !(pentry->m_type & SERIALIZE_FLAG_ARRAY))
+        return nullptr;
+      array_ref& arr = m_arrays[pentry->m_child];
+      arr.m_pos = arr.m_data;
+      arr.m_index = 0;
+      if(!get_next_value(&arr, target))
+        return nullptr;
+      return &arr;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    bool portable_storage_bin_reader::get_next_value(harray hval_array, t_value& target)
+    {
+      BOOST_MPL_ASSERT(( boost::mpl::contains<storage_entry::types, t_value> ));
+      CHECK_AND_ASSERT(hval_array, false);
+      if(hval_array->m_index >= hval_array->m_count)
+        return false;
+      read_typed(hval_array->m_type, hval_array->m_pos, m_end, target);
+      ++hval_array->m_index;
+      return true;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_reader::harray portable_storage_bin_reader::get_first_section(const char* sec_name, hsection& h_child_section, hsection hparent_section)
+    {
+      entry_ref* pentry = find_entry(sec_name, hparent_section);
+      if(!pentry || pentry->m_type != (SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY))
+        return nullptr;
+      array_ref& arr = m_arrays[pentry->m_child];
+      if(!arr.m_count)
+        return nullptr;
+      h_child_section = &m_sections[arr.m_first_section];
+      arr.m_index = 1;
+      return &arr;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_bin_reader::get_next_section(harray hsec_array, hsection& h_child_section)
+    {
+      CHECK_AND_ASSERT(hsec_array, false);
+      if(hsec_array->m_type != SERIALIZE_TYPE_OBJECT || hsec_array->m_index >= hsec_array->m_count)
+        return false;
+      h_child_section = &m_sections[hsec_array->m_first_section + hsec_array->m_index++];
+      return true;
+    }
+  }
+}
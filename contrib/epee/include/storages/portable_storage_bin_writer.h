@@ -0,0 +1,364 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+#include <limits>
+
+#include "misc_language.h"
+#include "misc_log_ex.h"
+#include "portable_storage_base.h"
+#include "portable_storage_to_bin.h"
+#include "portable_storage_from_bin.h"
+
+namespace epee
+{
+  namespace serialization
+  {
+    template<class t_value> struct bin_type_code;
+    template<> struct bin_type_code<uint64_t>    { static const uint8_t value = SERIALIZE_TYPE_UINT64; };
+    template<> struct bin_type_code<uint32_t>    { static const uint8_t value = SERIALIZE_TYPE_UINT32; };
+    template<> struct bin_type_code<uint16_t>    { static const uint8_t value = SERIALIZE_TYPE_UINT16; };
+    template<> struct bin_type_code<uint8_t>     { static const uint8_t value = SERIALIZE_TYPE_UINT8; };
+    template<> struct bin_type_code<int64_t>     { static const uint8_t value = SERIALIZE_TYPE_INT64; };
+    template<> struct bin_type_code<int32_t>     { static const uint8_t value = SERIALIZE_TYPE_INT32; };
+    template<> struct bin_type_code<int16_t>     { static const uint8_t value = SERIALIZE_TYPE_INT16; };
+    template<> struct bin_type_code<int8_t>      { static const uint8_t value = SERIALIZE_TYPE_INT8; };
+    template<> struct bin_type_code<double>      { static const uint8_t value = SERIALIZE_TYPE_DUOBLE; };
+    template<> struct bin_type_code<bool>        { static const uint8_t value = SERIALIZE_TYPE_BOOL; };
+    template<> struct bin_type_code<std::string> { static const uint8_t value = SERIALIZE_TYPE_STRING; };
+
+    /************************************************************************/
+    /* Writes KV_SERIALIZE maps straight into the binary portable_storage   */
+    /* format, without building the section/storage_entry tree first.      */
+    /* Output is byte-identical to portable_storage::store_to_binary():     */
+    /* entries of every section are emitted sorted by name, as std::map     */
+    /* would order them.                                                    */
+    /************************************************************************/
+    class portable_storage_bin_writer
+    {
+    public:
+      struct frame
+      {
+        size_t  m_start;        //offset of the element count in m_buff
+        size_t  m_count;
+        size_t  m_names_begin;  //first entry of this section in m_names
+        uint8_t m_type;         //element type for arrays
+        bool    m_is_array;
+        bool    m_sorted;
+      };
+      typedef frame* hsection;
+      typedef frame* harray;
+      typedef storage_entry meta_entry;
+
+      portable_storage_bin_writer();
+
+      hsection   open_section(const char* section_name, hsection hparent_section, bool create_if_notexist = true);
+      template<class t_value>
+      bool       set_value(const char* value_name, const t_value& v, hsection hparent_section);
+      bool       set_value(const char* value_name, const storage_entry& v, hsection hparent_section);
+
+      //serial access for arrays of values --------------------------------------
+      template<class t_value>
+      harray     insert_first_value(const char* value_name, const t_value& v, hsection hparent_section);
+      template<class t_value>
+      bool       insert_next_value(harray hval_array, const t_value& v);
+      //sections
+      harray     insert_first_section(const char* sec_name, hsection& hinserted_childsection, hsection hparent_section);
+      bool       insert_next_section(harray hsec_array, hsection& hinserted_childsection);
+      //------------------------------------------------------------------------
+      bool       store_to_binary(binarybuffer& target);
+
+    private:
+      struct string_stream
+      {
+        std::string& m_buff;
+        string_stream(std::string& buff):m_buff(buff){}
+        void write(const char* p, size_t count){m_buff.append(p, count);}
+      };
+      struct varint_stream
+      {
+        char   m_buff[sizeof(uint64_t)];
+        size_t m_size;
+        varint_stream():m_size(0){}
+        void write(const char* p, size_t count){memcpy(m_buff + m_size, p, count); m_size += count;}
+      };
+
+      void      close_to(frame* f);
+      frame&    push_frame(bool is_array, uint8_t type);
+      void      finalize(frame& f);
+      void      sort_entries(frame& f);
+      void      begin_entry(frame& sec, const char* name);
+      frame&    get_section(hsection hsec);
+      int       compare_names(const std::string& buff, size_t a, size_t b) const;
+
+      template<class t_pod_type>
+      void      write_value(const t_pod_type& v){ m_buff.append((const char*)&v, sizeof(t_pod_type)); }
+      void      write_value(const std::string& v){ string_stream ss(m_buff); put_string(ss, v); }
+
+      std::string m_buff;
+      std::string m_scratch;
+      std::vector<frame> m_frames;
+      std::vector<size_t> m_names;
+      std::vector<std::pair<size_t, size_t> > m_order;
+    };
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_writer::portable_storage_bin_writer()
+    {
+      //frames are addressed by pointer, so the stack must never reallocate
+      m_frames.reserve(EPEE_PORTABLE_STORAGE_RECURSION_LIMIT_INTERNAL);
+      uint32_t signature_a = PORTABLE_STORAGE_SIGNATUREA;
+      uint32_t signature_b = PORTABLE_STORAGE_SIGNATUREB;
+      uint8_t ver = PORTABLE_STORAGE_FORMAT_VER;
+      write_value(signature_a);
+      write_value(signature_b);
+      write_value(ver);
+      push_frame(false, SERIALIZE_TYPE_OBJECT);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_writer::frame& portable_storage_bin_writer::push_frame(bool is_array, uint8_t type)
+    {
+      CHECK_AND_ASSERT_THROW_MES(m_frames.size() < m_frames.capacity(), "portable_storage_bin_writer: recursion limitation (" << m_frames.capacity() << ") exceeded");
+      frame f = AUTO_VAL_INIT(f);
+      f.m_start = m_buff.size();
+      f.m_names_begin = m_names.size();
+      f.m_type = type;
+      f.m_is_array = is_array;
+      f.m_sorted = true;
+      //one byte is enough for counts up to 63, finalize() widens it if needed
+      m_buff.push_back(0);
+      m_frames.push_back(f);
+      return m_frames.back();
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_writer::close_to(frame* f)
+    {
+      CHECK_AND_ASSERT_THROW_MES(!m_frames.empty() && f >= &m_frames.front() && f <= &m_frames.back(), "portable_storage_bin_writer: handle refers to already closed section or array");
+      while(&m_frames.back() != f)
+      {
+        finalize(m_frames.back());
+        m_frames.pop_back();
+      }
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_writer::frame& portable_storage_bin_writer::get_section(hsection hsec)
+    {
+      frame* f = hsec ? hsec : &m_frames.front();
+      close_to(f);
+      CHECK_AND_ASSERT_THROW_MES(!f->m_is_array, "portable_storage_bin_writer: array handle used as section");
+      return *f;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    int portable_storage_bin_writer::compare_names(const std::string& buff, size_t a, size_t b) const
+    {
+      size_t len_a = static_cast<uint8_t>(buff[a]);
+      size_t len_b = static_cast<uint8_t>(buff[b]);
+      int r = memcmp(buff.data() + a + 1, buff.data() + b + 1, std::min(len_a, len_b));
+      if(r)
+        return r;
+      return len_a < len_b ? -1 : (len_a > len_b ? 1 : 0);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_writer::begin_entry(frame& sec, const char* name)
+    {
+      size_t len = strlen(name);
+      CHECK_AND_ASSERT_THROW_MES(len < std::numeric_limits<uint8_t>::max(), "storage_entry_name is too long: " << len << ", val: " << name);
+      size_t entry_start = m_buff.size();
+      m_buff.push_back(static_cast<char>(len));
+      m_buff.append(name, len);
+      if(m_names.size() > sec.m_names_begin)
+      {
+        int r = compare_names(m_buff, m_names.back(), entry_start);
+        if(!r)
+        {
+          m_buff.resize(entry_start);
+          ASSERT_MES_AND_THROW("portable_storage_bin_writer: duplicate entry name " << name);
+        }
+        if(r > 0)
+          sec.m_sorted = false;
+      }
+      m_names.push_back(entry_start);
+      ++sec.m_count;
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_writer::sort_entries(frame& f)
+    {
+      //entries are contiguous: each one ends where the next begins
+      size_t region_begin = f.m_start + 1;
+      size_t region_size = m_buff.size() - region_begin;
+      m_scratch.assign(m_buff, region_begin, region_size);
+      m_order.clear();
+      for(size_t i = f.m_names_begin; i != m_names.size(); ++i)
+      {
+        size_t end = i + 1 != m_names.size() ? m_names[i + 1] : m_buff.size();
+        m_order.push_back(std::make_pair(m_names[i] - region_begin, end - region_begin));
+      }
+      const std::string& scratch = m_scratch;
+      std::sort(m_order.begin(), m_order.end(), [&](const std::pair<size_t, size_t>& a, const std::pair<size_t, size_t>& b)
+      {
+        return compare_names(scratch, a.first, b.first) < 0;
+      });
+      //begin_entry() only sees the previous name, duplicates that weren't written one after another meet here
+      for(size_t i = 1; i < m_order.size(); ++i)
+      {
+        if(!compare_names(scratch, m_order[i - 1].first, m_order[i].first))
+          ASSERT_MES_AND_THROW("portable_storage_bin_writer: duplicate entry name " << std::string(scratch.data() + m_order[i].first + 1, static_cast<uint8_t>(scratch[m_order[i].first])));
+      }
+      size_t pos = region_begin;
+      for(const std::pair<size_t, size_t>& e: m_order)
+      {
+        memcpy(&m_buff[pos], m_scratch.data() + e.first, e.second - e.first);
+        pos += e.second - e.first;
+      }
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    void portable_storage_bin_writer::finalize(frame& f)
+    {
+      if(!f.m_is_array && !f.m_sorted)
+        sort_entries(f);
+      m_names.resize(f.m_names_begin);
+
+      varint_stream vs;
+      pack_varint(vs, f.m_count);
+      m_buff[f.m_start] = vs.m_buff[0];
+      if(vs.m_size > 1)
+        m_buff.insert(f.m_start + 1, vs.m_buff + 1, vs.m_size - 1);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_writer::hsection portable_storage_bin_writer::open_section(const char* section_name, hsection hparent_section, bool create_if_notexist)
+    {
+      TRY_ENTRY();
+      begin_entry(get_section(hparent_section), section_name);
+      m_buff.push_back(SERIALIZE_TYPE_OBJECT);
+      return &push_frame(false, SERIALIZE_TYPE_OBJECT);
+      CATCH_ENTRY("portable_storage_bin_writer::open_section", nullptr);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    bool portable_storage_bin_writer::set_value(const char* value_name, const t_value& v, hsection hparent_section)
+    {
+      TRY_ENTRY();
+      begin_entry(get_section(hparent_section), value_name);
+      m_buff.push_back(bin_type_code<t_value>::value);
+      write_value(v);
+      return true;
+      CATCH_ENTRY("portable_storage_bin_writer::template<>set_value", false);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_bin_writer::set_value(const char* value_name, const storage_entry& v, hsection hparent_section)
+    {
+      TRY_ENTRY();
+      begin_entry(get_section(hparent_section), value_name);
+      string_stream ss(m_buff);
+      return pack_entry_to_buff(ss, v);
+      CATCH_ENTRY("portable_storage_bin_writer::set_value", false);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    portable_storage_bin_writer::harray portable_storage_bin_writer::insert_first_value(const char* value_name, const t_value& v, hsection hparent_section)
+    {
+      TRY_ENTRY();
+      begin_entry(get_section(hparent_section), value_name);
+      m_buff.push_back(bin_type_code<t_value>::value | SERIALIZE_FLAG_ARRAY);
+      frame& arr = push_frame(true, bin_type_code<t_value>::value);
+      write_value(v);
+      arr.m_count = 1;
+      return &arr;
+      CATCH_ENTRY("portable_storage_bin_writer::insert_first_value", nullptr);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    template<class t_value>
+    bool portable_storage_bin_writer::insert_next_value(harray hval_array, const t_value& v)
+    {
+      TRY_ENTRY();
+      CHECK_AND_ASSERT(hval_array, false);
+      close_to(hval_array);
+      CHECK_AND_ASSERT_MES(hval_array->m_is_array && hval_array->m_type == bin_type_code<t_value>::value,
+        false, "unexpected type in insert_next_value: " << typeid(t_value).name());
+      write_value(v);
+      ++hval_array->m_count;
+      return true;
+      CATCH_ENTRY("portable_storage_bin_writer::insert_next_value", false);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    portable_storage_bin_writer::harray portable_storage_bin_writer::insert_first_section(const char* sec_name, hsection& hinserted_childsection, hsection hparent_section)
+    {
+      TRY_ENTRY();
+      begin_entry(get_section(hparent_section), sec_name);
+      m_buff.push_back(SERIALIZE_TYPE_OBJECT | SERIALIZE_FLAG_ARRAY);
+      frame& arr = push_frame(true, SERIALIZE_TYPE_OBJECT);
+      arr.m_count = 1;
+      hinserted_childsection = &push_frame(false, SERIALIZE_TYPE_OBJECT);
+      return &arr;
+      CATCH_ENTRY("portable_storage_bin_writer::insert_first_section", nullptr);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_bin_writer::insert_next_section(harray hsec_array, hsection& hinserted_childsection)
+    {
+      TRY_ENTRY();
+      CHECK_AND_ASSERT(hsec_array, false);
+      close_to(hsec_array);
+      CHECK_AND_ASSERT_MES(hsec_array->m_is_array && hsec_array->m_type == SERIALIZE_TYPE_OBJECT,
+        false, "unexpected type(not 'section') in insert_next_section");
+      ++hsec_array->m_count;
+      hinserted_childsection = &push_frame(false, SERIALIZE_TYPE_OBJECT);
+      return true;
+      CATCH_ENTRY("portable_storage_bin_writer::insert_next_section", false);
+    }
+    //---------------------------------------------------------------------------------------------------------------
+    inline
+    bool portable_storage_bin_writer::store_to_binary(binarybuffer& target)
+    {
+      TRY_ENTRY();
+      CHECK_AND_ASSERT_MES(!m_frames.empty(), false, "portable_storage_bin_writer: already stored");
+      close_to(&m_frames.front());
+      finalize(m_frames.front());
+      m_frames.clear();
+      target.swap(m_buff);
+      m_buff.clear();
+      return true;
+      CATCH_ENTRY("portable_storage_bin_writer::store_to_binary", false);
+    }
+  }
+}
@@ -137,7 +137,25 @@ namespace epee
       //TODO: add some optimization here later
       while(size--)
         sa.m_array.push_back(read<type_name>());        
-      return storage_entry(array_entry(sa));
+      return storage_entry(array_entry(std::move(sa)));
+    }
+
+    template<>
+    inline storage_entry throwable_buffer_reader::read_ae<array_entry>()
+    {
+      RECURSION_LIMITATION();
+      //unlike pod elements, every nested array starts with its own type
+      array_entry_t<array_entry> sa;
+      size_t size = read_varint();
+      while(size--)
+      {
+        uint8_t ent_type = 0;
+        read(ent_type);
+        CHECK_AND_ASSERT_THROW_MES(ent_type&SERIALIZE_FLAG_ARRAY, "wrong type sequenses");
+        storage_entry se = load_storage_array_entry(ent_type);
+        sa.m_array.push_back(boost::get<array_entry>(se));
+      }
+      return storage_entry(array_entry(std::move(sa)));
     }
 
     inline 
@@ -196,7 +196,7 @@ namespace epee
     template<class t_stream>
     bool pack_entry_to_buff(t_stream& strm, const section& sec)
     {
-      typedef std::map<std::string, storage_entry>::value_type section_pair;
+      typedef section::container_type::value_type section_pair;
       pack_varint(strm, sec.m_entries.size());
       for(const section_pair& se: sec.m_entries)
       {
@@ -0,0 +1,226 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <list>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+#include <condition_variable>
+#include <mutex>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include "misc_log_ex.h"
+
+namespace epee
+{
+  /************************************************************************/
+  /* Fixed set of bounded task queues, each one served by its own threads */
+  /* so slow tasks posted to one queue can't delay tasks of another.      */
+  /* Tasks carry a key (like method name); number of tasks with the same  */
+  /* key running at once may be limited, tasks over the limit wait while  */
+  /* other tasks of the queue are taken.                                  */
+  /************************************************************************/
+  class worker_queues
+  {
+  public:
+    typedef boost::function<void()> task_t;
+    static const size_t invalid_queue = static_cast<size_t>(-1);
+
+    worker_queues():m_stop(false), m_started(false)
+    {}
+
+    ~worker_queues()
+    {
+      stop();
+    }
+
+    //max_pending - tasks waiting in queue above which post() fails, 0 - unbounded; returns queue id,
+    //or invalid_queue if workers are started already
+    size_t add_queue(const std::string& name, size_t threads_count, size_t max_pending)
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      CHECK_AND_ASSERT_MES(!m_started, invalid_queue, "worker_queues: can't add queue \"" << name << "\" after start");
+      m_queues.push_back(std::unique_ptr<queue>(new queue()));
+      queue& q = *m_queues.back();
+      q.name = name;
+      q.threads_count = threads_count ? threads_count : 1;
+      q.max_pending = max_pending;
+      return m_queues.size() - 1;
+    }
+
+    void set_concurrency_limit(const std::string& key, size_t limit)
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      m_keys[key].limit = limit;
+    }
+
+    bool start()
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      CHECK_AND_ASSERT_MES(!m_started, false, "worker_queues already started");
+      m_stop = false;
+      for(auto& q: m_queues)
+      {
+        queue* pq = q.get();
+        for(size_t i = 0; i != pq->threads_count; i++)
+          m_threads.create_thread([this, pq](){worker_loop(*pq);});
+      }
+      m_started = true;
+      return true;
+    }
+
+    //waits for running tasks, pending ones are dropped
+    void stop()
+    {
+      {
+        std::unique_lock<std::mutex> lock(m_lock);
+        if(!m_started)
+          return;
+        m_stop = true;
+        for(auto& q: m_queues)
+          q->cv.notify_all();
+      }
+      m_threads.join_all();
+
+      std::list<task_entry> dropped;
+      std::unique_lock<std::mutex> lock(m_lock);
+      for(auto& q: m_queues)
+        dropped.splice(dropped.end(), q->tasks);
+      m_started = false;
+      lock.unlock();
+      //tasks may hold resources released in destructors, let it happen outside of lock
+      dropped.clear();
+    }
+
+    bool post(size_t queue_id, const std::string& key, const task_t& task)
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      CHECK_AND_ASSERT_MES(queue_id < m_queues.size(), false, "worker_queues: wrong queue id " << queue_id);
+      if(m_stop || !m_started)
+        return false;
+      queue& q = *m_queues[queue_id];
+      if(q.max_pending && q.tasks.size() >= q.max_pending)
+      {
+        LOG_PRINT_L1("worker queue \"" << q.name << "\" is full (" << q.tasks.size() << " tasks), rejecting " << key);
+        return false;
+      }
+      q.tasks.push_back(task_entry());
+      q.tasks.back().task = task;
+      auto it = m_keys.find(key);
+      q.tasks.back().pkey = it != m_keys.end() ? &it->second : nullptr;
+      q.cv.notify_one();
+      return true;
+    }
+
+    size_t get_pending_count(size_t queue_id)
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      CHECK_AND_ASSERT_MES(queue_id < m_queues.size(), 0, "worker_queues: wrong queue id " << queue_id);
+      return m_queues[queue_id]->tasks.size();
+    }
+
+  private:
+    struct key_state
+    {
+      key_state():limit(0), running(0)
+      {}
+      size_t limit; //0 - unlimited
+      size_t running;
+    };
+
+    struct task_entry
+    {
+      task_t task;
+      key_state* pkey;
+    };
+
+    struct queue
+    {
+      std::string name;
+      size_t threads_count;
+      size_t max_pending;
+      std::list<task_entry> tasks;
+      std::condition_variable cv;
+    };
+
+    void worker_loop(queue& q)
+    {
+      std::unique_lock<std::mutex> lock(m_lock);
+      while(!m_stop)
+      {
+        auto it = q.tasks.begin();
+        for(; it != q.tasks.end(); ++it)
+          if(!it->pkey || !it->pkey->limit || it->pkey->running < it->pkey->limit)
+            break;
+        if(it == q.tasks.end())
+        {
+          q.cv.wait(lock);
+          continue;
+        }
+
+        task_entry entry = *it;
+        q.tasks.erase(it);
+        if(entry.pkey)
+          ++entry.pkey->running;
+        lock.unlock();
+        try
+        {
+          entry.task();
+        }
+        catch(const std::exception& e)
+        {
+          LOG_ERROR("worker queue \"" << q.name << "\": task threw exception: " << e.what());
+        }
+        catch(...)
+        {
+          LOG_ERROR("worker queue \"" << q.name << "\": task threw unknown exception");
+        }
+        entry.task.clear();
+        lock.lock();
+        if(entry.pkey)
+        {
+          --entry.pkey->running;
+          //a task held back by this key may wait in any queue
+          if(entry.pkey->limit)
+            for(auto& other: m_queues)
+              other->cv.notify_all();
+        }
+      }
+    }
+
+    std::mutex m_lock;
+    std::vector<std::unique_ptr<queue> > m_queues;
+    std::map<std::string, key_state> m_keys;
+    boost::thread_group m_threads;
+    bool m_stop;
+    bool m_started;
+  };
+}
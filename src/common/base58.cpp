@@ -30,6 +30,7 @@
 
 #include "base58.h"
 
+#include <algorithm>
 #include <assert.h>
 #include <string>
 #include <vector>
@@ -51,6 +52,7 @@ namespace tools
       const size_t full_block_size = sizeof(encoded_block_sizes) / sizeof(encoded_block_sizes[0]) - 1;
       const size_t full_encoded_block_size = encoded_block_sizes[full_block_size];
       const size_t addr_checksum_size = 4;
+      const size_t max_varint_size = 10; // uint64_t
 
       struct reverse_alphabet
       {
@@ -182,61 +184,78 @@ namespace tools
       }
     }
 
-    std::string encode(const std::string& data)
+    size_t encoded_size(size_t size)
     {
-      if (data.empty())
-        return std::string();
+      return size / full_block_size * full_encoded_block_size + encoded_block_sizes[size % full_block_size];
+    }
 
-      size_t full_block_count = data.size() / full_block_size;
-      size_t last_block_size = data.size() % full_block_size;
-      size_t res_size = full_block_count * full_encoded_block_size + encoded_block_sizes[last_block_size];
+    bool decoded_size(size_t enc_size, size_t& size)
+    {
+      int last_block_decoded_size = decoded_block_sizes::instance(enc_size % full_encoded_block_size);
+      if (last_block_decoded_size < 0)
+        return false; // Invalid enc length
+      size = enc_size / full_encoded_block_size * full_block_size + last_block_decoded_size;
+      return true;
+    }
+
+    void encode(const char* data, size_t size, char* enc)
+    {
+      size_t full_block_count = size / full_block_size;
+      size_t last_block_size = size % full_block_size;
 
-      std::string res(res_size, alphabet[0]);
+      // encode_block leaves leading zero digits untouched
+      std::fill(enc, enc + encoded_size(size), alphabet[0]);
       for (size_t i = 0; i < full_block_count; ++i)
       {
-        encode_block(data.data() + i * full_block_size, full_block_size, &res[i * full_encoded_block_size]);
+        encode_block(data + i * full_block_size, full_block_size, enc + i * full_encoded_block_size);
       }
 
       if (0 < last_block_size)
       {
-        encode_block(data.data() + full_block_count * full_block_size, last_block_size, &res[full_block_count * full_encoded_block_size]);
+        encode_block(data + full_block_count * full_block_size, last_block_size, enc + full_block_count * full_encoded_block_size);
       }
-
-      return res;
     }
 
-    bool decode(const std::string& enc, std::string& data)
+    bool decode(const char* enc, size_t enc_size, char* data)
     {
-      if (enc.empty())
-      {
-        data.clear();
-        return true;
-      }
-
-      size_t full_block_count = enc.size() / full_encoded_block_size;
-      size_t last_block_size = enc.size() % full_encoded_block_size;
-      int last_block_decoded_size = decoded_block_sizes::instance(last_block_size);
-      if (last_block_decoded_size < 0)
+      size_t full_block_count = enc_size / full_encoded_block_size;
+      size_t last_block_size = enc_size % full_encoded_block_size;
+      if (decoded_block_sizes::instance(last_block_size) < 0)
         return false; // Invalid enc length
-      size_t data_size = full_block_count * full_block_size + last_block_decoded_size;
 
-      data.resize(data_size, 0);
       for (size_t i = 0; i < full_block_count; ++i)
       {
-        if (!decode_block(enc.data() + i * full_encoded_block_size, full_encoded_block_size, &data[i * full_block_size]))
+        if (!decode_block(enc + i * full_encoded_block_size, full_encoded_block_size, data + i * full_block_size))
           return false;
       }
 
       if (0 < last_block_size)
       {
-        if (!decode_block(enc.data() + full_block_count * full_encoded_block_size, last_block_size,
-          &data[full_block_count * full_block_size]))
+        if (!decode_block(enc + full_block_count * full_encoded_block_size, last_block_size, data + full_block_count * full_block_size))
           return false;
       }
 
       return true;
     }
 
+    std::string encode(const std::string& data)
+    {
+      std::string res(encoded_size(data.size()), alphabet[0]);
+      if (!data.empty())
+        encode(data.data(), data.size(), &res[0]);
+      return res;
+    }
+
+    bool decode(const std::string& enc, std::string& data)
+    {
+      size_t data_size;
+      if (!decoded_size(enc.size(), data_size))
+        return false;
+
+      data.resize(data_size, 0);
+      return enc.empty() || decode(enc.data(), enc.size(), &data[0]);
+    }
+
     std::string encode_addr(uint64_t tag, const std::string& data)
     {
       std::string buf = get_varint_data(tag);
@@ -268,5 +287,24 @@ namespace tools
       data = addr_data.substr(read);
       return true;
     }
+
+    bool decode_addr(const char* addr, size_t addr_size, uint64_t& tag, char* data, size_t data_size)
+    {
+      char addr_data[max_varint_size + max_addr_data_size + addr_checksum_size];
+      size_t addr_data_size;
+      if (max_addr_data_size < data_size || !decoded_size(addr_size, addr_data_size)) return false;
+      if (addr_data_size <= data_size + addr_checksum_size || sizeof(addr_data) < addr_data_size) return false;
+      if (!decode(addr, addr_size, addr_data)) return false;
+
+      addr_data_size -= addr_checksum_size;
+      crypto::hash hash = crypto::cn_fast_hash(addr_data, addr_data_size);
+      if (0 != memcmp(&hash, addr_data + addr_data_size, addr_checksum_size)) return false;
+
+      int read = tools::read_varint(addr_data + 0, addr_data + addr_data_size, tag);
+      if (read <= 0 || addr_data_size - read != data_size) return false;
+
+      memcpy(data, addr_data + read, data_size);
+      return true;
+    }
   }
 }
@@ -42,5 +42,18 @@ namespace tools
 
     std::string encode_addr(uint64_t tag, const std::string& data);
     bool decode_addr(std::string addr, uint64_t& tag, std::string& data);
+
+    // Versions writing to caller provided buffers, they don't allocate
+    const size_t max_addr_data_size = 128;
+
+    size_t encoded_size(size_t size);
+    // false if enc_size isn't a possible length of an encoded string
+    bool decoded_size(size_t enc_size, size_t& size);
+    // enc gets encoded_size(size) chars, not zero terminated
+    void encode(const char* data, size_t size, char* enc);
+    // data gets decoded_size(enc_size) bytes
+    bool decode(const char* enc, size_t enc_size, char* data);
+    // fails unless the address carries exactly data_size bytes, data_size is at most max_addr_data_size
+    bool decode_addr(const char* addr, size_t addr_size, uint64_t& tag, char* data, size_t data_size);
   }
 }
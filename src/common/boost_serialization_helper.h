@@ -33,6 +33,9 @@
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 
+#include "chacha_streambuf.h"
+#include "crypto/crypto.h"
+
 
 namespace tools
 {
@@ -107,4 +110,53 @@ namespace tools
     return !data_file.fail();
     CATCH_ENTRY_L0("unserialize_obj_from_file", false);
   }
+
+  //file is the random iv followed by the chacha8 encrypted archive, it is encrypted while
+  //being written, without a plain text copy of the whole archive in memory
+  template<class t_object>
+  bool serialize_obj_to_crypted_file(t_object& obj, const std::string& file_path, const crypto::chacha8_key& key)
+  {
+    TRY_ENTRY();
+    std::ofstream data_file;
+    data_file.open(file_path , std::ios_base::binary | std::ios_base::out| std::ios::trunc);
+    if (data_file.fail())
+      return false;
+
+    crypto::chacha8_iv iv = crypto::rand<crypto::chacha8_iv>();
+    data_file.write(reinterpret_cast<const char*>(&iv), sizeof(iv));
+    if (data_file.fail())
+      return false;
+
+    chacha_ostreambuf crypted_buf(*data_file.rdbuf(), key, iv);
+    std::ostream crypted_file(&crypted_buf);
+    {
+      boost::archive::binary_oarchive a(crypted_file);
+      a << obj;
+    }
+    crypted_file.flush();
+    return !crypted_file.fail() && !data_file.fail();
+    CATCH_ENTRY_L0("serialize_obj_to_crypted_file", false);
+  }
+
+  template<class t_object>
+  bool unserialize_obj_from_crypted_file(t_object& obj, const std::string& file_path, const crypto::chacha8_key& key)
+  {
+    TRY_ENTRY();
+    std::ifstream data_file;
+    data_file.open(file_path, std::ios_base::binary | std::ios_base::in);
+    if(data_file.fail())
+      return false;
+
+    crypto::chacha8_iv iv;
+    data_file.read(reinterpret_cast<char*>(&iv), sizeof(iv));
+    if(data_file.fail())
+      return false;
+
+    chacha_istreambuf crypted_buf(*data_file.rdbuf(), key, iv);
+    std::istream crypted_file(&crypted_buf);
+    boost::archive::binary_iarchive a(crypted_file);
+    a >> obj;
+    return !crypted_file.fail();
+    CATCH_ENTRY_L0("unserialize_obj_from_crypted_file", false);
+  }
 }
@@ -0,0 +1,126 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <algorithm>
+#include <streambuf>
+#include <vector>
+
+#include "crypto/chacha8.h"
+
+namespace tools
+{
+  /************************************************************************/
+  /* Stream buffers that chacha en/decrypt data on its way to or from an  */
+  /* underlying streambuf (usually the one of a file stream), one buffer  */
+  /* at a time, so the whole plain text is never held in memory.          */
+  /************************************************************************/
+  class chacha_ostreambuf: public std::streambuf
+  {
+  public:
+    chacha_ostreambuf(std::streambuf& sink, const crypto::chacha8_key& key, const crypto::chacha8_iv& iv, unsigned rounds = CHACHA8_ROUNDS, size_t buffer_size = 64 * 1024)
+      : m_sink(sink), m_buff(buffer_size)
+    {
+      crypto::chacha_init(m_ctx, key, iv, rounds);
+      setp(m_buff.data(), m_buff.data() + m_buff.size());
+    }
+
+    virtual ~chacha_ostreambuf()
+    {
+      flush_buffer();
+      crypto::chacha_wipe(&m_ctx);
+    }
+
+  protected:
+    virtual int_type overflow(int_type c)
+    {
+      if(!flush_buffer())
+        return traits_type::eof();
+      if(!traits_type::eq_int_type(c, traits_type::eof()))
+      {
+        *pptr() = traits_type::to_char_type(c);
+        pbump(1);
+      }
+      return traits_type::not_eof(c);
+    }
+
+    virtual int sync()
+    {
+      return flush_buffer() && m_sink.pubsync() == 0 ? 0 : -1;
+    }
+
+  private:
+    bool flush_buffer()
+    {
+      std::streamsize len = pptr() - pbase();
+      if(!len)
+        return true;
+      crypto::chacha_crypt(&m_ctx, pbase(), len, pbase());
+      setp(m_buff.data(), m_buff.data() + m_buff.size());
+      return m_sink.sputn(m_buff.data(), len) == len;
+    }
+
+    std::streambuf& m_sink;
+    crypto::chacha_ctx m_ctx;
+    std::vector<char> m_buff;
+  };
+
+  class chacha_istreambuf: public std::streambuf
+  {
+  public:
+    chacha_istreambuf(std::streambuf& source, const crypto::chacha8_key& key, const crypto::chacha8_iv& iv, unsigned rounds = CHACHA8_ROUNDS, size_t buffer_size = 64 * 1024)
+      : m_source(source), m_buff(buffer_size)
+    {
+      crypto::chacha_init(m_ctx, key, iv, rounds);
+      setg(m_buff.data(), m_buff.data(), m_buff.data());
+    }
+
+    virtual ~chacha_istreambuf()
+    {
+      std::fill(m_buff.begin(), m_buff.end(), 0);
+      crypto::chacha_wipe(&m_ctx);
+    }
+
+  protected:
+    virtual int_type underflow()
+    {
+      std::streamsize len = m_source.sgetn(m_buff.data(), m_buff.size());
+      if(len <= 0)
+        return traits_type::eof();
+      crypto::chacha_crypt(&m_ctx, m_buff.data(), len, m_buff.data());
+      setg(m_buff.data(), m_buff.data(), m_buff.data() + len);
+      return traits_type::to_int_type(*gptr());
+    }
+
+  private:
+    std::streambuf& m_source;
+    crypto::chacha_ctx m_ctx;
+    std::vector<char> m_buff;
+  };
+}
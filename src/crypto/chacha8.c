@@ -12,6 +12,13 @@ Public domain.
 #include "common/int-util.h"
 #include "warnings.h"
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 /*
  * The following macros are used to obtain exact-width results.
  */
@@ -40,131 +47,354 @@ static const char sigma[] = "expand 32-byte k";
 
 DISABLE_GCC_AND_CLANG_WARNING(strict-aliasing)
 
-void chacha8(const void* data, size_t length, const uint8_t* key, const uint8_t* iv, char* cipher) {
+// The block counter is the 64 bit word pair input[12] (low), input[13] (high).
+// All block functions below are free of secret dependent branches and lookups,
+// they only differ in how many blocks are computed side by side.
+
+static void chacha_counter(const uint32_t* input, uint32_t i, uint32_t* lo, uint32_t* hi) {
+  *lo = input[12] + i;
+  *hi = input[13] + (*lo < input[12]);
+}
+
+static void chacha_advance(uint32_t* input, uint32_t blocks) {
+  uint32_t lo, hi;
+  chacha_counter(input, blocks, &lo, &hi);
+  input[12] = lo;
+  input[13] = hi;
+  /* stopping at 2^70 bytes per iv is user's responsibility */
+}
+
+// xors one block of keystream into in (or writes the bare keystream when in is NULL)
+static void chacha_block(uint32_t* input, const uint8_t* in, uint8_t* out, unsigned rounds) {
   uint32_t x0, x1, x2, x3, x4, x5, x6, x7, x8, x9, x10, x11, x12, x13, x14, x15;
-  uint32_t j0, j1, j2, j3, j4, j5, j6, j7, j8, j9, j10, j11, j12, j13, j14, j15;
-  char* ctarget = 0;
-  char tmp[64];
-  int i;
+  unsigned i;
 
-  if (!length) return;
+  x0  = input[0];
+  x1  = input[1];
+  x2  = input[2];
+  x3  = input[3];
+  x4  = input[4];
+  x5  = input[5];
+  x6  = input[6];
+  x7  = input[7];
+  x8  = input[8];
+  x9  = input[9];
+  x10 = input[10];
+  x11 = input[11];
+  x12 = input[12];
+  x13 = input[13];
+  x14 = input[14];
+  x15 = input[15];
+  for (i = rounds;i > 0;i -= 2) {
+    QUARTERROUND( x0, x4, x8,x12)
+    QUARTERROUND( x1, x5, x9,x13)
+    QUARTERROUND( x2, x6,x10,x14)
+    QUARTERROUND( x3, x7,x11,x15)
+    QUARTERROUND( x0, x5,x10,x15)
+    QUARTERROUND( x1, x6,x11,x12)
+    QUARTERROUND( x2, x7, x8,x13)
+    QUARTERROUND( x3, x4, x9,x14)
+  }
+  x0  = PLUS( x0, input[0]);
+  x1  = PLUS( x1, input[1]);
+  x2  = PLUS( x2, input[2]);
+  x3  = PLUS( x3, input[3]);
+  x4  = PLUS( x4, input[4]);
+  x5  = PLUS( x5, input[5]);
+  x6  = PLUS( x6, input[6]);
+  x7  = PLUS( x7, input[7]);
+  x8  = PLUS( x8, input[8]);
+  x9  = PLUS( x9, input[9]);
+  x10 = PLUS(x10,input[10]);
+  x11 = PLUS(x11,input[11]);
+  x12 = PLUS(x12,input[12]);
+  x13 = PLUS(x13,input[13]);
+  x14 = PLUS(x14,input[14]);
+  x15 = PLUS(x15,input[15]);
 
-  j0  = U8TO32_LITTLE(sigma + 0);
-  j1  = U8TO32_LITTLE(sigma + 4);
-  j2  = U8TO32_LITTLE(sigma + 8);
-  j3  = U8TO32_LITTLE(sigma + 12);
-  j4  = U8TO32_LITTLE(key + 0);
-  j5  = U8TO32_LITTLE(key + 4);
-  j6  = U8TO32_LITTLE(key + 8);
-  j7  = U8TO32_LITTLE(key + 12);
-  j8  = U8TO32_LITTLE(key + 16);
-  j9  = U8TO32_LITTLE(key + 20);
-  j10 = U8TO32_LITTLE(key + 24);
-  j11 = U8TO32_LITTLE(key + 28);
-  j12 = 0;
-  j13 = 0;
-  j14 = U8TO32_LITTLE(iv + 0);
-  j15 = U8TO32_LITTLE(iv + 4);
-
-  for (;;) {
-    if (length < 64) {
-      memcpy(tmp, data, length);
-      data = tmp;
-      ctarget = cipher;
-      cipher = tmp;
-    }
-    x0  = j0;
-    x1  = j1;
-    x2  = j2;
-    x3  = j3;
-    x4  = j4;
-    x5  = j5;
-    x6  = j6;
-    x7  = j7;
-    x8  = j8;
-    x9  = j9;
-    x10 = j10;
-    x11 = j11;
-    x12 = j12;
-    x13 = j13;
-    x14 = j14;
-    x15 = j15;
-    for (i = 8;i > 0;i -= 2) {
-      QUARTERROUND( x0, x4, x8,x12)
-      QUARTERROUND( x1, x5, x9,x13)
-      QUARTERROUND( x2, x6,x10,x14)
-      QUARTERROUND( x3, x7,x11,x15)
-      QUARTERROUND( x0, x5,x10,x15)
-      QUARTERROUND( x1, x6,x11,x12)
-      QUARTERROUND( x2, x7, x8,x13)
-      QUARTERROUND( x3, x4, x9,x14)
-    }
-    x0  = PLUS( x0, j0);
-    x1  = PLUS( x1, j1);
-    x2  = PLUS( x2, j2);
-    x3  = PLUS( x3, j3);
-    x4  = PLUS( x4, j4);
-    x5  = PLUS( x5, j5);
-    x6  = PLUS( x6, j6);
-    x7  = PLUS( x7, j7);
-    x8  = PLUS( x8, j8);
-    x9  = PLUS( x9, j9);
-    x10 = PLUS(x10,j10);
-    x11 = PLUS(x11,j11);
-    x12 = PLUS(x12,j12);
-    x13 = PLUS(x13,j13);
-    x14 = PLUS(x14,j14);
-    x15 = PLUS(x15,j15);
-
-    x0  = XOR( x0,U8TO32_LITTLE((uint8_t*)data +  0));
-    x1  = XOR( x1,U8TO32_LITTLE((uint8_t*)data +  4));
-    x2  = XOR( x2,U8TO32_LITTLE((uint8_t*)data +  8));
-    x3  = XOR( x3,U8TO32_LITTLE((uint8_t*)data + 12));
-    x4  = XOR( x4,U8TO32_LITTLE((uint8_t*)data + 16));
-    x5  = XOR( x5,U8TO32_LITTLE((uint8_t*)data + 20));
-    x6  = XOR( x6,U8TO32_LITTLE((uint8_t*)data + 24));
-    x7  = XOR( x7,U8TO32_LITTLE((uint8_t*)data + 28));
-    x8  = XOR( x8,U8TO32_LITTLE((uint8_t*)data + 32));
-    x9  = XOR( x9,U8TO32_LITTLE((uint8_t*)data + 36));
-    x10 = XOR(x10,U8TO32_LITTLE((uint8_t*)data + 40));
-    x11 = XOR(x11,U8TO32_LITTLE((uint8_t*)data + 44));
-    x12 = XOR(x12,U8TO32_LITTLE((uint8_t*)data + 48));
-    x13 = XOR(x13,U8TO32_LITTLE((uint8_t*)data + 52));
-    x14 = XOR(x14,U8TO32_LITTLE((uint8_t*)data + 56));
-    x15 = XOR(x15,U8TO32_LITTLE((uint8_t*)data + 60));
-
-    j12 = PLUSONE(j12);
-    if (!j12)
-    {
-      j13 = PLUSONE(j13);
-      /* stopping at 2^70 bytes per iv is user's responsibility */
+  if (in) {
+    x0  = XOR( x0,U8TO32_LITTLE(in +  0));
+    x1  = XOR( x1,U8TO32_LITTLE(in +  4));
+    x2  = XOR( x2,U8TO32_LITTLE(in +  8));
+    x3  = XOR( x3,U8TO32_LITTLE(in + 12));
+    x4  = XOR( x4,U8TO32_LITTLE(in + 16));
+    x5  = XOR( x5,U8TO32_LITTLE(in + 20));
+    x6  = XOR( x6,U8TO32_LITTLE(in + 24));
+    x7  = XOR( x7,U8TO32_LITTLE(in + 28));
+    x8  = XOR( x8,U8TO32_LITTLE(in + 32));
+    x9  = XOR( x9,U8TO32_LITTLE(in + 36));
+    x10 = XOR(x10,U8TO32_LITTLE(in + 40));
+    x11 = XOR(x11,U8TO32_LITTLE(in + 44));
+    x12 = XOR(x12,U8TO32_LITTLE(in + 48));
+    x13 = XOR(x13,U8TO32_LITTLE(in + 52));
+    x14 = XOR(x14,U8TO32_LITTLE(in + 56));
+    x15 = XOR(x15,U8TO32_LITTLE(in + 60));
+  }
+
+  chacha_advance(input, 1);
+
+  U32TO8_LITTLE(out +  0,x0);
+  U32TO8_LITTLE(out +  4,x1);
+  U32TO8_LITTLE(out +  8,x2);
+  U32TO8_LITTLE(out + 12,x3);
+  U32TO8_LITTLE(out + 16,x4);
+  U32TO8_LITTLE(out + 20,x5);
+  U32TO8_LITTLE(out + 24,x6);
+  U32TO8_LITTLE(out + 28,x7);
+  U32TO8_LITTLE(out + 32,x8);
+  U32TO8_LITTLE(out + 36,x9);
+  U32TO8_LITTLE(out + 40,x10);
+  U32TO8_LITTLE(out + 44,x11);
+  U32TO8_LITTLE(out + 48,x12);
+  U32TO8_LITTLE(out + 52,x13);
+  U32TO8_LITTLE(out + 56,x14);
+  U32TO8_LITTLE(out + 60,x15);
+}
+
+// The vector versions hold word i of 4 (SSE2) or 8 (AVX2) consecutive blocks in x[i]
+// and transpose them back to block order when storing.
+#define QUARTERROUND_V(ADD, XORV, ROT16, ROT12, ROT8, ROT7, a, b, c, d) \
+  a = ADD(a, b); d = ROT16(XORV(d, a)); \
+  c = ADD(c, d); b = ROT12(XORV(b, c)); \
+  a = ADD(a, b); d = ROT8(XORV(d, a)); \
+  c = ADD(c, d); b = ROT7(XORV(b, c));
+
+#define DOUBLEROUND_V(ADD, XORV, ROT16, ROT12, ROT8, ROT7, x) \
+  QUARTERROUND_V(ADD, XORV, ROT16, ROT12, ROT8, ROT7, x[0], x[4], x[8], x[12]) \
+  QUARTERROUND_V(ADD, XORV, ROT16, ROT12, ROT8, ROT7, x[1], x[5], x[9], x[13]) \
+  QUARTERROUND_V(ADD, XORV, ROT16, ROT12, ROT8, ROT7, x[2], x[6], x[10], x[14]) \
+  QUARTERROUND_V(ADD, XORV, ROT16, ROT12, ROT8, ROT7, x[3], x[7], x[11], x[15]) \
+  QUARTERROUND_V(ADD, XORV, ROT16, ROT12, ROT8, ROT7, x[0], x[5], x[10], x[15]) \
+  QUARTERROUND_V(ADD, XORV, ROT16, ROT12, ROT8, ROT7, x[1], x[6], x[11], x[12]) \
+  QUARTERROUND_V(ADD, XORV, ROT16, ROT12, ROT8, ROT7, x[2], x[7], x[8], x[13]) \
+  QUARTERROUND_V(ADD, XORV, ROT16, ROT12, ROT8, ROT7, x[3], x[4], x[9], x[14])
+
+#if defined(__SSE2__)
+
+#if defined(__AVX512VL__)
+#define ROT128(v, c) _mm_rol_epi32(v, c)
+#define ROT128_16(v) _mm_rol_epi32(v, 16)
+#else
+#define ROT128(v, c) _mm_or_si128(_mm_slli_epi32(v, c), _mm_srli_epi32(v, 32 - (c)))
+#define ROT128_16(v) _mm_shufflehi_epi16(_mm_shufflelo_epi16(v, _MM_SHUFFLE(2, 3, 0, 1)), _MM_SHUFFLE(2, 3, 0, 1))
+#endif
+#define ROT128_12(v) ROT128(v, 12)
+#define ROT128_8(v) ROT128(v, 8)
+#define ROT128_7(v) ROT128(v, 7)
+
+static void chacha_block_x4(uint32_t* input, const uint8_t* in, uint8_t* out, unsigned rounds) {
+  __m128i j[16], x[16];
+  uint32_t lo[4], hi[4];
+  unsigned i;
+
+  for (i = 0; i < 16; ++i) {
+    j[i] = _mm_set1_epi32((int)input[i]);
+  }
+  for (i = 0; i < 4; ++i) {
+    chacha_counter(input, i, &lo[i], &hi[i]);
+  }
+  j[12] = _mm_loadu_si128((const __m128i*)lo);
+  j[13] = _mm_loadu_si128((const __m128i*)hi);
+  for (i = 0; i < 16; ++i) {
+    x[i] = j[i];
+  }
+  for (i = rounds; i > 0; i -= 2) {
+    DOUBLEROUND_V(_mm_add_epi32, _mm_xor_si128, ROT128_16, ROT128_12, ROT128_8, ROT128_7, x)
+  }
+  for (i = 0; i < 16; ++i) {
+    x[i] = _mm_add_epi32(x[i], j[i]);
+  }
+
+  for (i = 0; i < 16; i += 4) {
+    __m128i t0 = _mm_unpacklo_epi32(x[i], x[i + 1]);
+    __m128i t1 = _mm_unpackhi_epi32(x[i], x[i + 1]);
+    __m128i t2 = _mm_unpacklo_epi32(x[i + 2], x[i + 3]);
+    __m128i t3 = _mm_unpackhi_epi32(x[i + 2], x[i + 3]);
+    __m128i b[4];
+    unsigned k;
+    b[0] = _mm_unpacklo_epi64(t0, t2);
+    b[1] = _mm_unpackhi_epi64(t0, t2);
+    b[2] = _mm_unpacklo_epi64(t1, t3);
+    b[3] = _mm_unpackhi_epi64(t1, t3);
+    for (k = 0; k < 4; ++k) {
+      __m128i* p = (__m128i*)(out + 64 * k + 4 * i);
+      if (in) {
+        b[k] = _mm_xor_si128(b[k], _mm_loadu_si128((const __m128i*)(in + 64 * k + 4 * i)));
+      }
+      _mm_storeu_si128(p, b[k]);
     }
+  }
+
+  chacha_advance(input, 4);
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+#if defined(__AVX512VL__)
+#define ROT256(v, c) _mm256_rol_epi32(v, c)
+#define ROT256_16(v) _mm256_rol_epi32(v, 16)
+#define ROT256_8(v) _mm256_rol_epi32(v, 8)
+#else
+#define ROT256(v, c) _mm256_or_si256(_mm256_slli_epi32(v, c), _mm256_srli_epi32(v, 32 - (c)))
+#define ROT256_16(v) _mm256_shuffle_epi8(v, rot16)
+#define ROT256_8(v) _mm256_shuffle_epi8(v, rot8)
+#endif
+#define ROT256_12(v) ROT256(v, 12)
+#define ROT256_7(v) ROT256(v, 7)
+
+static void chacha_block_x8(uint32_t* input, const uint8_t* in, uint8_t* out, unsigned rounds) {
+#if !defined(__AVX512VL__)
+  const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                         2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+  const __m256i rot8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                        3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+#endif
+  __m256i j[16], x[16];
+  uint32_t lo[8], hi[8];
+  unsigned i;
 
-    U32TO8_LITTLE(cipher +  0,x0);
-    U32TO8_LITTLE(cipher +  4,x1);
-    U32TO8_LITTLE(cipher +  8,x2);
-    U32TO8_LITTLE(cipher + 12,x3);
-    U32TO8_LITTLE(cipher + 16,x4);
-    U32TO8_LITTLE(cipher + 20,x5);
-    U32TO8_LITTLE(cipher + 24,x6);
-    U32TO8_LITTLE(cipher + 28,x7);
-    U32TO8_LITTLE(cipher + 32,x8);
-    U32TO8_LITTLE(cipher + 36,x9);
-    U32TO8_LITTLE(cipher + 40,x10);
-    U32TO8_LITTLE(cipher + 44,x11);
-    U32TO8_LITTLE(cipher + 48,x12);
-    U32TO8_LITTLE(cipher + 52,x13);
-    U32TO8_LITTLE(cipher + 56,x14);
-    U32TO8_LITTLE(cipher + 60,x15);
-
-    if (length <= 64) {
-      if (length < 64) {
-        memcpy(ctarget, cipher, length);
+  for (i = 0; i < 16; ++i) {
+    j[i] = _mm256_set1_epi32((int)input[i]);
+  }
+  for (i = 0; i < 8; ++i) {
+    chacha_counter(input, i, &lo[i], &hi[i]);
+  }
+  j[12] = _mm256_loadu_si256((const __m256i*)lo);
+  j[13] = _mm256_loadu_si256((const __m256i*)hi);
+  for (i = 0; i < 16; ++i) {
+    x[i] = j[i];
+  }
+  for (i = rounds; i > 0; i -= 2) {
+    DOUBLEROUND_V(_mm256_add_epi32, _mm256_xor_si256, ROT256_16, ROT256_12, ROT256_8, ROT256_7, x)
+  }
+  for (i = 0; i < 16; ++i) {
+    x[i] = _mm256_add_epi32(x[i], j[i]);
+  }
+
+  // same 4x4 transpose as chacha_block_x4 in each 128 bit lane, the low lanes hold
+  // blocks 0..3 and the high lanes blocks 4..7
+  for (i = 0; i < 16; i += 4) {
+    __m256i t0 = _mm256_unpacklo_epi32(x[i], x[i + 1]);
+    __m256i t1 = _mm256_unpackhi_epi32(x[i], x[i + 1]);
+    __m256i t2 = _mm256_unpacklo_epi32(x[i + 2], x[i + 3]);
+    __m256i t3 = _mm256_unpackhi_epi32(x[i + 2], x[i + 3]);
+    __m256i b[4];
+    unsigned k;
+    b[0] = _mm256_unpacklo_epi64(t0, t2);
+    b[1] = _mm256_unpackhi_epi64(t0, t2);
+    b[2] = _mm256_unpacklo_epi64(t1, t3);
+    b[3] = _mm256_unpackhi_epi64(t1, t3);
+    for (k = 0; k < 4; ++k) {
+      __m128i b_lo = _mm256_castsi256_si128(b[k]);
+      __m128i b_hi = _mm256_extracti128_si256(b[k], 1);
+      __m128i* p_lo = (__m128i*)(out + 64 * k + 4 * i);
+      __m128i* p_hi = (__m128i*)(out + 64 * (k + 4) + 4 * i);
+      if (in) {
+        b_lo = _mm_xor_si128(b_lo, _mm_loadu_si128((const __m128i*)(in + 64 * k + 4 * i)));
+        b_hi = _mm_xor_si128(b_hi, _mm_loadu_si128((const __m128i*)(in + 64 * (k + 4) + 4 * i)));
       }
-      return;
+      _mm_storeu_si128(p_lo, b_lo);
+      _mm_storeu_si128(p_hi, b_hi);
     }
-    length -= 64;
-    cipher += 64;
-    data = (uint8_t*)data + 64;
   }
+
+  chacha_advance(input, 8);
+}
+
+#endif
+
+static void chacha_blocks(uint32_t* input, const uint8_t* in, uint8_t* out, size_t blocks, unsigned rounds) {
+#if defined(__AVX2__)
+  for (; blocks >= 8; blocks -= 8) {
+    chacha_block_x8(input, in, out, rounds);
+    in = in ? in + 8 * CHACHA_BLOCK_SIZE : NULL;
+    out += 8 * CHACHA_BLOCK_SIZE;
+  }
+#endif
+#if defined(__SSE2__)
+  for (; blocks >= 4; blocks -= 4) {
+    chacha_block_x4(input, in, out, rounds);
+    in = in ? in + 4 * CHACHA_BLOCK_SIZE : NULL;
+    out += 4 * CHACHA_BLOCK_SIZE;
+  }
+#endif
+  for (; blocks > 0; --blocks) {
+    chacha_block(input, in, out, rounds);
+    in = in ? in + CHACHA_BLOCK_SIZE : NULL;
+    out += CHACHA_BLOCK_SIZE;
+  }
+}
+
+void chacha_init(chacha_ctx* ctx, const uint8_t* key, const uint8_t* iv, unsigned rounds) {
+  ctx->input[0]  = U8TO32_LITTLE(sigma + 0);
+  ctx->input[1]  = U8TO32_LITTLE(sigma + 4);
+  ctx->input[2]  = U8TO32_LITTLE(sigma + 8);
+  ctx->input[3]  = U8TO32_LITTLE(sigma + 12);
+  ctx->input[4]  = U8TO32_LITTLE(key + 0);
+  ctx->input[5]  = U8TO32_LITTLE(key + 4);
+  ctx->input[6]  = U8TO32_LITTLE(key + 8);
+  ctx->input[7]  = U8TO32_LITTLE(key + 12);
+  ctx->input[8]  = U8TO32_LITTLE(key + 16);
+  ctx->input[9]  = U8TO32_LITTLE(key + 20);
+  ctx->input[10] = U8TO32_LITTLE(key + 24);
+  ctx->input[11] = U8TO32_LITTLE(key + 28);
+  ctx->input[12] = 0;
+  ctx->input[13] = 0;
+  ctx->input[14] = U8TO32_LITTLE(iv + 0);
+  ctx->input[15] = U8TO32_LITTLE(iv + 4);
+  ctx->keystream_pos = CHACHA_BLOCK_SIZE;
+  ctx->rounds = rounds;
+}
+
+void chacha_crypt(chacha_ctx* ctx, const void* data, size_t length, char* cipher) {
+  const uint8_t* in = (const uint8_t*)data;
+  uint8_t* out = (uint8_t*)cipher;
+  size_t blocks, i;
+
+  // the rest of the block started by the previous call
+  for (; length > 0 && ctx->keystream_pos < CHACHA_BLOCK_SIZE; --length) {
+    *out++ = *in++ ^ ctx->keystream[ctx->keystream_pos++];
+  }
+
+  blocks = length / CHACHA_BLOCK_SIZE;
+  if (blocks > 0) {
+    chacha_blocks(ctx->input, in, out, blocks, ctx->rounds);
+    in += blocks * CHACHA_BLOCK_SIZE;
+    out += blocks * CHACHA_BLOCK_SIZE;
+    length -= blocks * CHACHA_BLOCK_SIZE;
+  }
+
+  if (length > 0) {
+    chacha_blocks(ctx->input, NULL, ctx->keystream, 1, ctx->rounds);
+    for (i = 0; i < length; ++i) {
+      out[i] = in[i] ^ ctx->keystream[i];
+    }
+    ctx->keystream_pos = length;
+  }
+}
+
+void chacha_wipe(chacha_ctx* ctx) {
+  volatile uint8_t* p = (volatile uint8_t*)ctx;
+  size_t i;
+  for (i = 0; i < sizeof(chacha_ctx); ++i) {
+    p[i] = 0;
+  }
+}
+
+static void chacha(unsigned rounds, const void* data, size_t length, const uint8_t* key, const uint8_t* iv, char* cipher) {
+  chacha_ctx ctx;
+  if (!length) return;
+  chacha_init(&ctx, key, iv, rounds);
+  chacha_crypt(&ctx, data, length, cipher);
+  chacha_wipe(&ctx);
+}
+
+void chacha8(const void* data, size_t length, const uint8_t* key, const uint8_t* iv, char* cipher) {
+  chacha(CHACHA8_ROUNDS, data, length, key, iv, cipher);
+}
+
+void chacha20(const void* data, size_t length, const uint8_t* key, const uint8_t* iv, char* cipher) {
+  chacha(CHACHA20_ROUNDS, data, length, key, iv, cipher);
 }
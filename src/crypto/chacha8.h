@@ -35,6 +35,9 @@
 
 #define CHACHA8_KEY_SIZE 32
 #define CHACHA8_IV_SIZE 8
+#define CHACHA_BLOCK_SIZE 64
+#define CHACHA8_ROUNDS 8
+#define CHACHA20_ROUNDS 20
 
 #if defined(__cplusplus)
 #include <memory.h>
@@ -44,7 +47,21 @@
 namespace crypto {
   extern "C" {
 #endif
+    // Incremental en/decryption: consecutive chacha_crypt calls continue the keystream
+    // where the previous call stopped, so data can be processed in chunks of any size
+    typedef struct chacha_ctx {
+      uint32_t input[16];
+      uint8_t keystream[CHACHA_BLOCK_SIZE];
+      size_t keystream_pos;
+      unsigned rounds;
+    } chacha_ctx;
+
+    void chacha_init(chacha_ctx* ctx, const uint8_t* key, const uint8_t* iv, unsigned rounds);
+    void chacha_crypt(chacha_ctx* ctx, const void* data, size_t length, char* cipher);
+    void chacha_wipe(chacha_ctx* ctx);
+
     void chacha8(const void* data, size_t length, const uint8_t* key, const uint8_t* iv, char* cipher);
+    void chacha20(const void* data, size_t length, const uint8_t* key, const uint8_t* iv, char* cipher);
 #if defined(__cplusplus)
   }
 
@@ -70,6 +87,14 @@ namespace crypto {
     chacha8(data, length, reinterpret_cast<const uint8_t*>(&key), reinterpret_cast<const uint8_t*>(&iv), cipher);
   }
 
+  inline void chacha20(const void* data, std::size_t length, const chacha8_key& key, const chacha8_iv& iv, char* cipher) {
+    chacha20(data, length, reinterpret_cast<const uint8_t*>(&key), reinterpret_cast<const uint8_t*>(&iv), cipher);
+  }
+
+  inline void chacha_init(chacha_ctx& ctx, const chacha8_key& key, const chacha8_iv& iv, unsigned rounds = CHACHA8_ROUNDS) {
+    chacha_init(&ctx, reinterpret_cast<const uint8_t*>(&key), reinterpret_cast<const uint8_t*>(&iv), rounds);
+  }
+
   inline void generate_chacha8_key(std::string password, chacha8_key& key) {
     static_assert(sizeof(chacha8_key) <= sizeof(hash), "Size of hash must be at least that of chacha8_key");
     char pwd_hash[HASH_SIZE];
@@ -29,6 +29,7 @@
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
 #include <assert.h>
+#include <stddef.h>
 #include <stdint.h>
 
 #include "warnings.h"
@@ -377,7 +378,7 @@ Can get away with 11 carries, but then data flow is much deeper.
 With tighter constraints on inputs can squeeze carries into int32.
 */
 
-static void fe_mul(fe h, const fe f, const fe g) {
+static void fe_mul_ref10(fe h, const fe f, const fe g) {
   int32_t f0 = f[0];
   int32_t f1 = f[1];
   int32_t f2 = f[2];
@@ -657,7 +658,7 @@ Postconditions:
 See fe_mul.c for discussion of implementation strategy.
 */
 
-static void fe_sq(fe h, const fe f) {
+static void fe_sq_ref10(fe h, const fe f) {
   int32_t f0 = f[0];
   int32_t f1 = f[1];
   int32_t f2 = f[2];
@@ -805,7 +806,7 @@ Postconditions:
 See fe_mul.c for discussion of implementation strategy.
 */
 
-static void fe_sq2(fe h, const fe f) {
+static void fe_sq2_ref10(fe h, const fe f) {
   int32_t f0 = f[0];
   int32_t f1 = f[1];
   int32_t f2 = f[2];
@@ -947,6 +948,186 @@ static void fe_sq2(fe h, const fe f) {
   h[9] = h9;
 }
 
+/* fe_mul, fe_sq and fe_sq2 with 64-bit limbs */
+
+/*
+Same functions as above, computed in radix 2^51 with 128-bit products:
+25 multiplications instead of 100. Limbs 2i and 2i+1 of fe are at bits 51i
+and 51i+26, so f is converted by f[2i] + f[2i+1]*2^26 and the reduced
+result is split back with the carries of fe_mul. Inputs and outputs have
+the same bounds as for the ref10 functions, results are the same.
+*/
+
+#if defined(__SIZEOF_INT128__)
+#define FE_HAVE_INT128 1
+
+typedef __int128 int128_t;
+
+static const int64_t fe51_mask = (((int64_t) 1) << 51) - 1;
+
+static void fe51_load(int64_t r[5], const fe f) {
+  r[0] = f[0] + ((int64_t) f[1] << 26);
+  r[1] = f[2] + ((int64_t) f[3] << 26);
+  r[2] = f[4] + ((int64_t) f[5] << 26);
+  r[3] = f[6] + ((int64_t) f[7] << 26);
+  r[4] = f[8] + ((int64_t) f[9] << 26);
+}
+
+static void fe51_store(fe h, int128_t t0, int128_t t1, int128_t t2, int128_t t3, int128_t t4) {
+  int64_t r0, r1, r2, r3, r4;
+  int64_t h0, h1, h2, h3, h4, h5, h6, h7, h8, h9;
+  int64_t carry;
+
+  /* |t| <= 2^114 */
+  t1 += t0 >> 51; t0 &= fe51_mask;
+  t2 += t1 >> 51; t1 &= fe51_mask;
+  t3 += t2 >> 51; t2 &= fe51_mask;
+  t4 += t3 >> 51; t3 &= fe51_mask;
+  t0 += (t4 >> 51) * 19; t4 &= fe51_mask;
+  /* |t0| <= 2^68 */
+  t1 += t0 >> 51; t0 &= fe51_mask;
+  r0 = (int64_t) t0;
+  r1 = (int64_t) t1;
+  r2 = (int64_t) t2;
+  r3 = (int64_t) t3;
+  r4 = (int64_t) t4;
+  /* 0 <= r < 2^51, except r1 < 2^51 + 2^18 */
+
+  h0 = r0;
+  carry = (h0 + (int64_t) (1<<25)) >> 26; h1 = carry; h0 -= carry << 26;
+  carry = (h1 + (int64_t) (1<<24)) >> 25; h2 = r1 + carry; h1 -= carry << 25;
+  carry = (h2 + (int64_t) (1<<25)) >> 26; h3 = carry; h2 -= carry << 26;
+  carry = (h3 + (int64_t) (1<<24)) >> 25; h4 = r2 + carry; h3 -= carry << 25;
+  carry = (h4 + (int64_t) (1<<25)) >> 26; h5 = carry; h4 -= carry << 26;
+  carry = (h5 + (int64_t) (1<<24)) >> 25; h6 = r3 + carry; h5 -= carry << 25;
+  carry = (h6 + (int64_t) (1<<25)) >> 26; h7 = carry; h6 -= carry << 26;
+  carry = (h7 + (int64_t) (1<<24)) >> 25; h8 = r4 + carry; h7 -= carry << 25;
+  carry = (h8 + (int64_t) (1<<25)) >> 26; h9 = carry; h8 -= carry << 26;
+  carry = (h9 + (int64_t) (1<<24)) >> 25; h0 += carry * 19; h9 -= carry << 25;
+  carry = (h0 + (int64_t) (1<<25)) >> 26; h1 += carry; h0 -= carry << 26;
+
+  h[0] = (int32_t) h0;
+  h[1] = (int32_t) h1;
+  h[2] = (int32_t) h2;
+  h[3] = (int32_t) h3;
+  h[4] = (int32_t) h4;
+  h[5] = (int32_t) h5;
+  h[6] = (int32_t) h6;
+  h[7] = (int32_t) h7;
+  h[8] = (int32_t) h8;
+  h[9] = (int32_t) h9;
+}
+
+static void fe_mul_int128(fe h, const fe f, const fe g) {
+  int64_t a[5], b[5];
+  int64_t b1_19, b2_19, b3_19, b4_19;
+  fe51_load(a, f);
+  fe51_load(b, g);
+  b1_19 = 19 * b[1];
+  b2_19 = 19 * b[2];
+  b3_19 = 19 * b[3];
+  b4_19 = 19 * b[4];
+  fe51_store(h,
+    (int128_t) a[0] * b[0] + (int128_t) a[1] * b4_19 + (int128_t) a[2] * b3_19 + (int128_t) a[3] * b2_19 + (int128_t) a[4] * b1_19,
+    (int128_t) a[0] * b[1] + (int128_t) a[1] * b[0] + (int128_t) a[2] * b4_19 + (int128_t) a[3] * b3_19 + (int128_t) a[4] * b2_19,
+    (int128_t) a[0] * b[2] + (int128_t) a[1] * b[1] + (int128_t) a[2] * b[0] + (int128_t) a[3] * b4_19 + (int128_t) a[4] * b3_19,
+    (int128_t) a[0] * b[3] + (int128_t) a[1] * b[2] + (int128_t) a[2] * b[1] + (int128_t) a[3] * b[0] + (int128_t) a[4] * b4_19,
+    (int128_t) a[0] * b[4] + (int128_t) a[1] * b[3] + (int128_t) a[2] * b[2] + (int128_t) a[3] * b[1] + (int128_t) a[4] * b[0]);
+}
+
+static void fe51_sq_products(int128_t t[5], const fe f) {
+  int64_t a[5];
+  int64_t a0_2, a1_2, a2_2, a3_2, a3_19, a4_19;
+  fe51_load(a, f);
+  a0_2 = 2 * a[0];
+  a1_2 = 2 * a[1];
+  a2_2 = 2 * a[2];
+  a3_2 = 2 * a[3];
+  a3_19 = 19 * a[3];
+  a4_19 = 19 * a[4];
+  t[0] = (int128_t) a[0] * a[0] + (int128_t) a1_2 * a4_19 + (int128_t) a2_2 * a3_19;
+  t[1] = (int128_t) a0_2 * a[1] + (int128_t) a2_2 * a4_19 + (int128_t) a[3] * a3_19;
+  t[2] = (int128_t) a0_2 * a[2] + (int128_t) a[1] * a[1] + (int128_t) a3_2 * a4_19;
+  t[3] = (int128_t) a0_2 * a[3] + (int128_t) a1_2 * a[2] + (int128_t) a[4] * a4_19;
+  t[4] = (int128_t) a0_2 * a[4] + (int128_t) a1_2 * a[3] + (int128_t) a[2] * a[2];
+}
+
+static void fe_sq_int128(fe h, const fe f) {
+  int128_t t[5];
+  fe51_sq_products(t, f);
+  fe51_store(h, t[0], t[1], t[2], t[3], t[4]);
+}
+
+static void fe_sq2_int128(fe h, const fe f) {
+  int128_t t[5];
+  fe51_sq_products(t, f);
+  fe51_store(h, 2 * t[0], 2 * t[1], 2 * t[2], 2 * t[3], 2 * t[4]);
+}
+#else
+#define FE_HAVE_INT128 0
+#endif
+
+/* Backend selection */
+
+#if FE_HAVE_INT128
+static int fe_backend = FE_BACKEND_INT128;
+#else
+static int fe_backend = FE_BACKEND_REF10;
+#endif
+
+int fe_backend_available(int backend) {
+  switch (backend) {
+  case FE_BACKEND_REF10:
+    return 1;
+  case FE_BACKEND_INT128:
+    return FE_HAVE_INT128;
+  default:
+    return 0;
+  }
+}
+
+int fe_backend_select(int backend) {
+  if (!fe_backend_available(backend)) {
+    return -1;
+  }
+  fe_backend = backend;
+  return 0;
+}
+
+int fe_backend_current(void) {
+  return fe_backend;
+}
+
+static void fe_mul(fe h, const fe f, const fe g) {
+#if FE_HAVE_INT128
+  if (fe_backend == FE_BACKEND_INT128) {
+    fe_mul_int128(h, f, g);
+    return;
+  }
+#endif
+  fe_mul_ref10(h, f, g);
+}
+
+static void fe_sq(fe h, const fe f) {
+#if FE_HAVE_INT128
+  if (fe_backend == FE_BACKEND_INT128) {
+    fe_sq_int128(h, f);
+    return;
+  }
+#endif
+  fe_sq_ref10(h, f);
+}
+
+static void fe_sq2(fe h, const fe f) {
+#if FE_HAVE_INT128
+  if (fe_backend == FE_BACKEND_INT128) {
+    fe_sq2_int128(h, f);
+    return;
+  }
+#endif
+  fe_sq2_ref10(h, f);
+}
+
 /* From fe_sub.c */
 
 /*
@@ -1196,16 +1377,23 @@ B is the Ed25519 base point (x,4/5) with x positive.
 */
 
 void ge_double_scalarmult_base_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b) {
+  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
+
+  ge_dsm_precomp(Ai, A);
+  ge_double_scalarmult_base_precomp_vartime(r, a, Ai, b);
+}
+
+/* Same as ge_double_scalarmult_base_vartime, with A given as ge_dsm_precomp table */
+
+void ge_double_scalarmult_base_precomp_vartime(ge_p2 *r, const unsigned char *a, const ge_dsmp Ai, const unsigned char *b) {
   signed char aslide[256];
   signed char bslide[256];
-  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
   ge_p1p1 t;
   ge_p3 u;
   int i;
 
   slide(aslide, a);
   slide(bslide, b);
-  ge_dsm_precomp(Ai, A);
 
   ge_p2_0(r);
 
@@ -2002,17 +2190,64 @@ void ge_scalarmult(ge_p2 *r, const unsigned char *a, const ge_p3 *A) {
   }
 }
 
+/* ge_tobytes for count points, with one field inversion per GE_TOBYTES_BATCH points */
+
+#define GE_TOBYTES_BATCH 32
+
+static void ge_tobytes_recip(unsigned char *s, const ge_p2 *h, const fe recip) {
+  fe x;
+  fe y;
+
+  fe_mul(x, h->X, recip);
+  fe_mul(y, h->Y, recip);
+  fe_tobytes(s, y);
+  s[31] ^= fe_isnegative(x) << 7;
+}
+
+void ge_tobytes_batch(unsigned char *s, const ge_p2 *h, size_t count) {
+  fe acc[GE_TOBYTES_BATCH]; /* acc[i] = h[0].Z * ... * h[i].Z */
+  fe inv;
+  fe recip;
+  size_t n, i;
+
+  while (count > 0) {
+    n = count < GE_TOBYTES_BATCH ? count : GE_TOBYTES_BATCH;
+    fe_copy(acc[0], h[0].Z);
+    for (i = 1; i < n; i++) {
+      fe_mul(acc[i], acc[i - 1], h[i].Z);
+    }
+    fe_invert(inv, acc[n - 1]);
+    for (i = n - 1; i > 0; i--) {
+      /* inv = 1 / (h[0].Z * ... * h[i].Z) */
+      fe_mul(recip, inv, acc[i - 1]);
+      fe_mul(inv, inv, h[i].Z);
+      ge_tobytes_recip(s + 32 * i, &h[i], recip);
+    }
+    ge_tobytes_recip(s, &h[0], inv);
+    s += 32 * n;
+    h += n;
+    count -= n;
+  }
+}
+
 void ge_double_scalarmult_precomp_vartime(ge_p2 *r, const unsigned char *a, const ge_p3 *A, const unsigned char *b, const ge_dsmp Bi) {
+  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
+
+  ge_dsm_precomp(Ai, A);
+  ge_double_scalarmult_precomp2_vartime(r, a, Ai, b, Bi);
+}
+
+/* r = a * A + b * B, with both A and B given as ge_dsm_precomp tables */
+
+void ge_double_scalarmult_precomp2_vartime(ge_p2 *r, const unsigned char *a, const ge_dsmp Ai, const unsigned char *b, const ge_dsmp Bi) {
   signed char aslide[256];
   signed char bslide[256];
-  ge_dsmp Ai; /* A, 3A, 5A, 7A, 9A, 11A, 13A, 15A */
   ge_p1p1 t;
   ge_p3 u;
   int i;
 
   slide(aslide, a);
   slide(bslide, b);
-  ge_dsm_precomp(Ai, A);
 
   ge_p2_0(r);
 
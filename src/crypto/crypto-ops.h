@@ -79,6 +79,7 @@ typedef ge_cached ge_dsmp[8];
 extern const ge_precomp ge_Bi[8];
 void ge_dsm_precomp(ge_dsmp r, const ge_p3 *s);
 void ge_double_scalarmult_base_vartime(ge_p2 *, const unsigned char *, const ge_p3 *, const unsigned char *);
+void ge_double_scalarmult_base_precomp_vartime(ge_p2 *, const unsigned char *, const ge_dsmp, const unsigned char *);
 
 /* From ge_frombytes.c, modified */
 
@@ -126,8 +127,23 @@ void sc_reduce(unsigned char *);
 
 /* New code */
 
+/* Field arithmetic backends. FE_BACKEND_INT128 (radix 2^51 with 128-bit products) is
+   used by default where the compiler has __int128, FE_BACKEND_REF10 otherwise.
+   Both give the same results; selection is global and not synchronized, it is meant
+   to be done at startup or by tests. */
+enum {
+  FE_BACKEND_REF10,
+  FE_BACKEND_INT128,
+  FE_BACKEND_COUNT
+};
+int fe_backend_available(int);
+int fe_backend_select(int); /* 0 on success, -1 if not available */
+int fe_backend_current(void);
+
 void ge_scalarmult(ge_p2 *, const unsigned char *, const ge_p3 *);
+void ge_tobytes_batch(unsigned char *, const ge_p2 *, size_t);
 void ge_double_scalarmult_precomp_vartime(ge_p2 *, const unsigned char *, const ge_p3 *, const unsigned char *, const ge_dsmp);
+void ge_double_scalarmult_precomp2_vartime(ge_p2 *, const unsigned char *, const ge_dsmp, const unsigned char *, const ge_dsmp);
 void ge_mul8(ge_p1p1 *, const ge_p2 *);
 extern const fe fe_ma2;
 extern const fe fe_ma;
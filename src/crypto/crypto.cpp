@@ -34,7 +34,8 @@
 #include <cstdlib>
 #include <cstring>
 #include <memory>
-#include <mutex>
+#include <unordered_map>
+#include <vector>
 
 #include "common/varint.h"
 #include "warnings.h"
@@ -52,8 +53,6 @@ namespace crypto {
   using std::abort;
   using std::int32_t;
   using std::int64_t;
-  using std::lock_guard;
-  using std::mutex;
   using std::size_t;
   using std::uint32_t;
   using std::uint64_t;
@@ -63,8 +62,6 @@ namespace crypto {
 #include "random.h"
   }
 
-  mutex random_lock;
-
   static inline unsigned char *operator &(ec_point &point) {
     return &reinterpret_cast<unsigned char &>(point);
   }
@@ -100,7 +97,6 @@ namespace crypto {
    * 
    */
   secret_key crypto_ops::generate_keys(public_key &pub, secret_key &sec, const secret_key& recovery_key, bool recover) {
-    lock_guard<mutex> lock(random_lock);
     ge_p3 point;
 
     secret_key rng;
@@ -152,6 +148,49 @@ namespace crypto {
     return true;
   }
 
+  key_derivation_precomp::key_derivation_precomp(const secret_key &key) : m_key(key) {
+    assert(sc_check(&key) == 0);
+  }
+
+  key_derivation_precomp::~key_derivation_precomp() {
+    memset(&m_key, 0, sizeof(m_key));
+  }
+
+  bool key_derivation_precomp::derive(const public_key &key, key_derivation &derivation) const {
+    bool valid;
+    return derive(std::addressof(key), 1, std::addressof(derivation), &valid) == 1;
+  }
+
+  size_t key_derivation_precomp::derive(const public_key *keys, size_t count, key_derivation *derivations, bool *valid) const {
+    std::vector<ge_p2> points;
+    std::vector<key_derivation> results;
+    points.reserve(count);
+    for (size_t i = 0; i < count; i++) {
+      ge_p3 point;
+      ge_p1p1 point2;
+      valid[i] = ge_frombytes_vartime(&point, &keys[i]) == 0;
+      if (!valid[i]) {
+        continue;
+      }
+      points.emplace_back();
+      ge_scalarmult(&points.back(), &m_key, &point);
+      ge_mul8(&point2, &points.back());
+      ge_p1p1_to_p2(&points.back(), &point2);
+    }
+    results.resize(points.size());
+    if (!points.empty()) {
+      ge_tobytes_batch(reinterpret_cast<unsigned char *>(results.data()), points.data(), points.size());
+    }
+    for (size_t i = 0, j = 0; i < count; i++) {
+      if (valid[i]) {
+        derivations[i] = results[j++];
+      } else {
+        memset(&derivations[i], 0, sizeof(key_derivation));
+      }
+    }
+    return points.size();
+  }
+
   static void derivation_to_scalar(const key_derivation &derivation, size_t output_index, ec_scalar &res) {
     struct {
       key_derivation derivation;
@@ -199,7 +238,6 @@ namespace crypto {
   };
 
   void crypto_ops::generate_signature(const hash &prefix_hash, const public_key &pub, const secret_key &sec, signature &sig) {
-    lock_guard<mutex> lock(random_lock);
     ge_p3 tmp3;
     ec_scalar k;
     s_comm buf;
@@ -280,7 +318,6 @@ POP_WARNINGS
     const public_key *const *pubs, size_t pubs_count,
     const secret_key &sec, size_t sec_index,
     signature *sig) {
-    lock_guard<mutex> lock(random_lock);
     size_t i;
     ge_p3 image_unp;
     ge_dsmp image_pre;
@@ -377,4 +414,175 @@ POP_WARNINGS
     sc_sub(&h, &h, &sum);
     return sc_isnonzero(&h) == 0;
   }
+
+  /* ring_member_cache */
+
+  struct ring_member_precomp {
+    bool valid;
+    ge_dsmp key_pre;  /* odd multiples of the key */
+    ge_dsmp hp_pre;   /* odd multiples of hash_to_ec(key) */
+  };
+
+  struct ring_member_cache::impl {
+    typedef std::unordered_map<public_key, std::unique_ptr<ring_member_precomp>> precomp_map;
+
+    /* Two generations approximate LRU: when the current one is half of max_count, it becomes
+     * the old one and the previous old one is dropped. Hits in the old one move back. */
+    precomp_map current;
+    precomp_map old;
+    std::size_t max_count;
+    ring_member_precomp scratch;
+
+    static void compute(const public_key &key, ring_member_precomp &pre) {
+      ge_p3 point;
+      pre.valid = ge_frombytes_vartime(&point, &key) == 0;
+      if (pre.valid) {
+        ge_dsm_precomp(pre.key_pre, &point);
+        hash_to_ec(key, point);
+        ge_dsm_precomp(pre.hp_pre, &point);
+      }
+    }
+
+    /* Returned reference is valid until the next call */
+    const ring_member_precomp &get(const public_key &key) {
+      auto it = current.find(key);
+      if (it != current.end()) {
+        return *it->second;
+      }
+      if (max_count == 0) {
+        compute(key, scratch);
+        return scratch;
+      }
+      std::unique_ptr<ring_member_precomp> pre;
+      it = old.find(key);
+      if (it != old.end()) {
+        pre = std::move(it->second);
+        old.erase(it);
+      } else {
+        pre.reset(new ring_member_precomp);
+        compute(key, *pre);
+      }
+      if (current.size() * 2 >= max_count) {
+        old = std::move(current);
+        current.clear();
+      }
+      return *current.emplace(key, std::move(pre)).first->second;
+    }
+  };
+
+  ring_member_cache::ring_member_cache(std::size_t max_count) : m_impl(new impl) {
+    m_impl->max_count = max_count;
+  }
+
+  ring_member_cache::~ring_member_cache() {
+  }
+
+  std::size_t ring_member_cache::size() const {
+    return m_impl->current.size() + m_impl->old.size();
+  }
+
+  void ring_member_cache::clear() {
+    m_impl->current.clear();
+    m_impl->old.clear();
+  }
+
+  /* ring_signature_batch */
+
+  struct ring_signature_batch::impl {
+    struct entry {
+      hash prefix_hash;
+      key_image image;
+      std::vector<public_key> pubs;
+      std::vector<signature> sigs;
+    };
+
+    explicit impl(ring_member_cache *c) : own_cache(c ? nullptr : new ring_member_cache()), cache(c ? *c : *own_cache) {
+    }
+
+    std::vector<entry> queue;
+    std::unique_ptr<ring_member_cache> own_cache;
+    ring_member_cache &cache;
+    std::vector<char> comm_buf;
+
+    bool check(const entry &e) {
+      ge_p3 image_unp;
+      ge_dsmp image_pre;
+      ec_scalar sum, h;
+      const size_t pubs_count = e.pubs.size();
+      if (ge_frombytes_vartime(&image_unp, &e.image) != 0) {
+        return false;
+      }
+      ge_dsm_precomp(image_pre, &image_unp);
+      comm_buf.resize(rs_comm_size(pubs_count));
+      rs_comm *const buf = reinterpret_cast<rs_comm *>(comm_buf.data());
+      sc_0(&sum);
+      buf->h = e.prefix_hash;
+      for (size_t i = 0; i < pubs_count; i++) {
+        const signature &sig = e.sigs[i];
+        ge_p2 tmp2;
+        if (sc_check(&sig.c) != 0 || sc_check(&sig.r) != 0) {
+          return false;
+        }
+        const ring_member_precomp &pre = cache.m_impl->get(e.pubs[i]);
+        if (!pre.valid) {
+          return false;
+        }
+        ge_double_scalarmult_base_precomp_vartime(&tmp2, &sig.c, pre.key_pre, &sig.r);
+        ge_tobytes(&buf->ab[i].a, &tmp2);
+        ge_double_scalarmult_precomp2_vartime(&tmp2, &sig.r, pre.hp_pre, &sig.c, image_pre);
+        ge_tobytes(&buf->ab[i].b, &tmp2);
+        sc_add(&sum, &sum, &sig.c);
+      }
+      hash_to_scalar(buf, rs_comm_size(pubs_count), h);
+      sc_sub(&h, &h, &sum);
+      return sc_isnonzero(&h) == 0;
+    }
+  };
+
+  ring_signature_batch::ring_signature_batch(ring_member_cache *cache) : m_impl(new impl(cache)) {
+  }
+
+  ring_signature_batch::~ring_signature_batch() {
+  }
+
+  void ring_signature_batch::add(const hash &prefix_hash, const key_image &image,
+    const public_key *const *pubs, std::size_t pubs_count,
+    const signature *sig) {
+    m_impl->queue.emplace_back();
+    impl::entry &e = m_impl->queue.back();
+    e.prefix_hash = prefix_hash;
+    e.image = image;
+    e.pubs.reserve(pubs_count);
+    for (size_t i = 0; i < pubs_count; i++) {
+      e.pubs.push_back(*pubs[i]);
+    }
+    e.sigs.assign(sig, sig + pubs_count);
+  }
+
+  bool ring_signature_batch::verify(std::size_t *failed_index) {
+    bool r = true;
+    for (size_t i = 0; i < m_impl->queue.size(); i++) {
+      if (!m_impl->check(m_impl->queue[i])) {
+        if (failed_index) {
+          *failed_index = i;
+        }
+        r = false;
+        break;
+      }
+    }
+    m_impl->queue.clear();
+    return r;
+  }
+
+  std::size_t ring_signature_batch::size() const {
+    return m_impl->queue.size();
+  }
+
+  void ring_signature_batch::clear() {
+    m_impl->queue.clear();
+  }
+
+  void ring_signature_batch::clear_cache() {
+    m_impl->cache.clear();
+  }
 }
@@ -31,6 +31,7 @@
 #pragma once
 
 #include <cstddef>
+#include <memory>
 #include <mutex>
 #include <vector>
 
@@ -44,8 +45,6 @@ namespace crypto {
 #include "random.h"
   }
 
-  extern std::mutex random_lock;
-
 #pragma pack(push, 1)
   POD_CLASS ec_point {
     char data[32];
@@ -121,7 +120,6 @@ namespace crypto {
   template<typename T>
   typename std::enable_if<std::is_pod<T>::value, T>::type rand() {
     typename std::remove_cv<T>::type res;
-    std::lock_guard<std::mutex> lock(random_lock);
     generate_random_bytes(sizeof(T), &res);
     return res;
   }
@@ -162,6 +160,24 @@ namespace crypto {
     crypto_ops::derive_secret_key(derivation, output_index, base, derived_key);
   }
 
+  /* Key derivations by one fixed secret key, i.e. the view key while scanning transactions.
+   * Each key is multiplied in constant time as in generate_key_derivation, and the batch
+   * variant shares one field inversion between up to 32 results. Results are the same as
+   * generate_key_derivation.
+   */
+  class key_derivation_precomp {
+  public:
+    explicit key_derivation_precomp(const secret_key &key);
+    ~key_derivation_precomp();
+
+    bool derive(const public_key &key, key_derivation &derivation) const;
+    /* valid[i] is set to false for keys that are not valid points, returns the number of valid keys */
+    std::size_t derive(const public_key *keys, std::size_t count, key_derivation *derivations, bool *valid) const;
+
+  private:
+    secret_key m_key;
+  };
+
   /* Generation and checking of a standard signature.
    */
   inline void generate_signature(const hash &prefix_hash, const public_key &pub, const secret_key &sec, signature &sig) {
@@ -205,8 +221,66 @@ namespace crypto {
     const signature *sig) {
     return check_ring_signature(prefix_hash, image, pubs.data(), pubs.size(), sig);
   }
+
+  /* Bounded cache of precomputed ring member tables (the decompressed key and its hash_to_ec
+   * point), keyed by the member's public key. Least recently used keys are dropped first,
+   * about max_count keys (2.5 KB each) are kept, 0 disables caching.
+   * Not thread safe, callers sharing one cache have to serialize access to it.
+   */
+  class ring_member_cache {
+  public:
+    explicit ring_member_cache(std::size_t max_count = 4096);
+    ~ring_member_cache();
+
+    std::size_t size() const;
+    void clear();
+
+  private:
+    ring_member_cache(const ring_member_cache &);
+    void operator=(const ring_member_cache &);
+
+    friend class ring_signature_batch;
+    struct impl;
+    std::unique_ptr<impl> m_impl;
+  };
+
+  /* Batched checking of ring signatures.
+   * Signatures are queued with add() and checked together by verify(). Ring member tables
+   * are taken from the cache, so a key shared by several rings is decompressed and hashed once.
+   * Without a cache given, the batch uses a private one that is kept between verify() calls.
+   * verify() gives the same result as check_ring_signature for each queued signature,
+   * but returns false for a ring member that is not a valid point instead of aborting.
+   * Not thread safe, use one batch per thread.
+   */
+  class ring_signature_batch {
+  public:
+    explicit ring_signature_batch(ring_member_cache *cache = nullptr);
+    ~ring_signature_batch();
+
+    void add(const hash &prefix_hash, const key_image &image,
+      const public_key *const *pubs, std::size_t pubs_count,
+      const signature *sig);
+    void add(const hash &prefix_hash, const key_image &image,
+      const std::vector<const public_key *> &pubs,
+      const signature *sig) {
+      add(prefix_hash, image, pubs.data(), pubs.size(), sig);
+    }
+    /* Checks and removes all queued signatures. On failure, failed_index (if given) is set to
+     * the position (in add() order) of the first bad signature. */
+    bool verify(std::size_t *failed_index = nullptr);
+    std::size_t size() const;
+    void clear();
+    void clear_cache();
+
+  private:
+    ring_signature_batch(const ring_signature_batch &);
+    void operator=(const ring_signature_batch &);
+
+    struct impl;
+    std::unique_ptr<impl> m_impl;
+  };
 }
 
-CRYPTO_MAKE_COMPARABLE(public_key)
+CRYPTO_MAKE_HASHABLE(public_key)
 CRYPTO_MAKE_HASHABLE(key_image)
 CRYPTO_MAKE_COMPARABLE(signature)
@@ -79,7 +79,11 @@ enum {
 };
 
 void cn_fast_hash(const void *data, size_t length, char *hash);
+/* 4 messages of length bytes back to back in data, 4 hashes back to back in hash (hash may be data) */
+void cn_fast_hash_x4(const void *data, size_t length, char *hash);
 void cn_slow_hash(const void *data, size_t length, char *hash);
+/* same as cn_slow_hash with software AES, cn_slow_hash uses it when AES-NI is not available */
+void cn_slow_hash_portable(const void *data, size_t length, char *hash);
 
 void hash_extra_blake(const void *data, size_t length, char *hash);
 void hash_extra_groestl(const void *data, size_t length, char *hash);
@@ -48,3 +48,7 @@ void cn_fast_hash(const void *data, size_t length, char *hash) {
   hash_process(&state, data, length);
   memcpy(hash, &state, HASH_SIZE);
 }
+
+void cn_fast_hash_x4(const void *data, size_t length, char *hash) {
+  keccak_x4(data, length, (uint8_t*)hash, HASH_SIZE);
+}
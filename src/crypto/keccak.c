@@ -5,6 +5,10 @@
 #include "hash-ops.h"
 #include "keccak.h"
 
+#if defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
 const uint64_t keccakf_rndc[24] = 
 {
     0x0000000000000001, 0x0000000000008082, 0x800000000000808a,
@@ -17,57 +21,167 @@ const uint64_t keccakf_rndc[24] =
     0x8000000000008080, 0x0000000080000001, 0x8000000080008008
 };
 
-const int keccakf_rotc[24] = 
-{
-    1,  3,  6,  10, 15, 21, 28, 36, 45, 55, 2,  14, 
-    27, 41, 56, 8,  25, 43, 62, 18, 39, 61, 20, 44
-};
+// Lanes are named after their position in the state: rows b, g, k, m, s (y = 0..4) and
+// columns a, e, i, o, u (x = 0..4), so st[x + 5 * y] is A<row><column>.
+// Rounds are unrolled by two between the A and E sets of lanes, which saves moving the
+// state around. The scalar version keeps lanes 1, 2, 8, 12, 17 and 20 complemented
+// between keccakf entry and exit ("lane complementing"), this turns most NOTs of chi into ORs.
 
-const int keccakf_piln[24] = 
-{
-    10, 7,  11, 17, 18, 3, 5,  16, 8,  21, 24, 4, 
-    15, 23, 19, 13, 12, 2, 20, 14, 22, 9,  6,  1 
-};
+#define KECCAK_ROUND(S, T, RC) \
+    Ca = S##ba ^ S##ga ^ S##ka ^ S##ma ^ S##sa; \
+    Ce = S##be ^ S##ge ^ S##ke ^ S##me ^ S##se; \
+    Ci = S##bi ^ S##gi ^ S##ki ^ S##mi ^ S##si; \
+    Co = S##bo ^ S##go ^ S##ko ^ S##mo ^ S##so; \
+    Cu = S##bu ^ S##gu ^ S##ku ^ S##mu ^ S##su; \
+    Da = Cu ^ ROTL64(Ce, 1); \
+    De = Ca ^ ROTL64(Ci, 1); \
+    Di = Ce ^ ROTL64(Co, 1); \
+    Do = Ci ^ ROTL64(Cu, 1); \
+    Du = Co ^ ROTL64(Ca, 1); \
+    Ba = S##ba ^ Da; \
+    Be = ROTL64(S##ge ^ De, 44); \
+    Bi = ROTL64(S##ki ^ Di, 43); \
+    Bo = ROTL64(S##mo ^ Do, 21); \
+    Bu = ROTL64(S##su ^ Du, 14); \
+    T##ba = Ba ^ (Be | Bi); \
+    T##be = Be ^ (~Bi | Bo); \
+    T##bi = Bi ^ (Bo & Bu); \
+    T##bo = Bo ^ (Bu | Ba); \
+    T##bu = Bu ^ (Ba & Be); \
+    T##ba ^= RC; \
+    Ba = ROTL64(S##bo ^ Do, 28); \
+    Be = ROTL64(S##gu ^ Du, 20); \
+    Bi = ROTL64(S##ka ^ Da, 3); \
+    Bo = ROTL64(S##me ^ De, 45); \
+    Bu = ROTL64(S##si ^ Di, 61); \
+    T##ga = Ba ^ (Be | Bi); \
+    T##ge = Be ^ (Bi & Bo); \
+    T##gi = Bi ^ (Bo | ~Bu); \
+    T##go = Bo ^ (Bu | Ba); \
+    T##gu = Bu ^ (Ba & Be); \
+    Ba = ROTL64(S##be ^ De, 1); \
+    Be = ROTL64(S##gi ^ Di, 6); \
+    Bi = ROTL64(S##ko ^ Do, 25); \
+    Bo = ROTL64(S##mu ^ Du, 8); \
+    Bu = ROTL64(S##sa ^ Da, 18); \
+    T##ka = Ba ^ (Be | Bi); \
+    T##ke = Be ^ (Bi & Bo); \
+    T##ki = Bi ^ (~Bo & Bu); \
+    T##ko = ~Bo ^ (Bu | Ba); \
+    T##ku = Bu ^ (Ba & Be); \
+    Ba = ROTL64(S##bu ^ Du, 27); \
+    Be = ROTL64(S##ga ^ Da, 36); \
+    Bi = ROTL64(S##ke ^ De, 10); \
+    Bo = ROTL64(S##mi ^ Di, 15); \
+    Bu = ROTL64(S##so ^ Do, 56); \
+    T##ma = Ba ^ (Be & Bi); \
+    T##me = Be ^ (Bi | Bo); \
+    T##mi = Bi ^ (~Bo | Bu); \
+    T##mo = ~Bo ^ (Bu & Ba); \
+    T##mu = Bu ^ (Ba | Be); \
+    Ba = ROTL64(S##bi ^ Di, 62); \
+    Be = ROTL64(S##go ^ Do, 55); \
+    Bi = ROTL64(S##ku ^ Du, 39); \
+    Bo = ROTL64(S##ma ^ Da, 41); \
+    Bu = ROTL64(S##se ^ De, 2); \
+    T##sa = Ba ^ (~Be & Bi); \
+    T##se = ~Be ^ (Bi | Bo); \
+    T##si = Bi ^ (Bo & Bu); \
+    T##so = Bo ^ (Bu | Ba); \
+    T##su = Bu ^ (Ba & Be);
 
-// update the state with given number of rounds
 
 void keccakf(uint64_t st[25], int rounds)
 {
-    int i, j, round;
-    uint64_t t, bc[5];
-
-    for (round = 0; round < rounds; round++) {
-
-        // Theta
-        for (i = 0; i < 5; i++)     
-            bc[i] = st[i] ^ st[i + 5] ^ st[i + 10] ^ st[i + 15] ^ st[i + 20];
-
-        for (i = 0; i < 5; i++) {
-            t = bc[(i + 4) % 5] ^ ROTL64(bc[(i + 1) % 5], 1);
-            for (j = 0; j < 25; j += 5)
-                st[j + i] ^= t;
-        }
-
-        // Rho Pi
-        t = st[1];
-        for (i = 0; i < 24; i++) {
-            j = keccakf_piln[i];
-            bc[0] = st[j];
-            st[j] = ROTL64(t, keccakf_rotc[i]);
-            t = bc[0];
-        }
-
-        //  Chi
-        for (j = 0; j < 25; j += 5) {
-            for (i = 0; i < 5; i++)
-                bc[i] = st[j + i];
-            for (i = 0; i < 5; i++)
-                st[j + i] ^= (~bc[(i + 1) % 5]) & bc[(i + 2) % 5];
-        }
-
-        //  Iota
-        st[0] ^= keccakf_rndc[round];
+    uint64_t Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki, Ako, Aku, Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+    uint64_t Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki, Eko, Eku, Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;
+    uint64_t Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du, Ba, Be, Bi, Bo, Bu;
+    int round;
+
+    Aba = st[0];
+    Abe = ~st[1];
+    Abi = ~st[2];
+    Abo = st[3];
+    Abu = st[4];
+    Aga = st[5];
+    Age = st[6];
+    Agi = st[7];
+    Ago = ~st[8];
+    Agu = st[9];
+    Aka = st[10];
+    Ake = st[11];
+    Aki = ~st[12];
+    Ako = st[13];
+    Aku = st[14];
+    Ama = st[15];
+    Ame = st[16];
+    Ami = ~st[17];
+    Amo = st[18];
+    Amu = st[19];
+    Asa = ~st[20];
+    Ase = st[21];
+    Asi = st[22];
+    Aso = st[23];
+    Asu = st[24];
+
+    for (round = 0; round + 1 < rounds; round += 2) {
+        KECCAK_ROUND(A, E, keccakf_rndc[round]);
+        KECCAK_ROUND(E, A, keccakf_rndc[round + 1]);
+    }
+    if (round < rounds) {
+        KECCAK_ROUND(A, E, keccakf_rndc[round]);
+        Aba = Eba;
+        Abe = Ebe;
+        Abi = Ebi;
+        Abo = Ebo;
+        Abu = Ebu;
+        Aga = Ega;
+        Age = Ege;
+        Agi = Egi;
+        Ago = Ego;
+        Agu = Egu;
+        Aka = Eka;
+        Ake = Eke;
+        Aki = Eki;
+        Ako = Eko;
+        Aku = Eku;
+        Ama = Ema;
+        Ame = Eme;
+        Ami = Emi;
+        Amo = Emo;
+        Amu = Emu;
+        Asa = Esa;
+        Ase = Ese;
+        Asi = Esi;
+        Aso = Eso;
+        Asu = Esu;
     }
+
+    st[0] = Aba;
+    st[1] = ~Abe;
+    st[2] = ~Abi;
+    st[3] = Abo;
+    st[4] = Abu;
+    st[5] = Aga;
+    st[6] = Age;
+    st[7] = Agi;
+    st[8] = ~Ago;
+    st[9] = Agu;
+    st[10] = Aka;
+    st[11] = Ake;
+    st[12] = ~Aki;
+    st[13] = Ako;
+    st[14] = Aku;
+    st[15] = Ama;
+    st[16] = Ame;
+    st[17] = ~Ami;
+    st[18] = Amo;
+    st[19] = Amu;
+    st[20] = ~Asa;
+    st[21] = Ase;
+    st[22] = Asi;
+    st[23] = Aso;
+    st[24] = Asu;
 }
 
 // compute a keccak hash (md) of given byte length from "in"
@@ -110,3 +224,236 @@ void keccak1600(const uint8_t *in, int inlen, uint8_t *md)
 {
     keccak(in, inlen, md, sizeof(state_t));
 }
+
+#if defined(__AVX2__)
+
+#define XOR(a, b) _mm256_xor_si256(a, b)
+#define ANDNOT(a, b) _mm256_andnot_si256(a, b)
+#if defined(__AVX512VL__)
+#define ROL(a, n) _mm256_rol_epi64(a, n)
+#else
+#define ROL(a, n) _mm256_or_si256(_mm256_slli_epi64(a, n), _mm256_srli_epi64(a, 64 - (n)))
+#endif
+
+// same rounds as keccakf on 4 interleaved states, st[i] holds lane i of each of them
+#define KECCAK_ROUND_X4(S, T, RC) \
+    Ca = XOR(XOR(XOR(XOR(S##ba, S##ga), S##ka), S##ma), S##sa); \
+    Ce = XOR(XOR(XOR(XOR(S##be, S##ge), S##ke), S##me), S##se); \
+    Ci = XOR(XOR(XOR(XOR(S##bi, S##gi), S##ki), S##mi), S##si); \
+    Co = XOR(XOR(XOR(XOR(S##bo, S##go), S##ko), S##mo), S##so); \
+    Cu = XOR(XOR(XOR(XOR(S##bu, S##gu), S##ku), S##mu), S##su); \
+    Da = XOR(Cu, ROL(Ce, 1)); \
+    De = XOR(Ca, ROL(Ci, 1)); \
+    Di = XOR(Ce, ROL(Co, 1)); \
+    Do = XOR(Ci, ROL(Cu, 1)); \
+    Du = XOR(Co, ROL(Ca, 1)); \
+    Ba = XOR(S##ba, Da); \
+    Be = ROL(XOR(S##ge, De), 44); \
+    Bi = ROL(XOR(S##ki, Di), 43); \
+    Bo = ROL(XOR(S##mo, Do), 21); \
+    Bu = ROL(XOR(S##su, Du), 14); \
+    T##ba = XOR(Ba, ANDNOT(Be, Bi)); \
+    T##be = XOR(Be, ANDNOT(Bi, Bo)); \
+    T##bi = XOR(Bi, ANDNOT(Bo, Bu)); \
+    T##bo = XOR(Bo, ANDNOT(Bu, Ba)); \
+    T##bu = XOR(Bu, ANDNOT(Ba, Be)); \
+    T##ba = XOR(T##ba, RC); \
+    Ba = ROL(XOR(S##bo, Do), 28); \
+    Be = ROL(XOR(S##gu, Du), 20); \
+    Bi = ROL(XOR(S##ka, Da), 3); \
+    Bo = ROL(XOR(S##me, De), 45); \
+    Bu = ROL(XOR(S##si, Di), 61); \
+    T##ga = XOR(Ba, ANDNOT(Be, Bi)); \
+    T##ge = XOR(Be, ANDNOT(Bi, Bo)); \
+    T##gi = XOR(Bi, ANDNOT(Bo, Bu)); \
+    T##go = XOR(Bo, ANDNOT(Bu, Ba)); \
+    T##gu = XOR(Bu, ANDNOT(Ba, Be)); \
+    Ba = ROL(XOR(S##be, De), 1); \
+    Be = ROL(XOR(S##gi, Di), 6); \
+    Bi = ROL(XOR(S##ko, Do), 25); \
+    Bo = ROL(XOR(S##mu, Du), 8); \
+    Bu = ROL(XOR(S##sa, Da), 18); \
+    T##ka = XOR(Ba, ANDNOT(Be, Bi)); \
+    T##ke = XOR(Be, ANDNOT(Bi, Bo)); \
+    T##ki = XOR(Bi, ANDNOT(Bo, Bu)); \
+    T##ko = XOR(Bo, ANDNOT(Bu, Ba)); \
+    T##ku = XOR(Bu, ANDNOT(Ba, Be)); \
+    Ba = ROL(XOR(S##bu, Du), 27); \
+    Be = ROL(XOR(S##ga, Da), 36); \
+    Bi = ROL(XOR(S##ke, De), 10); \
+    Bo = ROL(XOR(S##mi, Di), 15); \
+    Bu = ROL(XOR(S##so, Do), 56); \
+    T##ma = XOR(Ba, ANDNOT(Be, Bi)); \
+    T##me = XOR(Be, ANDNOT(Bi, Bo)); \
+    T##mi = XOR(Bi, ANDNOT(Bo, Bu)); \
+    T##mo = XOR(Bo, ANDNOT(Bu, Ba)); \
+    T##mu = XOR(Bu, ANDNOT(Ba, Be)); \
+    Ba = ROL(XOR(S##bi, Di), 62); \
+    Be = ROL(XOR(S##go, Do), 55); \
+    Bi = ROL(XOR(S##ku, Du), 39); \
+    Bo = ROL(XOR(S##ma, Da), 41); \
+    Bu = ROL(XOR(S##se, De), 2); \
+    T##sa = XOR(Ba, ANDNOT(Be, Bi)); \
+    T##se = XOR(Be, ANDNOT(Bi, Bo)); \
+    T##si = XOR(Bi, ANDNOT(Bo, Bu)); \
+    T##so = XOR(Bo, ANDNOT(Bu, Ba)); \
+    T##su = XOR(Bu, ANDNOT(Ba, Be));
+
+
+static void keccakf_x4(__m256i st[25], int rounds)
+{
+    __m256i Aba, Abe, Abi, Abo, Abu, Aga, Age, Agi, Ago, Agu, Aka, Ake, Aki, Ako, Aku, Ama, Ame, Ami, Amo, Amu, Asa, Ase, Asi, Aso, Asu;
+    __m256i Eba, Ebe, Ebi, Ebo, Ebu, Ega, Ege, Egi, Ego, Egu, Eka, Eke, Eki, Eko, Eku, Ema, Eme, Emi, Emo, Emu, Esa, Ese, Esi, Eso, Esu;
+    __m256i Ca, Ce, Ci, Co, Cu, Da, De, Di, Do, Du, Ba, Be, Bi, Bo, Bu;
+    int round;
+
+    Aba = st[0];
+    Abe = st[1];
+    Abi = st[2];
+    Abo = st[3];
+    Abu = st[4];
+    Aga = st[5];
+    Age = st[6];
+    Agi = st[7];
+    Ago = st[8];
+    Agu = st[9];
+    Aka = st[10];
+    Ake = st[11];
+    Aki = st[12];
+    Ako = st[13];
+    Aku = st[14];
+    Ama = st[15];
+    Ame = st[16];
+    Ami = st[17];
+    Amo = st[18];
+    Amu = st[19];
+    Asa = st[20];
+    Ase = st[21];
+    Asi = st[22];
+    Aso = st[23];
+    Asu = st[24];
+
+    for (round = 0; round + 1 < rounds; round += 2) {
+        KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x(keccakf_rndc[round]));
+        KECCAK_ROUND_X4(E, A, _mm256_set1_epi64x(keccakf_rndc[round + 1]));
+    }
+    if (round < rounds) {
+        KECCAK_ROUND_X4(A, E, _mm256_set1_epi64x(keccakf_rndc[round]));
+        Aba = Eba;
+        Abe = Ebe;
+        Abi = Ebi;
+        Abo = Ebo;
+        Abu = Ebu;
+        Aga = Ega;
+        Age = Ege;
+        Agi = Egi;
+        Ago = Ego;
+        Agu = Egu;
+        Aka = Eka;
+        Ake = Eke;
+        Aki = Eki;
+        Ako = Eko;
+        Aku = Eku;
+        Ama = Ema;
+        Ame = Eme;
+        Ami = Emi;
+        Amo = Emo;
+        Amu = Emu;
+        Asa = Esa;
+        Ase = Ese;
+        Asi = Esi;
+        Aso = Eso;
+        Asu = Esu;
+    }
+
+    st[0] = Aba;
+    st[1] = Abe;
+    st[2] = Abi;
+    st[3] = Abo;
+    st[4] = Abu;
+    st[5] = Aga;
+    st[6] = Age;
+    st[7] = Agi;
+    st[8] = Ago;
+    st[9] = Agu;
+    st[10] = Aka;
+    st[11] = Ake;
+    st[12] = Aki;
+    st[13] = Ako;
+    st[14] = Aku;
+    st[15] = Ama;
+    st[16] = Ame;
+    st[17] = Ami;
+    st[18] = Amo;
+    st[19] = Amu;
+    st[20] = Asa;
+    st[21] = Ase;
+    st[22] = Asi;
+    st[23] = Aso;
+    st[24] = Asu;
+}
+
+static inline uint64_t load64(const uint8_t *p)
+{
+    uint64_t w;
+    memcpy(&w, p, sizeof(w));
+    return w;
+}
+
+static void keccak_absorb_x4(__m256i st[25], const uint8_t *in, int inlen, int offset, int rsizw)
+{
+    int i;
+    for (i = 0; i < rsizw; i++)
+        st[i] = XOR(st[i], _mm256_set_epi64x(load64(in + 3 * inlen + offset + 8 * i), load64(in + 2 * inlen + offset + 8 * i),
+                                             load64(in + inlen + offset + 8 * i), load64(in + offset + 8 * i)));
+}
+
+void keccak_x4(const uint8_t *in, int inlen, uint8_t *md, int mdlen)
+{
+    __m256i st[25];
+    uint64_t out[4][25];
+    uint8_t temp[4][144];
+    int i, k, offset, rsiz, rsizw;
+
+    rsiz = 200 == mdlen ? HASH_DATA_AREA : 200 - 2 * mdlen;
+    rsizw = rsiz / 8;
+
+    for (i = 0; i < 25; i++)
+        st[i] = _mm256_setzero_si256();
+
+    for (offset = 0; inlen - offset >= rsiz; offset += rsiz) {
+        keccak_absorb_x4(st, in, inlen, offset, rsizw);
+        keccakf_x4(st, KECCAK_ROUNDS);
+    }
+
+    // last block and padding, same for all messages
+    for (k = 0; k < 4; k++) {
+        memcpy(temp[k], in + k * inlen + offset, inlen - offset);
+        temp[k][inlen - offset] = 1;
+        memset(temp[k] + inlen - offset + 1, 0, rsiz - (inlen - offset) - 1);
+        temp[k][rsiz - 1] |= 0x80;
+    }
+    keccak_absorb_x4(st, temp[0], sizeof(temp[0]), 0, rsizw);
+    keccakf_x4(st, KECCAK_ROUNDS);
+
+    // all input is consumed at this point, so md can overlap it
+    for (i = 0; i < 25; i++) {
+        uint64_t lanes[4];
+        _mm256_storeu_si256((__m256i *) lanes, st[i]);
+        for (k = 0; k < 4; k++)
+            out[k][i] = lanes[k];
+    }
+    for (k = 0; k < 4; k++)
+        memcpy(md + k * mdlen, out[k], mdlen);
+}
+
+#else
+
+void keccak_x4(const uint8_t *in, int inlen, uint8_t *md, int mdlen)
+{
+    int k;
+    for (k = 0; k < 4; k++)
+        keccak(in + k * inlen, inlen, md + k * mdlen, mdlen);
+}
+
+#endif
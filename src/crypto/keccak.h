@@ -23,4 +23,8 @@ void keccakf(uint64_t st[25], int norounds);
 
 void keccak1600(const uint8_t *in, int inlen, uint8_t *md);
 
+// compute the keccak hashes of 4 messages of inlen bytes stored back to back in "in",
+// the digests are stored back to back in "md", which may point to "in" if mdlen <= inlen
+void keccak_x4(const uint8_t *in, int inlen, uint8_t *md, int mdlen);
+
 #endif
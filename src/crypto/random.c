@@ -90,41 +90,100 @@ static void generate_system_random_bytes(size_t n, void *result) {
 
 #endif
 
-static union hash_state state;
+#if defined(_MSC_VER)
+#define THREAD_LOCAL __declspec(thread)
+#else
+#define THREAD_LOCAL __thread
+#endif
+
+/* Every thread has its own generator, seeded from the system on first use,
+ * so callers don't need a global lock around random draws. State is wiped
+ * when its thread exits, and for the thread running finalizers at exit. */
+static THREAD_LOCAL union hash_state state;
+static THREAD_LOCAL int state_seeded;
 
 #if !defined(NDEBUG)
-static volatile int curstate; /* To catch thread safety problems. */
+static THREAD_LOCAL volatile int curstate; /* To catch reentrant use and use of wiped state. */
 #endif
 
-FINALIZER(deinit_random) {
+static void wipe_thread_state(void) {
 #if !defined(NDEBUG)
-  assert(curstate == 1);
+  assert(curstate != 2);
   curstate = 0;
 #endif
   memset(&state, 0, sizeof(union hash_state));
+  state_seeded = 0;
+}
+
+#if defined(_WIN32)
+
+static DWORD state_key = FLS_OUT_OF_INDEXES;
+
+static void NTAPI on_thread_exit(PVOID value) {
+  wipe_thread_state();
+}
+
+static void create_state_key(void) {
+  state_key = FlsAlloc(&on_thread_exit);
+  assert(state_key != FLS_OUT_OF_INDEXES);
+}
+
+static void register_thread_state(void) {
+  /* Callback is only called for threads with non-null value */
+  FlsSetValue(state_key, &state);
+}
+
+#else
+
+#include <pthread.h>
+
+static pthread_key_t state_key;
+
+static void on_thread_exit(void *value) {
+  wipe_thread_state();
+}
+
+static void create_state_key(void) {
+  if ((errno = pthread_key_create(&state_key, &on_thread_exit)) != 0) {
+    err(EXIT_FAILURE, "pthread_key_create");
+  }
+}
+
+static void register_thread_state(void) {
+  /* Destructor is only called for threads with non-null value */
+  if ((errno = pthread_setspecific(state_key, &state)) != 0) {
+    err(EXIT_FAILURE, "pthread_setspecific");
+  }
+}
+
+#endif
+
+FINALIZER(deinit_random) {
+  wipe_thread_state();
 }
 
 INITIALIZER(init_random) {
-  generate_system_random_bytes(32, &state);
+  create_state_key();
   REGISTER_FINALIZER(deinit_random);
-#if !defined(NDEBUG)
-  assert(curstate == 0);
-  curstate = 1;
-#endif
 }
 
 void generate_random_bytes(size_t n, void *result) {
-#if !defined(NDEBUG)
-  assert(curstate == 1);
-  curstate = 2;
-#endif
   if (n == 0) {
+    return;
+  }
+  if (!state_seeded) {
 #if !defined(NDEBUG)
-    assert(curstate == 2);
+    assert(curstate == 0);
     curstate = 1;
 #endif
-    return;
+    generate_system_random_bytes(32, &state);
+    register_thread_state();
+    state_seeded = 1;
   }
+#if !defined(NDEBUG)
+  assert(curstate == 1);
+  curstate = 2;
+#endif
   for (;;) {
     hash_permutation(&state);
     if (n <= HASH_DATA_AREA) {
@@ -31,13 +31,17 @@
 #include <assert.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include "common/int-util.h"
 #include "hash-ops.h"
+#include "initializer.h"
 #include "oaes_lib.h"
 
-#include <emmintrin.h>
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define SLOW_HASH_X86
+#endif
 
 #if defined(_MSC_VER)
 #include <intrin.h>
@@ -48,7 +52,6 @@
 #define RDATA_ALIGN16 __declspec(align(16))
 #endif
 #else
-#include <wmmintrin.h>
 #include <sys/mman.h>
 #define STATIC static
 #define INLINE inline
@@ -57,6 +60,13 @@
 #endif
 #endif
 
+#if defined(SLOW_HASH_X86)
+#include <emmintrin.h>
+#if !defined(_MSC_VER)
+#include <wmmintrin.h>
+#endif
+#endif
+
 #if defined(__INTEL_COMPILER)
 #define ASM __asm__
 #elif !defined(_MSC_VER)
@@ -86,39 +96,21 @@
 #else
 #if defined(__x86_64__)
 #define __mul() ASM("mulq %3\n\t" : "=d"(hi), "=a"(lo) : "%a" (c[0]), "rm" (b[0]) : "cc");
+#elif defined(__SIZEOF_INT128__)
+#define __mul() { unsigned __int128 prod = (unsigned __int128) c[0] * b[0]; hi = (uint64_t) (prod >> 64); lo = (uint64_t) prod; }
 #else
 #define __mul() lo = mul128(c[0], b[0], &hi);
 #endif
 #endif
 
-#define pre_aes() \
-    j = state_index(a); \
-	_c = _mm_load_si128(R128(&hp_state[j])); \
-	_a = _mm_load_si128(R128(a)); \
- 
-// dga's optimized scratchpad twiddling
-#define post_aes() \
-	_mm_store_si128(R128(c), _c); \
-	_b = _mm_xor_si128(_b, _c); \
-	_mm_store_si128(R128(&hp_state[j]), _b); \
-	j = state_index(c); \
-	p = U64(&hp_state[j]); \
-	b[0] = p[0]; b[1] = p[1]; \
-	__mul(); \
-	a[0] += hi; a[1] += lo; \
-	p = U64(&hp_state[j]); \
-	p[0] = a[0];  p[1] = a[1]; \
-	a[0] ^= b[0]; a[1] ^= b[1]; \
-	_b = _c; \
- 
 #if defined(_MSC_VER)
 #define THREADV __declspec(thread)
 #else
 #define THREADV __thread
 #endif
 
-extern int aesb_single_round(const uint8_t *in, uint8_t*out, const uint8_t *expandedKey);
-extern int aesb_pseudo_round(const uint8_t *in, uint8_t *out, const uint8_t *expandedKey);
+extern void aesb_single_round(const uint8_t *in, uint8_t *out, uint8_t *expandedKey);
+extern void aesb_pseudo_round(const uint8_t *in, uint8_t *out, uint8_t *expandedKey);
 
 #pragma pack(push, 1)
 union cn_slow_hash_state
@@ -135,10 +127,201 @@ union cn_slow_hash_state
 THREADV uint8_t *hp_state = NULL;
 THREADV int hp_allocated = 0;
 
+STATIC INLINE void xor_blocks(uint8_t *a, const uint8_t *b)
+{
+    U64(a)[0] ^= U64(b)[0];
+    U64(a)[1] ^= U64(b)[1];
+}
+
+STATIC INLINE void copy_block(uint8_t *dst, const uint8_t *src)
+{
+    U64(dst)[0] = U64(src)[0];
+    U64(dst)[1] = U64(src)[1];
+}
+
+#if defined(_MSC_VER)
+BOOL SetLockPagesPrivilege(HANDLE hProcess, BOOL bEnable)
+{
+    struct
+    {
+        DWORD count;
+        LUID_AND_ATTRIBUTES privilege[1];
+    } info;
+
+    HANDLE token;
+    if(!OpenProcessToken(hProcess, TOKEN_ADJUST_PRIVILEGES, &token))
+        return FALSE;
+
+    info.count = 1;
+    info.privilege[0].Attributes = bEnable ? SE_PRIVILEGE_ENABLED : 0;
+
+    if(!LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &(info.privilege[0].Luid)))
+        return FALSE;
+
+    if(!AdjustTokenPrivileges(token, FALSE, (PTOKEN_PRIVILEGES) &info, 0, NULL, NULL))
+        return FALSE;
+
+    if (GetLastError() != ERROR_SUCCESS)
+        return FALSE;
+
+    CloseHandle(token);
+
+    return TRUE;
+
+}
+#endif
+
+void slow_hash_allocate_state(void)
+{
+    int state = 0;
+    if(hp_state != NULL)
+        return;
+
+#if defined(_MSC_VER)
+    SetLockPagesPrivilege(GetCurrentProcess(), TRUE);
+    hp_state = (uint8_t *) VirtualAlloc(hp_state, MEMORY, MEM_LARGE_PAGES |
+                                        MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+#else
+#if defined(__APPLE__) || defined(__FreeBSD__)
+    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANON, 0, 0);    
+#else
+    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
+#endif
+    if(hp_state == MAP_FAILED)
+        hp_state = NULL;
+#endif
+    hp_allocated = 1;
+    if(hp_state == NULL)
+    {
+        hp_allocated = 0;
+        hp_state = (uint8_t *) malloc(MEMORY);
+    }
+}
+
+void slow_hash_free_state(void)
+{
+    if(hp_state == NULL)
+        return;
+
+    if(!hp_allocated)
+        free(hp_state);
+    else
+    {
+#if defined(_MSC_VER)
+        VirtualFree(hp_state, MEMORY, MEM_RELEASE);
+#else
+        munmap(hp_state, MEMORY);
+#endif
+    }
+
+    hp_state = NULL;
+    hp_allocated = 0;
+}
+
+
+/*
+ * Every variant below runs the whole hash with its AES implementation fixed at compile
+ * time, so neither the scratchpad loops nor the 1M iterations main loop look at the CPU.
+ * cn_slow_hash goes through cn_slow_hash_impl, which is picked once at static
+ * initialization, before any miner or verification thread can call it.
+ */
+
+static void (*const extra_hashes[4])(const void *, size_t, char *) =
+{
+    hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
+};
+
+STATIC INLINE void slow_hash_begin(union cn_slow_hash_state *state, const void *data, size_t length)
+{
+    // this isn't supposed to happen, but guard against it for now.
+    if(hp_state == NULL)
+        slow_hash_allocate_state();
+
+    hash_process(&state->hs, data, length);
+}
+
+STATIC INLINE void slow_hash_init_ab(const union cn_slow_hash_state *state, uint64_t *a, uint64_t *b)
+{
+    a[0] = U64(&state->k[0])[0] ^ U64(&state->k[32])[0];
+    a[1] = U64(&state->k[0])[1] ^ U64(&state->k[32])[1];
+    b[0] = U64(&state->k[16])[0] ^ U64(&state->k[48])[0];
+    b[1] = U64(&state->k[16])[1] ^ U64(&state->k[48])[1];
+}
+
+STATIC INLINE void slow_hash_end(union cn_slow_hash_state *state, const uint8_t *text, char *hash)
+{
+    memcpy(state->init, text, INIT_SIZE_BYTE);
+    hash_permutation(&state->hs);
+    extra_hashes[state->hs.b[0] & 3](state, 200, hash);
+}
+
+void cn_slow_hash_portable(const void *data, size_t length, char *hash)
+{
+    uint8_t text[INIT_SIZE_BYTE];
+    RDATA_ALIGN16 uint64_t a[2];
+    RDATA_ALIGN16 uint64_t b[2];
+    RDATA_ALIGN16 uint64_t c[2];
+    union cn_slow_hash_state state;
+    uint64_t hi, lo;
+
+    size_t i, j;
+    oaes_ctx *aes_ctx;
+
+    slow_hash_begin(&state, data, length);
+    memcpy(text, state.init, INIT_SIZE_BYTE);
+
+    aes_ctx = (oaes_ctx *) oaes_alloc();
+    oaes_key_import_data(aes_ctx, state.hs.b, AES_KEY_SIZE);
+    for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
+    {
+        for(j = 0; j < INIT_SIZE_BLK; j++)
+            aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
+
+        memcpy(&hp_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
+    }
+
+    slow_hash_init_ab(&state, a, b);
+
+    // same steps as pre_aes() / post_aes() of the AES-NI variant, on plain 64-bit words
+    for(i = 0; i < ITER / 2; i++)
+    {
+        j = state_index(a);
+        copy_block((uint8_t *) c, &hp_state[j]);
+        aesb_single_round((uint8_t *) c, (uint8_t *) c, (uint8_t *) a);
+        xor_blocks((uint8_t *) b, (uint8_t *) c);
+        copy_block(&hp_state[j], (uint8_t *) b);
+        j = state_index(c);
+        copy_block((uint8_t *) b, &hp_state[j]);
+        __mul();
+        a[0] += hi; a[1] += lo;
+        copy_block(&hp_state[j], (uint8_t *) a);
+        xor_blocks((uint8_t *) a, (uint8_t *) b);
+        copy_block((uint8_t *) b, (uint8_t *) c);
+    }
+
+    memcpy(text, state.init, INIT_SIZE_BYTE);
+    oaes_key_import_data(aes_ctx, &state.hs.b[32], AES_KEY_SIZE);
+    for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
+    {
+        for(j = 0; j < INIT_SIZE_BLK; j++)
+        {
+            xor_blocks(&text[j * AES_BLOCK_SIZE], &hp_state[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]);
+            aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
+        }
+    }
+    oaes_free((OAES_CTX **) &aes_ctx);
+
+    slow_hash_end(&state, text, hash);
+}
+
+#if defined(SLOW_HASH_X86)
+
 #if defined(_MSC_VER)
 #define cpuid(info,x)    __cpuidex(info,x,0)
 #else
-void cpuid(int CPUInfo[4], int InfoType)
+STATIC void cpuid(int CPUInfo[4], int InfoType)
 {
     ASM __volatile__
     (
@@ -152,24 +335,34 @@ void cpuid(int CPUInfo[4], int InfoType)
 }
 #endif
 
-STATIC INLINE void xor_blocks(uint8_t *a, const uint8_t *b)
-{
-    U64(a)[0] ^= U64(b)[0];
-    U64(a)[1] ^= U64(b)[1];
-}
-
 STATIC INLINE int check_aes_hw(void)
 {
     int cpuid_results[4];
-    static int supported = -1;
-
-    if(supported >= 0)
-        return supported;
 
     cpuid(cpuid_results,1);
-    return supported = cpuid_results[2] & (1 << 25);
+    return cpuid_results[2] & (1 << 25);
 }
 
+#define pre_aes() \
+    j = state_index(a); \
+	_c = _mm_load_si128(R128(&hp_state[j])); \
+	_a = _mm_load_si128(R128(a)); \
+ 
+// dga's optimized scratchpad twiddling
+#define post_aes() \
+	_mm_store_si128(R128(c), _c); \
+	_b = _mm_xor_si128(_b, _c); \
+	_mm_store_si128(R128(&hp_state[j]), _b); \
+	j = state_index(c); \
+	p = U64(&hp_state[j]); \
+	b[0] = p[0]; b[1] = p[1]; \
+	__mul(); \
+	a[0] += hi; a[1] += lo; \
+	p = U64(&hp_state[j]); \
+	p[0] = a[0];  p[1] = a[1]; \
+	a[0] ^= b[0]; a[1] ^= b[1]; \
+	_b = _c; \
+ 
 STATIC INLINE void aes_256_assist1(__m128i* t1, __m128i * t2)
 {
     __m128i t4;
@@ -287,88 +480,7 @@ STATIC INLINE void aes_pseudo_round_xor(const uint8_t *in, uint8_t *out,
     }
 }
 
-#if defined(_MSC_VER)
-BOOL SetLockPagesPrivilege(HANDLE hProcess, BOOL bEnable)
-{
-    struct
-    {
-        DWORD count;
-        LUID_AND_ATTRIBUTES privilege[1];
-    } info;
-
-    HANDLE token;
-    if(!OpenProcessToken(hProcess, TOKEN_ADJUST_PRIVILEGES, &token))
-        return FALSE;
-
-    info.count = 1;
-    info.privilege[0].Attributes = bEnable ? SE_PRIVILEGE_ENABLED : 0;
-
-    if(!LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &(info.privilege[0].Luid)))
-        return FALSE;
-
-    if(!AdjustTokenPrivileges(token, FALSE, (PTOKEN_PRIVILEGES) &info, 0, NULL, NULL))
-        return FALSE;
-
-    if (GetLastError() != ERROR_SUCCESS)
-        return FALSE;
-
-    CloseHandle(token);
-
-    return TRUE;
-
-}
-#endif
-
-void slow_hash_allocate_state(void)
-{
-    int state = 0;
-    if(hp_state != NULL)
-        return;
-
-#if defined(_MSC_VER)
-    SetLockPagesPrivilege(GetCurrentProcess(), TRUE);
-    hp_state = (uint8_t *) VirtualAlloc(hp_state, MEMORY, MEM_LARGE_PAGES |
-                                        MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
-#else
-#if defined(__APPLE__) || defined(__FreeBSD__)
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANON, 0, 0);    
-#else
-    hp_state = mmap(0, MEMORY, PROT_READ | PROT_WRITE,
-                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, 0, 0);
-#endif
-    if(hp_state == MAP_FAILED)
-        hp_state = NULL;
-#endif
-    hp_allocated = 1;
-    if(hp_state == NULL)
-    {
-        hp_allocated = 0;
-        hp_state = (uint8_t *) malloc(MEMORY);
-    }
-}
-
-void slow_hash_free_state(void)
-{
-    if(hp_state == NULL)
-        return;
-
-    if(!hp_allocated)
-        free(hp_state);
-    else
-    {
-#if defined(_MSC_VER)
-        VirtualFree(hp_state, MEMORY, MEM_RELEASE);
-#else
-        munmap(hp_state, MEMORY);
-#endif
-    }
-
-    hp_state = NULL;
-    hp_allocated = 0;
-}
-
-void cn_slow_hash(const void *data, size_t length, char *hash)
+STATIC void cn_slow_hash_aesni(const void *data, size_t length, char *hash)
 {
     RDATA_ALIGN16 uint8_t expandedKey[240];
 
@@ -382,95 +494,58 @@ void cn_slow_hash(const void *data, size_t length, char *hash)
 
     size_t i, j;
     uint64_t *p = NULL;
-    oaes_ctx *aes_ctx;
-    int useAes = check_aes_hw();
 
-    static void (*const extra_hashes[4])(const void *, size_t, char *) =
-    {
-        hash_extra_blake, hash_extra_groestl, hash_extra_jh, hash_extra_skein
-    };
-
-    // this isn't supposed to happen, but guard against it for now.
-    if(hp_state == NULL)
-        slow_hash_allocate_state();
-
-    hash_process(&state.hs, data, length);
+    slow_hash_begin(&state, data, length);
     memcpy(text, state.init, INIT_SIZE_BYTE);
 
-    if(useAes)
-    {
-        aes_expand_key(state.hs.b, expandedKey);
-        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
-        {
-            aes_pseudo_round(text, text, expandedKey, INIT_SIZE_BLK);
-            memcpy(&hp_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
-        }
-    }
-    else
+    aes_expand_key(state.hs.b, expandedKey);
+    for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
     {
-        aes_ctx = (oaes_ctx *) oaes_alloc();
-        oaes_key_import_data(aes_ctx, state.hs.b, AES_KEY_SIZE);
-        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
-        {
-            for(j = 0; j < INIT_SIZE_BLK; j++)
-                aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
-
-            memcpy(&hp_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
-        }
+        aes_pseudo_round(text, text, expandedKey, INIT_SIZE_BLK);
+        memcpy(&hp_state[i * INIT_SIZE_BYTE], text, INIT_SIZE_BYTE);
     }
 
-    U64(a)[0] = U64(&state.k[0])[0] ^ U64(&state.k[32])[0];
-    U64(a)[1] = U64(&state.k[0])[1] ^ U64(&state.k[32])[1];
-    U64(b)[0] = U64(&state.k[16])[0] ^ U64(&state.k[48])[0];
-    U64(b)[1] = U64(&state.k[16])[1] ^ U64(&state.k[48])[1];
+    slow_hash_init_ab(&state, a, b);
 
     _b = _mm_load_si128(R128(b));
-    // this is ugly but the branching affects the loop somewhat so put it outside.
-    if(useAes)
+    for(i = 0; i < ITER / 2; i++)
     {
-        for(i = 0; i < ITER / 2; i++)
-        {
-            pre_aes();
-            _c = _mm_aesenc_si128(_c, _a);
-            // post_aes(), optimized scratchpad twiddling (credits to dga)
-            post_aes();
-        }
-    }
-    else
-    {
-        for(i = 0; i < ITER / 2; i++)
-        {
-            pre_aes();
-            aesb_single_round((uint8_t *) &_c, (uint8_t *) &_c, (uint8_t *) &_a);
-            post_aes();
-        }
+        pre_aes();
+        _c = _mm_aesenc_si128(_c, _a);
+        // post_aes(), optimized scratchpad twiddling (credits to dga)
+        post_aes();
     }
 
     memcpy(text, state.init, INIT_SIZE_BYTE);
-    if(useAes)
+    aes_expand_key(&state.hs.b[32], expandedKey);
+    for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
     {
-        aes_expand_key(&state.hs.b[32], expandedKey);
-        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
-        {
-            // add the xor to the pseudo round
-            aes_pseudo_round_xor(text, text, expandedKey, &hp_state[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
-        }
+        // add the xor to the pseudo round
+        aes_pseudo_round_xor(text, text, expandedKey, &hp_state[i * INIT_SIZE_BYTE], INIT_SIZE_BLK);
     }
-    else
+
+    slow_hash_end(&state, text, hash);
+}
+
+#endif
+
+typedef void (*slow_hash_fn)(const void *data, size_t length, char *hash);
+
+// the portable variant is correct everywhere, so it also covers calls made before the
+// initializer below has run; after that the pointer is never written again
+static slow_hash_fn cn_slow_hash_impl = cn_slow_hash_portable;
+
+INITIALIZER(select_slow_hash)
+{
+#if defined(SLOW_HASH_X86)
+    if(check_aes_hw())
     {
-        oaes_key_import_data(aes_ctx, &state.hs.b[32], AES_KEY_SIZE);
-        for(i = 0; i < MEMORY / INIT_SIZE_BYTE; i++)
-        {
-            for(j = 0; j < INIT_SIZE_BLK; j++)
-            {
-                xor_blocks(&text[j * AES_BLOCK_SIZE], &hp_state[i * INIT_SIZE_BYTE + j * AES_BLOCK_SIZE]);
-                aesb_pseudo_round(&text[AES_BLOCK_SIZE * j], &text[AES_BLOCK_SIZE * j], aes_ctx->key->exp_data);
-            }
-        }
-        oaes_free((OAES_CTX **) &aes_ctx);
+        cn_slow_hash_impl = cn_slow_hash_aesni;
     }
+#endif
+}
 
-    memcpy(state.init, text, INIT_SIZE_BYTE);
-    hash_permutation(&state.hs);
-    extra_hashes[state.hs.b[0] & 3](&state, 200, hash);
+void cn_slow_hash(const void *data, size_t length, char *hash)
+{
+    cn_slow_hash_impl(data, length, hash);
 }
@@ -78,17 +78,30 @@
 
 #define BLOCKS_IDS_SYNCHRONIZING_DEFAULT_COUNT          10000  //by default, blocks ids count in synchronizing
 #define BLOCKS_SYNCHRONIZING_DEFAULT_COUNT              200    //by default, blocks count in blocks downloading
+#define BLOCKS_SYNCHRONIZING_MIN_COUNT                  20     //blocks span limits for peers with measured speed
+#define BLOCKS_SYNCHRONIZING_MAX_COUNT                  500
+#define BLOCKS_SYNCHRONIZING_TARGET_TIME                10000  //ms, blocks span is sized to be fetched in this time
 #define CRYPTONOTE_PROTOCOL_HOP_RELAX_COUNT             3      //value of hop, after which we use only announce of new block
 
 #define CRYPTONOTE_MEMPOOL_TX_LIVETIME                    86400 //seconds, one day
 #define CRYPTONOTE_MEMPOOL_TX_FROM_ALT_BLOCK_LIVETIME     604800 //seconds, one week
 
+#define CRYPTONOTE_OUTPUT_KEYS_CACHE_MAX_COUNT          8192   //outputs keys with tables for ring signature checks, about 2.5 KB each, 0 disables
+#define CRYPTONOTE_STORE_BATCH_BLOCKS                   1000   //blocks or transactions written to blockchain file per m_blockchain_lock hold while storing
+#define CRYPTONOTE_CONSTRUCT_TX_MIN_ITEMS_PER_THREAD 4    //inputs or outputs per thread before construct_tx spreads a pass over several threads by default
+
 #define COMMAND_RPC_GET_BLOCKS_FAST_MAX_COUNT           1000
+#define COMMAND_RPC_GET_BLOCK_HEADERS_RANGE_MAX_COUNT   1000
+#define COMMAND_RPC_WAIT_FOR_CHANGES_MAX_TIMEOUT        120 //seconds
+#define COMMAND_RPC_WAIT_FOR_CHANGES_MAX_WAITERS        1000
+#define COMMAND_RPC_GETBLOCKTEMPLATE_REFRESH_INTERVAL   5 //seconds, cached template is rebuilt for new pool transactions not more often
+#define COMMAND_RPC_GETBLOCKTEMPLATE_CACHE_SIZE         64
 
 #define P2P_LOCAL_WHITE_PEERLIST_LIMIT                  1000
 #define P2P_LOCAL_GRAY_PEERLIST_LIMIT                   5000
 
 #define P2P_DEFAULT_CONNECTIONS_COUNT                   12
+#define P2P_DEFAULT_CONNECTIONS_FANOUT                  8            //outgoing connection attempts in flight at once
 #define P2P_DEFAULT_HANDSHAKE_INTERVAL                  60           //secondes
 #define P2P_DEFAULT_PACKET_MAX_SIZE                     50000000     //50000000 bytes maximum packet size
 #define P2P_DEFAULT_PEERS_IN_HANDSHAKE                  250
@@ -97,6 +110,11 @@
 #define P2P_DEFAULT_INVOKE_TIMEOUT                      60*2*1000  //2 minutes
 #define P2P_DEFAULT_HANDSHAKE_INVOKE_TIMEOUT            5000       //5 seconds
 #define P2P_DEFAULT_WHITELIST_CONNECTIONS_PERCENT       70
+#define P2P_DEFAULT_PEER_RTT                            1000       //ms, assumed for peers without measured handshake
+#define P2P_DEFAULT_PEER_THROUGHPUT                     50000      //bytes per second, assumed for peers without measured transfer
+#define P2P_PEER_SCORE_REFERENCE_SIZE                   500000     //bytes, peer score is the estimated time to fetch this much
+#define P2P_PEER_FAIL_PENALTY                           10000      //ms added to peer score per failed connection attempt
+#define P2P_PEER_FAIL_HALF_LIFE                         3600       //seconds, failed attempts count half as much this long after the last one
 
 #define ALLOW_DEBUG_COMMANDS
 
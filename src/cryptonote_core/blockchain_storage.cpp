@@ -53,6 +53,16 @@ using namespace cryptonote;
 
 DISABLE_VS_WARNINGS(4267)
 
+//------------------------------------------------------------------
+void blockchain_storage::lock()
+{
+  m_blockchain_lock.lock();
+}
+//------------------------------------------------------------------
+void blockchain_storage::unlock()
+{
+  m_blockchain_lock.unlock();
+}
 //------------------------------------------------------------------
 bool blockchain_storage::have_tx(const crypto::hash &id)
 {
@@ -178,9 +188,57 @@ bool blockchain_storage::store_genesis_block(bool testnet) {
 //------------------------------------------------------------------
 bool blockchain_storage::store_blockchain()
 {
+  CRITICAL_REGION_LOCAL(m_store_lock);
+  // Only the chain height, block ids index, transaction ids, key images, outputs counts per amount and
+  // the alternative and invalid blocks are copied under m_blockchain_lock. Blocks, transactions and
+  // outputs below the height are written from the live containers, m_blockchain_lock is held for one
+  // batch of them at a time. Extra memory is tens of bytes per block, transaction and key image plus
+  // one amount's outputs, not a second copy of the chain.
+  store_snapshot snapshot;
+  {
+    m_is_blockchain_storing = true;
+    epee::misc_utils::auto_scope_leave_caller scope_exit_handler = epee::misc_utils::create_scope_leave_handler([&](){m_is_blockchain_storing=false;});
+    CRITICAL_REGION_LOCAL1(m_blockchain_lock);
+    snapshot.height = m_blocks.size();
+    snapshot.blocks_index = m_blocks_index;
+    snapshot.transactions.reserve(m_transactions.size());
+    BOOST_FOREACH(const auto& tx, m_transactions)
+      snapshot.transactions.push_back(tx.first);
+    snapshot.spent_keys = m_spent_keys;
+    snapshot.outputs_counts.reserve(m_outputs.size());
+    BOOST_FOREACH(const auto& amount_outs, m_outputs)
+      snapshot.outputs_counts.push_back(std::make_pair(amount_outs.first, amount_outs.second.size()));
+    snapshot.alternative_chains = m_alternative_chains;
+    snapshot.invalid_blocks = m_invalid_blocks;
+    snapshot.current_block_cumul_sz_limit = m_current_block_cumul_sz_limit;
+    snapshot.broken = false;
+    m_store_min_height = snapshot.height;
+  }
+
+  m_store_snapshot = &snapshot;
+  bool r = store_blockchain_data(*this);
+  m_store_snapshot = NULL;
+  if(r || !snapshot.broken)
+    return r;
+
+  // chain was reorganized below snapshot height meanwhile, store it as a whole under the lock
+  LOG_PRINT_L0("Blockchain changed below snapshot height while storing, storing it again under lock");
   m_is_blockchain_storing = true;
   epee::misc_utils::auto_scope_leave_caller scope_exit_handler = epee::misc_utils::create_scope_leave_handler([&](){m_is_blockchain_storing=false;});
-
+  CRITICAL_REGION_LOCAL1(m_blockchain_lock);
+  return store_blockchain_data(*this);
+}
+//------------------------------------------------------------------
+void blockchain_storage::check_store_snapshot(bool ok, const char* what)
+{
+  if(ok)
+    return;
+  m_store_snapshot->broken = true;
+  throw std::runtime_error(what);
+}
+//------------------------------------------------------------------
+bool blockchain_storage::store_blockchain_data(blockchain_storage& bs)
+{
   LOG_PRINT_L0("Storing blockchain...");
   if (!tools::create_directories_if_necessary(m_config_folder))
   {
@@ -191,7 +249,7 @@ bool blockchain_storage::store_blockchain()
   const std::string temp_filename = m_config_folder + "/" CRYPTONOTE_BLOCKCHAINDATA_TEMP_FILENAME;
   // There is a chance that temp_filename and filename are hardlinks to the same file
   std::remove(temp_filename.c_str());
-  if(!tools::serialize_obj_to_file(*this, temp_filename))
+  if(!tools::serialize_obj_to_file(bs, temp_filename))
   {
     //achtung!
     LOG_ERROR("Failed to save blockchain data to file: " << temp_filename);
@@ -210,7 +268,11 @@ bool blockchain_storage::store_blockchain()
 //------------------------------------------------------------------
 bool blockchain_storage::deinit()
 {
-  return store_blockchain();
+  // nothing else touches the chain at shutdown, so skip the copy
+  CRITICAL_REGION_LOCAL(m_store_lock);
+  m_is_blockchain_storing = true;
+  epee::misc_utils::auto_scope_leave_caller scope_exit_handler = epee::misc_utils::create_scope_leave_handler([&](){m_is_blockchain_storing=false;});
+  return store_blockchain_data(*this);
 }
 //------------------------------------------------------------------
 bool blockchain_storage::pop_block_from_blockchain()
@@ -230,6 +292,7 @@ bool blockchain_storage::pop_block_from_blockchain()
   m_blocks_index.erase(bl_ind);
   //pop block from core
   m_blocks.pop_back();
+  m_store_min_height = std::min<uint64_t>(m_store_min_height, m_blocks.size());
   m_tx_pool.on_blockchain_dec(m_blocks.size()-1, get_tail_id());
   return true;
 }
@@ -243,6 +306,8 @@ bool blockchain_storage::reset_and_set_genesis_block(const block& b)
   m_blocks_index.clear();
   m_alternative_chains.clear();
   m_outputs.clear();
+  m_output_keys_cache.clear();
+  m_store_min_height = 0;
 
   block_verification_context bvc = boost::value_initialized<block_verification_context>();
   add_new_block(b, bvc);
@@ -850,6 +915,8 @@ bool blockchain_storage::handle_alternative_block(const block& b, const crypto::
 
     block_extended_info bei = boost::value_initialized<block_extended_info>();
     bei.bl = b;
+    bei.hash = id;
+    bei.reward = get_outs_money_amount(b.miner_tx);
     bei.height = alt_chain.size() ? it_prev->second.height + 1 : it_main_prev->second + 1;
 
     bool is_a_checkpoint;
@@ -1145,6 +1212,32 @@ uint64_t blockchain_storage::block_difficulty(size_t i)
   return m_blocks[i].cumulative_difficulty - m_blocks[i-1].cumulative_difficulty;
 }
 //------------------------------------------------------------------
+bool blockchain_storage::get_block_headers(uint64_t start_height, uint64_t end_height, std::list<block_header_responce>& headers)
+{
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
+  CHECK_AND_ASSERT_MES(start_height <= end_height && end_height < m_blocks.size(), false, "wrong block headers range " << start_height << " - " << end_height << ", blockchain height " << m_blocks.size());
+
+  for(uint64_t i = start_height; i <= end_height; ++i)
+  {
+    const block_extended_info& bei = m_blocks[i];
+    headers.push_back(block_header_responce());
+    block_header_responce& h = headers.back();
+    h.major_version = bei.bl.major_version;
+    h.minor_version = bei.bl.minor_version;
+    h.timestamp = bei.bl.timestamp;
+    h.prev_hash = epee::string_tools::pod_to_hex(bei.bl.prev_id);
+    h.nonce = bei.bl.nonce;
+    h.orphan_status = false;
+    h.height = i;
+    h.depth = m_blocks.size() - i - 1;
+    h.hash = epee::string_tools::pod_to_hex(bei.hash);
+    h.difficulty = i ? bei.cumulative_difficulty - m_blocks[i - 1].cumulative_difficulty : bei.cumulative_difficulty;
+    h.reward = bei.reward;
+    h.block_size = bei.block_cumulative_size;
+  }
+  return true;
+}
+//------------------------------------------------------------------
 void blockchain_storage::print_blockchain(uint64_t start_index, uint64_t end_index)
 {
   std::stringstream ss;
@@ -1238,6 +1331,7 @@ bool blockchain_storage::add_block_as_invalid(const block& bl, const crypto::has
 {
   block_extended_info bei = AUTO_VAL_INIT(bei);
   bei.bl = bl;
+  bei.hash = h;
   return add_block_as_invalid(bei, h);
 }
 //------------------------------------------------------------------
@@ -1426,12 +1520,18 @@ bool blockchain_storage::check_tx_inputs(const transaction& tx, uint64_t* pmax_u
   return check_tx_inputs(tx, tx_prefix_hash, pmax_used_block_height);
 }
 //------------------------------------------------------------------
-bool blockchain_storage::check_tx_inputs(const transaction& tx, const crypto::hash& tx_prefix_hash, uint64_t* pmax_used_block_height)
+bool blockchain_storage::check_tx_inputs(const transaction& tx, const crypto::hash& tx_prefix_hash, uint64_t* pmax_used_block_height, crypto::ring_signature_batch* psig_batch)
 {
+  //m_output_keys_cache is shared by all checks
+  CRITICAL_REGION_LOCAL(m_blockchain_lock);
   size_t sig_index = 0;
   if(pmax_used_block_height)
     *pmax_used_block_height = 0;
 
+  //without caller's batch, ring signatures of this transaction are checked together at the end
+  crypto::ring_signature_batch tx_sig_batch(&m_output_keys_cache);
+  crypto::ring_signature_batch& sig_batch = psig_batch ? *psig_batch : tx_sig_batch;
+
   BOOST_FOREACH(const auto& txin,  tx.vin)
   {
     CHECK_AND_ASSERT_MES(txin.type() == typeid(txin_to_key), false, "wrong type id in tx input at blockchain_storage::check_tx_inputs");
@@ -1446,7 +1546,7 @@ bool blockchain_storage::check_tx_inputs(const transaction& tx, const crypto::ha
     }
 
     CHECK_AND_ASSERT_MES(sig_index < tx.signatures.size(), false, "wrong transaction: not signature entry for input with index= " << sig_index);
-    if(!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[sig_index], pmax_used_block_height))
+    if(!check_tx_input(in_to_key, tx_prefix_hash, tx.signatures[sig_index], pmax_used_block_height, &sig_batch))
     {
       LOG_PRINT_L1("Failed to check ring signature for tx " << get_transaction_hash(tx));
       return false;
@@ -1455,6 +1555,12 @@ bool blockchain_storage::check_tx_inputs(const transaction& tx, const crypto::ha
     sig_index++;
   }
 
+  if(!psig_batch && !tx_sig_batch.verify())
+  {
+    LOG_PRINT_L1("Failed to check ring signature for tx " << get_transaction_hash(tx));
+    return false;
+  }
+
   return true;
 }
 //------------------------------------------------------------------
@@ -1479,7 +1585,7 @@ bool blockchain_storage::is_tx_spendtime_unlocked(uint64_t unlock_time)
   return false;
 }
 //------------------------------------------------------------------
-bool blockchain_storage::check_tx_input(const txin_to_key& txin, const crypto::hash& tx_prefix_hash, const std::vector<crypto::signature>& sig, uint64_t* pmax_related_block_height)
+bool blockchain_storage::check_tx_input(const txin_to_key& txin, const crypto::hash& tx_prefix_hash, const std::vector<crypto::signature>& sig, uint64_t* pmax_related_block_height, crypto::ring_signature_batch* psig_batch)
 {
   CRITICAL_REGION_LOCAL(m_blockchain_lock);
 
@@ -1526,6 +1632,12 @@ bool blockchain_storage::check_tx_input(const txin_to_key& txin, const crypto::h
   CHECK_AND_ASSERT_MES(sig.size() == output_keys.size(), false, "internal error: tx signatures count=" << sig.size() << " mismatch with outputs keys count for inputs=" << output_keys.size());
   if(m_is_in_checkpoint_zone)
     return true;
+  if(psig_batch)
+  {
+    //signature is checked later by psig_batch->verify()
+    psig_batch->add(tx_prefix_hash, txin.k_image, output_keys, sig.data());
+    return true;
+  }
   return crypto::check_ring_signature(tx_prefix_hash, txin.k_image, output_keys, sig.data());
 }
 //------------------------------------------------------------------
@@ -1645,6 +1757,7 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
   }
   size_t tx_processed_count = 0;
   uint64_t fee_summary = 0;
+  m_block_sig_batch.clear();
   BOOST_FOREACH(const crypto::hash& tx_id, bl.tx_hashes)
   {
     transaction tx;
@@ -1658,7 +1771,7 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
       bvc.m_verifivation_failed = true;
       return false;
     }
-    if(!check_tx_inputs(tx))
+    if(!check_tx_inputs(tx, get_transaction_prefix_hash(tx), NULL, &m_block_sig_batch))
     {
       LOG_PRINT_L1("Block with id: " << id  << "has at least one transaction (id: " << tx_id << ") with wrong inputs.");
       cryptonote::tx_verification_context tvc = AUTO_VAL_INIT(tvc);
@@ -1685,6 +1798,16 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
     cumulative_block_size += blob_size;
     ++tx_processed_count;
   }
+  //ring signatures of all transactions are checked at once, ring members shared between inputs are decompressed only once
+  if(!m_block_sig_batch.verify())
+  {
+    LOG_PRINT_L1("Block with id: " << id  << " has at least one transaction with wrong ring signature.");
+    purge_block_data_from_blockchain(bl, tx_processed_count);
+    add_block_as_invalid(bl, id);
+    LOG_PRINT_L1("Block with id " << id << " added as invalid becouse of wrong inputs in transactions");
+    bvc.m_verifivation_failed = true;
+    return false;
+  }
   uint64_t base_reward = 0;
   uint64_t already_generated_coins = m_blocks.size() ? m_blocks.back().already_generated_coins:0;
   if(!validate_miner_transaction(bl, cumulative_block_size, fee_summary, base_reward, already_generated_coins))
@@ -1702,6 +1825,8 @@ bool blockchain_storage::handle_block_to_main_chain(const block& bl, const crypt
   bei.block_cumulative_size = cumulative_block_size;
   bei.cumulative_difficulty = current_diffic;
   bei.already_generated_coins = already_generated_coins + base_reward;
+  bei.hash = id;
+  bei.reward = get_outs_money_amount(bl.miner_tx);
   if(m_blocks.size())
     bei.cumulative_difficulty += m_blocks.back().cumulative_difficulty;
 
@@ -32,12 +32,18 @@
 #include <boost/serialization/serialization.hpp>
 #include <boost/serialization/version.hpp>
 #include <boost/serialization/list.hpp>
+#include <boost/serialization/collection_size_type.hpp>
+#include <boost/serialization/item_version_type.hpp>
+#include <boost/serialization/nvp.hpp>
+#include <boost/mpl/bool.hpp>
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/global_fun.hpp>
 #include <boost/multi_index/hashed_index.hpp>
 #include <boost/multi_index/member.hpp>
 #include <boost/foreach.hpp>
 #include <atomic>
+#include <functional>
+#include <memory>
 
 #include "syncobj.h"
 #include "string_tools.h"
@@ -76,9 +82,11 @@ namespace cryptonote
       size_t block_cumulative_size;
       difficulty_type cumulative_difficulty;
       uint64_t already_generated_coins;
+      crypto::hash hash;
+      uint64_t reward;                    //sum of miner tx outputs
     };
 
-    blockchain_storage(tx_memory_pool& tx_pool):m_tx_pool(tx_pool), m_current_block_cumul_sz_limit(0), m_is_in_checkpoint_zone(false), m_is_blockchain_storing(false)
+    blockchain_storage(tx_memory_pool& tx_pool):m_tx_pool(tx_pool), m_current_block_cumul_sz_limit(0), m_output_keys_cache(CRYPTONOTE_OUTPUT_KEYS_CACHE_MAX_COUNT), m_block_sig_batch(&m_output_keys_cache), m_is_in_checkpoint_zone(false), m_is_blockchain_storing(false), m_store_snapshot(NULL), m_store_min_height(0)
     {};
 
     bool init() { return init(tools::get_default_data_dir(), true); }
@@ -127,12 +135,16 @@ namespace cryptonote
     bool get_backward_blocks_sizes(size_t from_height, std::vector<size_t>& sz, size_t count);
     bool get_tx_outputs_gindexs(const crypto::hash& tx_id, std::vector<uint64_t>& indexs);
     bool store_blockchain();
-    bool check_tx_input(const txin_to_key& txin, const crypto::hash& tx_prefix_hash, const std::vector<crypto::signature>& sig, uint64_t* pmax_related_block_height = NULL);
-    bool check_tx_inputs(const transaction& tx, const crypto::hash& tx_prefix_hash, uint64_t* pmax_used_block_height = NULL);
+    bool check_tx_input(const txin_to_key& txin, const crypto::hash& tx_prefix_hash, const std::vector<crypto::signature>& sig, uint64_t* pmax_related_block_height = NULL, crypto::ring_signature_batch* psig_batch = NULL);
+    bool check_tx_inputs(const transaction& tx, const crypto::hash& tx_prefix_hash, uint64_t* pmax_used_block_height = NULL, crypto::ring_signature_batch* psig_batch = NULL);
     bool check_tx_inputs(const transaction& tx, uint64_t* pmax_used_block_height = NULL);
     bool check_tx_inputs(const transaction& tx, uint64_t& pmax_used_block_height, crypto::hash& max_used_block_id);
     uint64_t get_current_comulative_blocksize_limit();
+    // true only while the chain state is being copied for a save; the copy is then written to disk without holding m_blockchain_lock
     bool is_storing_blockchain(){return m_is_blockchain_storing;}
+    //lets callers run several queries under one acquisition of m_blockchain_lock
+    void lock();
+    void unlock();
     uint64_t block_difficulty(size_t i);
 
     template<class t_ids_container, class t_blocks_container, class t_missed_container>
@@ -176,6 +188,32 @@ namespace cryptonote
       }
       return true;
     }
+    //same as get_transactions(), but serializes found transactions right in place, without copying them
+    template<class t_ids_container, class t_blobs_container, class t_missed_container>
+    bool get_transactions_blobs(const t_ids_container& txs_ids, t_blobs_container& txs, t_missed_container& missed_txs)
+    {
+      CRITICAL_REGION_LOCAL(m_blockchain_lock);
+
+      BOOST_FOREACH(const auto& tx_id, txs_ids)
+      {
+        auto it = m_transactions.find(tx_id);
+        if(it == m_transactions.end())
+        {
+          blobdata tx_blob;
+          if(!m_tx_pool.get_transaction_blob(tx_id, tx_blob))
+            missed_txs.push_back(tx_id);
+          else
+            txs.push_back(std::move(tx_blob));
+        }
+        else
+        {
+          txs.push_back(blobdata());
+          CHECK_AND_ASSERT_MES(tx_to_blob(it->second.tx, txs.back()), false, "failed to serialize transaction " << tx_id);
+        }
+      }
+      return true;
+    }
+    bool get_block_headers(uint64_t start_height, uint64_t end_height, std::list<block_header_responce>& headers);
     //debug functions
     void print_blockchain(uint64_t start_index, uint64_t end_index);
     void print_blockchain_index();
@@ -207,12 +245,48 @@ namespace cryptonote
     // some invalid blocks
     blocks_ext_by_hash m_invalid_blocks;     // crypto::hash -> block_extended_info
     outputs_container m_outputs;
+    crypto::ring_member_cache m_output_keys_cache;  // decompressed outputs keys and their hash_to_ec points, for ring signature checks
+    crypto::ring_signature_batch m_block_sig_batch; // ring signatures of the block being added
 
 
     std::string m_config_folder;
     checkpoints m_checkpoints;
     std::atomic<bool> m_is_in_checkpoint_zone;
     std::atomic<bool> m_is_blockchain_storing;
+    epee::critical_section m_store_lock;     // serializes concurrent store_blockchain() calls, they share the temp file
+
+    // What store_blockchain() copies under m_blockchain_lock. Main chain below height never changes unless
+    // the chain is reorganized below it, so it is written from the live containers instead. Unordered
+    // containers are written in the order they had then, so the archive is the one serialize() wrote.
+    struct store_snapshot
+    {
+      uint64_t height;
+      blocks_by_id_index blocks_index;
+      std::vector<crypto::hash> transactions;  // keys of m_transactions, in its iteration order
+      key_images_container spent_keys;
+      std::vector<std::pair<uint64_t, size_t> > outputs_counts; // amount -> outputs count below height
+      blocks_ext_by_hash alternative_chains;
+      blocks_ext_by_hash invalid_blocks;
+      size_t current_block_cumul_sz_limit;
+      bool broken;                           // chain went below height or did not match snapshot while storing
+    };
+    // Archived in place of one of the containers, with the same class header, so its items can be
+    // written from the live containers. tag makes a distinct type for every container it stands for.
+    template<class archive_t, int tag>
+    struct store_container_view
+    {
+      std::function<void(archive_t&)> save_items;
+      void serialize(archive_t& ar, const unsigned int version) { save_items(ar); }
+    };
+    store_snapshot* m_store_snapshot;        // set while store_blockchain() writes the snapshot
+    uint64_t m_store_min_height;             // lowest chain height since last snapshot
+
+    bool store_blockchain_data(blockchain_storage& bs);
+    template<class archive_t>
+    void save_snapshot(archive_t& ar, boost::mpl::true_);
+    template<class archive_t>
+    void save_snapshot(archive_t& ar, boost::mpl::false_) {}
+    void check_store_snapshot(bool ok, const char* what);
 
     bool switch_to_alternative_blockchain(std::list<blocks_ext_by_hash::iterator>& alt_chain, bool discard_disconnected_chain);
     bool pop_block_from_blockchain();
@@ -257,6 +331,11 @@ namespace cryptonote
   {
     if(version < 11)
       return;
+    if(m_store_snapshot)
+    {
+      save_snapshot(ar, typename archive_t::is_saving());
+      return;
+    }
     CRITICAL_REGION_LOCAL(m_blockchain_lock);
     ar & m_blocks;
     ar & m_blocks_index;
@@ -352,3 +431,100 @@ namespace cryptonote
 
 
 BOOST_CLASS_VERSION(cryptonote::blockchain_storage, CURRENT_BLOCKCHAIN_STORAGE_ARCHIVE_VER)
+BOOST_CLASS_VERSION(cryptonote::blockchain_storage::block_extended_info, 1)
+
+namespace cryptonote
+{
+  // Writes the same archive as serialize() would have written for the chain at m_store_snapshot->height.
+  // m_blockchain_lock is taken for CRYPTONOTE_STORE_BATCH_BLOCKS blocks or transactions, or one amount's outputs at a time.
+  template<class archive_t>
+  void blockchain_storage::save_snapshot(archive_t& ar, boost::mpl::true_)
+  {
+    store_snapshot& s = *m_store_snapshot;
+
+    // m_blocks, in boost collection format
+    store_container_view<archive_t, 0> blocks;
+    blocks.save_items = [&](archive_t& ar)
+    {
+      const boost::serialization::collection_size_type count(s.height);
+      const boost::serialization::item_version_type item_version(boost::serialization::version<block_extended_info>::value);
+      ar << BOOST_SERIALIZATION_NVP(count);
+      ar << BOOST_SERIALIZATION_NVP(item_version);
+      for(uint64_t h = 0; h < s.height;)
+      {
+        CRITICAL_REGION_LOCAL(m_blockchain_lock);
+        check_store_snapshot(s.height <= m_store_min_height, "blockchain was reorganized below snapshot height");
+        for(uint64_t end = std::min<uint64_t>(h + CRYPTONOTE_STORE_BATCH_BLOCKS, s.height); h != end; ++h)
+        {
+          const block_extended_info& bei = m_blocks[h];
+          ar << boost::serialization::make_nvp("item", bei);
+        }
+      }
+    };
+    ar << static_cast<const store_container_view<archive_t, 0>&>(blocks);
+
+    ar << s.blocks_index;
+
+    // m_transactions, in unordered containers format
+    store_container_view<archive_t, 1> transactions;
+    transactions.save_items = [&](archive_t& ar)
+    {
+      size_t count = s.transactions.size();
+      ar << count;
+      for(size_t i = 0; i < count;)
+      {
+        CRITICAL_REGION_LOCAL(m_blockchain_lock);
+        check_store_snapshot(s.height <= m_store_min_height, "blockchain was reorganized below snapshot height");
+        for(size_t end = std::min<size_t>(i + CRYPTONOTE_STORE_BATCH_BLOCKS, count); i != end; ++i)
+        {
+          auto it = m_transactions.find(s.transactions[i]);
+          check_store_snapshot(it != m_transactions.end(), "snapshot transaction not found");
+          ar << it->first;
+          ar << it->second;
+        }
+      }
+    };
+    ar << static_cast<const store_container_view<archive_t, 1>&>(transactions);
+
+    ar << s.spent_keys;
+    ar << s.alternative_chains;
+
+    // m_outputs, in boost collection format, outputs vectors are cut to snapshot height
+    store_container_view<archive_t, 2> outputs;
+    outputs.save_items = [&](archive_t& ar)
+    {
+      const boost::serialization::collection_size_type count(s.outputs_counts.size());
+      const boost::serialization::item_version_type item_version(boost::serialization::version<outputs_container::value_type>::value);
+      ar << BOOST_SERIALIZATION_NVP(count);
+      ar << BOOST_SERIALIZATION_NVP(item_version);
+      BOOST_FOREACH(const auto& amount_count, s.outputs_counts)
+      {
+        std::unique_ptr<outputs_container::value_type> item;
+        {
+          CRITICAL_REGION_LOCAL(m_blockchain_lock);
+          check_store_snapshot(s.height <= m_store_min_height, "blockchain was reorganized below snapshot height");
+          auto it = m_outputs.find(amount_count.first);
+          check_store_snapshot(it != m_outputs.end() && amount_count.second <= it->second.size(), "snapshot outputs not found");
+          item.reset(new outputs_container::value_type(it->first, outputs_container::mapped_type(it->second.begin(), it->second.begin() + amount_count.second)));
+        }
+        const outputs_container::value_type& item_ref = *item;
+        ar << boost::serialization::make_nvp("item", item_ref);
+      }
+    };
+    ar << static_cast<const store_container_view<archive_t, 2>&>(outputs);
+
+    ar << s.invalid_blocks;
+    ar << s.current_block_cumul_sz_limit;
+
+    uint64_t total_check_count = s.height + s.blocks_index.size() + s.transactions.size() + s.spent_keys.size() + s.alternative_chains.size() + s.outputs_counts.size() + s.invalid_blocks.size() + s.current_block_cumul_sz_limit;
+    ar << total_check_count;
+
+    LOG_PRINT_L2("Blockchain storage snapshot:" << ENDL <<
+        "height: " << s.height << ENDL <<
+        "transactions: " << s.transactions.size() << ENDL <<
+        "spent keys: " << s.spent_keys.size() << ENDL <<
+        "alternative chains: " << s.alternative_chains.size() << ENDL <<
+        "outputs amounts: " << s.outputs_counts.size() << ENDL <<
+        "invalid blocks: " << s.invalid_blocks.size());
+  }
+}
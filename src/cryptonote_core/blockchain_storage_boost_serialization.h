@@ -53,6 +53,15 @@ namespace boost
       ar & ei.cumulative_difficulty;
       ar & ei.block_cumulative_size;
       ar & ei.already_generated_coins;
+      if(version < 1)
+      {
+        //older storage: calculate it once, it is saved with next store
+        ei.hash = cryptonote::get_block_hash(ei.bl);
+        ei.reward = cryptonote::get_outs_money_amount(ei.bl.miner_tx);
+        return;
+      }
+      ar & ei.hash;
+      ar & ei.reward;
     }
 
   }
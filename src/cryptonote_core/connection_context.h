@@ -33,12 +33,19 @@
 #include <atomic>
 #include "net/net_utils_base.h"
 #include "copyable_atomic.h"
+#include "cryptonote_config.h"
 
 namespace cryptonote
 {
 
   struct cryptonote_connection_context: public epee::net_utils::connection_context_base
   {
+    cryptonote_connection_context(): m_state(state_befor_handshake),
+                                     m_remote_blockchain_height(0),
+                                     m_last_response_height(0),
+                                     m_last_request_time(0),
+                                     m_blocks_span(BLOCKS_SYNCHRONIZING_DEFAULT_COUNT)
+    {}
 
     enum state
     {
@@ -53,6 +60,8 @@ namespace cryptonote
     std::unordered_set<crypto::hash> m_requested_objects;
     uint64_t m_remote_blockchain_height;
     uint64_t m_last_response_height;
+    uint64_t m_last_request_time;   //ms tick of last NOTIFY_REQUEST_GET_OBJECTS
+    size_t m_blocks_span;           //blocks count for next NOTIFY_REQUEST_GET_OBJECTS, sized by measured speed
     epee::copyable_atomic m_callback_request_count; //in debug purpose: problem with double callback rise
     //size_t m_score;  TODO: add score calculations
   };
@@ -31,6 +31,8 @@
 #include "include_base_utils.h"
 using namespace epee;
 
+#include <unordered_map>
+
 #include "cryptonote_basic_impl.h"
 #include "string_tools.h"
 #include "serialization/binary_utils.h"
@@ -136,9 +138,10 @@ namespace cryptonote {
 
     if (2 * sizeof(public_address_outer_blob) != str.size())
     {
-      blobdata data;
+      // binary form of account_public_address, the two keys back to back
+      char data[sizeof(crypto::public_key) * 2];
       uint64_t prefix;
-      if (!tools::base58::decode_addr(str, prefix, data))
+      if (!tools::base58::decode_addr(str.data(), str.size(), prefix, data, sizeof(data)))
       {
         LOG_PRINT_L1("Invalid address format");
         return false;
@@ -150,11 +153,8 @@ namespace cryptonote {
         return false;
       }
 
-      if (!::serialization::parse_binary(data, adr))
-      {
-        LOG_PRINT_L1("Account public address keys can't be parsed");
-        return false;
-      }
+      memcpy(&adr.m_spend_public_key, data, sizeof(crypto::public_key));
+      memcpy(&adr.m_view_public_key, data + sizeof(crypto::public_key), sizeof(crypto::public_key));
 
       if (!crypto::check_key(adr.m_spend_public_key) || !crypto::check_key(adr.m_view_public_key))
       {
@@ -196,6 +196,37 @@ namespace cryptonote {
 
     return true;
   }
+  //-----------------------------------------------------------------------
+  size_t get_account_addresses_from_str(
+      std::vector<account_public_address>& adrs
+    , std::vector<bool>& valid
+    , bool testnet
+    , const std::vector<std::string>& strs
+    )
+  {
+    adrs.resize(strs.size());
+    valid.resize(strs.size());
+
+    // payouts often repeat addresses, keep the index of the first occurrence
+    std::unordered_map<std::string, size_t> parsed;
+    size_t valid_count = 0;
+    for (size_t i = 0; i < strs.size(); ++i)
+    {
+      auto ins = parsed.insert(std::make_pair(strs[i], i));
+      if (ins.second)
+      {
+        valid[i] = get_account_address_from_str(adrs[i], testnet, strs[i]);
+      }
+      else
+      {
+        adrs[i] = adrs[ins.first->second];
+        valid[i] = valid[ins.first->second];
+      }
+      if (valid[i])
+        ++valid_count;
+    }
+    return valid_count;
+  }
 
   bool operator ==(const cryptonote::transaction& a, const cryptonote::transaction& b) {
     return cryptonote::get_transaction_hash(a) == cryptonote::get_transaction_hash(b);
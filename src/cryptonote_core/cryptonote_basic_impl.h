@@ -78,6 +78,15 @@ namespace cryptonote {
     , const std::string& str
     );
 
+  // parses strs[i] into adrs[i], valid[i] is false for strings that get_account_address_from_str rejects.
+  // Repeated strings are decoded and checked once. Returns the number of valid addresses
+  size_t get_account_addresses_from_str(
+      std::vector<account_public_address>& adrs
+    , std::vector<bool>& valid
+    , bool testnet
+    , const std::vector<std::string>& strs
+    );
+
   bool is_coinbase(const transaction& tx);
 
   bool operator ==(const cryptonote::transaction& a, const cryptonote::transaction& b);
@@ -107,6 +107,11 @@ namespace cryptonote
     return m_blockchain_storage.get_transactions(txs_ids, txs, missed_txs);
   }
   //-----------------------------------------------------------------------------------------------
+  bool core::get_transactions_blobs(const std::list<crypto::hash>& txs_ids, std::list<blobdata>& txs, std::list<crypto::hash>& missed_txs)
+  {
+    return m_blockchain_storage.get_transactions_blobs(txs_ids, txs, missed_txs);
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::get_alternative_blocks(std::list<block>& blocks)
   {
     return m_blockchain_storage.get_alternative_blocks(blocks);
@@ -130,7 +135,11 @@ namespace cryptonote
     r = m_miner.init(vm, testnet);
     CHECK_AND_ASSERT_MES(r, false, "Failed to initialize blockchain storage");
 
-    return load_state_data();
+    r = load_state_data();
+    //listeners learn chain top that was loaded
+    if(r)
+      notify_state_changed();
+    return r;
   }
   //-----------------------------------------------------------------------------------------------
   bool core::set_genesis_block(const block& b)
@@ -198,7 +207,10 @@ namespace cryptonote
     {LOG_PRINT_RED_L1("Transaction verification impossible: " << tx_hash);}
 
     if(tvc.m_added_to_pool)
+    {
       LOG_PRINT_L1("tx added: " << tx_hash);
+      notify_state_changed();
+    }
     return r;
   }
   //-----------------------------------------------------------------------------------------------
@@ -368,7 +380,7 @@ namespace cryptonote
   {
     block_verification_context bvc = boost::value_initialized<block_verification_context>();
     m_miner.pause();
-    m_blockchain_storage.add_new_block(b, bvc);
+    add_new_block(b, bvc);
     //anyway - update miner template
     update_miner_block_template();
     m_miner.resume();
@@ -413,7 +425,11 @@ namespace cryptonote
   //-----------------------------------------------------------------------------------------------
   bool core::add_new_block(const block& b, block_verification_context& bvc)
   {
-    return m_blockchain_storage.add_new_block(b, bvc);
+    bool r = m_blockchain_storage.add_new_block(b, bvc);
+    //alternative blocks may change pool as well, notified listeners check what actually changed
+    if(r)
+      notify_state_changed();
+    return r;
   }
   //-----------------------------------------------------------------------------------------------
   bool core::handle_incoming_block(const blobdata& block_blob, block_verification_context& bvc, bool update_miner_blocktemplate)
@@ -461,6 +477,24 @@ namespace cryptonote
     return m_mempool.get_transactions_count();
   }
   //-----------------------------------------------------------------------------------------------
+  uint64_t core::get_pool_version()
+  {
+    return m_mempool.get_version();
+  }
+  //-----------------------------------------------------------------------------------------------
+  void core::set_state_change_notifier(const boost::function<void()>& notifier)
+  {
+    CRITICAL_REGION_LOCAL(m_state_change_notifier_lock);
+    m_state_change_notifier = notifier;
+  }
+  //-----------------------------------------------------------------------------------------------
+  void core::notify_state_changed()
+  {
+    CRITICAL_REGION_LOCAL(m_state_change_notifier_lock);
+    if(m_state_change_notifier)
+      m_state_change_notifier();
+  }
+  //-----------------------------------------------------------------------------------------------
   bool core::have_block(const crypto::hash& id)
   {
     return m_blockchain_storage.have_block(id);
@@ -534,7 +568,10 @@ namespace cryptonote
 
     m_store_blockchain_interval.do_call(boost::bind(&blockchain_storage::store_blockchain, &m_blockchain_storage));
     m_miner.on_idle();
+    uint64_t pool_version = m_mempool.get_version();
     m_mempool.on_idle();
+    if(pool_version != m_mempool.get_version())
+      notify_state_changed();
     return true;
   }
   //-----------------------------------------------------------------------------------------------
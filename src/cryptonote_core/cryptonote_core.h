@@ -30,6 +30,7 @@
 
 #pragma once
 
+#include <boost/function.hpp>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 
@@ -84,6 +85,7 @@ namespace cryptonote
      }
      crypto::hash get_block_id_by_height(uint64_t height);
      bool get_transactions(const std::vector<crypto::hash>& txs_ids, std::list<transaction>& txs, std::list<crypto::hash>& missed_txs);
+     bool get_transactions_blobs(const std::list<crypto::hash>& txs_ids, std::list<blobdata>& txs, std::list<crypto::hash>& missed_txs);
      bool get_block_by_hash(const crypto::hash &h, block &blk);
      //void get_all_known_block_ids(std::list<crypto::hash> &main, std::list<crypto::hash> &alt, std::list<crypto::hash> &invalid);
 
@@ -95,6 +97,7 @@ namespace cryptonote
 
      bool get_pool_transactions(std::list<transaction>& txs);
      size_t get_pool_transactions_count();
+     uint64_t get_pool_version();
      size_t get_blockchain_total_transactions();
      //bool get_outs(uint64_t amount, std::list<crypto::public_key>& pkeys);
      bool have_block(const crypto::hash& id);
@@ -119,6 +122,10 @@ namespace cryptonote
      void set_target_blockchain_height(uint64_t target_blockchain_height);
      uint64_t get_target_blockchain_height() const;
 
+     //called after blockchain top or tx pool may have changed (and once core is initialized), set it before core
+     //starts handling blocks. Once it is reset with empty notifier, previous one is not running and won't be called
+     void set_state_change_notifier(const boost::function<void()>& notifier);
+
    private:
      bool add_new_tx(const transaction& tx, const crypto::hash& tx_hash, const crypto::hash& tx_prefix_hash, size_t blob_size, tx_verification_context& tvc, bool keeped_by_block);
      bool add_new_tx(const transaction& tx, tx_verification_context& tvc, bool keeped_by_block);
@@ -136,6 +143,7 @@ namespace cryptonote
      bool check_tx_ring_signature(const txin_to_key& tx, const crypto::hash& tx_prefix_hash, const std::vector<crypto::signature>& sig);
      bool is_tx_spendtime_unlocked(uint64_t unlock_time);
      bool update_miner_block_template();
+     void notify_state_changed();
      bool handle_command_line(const boost::program_options::variables_map& vm, bool testnet);
      bool on_update_blocktemplate_interval();
      bool check_tx_inputs_keyimages_diff(const transaction& tx);
@@ -155,6 +163,8 @@ namespace cryptonote
      std::atomic<bool> m_starter_message_showed;
 
      uint64_t m_target_blockchain_height;
+     boost::function<void()> m_state_change_notifier;
+     epee::critical_section m_state_change_notifier_lock;
    };
 }
 
@@ -32,12 +32,68 @@
 using namespace epee;
 
 #include "cryptonote_format_utils.h"
+#include <atomic>
+#include <exception>
 #include <boost/foreach.hpp>
+#include <boost/thread/locks.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
 #include "cryptonote_config.h"
 #include "miner.h"
 #include "crypto/crypto.h"
 #include "crypto/hash.h"
 
+namespace
+{
+  // calls f(0) .. f(count - 1) on up to thread_count threads (0: one per core, but no more than one per
+  // CRYPTONOTE_CONSTRUCT_TX_MIN_ITEMS_PER_THREAD items), the calling thread included.
+  // Indices are handed out one at a time, f has to write its results to a slot of its own.
+  // If f throws, no more indices are handed out and the first exception is rethrown once all threads are joined
+  template<class t_func>
+  void parallel_for(size_t count, size_t thread_count, const t_func& f)
+  {
+    if (0 == thread_count)
+      thread_count = std::min<size_t>(std::max<size_t>(boost::thread::hardware_concurrency(), 1), count / CRYPTONOTE_CONSTRUCT_TX_MIN_ITEMS_PER_THREAD);
+    thread_count = std::min(thread_count, count);
+    if (thread_count <= 1)
+    {
+      for (size_t i = 0; i < count; ++i)
+        f(i);
+      return;
+    }
+
+    std::atomic<size_t> next(0);
+    std::exception_ptr error;
+    boost::mutex error_lock;
+    auto worker = [&]()
+    {
+      try
+      {
+        for (size_t i = next++; i < count; i = next++)
+          f(i);
+      }
+      catch (...)
+      {
+        next = count;
+        boost::lock_guard<boost::mutex> lock(error_lock);
+        if (!error)
+          error = std::current_exception();
+      }
+    };
+
+    {
+      boost::thread_group threads;
+      //workers reference this frame, so they are joined even if thread creation throws
+      auto join_guard = misc_utils::create_scope_leave_handler([&]() { threads.join_all(); });
+      for (size_t i = 1; i < thread_count; ++i)
+        threads.create_thread(worker);
+      worker();
+    }
+    if (error)
+      std::rethrow_exception(error);
+  }
+}
+
 namespace cryptonote
 {
   //---------------------------------------------------------------
@@ -321,7 +377,7 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------
-  bool construct_tx(const account_keys& sender_account_keys, const std::vector<tx_source_entry>& sources, const std::vector<tx_destination_entry>& destinations, std::vector<uint8_t> extra, transaction& tx, uint64_t unlock_time)
+  bool construct_tx(const account_keys& sender_account_keys, const std::vector<tx_source_entry>& sources, const std::vector<tx_destination_entry>& destinations, std::vector<uint8_t> extra, transaction& tx, uint64_t unlock_time, size_t thread_count)
   {
     tx.vin.clear();
     tx.vout.clear();
@@ -337,12 +393,13 @@ namespace cryptonote
     struct input_generation_context_data
     {
       keypair in_ephemeral;
+      crypto::key_image img;
+      bool r;
     };
-    std::vector<input_generation_context_data> in_contexts;
+    std::vector<input_generation_context_data> in_contexts(sources.size());
 
 
     uint64_t summary_inputs_money = 0;
-    //fill inputs
     BOOST_FOREACH(const tx_source_entry& src_entr,  sources)
     {
       if(src_entr.real_output >= src_entr.outputs.size())
@@ -351,19 +408,29 @@ namespace cryptonote
         return false;
       }
       summary_inputs_money += src_entr.amount;
+    }
 
-      //key_derivation recv_derivation;
-      in_contexts.push_back(input_generation_context_data());
-      keypair& in_ephemeral = in_contexts.back().in_ephemeral;
-      crypto::key_image img;
-      if(!generate_key_image_helper(sender_account_keys, src_entr.real_out_tx_key, src_entr.real_output_in_tx_index, in_ephemeral, img))
+    //key images of all inputs, every slot of in_contexts is written by one thread only
+    parallel_for(sources.size(), thread_count, [&](size_t i)
+    {
+      const tx_source_entry& src_entr = sources[i];
+      input_generation_context_data& ctx = in_contexts[i];
+      ctx.r = generate_key_image_helper(sender_account_keys, src_entr.real_out_tx_key, src_entr.real_output_in_tx_index, ctx.in_ephemeral, ctx.img);
+    });
+
+    //fill inputs
+    size_t i = 0;
+    BOOST_FOREACH(const tx_source_entry& src_entr,  sources)
+    {
+      const input_generation_context_data& ctx = in_contexts[i++];
+      if(!ctx.r)
         return false;
 
       //check that derivated key is equal with real output key
-      if( !(in_ephemeral.pub == src_entr.outputs[src_entr.real_output].second) )
+      if( !(ctx.in_ephemeral.pub == src_entr.outputs[src_entr.real_output].second) )
       {
         LOG_ERROR("derived public key missmatch with output public key! "<< ENDL << "derived_key:"
-          << string_tools::pod_to_hex(in_ephemeral.pub) << ENDL << "real output_public_key:"
+          << string_tools::pod_to_hex(ctx.in_ephemeral.pub) << ENDL << "real output_public_key:"
           << string_tools::pod_to_hex(src_entr.outputs[src_entr.real_output].second) );
         return false;
       }
@@ -371,7 +438,7 @@ namespace cryptonote
       //put key image into tx input
       txin_to_key input_to_key;
       input_to_key.amount = src_entr.amount;
-      input_to_key.k_image = img;
+      input_to_key.k_image = ctx.img;
 
       //fill outputs array and use relative offsets
       BOOST_FOREACH(const tx_source_entry::output_entry& out_entry, src_entr.outputs)
@@ -386,34 +453,51 @@ namespace cryptonote
     std::sort(shuffled_dsts.begin(), shuffled_dsts.end(), [](const tx_destination_entry& de1, const tx_destination_entry& de2) { return de1.amount < de2.amount; } );
 
     uint64_t summary_outs_money = 0;
-    //fill outputs
-    size_t output_index = 0;
     BOOST_FOREACH(const tx_destination_entry& dst_entr,  shuffled_dsts)
     {
       CHECK_AND_ASSERT_MES(dst_entr.amount > 0, false, "Destination with wrong amount: " << dst_entr.amount);
+      summary_outs_money += dst_entr.amount;
+    }
+
+    //check money
+    if(summary_outs_money > summary_inputs_money )
+    {
+      LOG_ERROR("Transaction inputs money ("<< summary_inputs_money << ") less than outputs money (" << summary_outs_money << ")");
+      return false;
+    }
+
+    //output keys, output_index is the position in shuffled_dsts
+    struct output_generation_context_data
+    {
       crypto::key_derivation derivation;
       crypto::public_key out_eph_public_key;
-      bool r = crypto::generate_key_derivation(dst_entr.addr.m_view_public_key, txkey.sec, derivation);
-      CHECK_AND_ASSERT_MES(r, false, "at creation outs: failed to generate_key_derivation(" << dst_entr.addr.m_view_public_key << ", " << txkey.sec << ")");
+      bool derivation_r;
+      bool r;
+    };
+    std::vector<output_generation_context_data> out_contexts(shuffled_dsts.size());
+    parallel_for(shuffled_dsts.size(), thread_count, [&](size_t output_index)
+    {
+      const tx_destination_entry& dst_entr = shuffled_dsts[output_index];
+      output_generation_context_data& ctx = out_contexts[output_index];
+      ctx.derivation_r = crypto::generate_key_derivation(dst_entr.addr.m_view_public_key, txkey.sec, ctx.derivation);
+      ctx.r = ctx.derivation_r && crypto::derive_public_key(ctx.derivation, output_index, dst_entr.addr.m_spend_public_key, ctx.out_eph_public_key);
+    });
 
-      r = crypto::derive_public_key(derivation, output_index, dst_entr.addr.m_spend_public_key, out_eph_public_key);
-      CHECK_AND_ASSERT_MES(r, false, "at creation outs: failed to derive_public_key(" << derivation << ", " << output_index << ", "<< dst_entr.addr.m_spend_public_key << ")");
+    //fill outputs
+    size_t output_index = 0;
+    BOOST_FOREACH(const tx_destination_entry& dst_entr,  shuffled_dsts)
+    {
+      const output_generation_context_data& ctx = out_contexts[output_index];
+      CHECK_AND_ASSERT_MES(ctx.derivation_r, false, "at creation outs: failed to generate_key_derivation(" << dst_entr.addr.m_view_public_key << ", " << txkey.sec << ")");
+      CHECK_AND_ASSERT_MES(ctx.r, false, "at creation outs: failed to derive_public_key(" << ctx.derivation << ", " << output_index << ", "<< dst_entr.addr.m_spend_public_key << ")");
 
       tx_out out;
       out.amount = dst_entr.amount;
       txout_to_key tk;
-      tk.key = out_eph_public_key;
+      tk.key = ctx.out_eph_public_key;
       out.target = tk;
       tx.vout.push_back(out);
       output_index++;
-      summary_outs_money += dst_entr.amount;
-    }
-
-    //check money
-    if(summary_outs_money > summary_inputs_money )
-    {
-      LOG_ERROR("Transaction inputs money ("<< summary_inputs_money << ") less than outputs money (" << summary_outs_money << ")");
-      return false;
     }
 
 
@@ -421,24 +505,29 @@ namespace cryptonote
     crypto::hash tx_prefix_hash;
     get_transaction_prefix_hash(tx, tx_prefix_hash);
 
-    std::stringstream ss_ring_s;
-    size_t i = 0;
-    BOOST_FOREACH(const tx_source_entry& src_entr,  sources)
+    tx.signatures.resize(sources.size());
+    parallel_for(sources.size(), thread_count, [&](size_t i)
     {
-      ss_ring_s << "pub_keys:" << ENDL;
+      const tx_source_entry& src_entr = sources[i];
       std::vector<const crypto::public_key*> keys_ptrs;
       BOOST_FOREACH(const tx_source_entry::output_entry& o, src_entr.outputs)
-      {
         keys_ptrs.push_back(&o.second);
-        ss_ring_s << o.second << ENDL;
-      }
 
-      tx.signatures.push_back(std::vector<crypto::signature>());
-      std::vector<crypto::signature>& sigs = tx.signatures.back();
+      std::vector<crypto::signature>& sigs = tx.signatures[i];
       sigs.resize(src_entr.outputs.size());
       crypto::generate_ring_signature(tx_prefix_hash, boost::get<txin_to_key>(tx.vin[i]).k_image, keys_ptrs, in_contexts[i].in_ephemeral.sec, src_entr.real_output, sigs.data());
+    });
+
+    std::stringstream ss_ring_s;
+    i = 0;
+    BOOST_FOREACH(const tx_source_entry& src_entr,  sources)
+    {
+      ss_ring_s << "pub_keys:" << ENDL;
+      BOOST_FOREACH(const tx_source_entry::output_entry& o, src_entr.outputs)
+        ss_ring_s << o.second << ENDL;
+
       ss_ring_s << "signatures:" << ENDL;
-      std::for_each(sigs.begin(), sigs.end(), [&](const crypto::signature& s){ss_ring_s << s << ENDL;});
+      std::for_each(tx.signatures[i].begin(), tx.signatures[i].end(), [&](const crypto::signature& s){ss_ring_s << s << ENDL;});
       ss_ring_s << "prefix_hash:" << tx_prefix_hash << ENDL << "in_ephemeral_key: " << in_contexts[i].in_ephemeral.sec << ENDL << "real_output: " << src_entr.real_output;
       i++;
     }
@@ -545,6 +634,11 @@ namespace cryptonote
   {
     crypto::key_derivation derivation;
     generate_key_derivation(tx_pub_key, acc.m_view_secret_key, derivation);
+    return is_out_to_acc(acc, out_key, derivation, output_index);
+  }
+  //---------------------------------------------------------------
+  bool is_out_to_acc(const account_keys& acc, const txout_to_key& out_key, const crypto::key_derivation& derivation, size_t output_index)
+  {
     crypto::public_key pk;
     derive_public_key(derivation, output_index, acc.m_account_address.m_spend_public_key, pk);
     return pk == out_key.key;
@@ -559,13 +653,21 @@ namespace cryptonote
   }
   //---------------------------------------------------------------
   bool lookup_acc_outs(const account_keys& acc, const transaction& tx, const crypto::public_key& tx_pub_key, std::vector<size_t>& outs, uint64_t& money_transfered)
+  {
+    //derivation is the same for all outputs of the transaction
+    crypto::key_derivation derivation;
+    generate_key_derivation(tx_pub_key, acc.m_view_secret_key, derivation);
+    return lookup_acc_outs(acc, tx, derivation, outs, money_transfered);
+  }
+  //---------------------------------------------------------------
+  bool lookup_acc_outs(const account_keys& acc, const transaction& tx, const crypto::key_derivation& derivation, std::vector<size_t>& outs, uint64_t& money_transfered)
   {
     money_transfered = 0;
     size_t i = 0;
     BOOST_FOREACH(const tx_out& o,  tx.vout)
     {
       CHECK_AND_ASSERT_MES(o.target.type() ==  typeid(txout_to_key), false, "wrong type id in transaction out" );
-      if(is_out_to_acc(acc, boost::get<txout_to_key>(o.target), tx_pub_key, i))
+      if(is_out_to_acc(acc, boost::get<txout_to_key>(o.target), derivation, i))
       {
         outs.push_back(i);
         money_transfered += o.amount;
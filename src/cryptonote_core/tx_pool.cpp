@@ -54,7 +54,7 @@ namespace cryptonote
   }
 
   //---------------------------------------------------------------------------------
-  tx_memory_pool::tx_memory_pool(blockchain_storage& bchs): m_blockchain(bchs)
+  tx_memory_pool::tx_memory_pool(blockchain_storage& bchs): m_version(0), m_blockchain(bchs)
   {
 
   }
@@ -172,6 +172,7 @@ namespace cryptonote
     }
 
     tvc.m_verifivation_failed = false;
+    ++m_version;
     //succeed
     return true;
   }
@@ -223,6 +224,7 @@ namespace cryptonote
     fee = it->second.fee;
     remove_transaction_keyimages(it->second.tx);
     m_transactions.erase(it);
+    ++m_version;
     return true;
   }
   //---------------------------------------------------------------------------------
@@ -244,6 +246,7 @@ namespace cryptonote
       {
         LOG_PRINT_L1("Tx " << it->first << " removed from tx pool due to outdated, age: " << tx_age );
         m_transactions.erase(it++);
+        ++m_version;
       }else
         ++it;
     }
@@ -273,6 +276,15 @@ namespace cryptonote
     return true;
   }
   //---------------------------------------------------------------------------------
+  bool tx_memory_pool::get_transaction_blob(const crypto::hash& id, blobdata& tx_blob) const
+  {
+    CRITICAL_REGION_LOCAL(m_transactions_lock);
+    auto it = m_transactions.find(id);
+    if(it == m_transactions.end())
+      return false;
+    return tx_to_blob(it->second.tx, tx_blob);
+  }
+  //---------------------------------------------------------------------------------
   bool tx_memory_pool::on_blockchain_inc(uint64_t new_block_height, const crypto::hash& top_block_id)
   {
     return true;
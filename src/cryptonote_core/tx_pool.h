@@ -31,6 +31,7 @@
 #pragma once
 #include "include_base_utils.h"
 
+#include <atomic>
 #include <set>
 #include <unordered_map>
 #include <unordered_set>
@@ -43,6 +44,7 @@
 #include "cryptonote_basic_impl.h"
 #include "verification_context.h"
 #include "crypto/hash.h"
+#include "cryptonote_protocol/blobdatatype.h"
 
 
 namespace cryptonote
@@ -75,7 +77,10 @@ namespace cryptonote
     bool fill_block_template(block &bl, size_t median_size, uint64_t already_generated_coins, size_t &total_size, uint64_t &fee);
     void get_transactions(std::list<transaction>& txs) const;
     bool get_transaction(const crypto::hash& h, transaction& tx) const;
+    bool get_transaction_blob(const crypto::hash& h, blobdata& tx_blob) const;
     size_t get_transactions_count() const;
+    //changes whenever transactions are added to or removed from pool
+    uint64_t get_version() const {return m_version;}
     std::string print_pool(bool short_format) const;
 
     /*bool flush_pool(const std::strig& folder);
@@ -123,6 +128,7 @@ namespace cryptonote
     transactions_container m_transactions;
     key_images_container m_spent_key_images;
     epee::math_helper::once_a_time_seconds<30> m_remove_stuck_tx_interval;
+    std::atomic<uint64_t> m_version;
 
     //transactions_container m_alternative_transactions;
 
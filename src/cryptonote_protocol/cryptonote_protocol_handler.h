@@ -116,6 +116,16 @@ namespace cryptonote
         return m_p2p->invoke_notify_to_peer(t_parametr::ID, blob, context);
       }
 
+      //for replies serving historical data, they are rate limited and yield to relay traffic
+      template<class t_parametr>
+      bool post_bulk_notify(typename t_parametr::request& arg, cryptonote_connection_context& context)
+      {
+        LOG_PRINT_L2("[" << epee::net_utils::print_connection_context_short(context) << "] post bulk " << typeid(t_parametr).name() << " -->");
+        std::string blob;
+        epee::serialization::store_t_to_binary(arg, blob);
+        return m_p2p->invoke_bulk_notify_to_peer(t_parametr::ID, blob, context);
+      }
+
       template<class t_parametr>
       bool relay_post_notify(typename t_parametr::request& arg, cryptonote_connection_context& exlude_context)
       {
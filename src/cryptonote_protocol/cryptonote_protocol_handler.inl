@@ -161,6 +161,12 @@ namespace cryptonote
   template<class t_core> 
   bool t_cryptonote_protocol_handler<t_core>::process_payload_sync_data(const CORE_SYNC_DATA& hshd, cryptonote_connection_context& context, bool is_inital)
   {
+    if(is_inital)
+    {
+      context.m_last_request_time = 0;
+      context.m_blocks_span = BLOCKS_SYNCHRONIZING_DEFAULT_COUNT;
+    }
+
     if(context.m_state == cryptonote_connection_context::state_befor_handshake && !is_inital)
       return true;
 
@@ -303,7 +309,7 @@ namespace cryptonote
     }
     LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_RESPONSE_GET_OBJECTS: blocks.size()=" << rsp.blocks.size() << ", txs.size()=" << rsp.txs.size() 
                             << ", rsp.m_current_blockchain_height=" << rsp.current_blockchain_height << ", missed_ids.size()=" << rsp.missed_ids.size());
-    post_notify<NOTIFY_RESPONSE_GET_OBJECTS>(rsp, context);
+    post_bulk_notify<NOTIFY_RESPONSE_GET_OBJECTS>(rsp, context);
     return 1;
   }
   //------------------------------------------------------------------------------------------------------------------------
@@ -321,6 +327,26 @@ namespace cryptonote
 
     context.m_remote_blockchain_height = arg.current_blockchain_height;
 
+    if(context.m_last_request_time && arg.blocks.size())
+    {
+      uint64_t elapsed = std::max<uint64_t>(epee::misc_utils::get_tick_count() - context.m_last_request_time, 1);
+      uint64_t bytes = 0;
+      BOOST_FOREACH(const block_complete_entry& block_entry, arg.blocks)
+      {
+        bytes += block_entry.block.size();
+        BOOST_FOREACH(const blobdata& tx_blob, block_entry.txs)
+          bytes += tx_blob.size();
+      }
+      m_p2p->add_peer_throughput(context, bytes, elapsed);
+
+      //size next span to be fetched in about BLOCKS_SYNCHRONIZING_TARGET_TIME, so fast peers serve more of the chain
+      uint64_t span = arg.blocks.size() * BLOCKS_SYNCHRONIZING_TARGET_TIME / elapsed;
+      span = (context.m_blocks_span + span) / 2;
+      context.m_blocks_span = static_cast<size_t>(std::min<uint64_t>(std::max<uint64_t>(span, BLOCKS_SYNCHRONIZING_MIN_COUNT), BLOCKS_SYNCHRONIZING_MAX_COUNT));
+      context.m_last_request_time = 0;
+      LOG_PRINT_CCONTEXT_L2("NOTIFY_RESPONSE_GET_OBJECTS: " << bytes << " bytes in " << elapsed << "ms, next blocks span " << context.m_blocks_span);
+    }
+
     size_t count = 0;
     BOOST_FOREACH(const block_complete_entry& block_entry, arg.blocks)
     {
@@ -441,7 +467,7 @@ namespace cryptonote
       return 1;
     }
     LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_RESPONSE_CHAIN_ENTRY: m_start_height=" << r.start_height << ", m_total_height=" << r.total_height << ", m_block_ids.size()=" << r.m_block_ids.size());
-    post_notify<NOTIFY_RESPONSE_CHAIN_ENTRY>(r, context);
+    post_bulk_notify<NOTIFY_RESPONSE_CHAIN_ENTRY>(r, context);
     return 1;
   }
   //------------------------------------------------------------------------------------------------------------------------
@@ -455,7 +481,7 @@ namespace cryptonote
       size_t count = 0;
       auto it = context.m_needed_objects.begin();
 
-      while(it != context.m_needed_objects.end() && count < BLOCKS_SYNCHRONIZING_DEFAULT_COUNT)
+      while(it != context.m_needed_objects.end() && count < context.m_blocks_span)
       {
         if( !(check_having_blocks && m_core.have_block(*it)))
         {
@@ -466,6 +492,7 @@ namespace cryptonote
         context.m_needed_objects.erase(it++);
       }
       LOG_PRINT_CCONTEXT_L2("-->>NOTIFY_REQUEST_GET_OBJECTS: blocks.size()=" << req.blocks.size() << ", txs.size()=" << req.txs.size());
+      context.m_last_request_time = epee::misc_utils::get_tick_count();
       post_notify<NOTIFY_REQUEST_GET_OBJECTS>(req, context);    
     }else if(context.m_last_response_height < context.m_remote_blockchain_height-1)
     {//we have to fetch more objects ids, request blockchain entry
@@ -271,10 +271,10 @@ int main(int argc, char* argv[])
   rpc_server.timed_wait_server_stop(5000);
 
   //deinitialize components
-  LOG_PRINT_L0("Deinitializing core...");
-  ccore.deinit();
   LOG_PRINT_L0("Deinitializing RPC server ...");
   rpc_server.deinit();
+  LOG_PRINT_L0("Deinitializing core...");
+  ccore.deinit();
   LOG_PRINT_L0("Deinitializing protocol...");
   cprotocol.deinit();
   LOG_PRINT_L0("Deinitializing P2P...");
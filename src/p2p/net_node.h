@@ -87,6 +87,7 @@ namespace nodetool
       : m_payload_handler(payload_handler)
       , m_allow_local_ip(false)
       , m_hide_my_port(false)
+      , m_connections_fanout(P2P_DEFAULT_CONNECTIONS_FANOUT)
       , m_network_id(std::move(network_id))
     {}
 
@@ -152,9 +153,11 @@ namespace nodetool
     virtual bool relay_notify_to_all(int command, const std::string& data_buff, const epee::net_utils::connection_context_base& context);
     virtual bool invoke_command_to_peer(int command, const std::string& req_buff, std::string& resp_buff, const epee::net_utils::connection_context_base& context);
     virtual bool invoke_notify_to_peer(int command, const std::string& req_buff, const epee::net_utils::connection_context_base& context);
+    virtual bool invoke_bulk_notify_to_peer(int command, const std::string& req_buff, const epee::net_utils::connection_context_base& context);
     virtual bool drop_connection(const epee::net_utils::connection_context_base& context);
     virtual void request_callback(const epee::net_utils::connection_context_base& context);
     virtual void for_each_connection(std::function<bool(typename t_payload_net_handler::connection_context&, peerid_type)> f);
+    virtual void add_peer_throughput(const epee::net_utils::connection_context_base& context, uint64_t bytes, uint64_t time_ms);
     //-----------------------------------------------------------------------------------------------
     bool parse_peer_from_string(nodetool::net_address& pe, const std::string& node_addr);
     bool handle_command_line(
@@ -172,10 +175,16 @@ namespace nodetool
     bool connections_maker();
     bool peer_sync_idle_maker();
     bool do_handshake_with_peer(peerid_type& pi, p2p_connection_context& context, bool just_take_peerlist = false);
+    template<class t_callback>
+    bool do_handshake_with_peer_async(p2p_connection_context& context, bool just_take_peerlist, t_callback cb);
     bool do_peer_timed_sync(const epee::net_utils::connection_context_base& context, peerid_type peer_id);
 
-    bool make_new_connection_from_peerlist(bool use_white_list);
+    bool make_new_connection_from_peerlist(bool use_white_list, size_t max_attempts = 1);
     bool try_to_connect_and_handshake_with_new_peer(const net_address& na, bool just_take_peerlist = false, uint64_t last_seen_stamp = 0, bool white = true);
+    bool try_to_connect_and_handshake_with_new_peer_async(const net_address& na, uint64_t last_seen_stamp, bool white);
+    void on_connection_attempt_finished(const net_address& na);
+    size_t get_connecting_peers_count();
+    bool is_addr_connecting(const net_address& peer);
     size_t get_random_index_with_fixed_probability(size_t max_index);
     bool is_peer_used(const peerlist_entry& peer);
     bool is_addr_connected(const net_address& peer);  
@@ -238,6 +247,10 @@ namespace nodetool
     std::vector<net_address> m_seed_nodes;
     std::list<nodetool::peerlist_entry> m_command_line_peers;
     uint64_t m_peer_livetime;
+    uint32_t m_connections_fanout;
+    //outgoing connect/handshake attempts in flight
+    epee::critical_section m_connecting_peers_lock;
+    std::set<net_address> m_connecting_peers;
     //keep connections to initiate some interactions
     net_server m_net_server;
     boost::uuids::uuid m_network_id;
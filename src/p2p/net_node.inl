@@ -78,6 +78,11 @@ namespace nodetool
                                                                                                   " If this option is given the options add-priority-node and seed-node are ignored"};
     const command_line::arg_descriptor<std::vector<std::string> > arg_p2p_seed_node   = {"seed-node", "Connect to a node to retrieve peer addresses, and disconnect"};
     const command_line::arg_descriptor<bool> arg_p2p_hide_my_port   =    {"hide-my-port", "Do not announce yourself as peerlist candidate", false, true};
+    const command_line::arg_descriptor<uint64_t> arg_p2p_limit_rate_up = {"limit-rate-up", "Limit total upload rate, kB/s (0 - unlimited). Blocks served to syncing peers wait for it, relay of new blocks and transactions does not", 0};
+    const command_line::arg_descriptor<uint64_t> arg_p2p_limit_rate_down = {"limit-rate-down", "Limit total download rate, kB/s (0 - unlimited)", 0};
+    const command_line::arg_descriptor<uint64_t> arg_p2p_limit_rate_up_per_peer = {"limit-rate-up-per-peer", "Limit upload rate to one peer, kB/s (0 - unlimited). Blocks served to syncing peers wait for it, relay of new blocks and transactions does not", 0};
+    const command_line::arg_descriptor<uint64_t> arg_p2p_limit_rate_down_per_peer = {"limit-rate-down-per-peer", "Limit download rate from one peer, kB/s (0 - unlimited)", 0};
+    const command_line::arg_descriptor<uint32_t> arg_p2p_connections_fanout = {"p2p-connections-fanout", "Maximum number of outgoing connection attempts made in parallel", P2P_DEFAULT_CONNECTIONS_FANOUT};
   }
 
   //-----------------------------------------------------------------------------------
@@ -93,7 +98,13 @@ namespace nodetool
     command_line::add_arg(desc, arg_p2p_add_priority_node);
     command_line::add_arg(desc, arg_p2p_add_exclusive_node);
     command_line::add_arg(desc, arg_p2p_seed_node);    
-    command_line::add_arg(desc, arg_p2p_hide_my_port);   }
+    command_line::add_arg(desc, arg_p2p_hide_my_port);
+    command_line::add_arg(desc, arg_p2p_connections_fanout);
+    command_line::add_arg(desc, arg_p2p_limit_rate_up);
+    command_line::add_arg(desc, arg_p2p_limit_rate_down);
+    command_line::add_arg(desc, arg_p2p_limit_rate_up_per_peer);
+    command_line::add_arg(desc, arg_p2p_limit_rate_down_per_peer);
+  }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
   bool node_server<t_payload_net_handler>::init_config()
@@ -192,6 +203,13 @@ namespace nodetool
     if(command_line::has_arg(vm, arg_p2p_hide_my_port))
       m_hide_my_port = true;
 
+    m_connections_fanout = std::max<uint32_t>(command_line::get_arg(vm, arg_p2p_connections_fanout), 1);
+
+    m_net_server.set_rate_limits(command_line::get_arg(vm, arg_p2p_limit_rate_up) * 1024,
+      command_line::get_arg(vm, arg_p2p_limit_rate_down) * 1024,
+      command_line::get_arg(vm, arg_p2p_limit_rate_up_per_peer) * 1024,
+      command_line::get_arg(vm, arg_p2p_limit_rate_down_per_peer) * 1024);
+
     return true;
   }
   //-----------------------------------------------------------------------------------
@@ -412,19 +430,46 @@ namespace nodetool
 
   template<class t_payload_net_handler>
   bool node_server<t_payload_net_handler>::do_handshake_with_peer(peerid_type& pi, p2p_connection_context& context_, bool just_take_peerlist)
+  {
+    epee::simple_event ev;
+    std::atomic<bool> hsh_result(false);
+
+    bool r = do_handshake_with_peer_async(context_, just_take_peerlist, [&](bool result, p2p_connection_context& context)
+    {
+      if(result && !just_take_peerlist)
+        pi = context.peer_id;
+      hsh_result = result;
+      ev.raise();
+    });
+
+    if(r)
+    {
+      ev.wait();
+    }
+
+    if(!hsh_result)
+    {
+      LOG_PRINT_CC_L1(context_, "COMMAND_HANDSHAKE Failed");
+      m_net_server.get_config_object().close(context_.m_connection_id);
+    }
+
+    return hsh_result;
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler> template<class t_callback>
+  bool node_server<t_payload_net_handler>::do_handshake_with_peer_async(p2p_connection_context& context_, bool just_take_peerlist, t_callback cb)
   {
     typename COMMAND_HANDSHAKE::request arg;
-    typename COMMAND_HANDSHAKE::response rsp;
     get_local_node_data(arg.node_data);
     m_payload_handler.get_payload_sync_data(arg.payload_data);
+
+    uint64_t start_time = epee::misc_utils::get_tick_count();
     
-    epee::simple_event ev;
-    std::atomic<bool> hsh_result(false);
-    
-    bool r = epee::net_utils::async_invoke_remote_command2<typename COMMAND_HANDSHAKE::response>(context_.m_connection_id, COMMAND_HANDSHAKE::ID, arg, m_net_server.get_config_object(), 
-      [this, &pi, &ev, &hsh_result, &just_take_peerlist](int code, const typename COMMAND_HANDSHAKE::response& rsp, p2p_connection_context& context)
+    return epee::net_utils::async_invoke_remote_command2<typename COMMAND_HANDSHAKE::response>(context_.m_connection_id, COMMAND_HANDSHAKE::ID, arg, m_net_server.get_config_object(), 
+      [this, just_take_peerlist, start_time, cb](int code, const typename COMMAND_HANDSHAKE::response& rsp, p2p_connection_context& context)
     {
-      epee::misc_utils::auto_scope_leave_caller scope_exit_handler = epee::misc_utils::create_scope_leave_handler([&](){ev.raise();});
+      bool hsh_result = false;
+      epee::misc_utils::auto_scope_leave_caller scope_exit_handler = epee::misc_utils::create_scope_leave_handler([&](){cb(hsh_result, context);});
 
       if(code < 0)
       {
@@ -443,23 +488,24 @@ namespace nodetool
         LOG_ERROR_CCONTEXT("COMMAND_HANDSHAKE: failed to handle_remote_peerlist(...), closing connection.");
         return;
       }
-      hsh_result = true;
       if(!just_take_peerlist)
       {
         if(!m_payload_handler.process_payload_sync_data(rsp.payload_data, context, true))
         {
           LOG_ERROR_CCONTEXT("COMMAND_HANDSHAKE invoked, but process_payload_sync_data returned false, dropping connection.");
-          hsh_result = false;
           return;
         }
 
-        pi = context.peer_id = rsp.node_data.peer_id;
+        context.peer_id = rsp.node_data.peer_id;
         m_peerlist.set_peer_just_seen(rsp.node_data.peer_id, context.m_remote_ip, context.m_remote_port);
+        net_address na = AUTO_VAL_INIT(na);
+        na.ip = context.m_remote_ip;
+        na.port = context.m_remote_port;
+        m_peerlist.set_peer_rtt(na, epee::misc_utils::get_tick_count() - start_time);
 
         if(rsp.node_data.peer_id == m_config.m_peer_id)
         {
           LOG_PRINT_CCONTEXT_L2("Connection to self detected, dropping connection");
-          hsh_result = false;
           return;
         }
         LOG_PRINT_CCONTEXT_L1(" COMMAND_HANDSHAKE INVOKED OK");
@@ -467,20 +513,8 @@ namespace nodetool
       {
         LOG_PRINT_CCONTEXT_L1(" COMMAND_HANDSHAKE(AND CLOSE) INVOKED OK");
       }
+      hsh_result = true;
     }, P2P_DEFAULT_HANDSHAKE_INVOKE_TIMEOUT);
-
-    if(r)
-    {
-      ev.wait();
-    }
-
-    if(!hsh_result)
-    {
-      LOG_PRINT_CC_L1(context_, "COMMAND_HANDSHAKE Failed");
-      m_net_server.get_config_object().close(context_.m_connection_id);
-    }
-
-    return hsh_result;
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
@@ -597,7 +631,7 @@ namespace nodetool
         << epee::string_tools::get_ip_string_from_int32(na.ip)
         << ":" << epee::string_tools::num_to_string_fast(na.port)
         /*<< ", try " << try_count*/);
-      //m_peerlist.set_peer_unreachable(pe);
+      m_peerlist.set_peer_unreachable(na);
       return false;
     }
 
@@ -611,6 +645,7 @@ namespace nodetool
         << epee::string_tools::get_ip_string_from_int32(na.ip)
         << ":" << epee::string_tools::num_to_string_fast(na.port)
         /*<< ", try " << try_count*/);
+      m_peerlist.set_peer_unreachable(na);
       return false;
     }
 
@@ -631,12 +666,106 @@ namespace nodetool
     LOG_PRINT_CC_GREEN(con, "CONNECTION HANDSHAKED OK.", LOG_LEVEL_2);
     return true;
   }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
+  bool node_server<t_payload_net_handler>::try_to_connect_and_handshake_with_new_peer_async(const net_address& na, uint64_t last_seen_stamp, bool white)
+  {
+    {
+      CRITICAL_REGION_LOCAL(m_connecting_peers_lock);
+      if(m_connecting_peers.size() >= m_connections_fanout || !m_connecting_peers.insert(na).second)
+        return false;
+    }
+
+    LOG_PRINT_L1("Connecting (async) to " << epee::string_tools::get_ip_string_from_int32(na.ip)  << ":"
+        << epee::string_tools::num_to_string_fast(na.port) << "(white=" << white << ", last_seen: "
+        << (last_seen_stamp ? epee::misc_utils::get_time_interval_string(time(NULL) - last_seen_stamp):"never")
+        << ")...");
+
+    bool res = m_net_server.connect_async(epee::string_tools::get_ip_string_from_int32(na.ip),
+      epee::string_tools::num_to_string_fast(na.port),
+      m_config.m_net_config.connection_timeout,
+      [this, na](const p2p_connection_context& con_, const boost::system::error_code& ec)
+    {
+      p2p_connection_context con = con_;
+      if(ec)
+      {
+        bool is_priority = is_priority_node(na);
+        LOG_PRINT_CC_PRIORITY_NODE(is_priority, con, "Connect failed to "
+          << epee::string_tools::get_ip_string_from_int32(na.ip)
+          << ":" << epee::string_tools::num_to_string_fast(na.port));
+        m_peerlist.set_peer_unreachable(na);
+        on_connection_attempt_finished(na);
+        return;
+      }
+
+      bool r = do_handshake_with_peer_async(con, false, [this, na](bool result, p2p_connection_context& context)
+      {
+        if(!result)
+        {
+          bool is_priority = is_priority_node(na);
+          LOG_PRINT_CC_PRIORITY_NODE(is_priority, context, "Failed to HANDSHAKE with peer "
+            << epee::string_tools::get_ip_string_from_int32(na.ip)
+            << ":" << epee::string_tools::num_to_string_fast(na.port));
+          m_peerlist.set_peer_unreachable(na);
+          m_net_server.get_config_object().close(context.m_connection_id);
+          on_connection_attempt_finished(na);
+          return;
+        }
+
+        peerlist_entry pe_local = AUTO_VAL_INIT(pe_local);
+        pe_local.adr = na;
+        pe_local.id = context.peer_id;
+        time(&pe_local.last_seen);
+        m_peerlist.append_with_peer_white(pe_local);
+        LOG_PRINT_CC_GREEN(context, "CONNECTION HANDSHAKED OK.", LOG_LEVEL_2);
+        on_connection_attempt_finished(na);
+      });
+
+      if(!r)
+      {
+        LOG_PRINT_CC_L1(con, "COMMAND_HANDSHAKE Failed");
+        m_peerlist.set_peer_unreachable(na);
+        m_net_server.get_config_object().close(con.m_connection_id);
+        on_connection_attempt_finished(na);
+      }
+    });
+
+    if(!res)
+    {
+      m_peerlist.set_peer_unreachable(na);
+      on_connection_attempt_finished(na);
+      return false;
+    }
+    return true;
+  }
 
 #undef LOG_PRINT_CC_PRIORITY_NODE
 
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
-  bool node_server<t_payload_net_handler>::make_new_connection_from_peerlist(bool use_white_list)
+  void node_server<t_payload_net_handler>::on_connection_attempt_finished(const net_address& na)
+  {
+    CRITICAL_REGION_LOCAL(m_connecting_peers_lock);
+    m_connecting_peers.erase(na);
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
+  size_t node_server<t_payload_net_handler>::get_connecting_peers_count()
+  {
+    CRITICAL_REGION_LOCAL(m_connecting_peers_lock);
+    return m_connecting_peers.size();
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
+  bool node_server<t_payload_net_handler>::is_addr_connecting(const net_address& peer)
+  {
+    CRITICAL_REGION_LOCAL(m_connecting_peers_lock);
+    return m_connecting_peers.count(peer) != 0;
+  }
+
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
+  bool node_server<t_payload_net_handler>::make_new_connection_from_peerlist(bool use_white_list, size_t max_attempts)
   {
     size_t local_peers_count = use_white_list ? m_peerlist.get_white_peers_count():m_peerlist.get_gray_peers_count();
     if(!local_peers_count)
@@ -645,10 +774,12 @@ namespace nodetool
     size_t max_random_index = std::min<uint64_t>(local_peers_count -1, 20);
 
     std::set<size_t> tried_peers;
+    std::vector<std::pair<uint64_t, peerlist_entry> > candidates;
 
     size_t try_count = 0;
     size_t rand_count = 0;
-    while(rand_count < (max_random_index+1)*3 &&  try_count < 10 && !m_net_server.is_stop_signal_sent())
+    size_t max_try_count = std::max<size_t>(10, max_attempts * 2);
+    while(rand_count < (max_random_index+1)*3 &&  try_count < max_try_count && !m_net_server.is_stop_signal_sent())
     {
       ++rand_count;
       size_t random_index = get_random_index_with_fixed_probability(max_random_index);
@@ -664,20 +795,37 @@ namespace nodetool
 
       ++try_count;
 
-      if(is_peer_used(pe))
+      if(is_peer_used(pe) || is_addr_connecting(pe.adr))
         continue;
 
+      candidates.push_back(std::make_pair(m_peerlist.get_peer_score(pe.adr), pe));
+    }
+
+    //try fast and reliable peers first, peers with equal score stay in random order
+    std::stable_sort(candidates.begin(), candidates.end(), [](const std::pair<uint64_t, peerlist_entry>& a, const std::pair<uint64_t, peerlist_entry>& b)
+    {
+      return a.first < b.first;
+    });
+
+    size_t started = 0;
+    BOOST_FOREACH(const auto& candidate, candidates)
+    {
+      if(m_net_server.is_stop_signal_sent() || started >= max_attempts)
+        break;
+
+      const peerlist_entry& pe = candidate.second;
       LOG_PRINT_L1("Selected peer: " << pe.id << " " << epee::string_tools::get_ip_string_from_int32(pe.adr.ip)
                     << ":" << boost::lexical_cast<std::string>(pe.adr.port)
                     << "[white=" << use_white_list
-                    << "] last_seen: " << (pe.last_seen ? epee::misc_utils::get_time_interval_string(time(NULL) - pe.last_seen) : "never"));
+                    << "] last_seen: " << (pe.last_seen ? epee::misc_utils::get_time_interval_string(time(NULL) - pe.last_seen) : "never")
+                    << ", score: " << candidate.first);
       
-      if(!try_to_connect_and_handshake_with_new_peer(pe.adr, false, pe.last_seen, use_white_list))
+      if(!try_to_connect_and_handshake_with_new_peer_async(pe.adr, pe.last_seen, use_white_list))
         continue;
 
-      return true;
+      ++started;
     }
-    return false;
+    return started != 0;
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
@@ -740,17 +888,17 @@ namespace nodetool
   template<class t_payload_net_handler>
   bool node_server<t_payload_net_handler>::make_expected_connections_count(bool white_list, size_t expected_connections)
   {
-    size_t conn_count = get_outgoing_connections_count();
-    //add new connections from white peers
-    while(conn_count < expected_connections)
-    {
-      if(m_net_server.is_stop_signal_sent())
-        return false;
+    if(m_net_server.is_stop_signal_sent())
+      return false;
 
-      if(!make_new_connection_from_peerlist(white_list))
-        break;
-      conn_count = get_outgoing_connections_count();
-    }
+    //attempts run asynchronously, count them as connections, next connections_maker call tops up failed ones
+    size_t connecting_count = get_connecting_peers_count();
+    size_t conn_count = get_outgoing_connections_count() + connecting_count;
+    if(conn_count >= expected_connections || connecting_count >= m_connections_fanout)
+      return true;
+
+    size_t attempts = std::min<size_t>(expected_connections - conn_count, m_connections_fanout - connecting_count);
+    make_new_connection_from_peerlist(white_list, attempts);
     return true;
   }
 
@@ -934,6 +1082,18 @@ namespace nodetool
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
+  void node_server<t_payload_net_handler>::add_peer_throughput(const epee::net_utils::connection_context_base& context, uint64_t bytes, uint64_t time_ms)
+  {
+    //incoming connections come from ephemeral ports, they don't match peerlist addresses
+    if(context.m_is_income)
+      return;
+    net_address na = AUTO_VAL_INIT(na);
+    na.ip = context.m_remote_ip;
+    na.port = context.m_remote_port;
+    m_peerlist.add_peer_throughput(na, bytes, time_ms);
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
   bool node_server<t_payload_net_handler>::relay_notify_to_all(int command, const std::string& data_buff, const epee::net_utils::connection_context_base& context)
   {
     std::list<boost::uuids::uuid> connections;
@@ -965,6 +1125,13 @@ namespace nodetool
   }
   //-----------------------------------------------------------------------------------
   template<class t_payload_net_handler>
+  bool node_server<t_payload_net_handler>::invoke_bulk_notify_to_peer(int command, const std::string& req_buff, const epee::net_utils::connection_context_base& context)
+  {
+    int res = m_net_server.get_config_object().notify(command, req_buff, context.m_connection_id, true);
+    return res > 0;
+  }
+  //-----------------------------------------------------------------------------------
+  template<class t_payload_net_handler>
   bool node_server<t_payload_net_handler>::invoke_command_to_peer(int command, const std::string& req_buff, std::string& resp_buff, const epee::net_utils::connection_context_base& context)
   {
     int res = m_net_server.get_config_object().invoke(command, req_buff, resp_buff, context.m_connection_id);
@@ -46,10 +46,12 @@ namespace nodetool
     virtual bool relay_notify_to_all(int command, const std::string& data_buff, const epee::net_utils::connection_context_base& context)=0;
     virtual bool invoke_command_to_peer(int command, const std::string& req_buff, std::string& resp_buff, const epee::net_utils::connection_context_base& context)=0;
     virtual bool invoke_notify_to_peer(int command, const std::string& req_buff, const epee::net_utils::connection_context_base& context)=0;
+    virtual bool invoke_bulk_notify_to_peer(int command, const std::string& req_buff, const epee::net_utils::connection_context_base& context)=0;
     virtual bool drop_connection(const epee::net_utils::connection_context_base& context)=0;
     virtual void request_callback(const epee::net_utils::connection_context_base& context)=0;
     virtual uint64_t get_connections_count()=0;
     virtual void for_each_connection(std::function<bool(t_connection_context&, peerid_type)> f)=0;
+    virtual void add_peer_throughput(const epee::net_utils::connection_context_base& context, uint64_t bytes, uint64_t time_ms)=0;
   };
 
   template<class t_connection_context>
@@ -67,6 +69,10 @@ namespace nodetool
     {
       return true;
     }
+    virtual bool invoke_bulk_notify_to_peer(int command, const std::string& req_buff, const epee::net_utils::connection_context_base& context)
+    {
+      return true;
+    }
     virtual bool drop_connection(const epee::net_utils::connection_context_base& context)
     {
       return false;
@@ -84,5 +90,9 @@ namespace nodetool
     {
       return false;
     }
+    virtual void add_peer_throughput(const epee::net_utils::connection_context_base& context, uint64_t bytes, uint64_t time_ms)
+    {
+
+    }
   };
 }
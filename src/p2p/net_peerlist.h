@@ -33,12 +33,14 @@
 #include <list>
 #include <set>
 #include <map>
+#include <limits>
 #include <boost/foreach.hpp>
 //#include <boost/bimap.hpp>
 //#include <boost/bimap/multiset_of.hpp>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 #include <boost/serialization/version.hpp>
+#include <boost/serialization/map.hpp>
 
 #include <boost/multi_index_container.hpp>
 #include <boost/multi_index/ordered_index.hpp>
@@ -77,7 +79,11 @@ namespace nodetool
     bool append_with_peer_gray(const peerlist_entry& pr);
     bool set_peer_just_seen(peerid_type peer, uint32_t ip, uint32_t port);
     bool set_peer_just_seen(peerid_type peer, const net_address& addr);
-    bool set_peer_unreachable(const peerlist_entry& pr);
+    bool set_peer_unreachable(const net_address& addr);
+    bool set_peer_rtt(const net_address& addr, uint64_t rtt);
+    bool add_peer_throughput(const net_address& addr, uint64_t bytes, uint64_t time_ms);
+    bool get_peer_stats(const net_address& addr, peer_stats& ps);
+    uint64_t get_peer_score(const net_address& addr);
     bool is_ip_allowed(uint32_t ip);
     void trim_white_peerlist();
     void trim_gray_peerlist();
@@ -161,10 +167,18 @@ namespace nodetool
       }
       a & m_peers_white;
       a & m_peers_gray;
+      if(ver < 5)
+        return;
+      a & m_peers_stats;
+      if(Archive::is_loading::value)
+        remove_unlisted_peer_stats();
     }
 
   private: 
     bool peers_indexed_from_old(const peers_indexed_old& pio, peers_indexed& pi);
+    //stats are kept only for peers in white or gray list, NULL for others
+    peer_stats* get_listed_peer_stats(const net_address& addr);
+    void remove_unlisted_peer_stats();
 
     friend class boost::serialization::access;
     epee::critical_section m_peerlist_lock;
@@ -174,6 +188,7 @@ namespace nodetool
 
     peers_indexed m_peers_gray;
     peers_indexed m_peers_white;
+    std::map<net_address, peer_stats> m_peers_stats;
   };
   //--------------------------------------------------------------------------------------------------
   inline
@@ -204,20 +219,44 @@ namespace nodetool
     return true;
   }
   //--------------------------------------------------------------------------------------------------
+  inline
+  peer_stats* peerlist_manager::get_listed_peer_stats(const net_address& addr)
+  {
+    if(m_peers_white.get<by_addr>().find(addr) == m_peers_white.get<by_addr>().end() &&
+      m_peers_gray.get<by_addr>().find(addr) == m_peers_gray.get<by_addr>().end())
+      return NULL;
+    return &m_peers_stats[addr];
+  }
+  //--------------------------------------------------------------------------------------------------
+  inline
+  void peerlist_manager::remove_unlisted_peer_stats()
+  {
+    for(auto it = m_peers_stats.begin(); it != m_peers_stats.end();)
+    {
+      if(m_peers_white.get<by_addr>().find(it->first) == m_peers_white.get<by_addr>().end() &&
+        m_peers_gray.get<by_addr>().find(it->first) == m_peers_gray.get<by_addr>().end())
+        it = m_peers_stats.erase(it);
+      else
+        ++it;
+    }
+  }
+  //--------------------------------------------------------------------------------------------------
   inline void peerlist_manager::trim_white_peerlist()
   {
-    while(m_peers_gray.size() > P2P_LOCAL_GRAY_PEERLIST_LIMIT)
+    while(m_peers_white.size() > P2P_LOCAL_WHITE_PEERLIST_LIMIT)
     {
-      peers_indexed::index<by_time>::type& sorted_index=m_peers_gray.get<by_time>();
+      peers_indexed::index<by_time>::type& sorted_index=m_peers_white.get<by_time>();
+      m_peers_stats.erase(sorted_index.begin()->adr);
       sorted_index.erase(sorted_index.begin());
     }
   }
   //--------------------------------------------------------------------------------------------------
   inline void peerlist_manager::trim_gray_peerlist()
   {
-    while(m_peers_white.size() > P2P_LOCAL_WHITE_PEERLIST_LIMIT)
+    while(m_peers_gray.size() > P2P_LOCAL_GRAY_PEERLIST_LIMIT)
     {
-      peers_indexed::index<by_time>::type& sorted_index=m_peers_white.get<by_time>();
+      peers_indexed::index<by_time>::type& sorted_index=m_peers_gray.get<by_time>();
+      m_peers_stats.erase(sorted_index.begin()->adr);
       sorted_index.erase(sorted_index.begin());
     }
   }
@@ -392,6 +431,83 @@ namespace nodetool
     return true;
   }
   //--------------------------------------------------------------------------------------------------
+  inline
+  bool peerlist_manager::set_peer_unreachable(const net_address& addr)
+  {
+    TRY_ENTRY();
+    CRITICAL_REGION_LOCAL(m_peerlist_lock);
+    peer_stats* pps = get_listed_peer_stats(addr);
+    if(!pps)
+      return true;
+    ++pps->fail_count;
+    pps->last_fail = time(NULL);
+    return true;
+    CATCH_ENTRY_L0("peerlist_manager::set_peer_unreachable()", false);
+  }
+  //--------------------------------------------------------------------------------------------------
+  inline
+  bool peerlist_manager::set_peer_rtt(const net_address& addr, uint64_t rtt)
+  {
+    TRY_ENTRY();
+    CRITICAL_REGION_LOCAL(m_peerlist_lock);
+    peer_stats* pps = get_listed_peer_stats(addr);
+    if(!pps)
+      return true;
+    peer_stats& ps = *pps;
+    //moving average, new sample weights 1/4
+    uint32_t sample = static_cast<uint32_t>(std::min<uint64_t>(rtt, std::numeric_limits<uint32_t>::max()));
+    ps.rtt = ps.rtt ? static_cast<uint32_t>((uint64_t(ps.rtt) * 3 + sample) / 4) : std::max<uint32_t>(sample, 1);
+    //handshake completed, peer is reachable again
+    ps.fail_count = 0;
+    return true;
+    CATCH_ENTRY_L0("peerlist_manager::set_peer_rtt()", false);
+  }
+  //--------------------------------------------------------------------------------------------------
+  inline
+  bool peerlist_manager::add_peer_throughput(const net_address& addr, uint64_t bytes, uint64_t time_ms)
+  {
+    TRY_ENTRY();
+    CRITICAL_REGION_LOCAL(m_peerlist_lock);
+    peer_stats* pps = get_listed_peer_stats(addr);
+    if(!pps)
+      return true;
+    peer_stats& ps = *pps;
+    uint64_t sample = std::max<uint64_t>(bytes * 1000 / std::max<uint64_t>(time_ms, 1), 1);
+    ps.throughput = ps.throughput ? (ps.throughput * 3 + sample) / 4 : sample;
+    return true;
+    CATCH_ENTRY_L0("peerlist_manager::add_peer_throughput()", false);
+  }
+  //--------------------------------------------------------------------------------------------------
+  inline
+  bool peerlist_manager::get_peer_stats(const net_address& addr, peer_stats& ps)
+  {
+    CRITICAL_REGION_LOCAL(m_peerlist_lock);
+    auto it = m_peers_stats.find(addr);
+    if(it == m_peers_stats.end())
+      return false;
+    ps = it->second;
+    return true;
+  }
+  //--------------------------------------------------------------------------------------------------
+  inline
+  uint64_t peerlist_manager::get_peer_score(const net_address& addr)
+  {
+    //estimated time in ms to fetch P2P_PEER_SCORE_REFERENCE_SIZE bytes from peer, lower is better
+    peer_stats ps = AUTO_VAL_INIT(ps);
+    get_peer_stats(addr, ps);
+    uint64_t rtt = ps.rtt ? ps.rtt : P2P_DEFAULT_PEER_RTT;
+    uint64_t throughput = ps.throughput ? ps.throughput : P2P_DEFAULT_PEER_THROUGHPUT;
+    //failures are forgiven over time, penalty halves every P2P_PEER_FAIL_HALF_LIFE since the last one
+    uint64_t fail_count = ps.fail_count;
+    time_t now = time(NULL);
+    if(fail_count && now > ps.last_fail)
+    {
+      uint64_t half_lifes = (now - ps.last_fail) / P2P_PEER_FAIL_HALF_LIFE;
+      fail_count = half_lifes < 64 ? fail_count >> half_lifes : 0;
+    }
+    return rtt + uint64_t(P2P_PEER_SCORE_REFERENCE_SIZE) * 1000 / throughput + fail_count * P2P_PEER_FAIL_PENALTY;
+  }
+  //--------------------------------------------------------------------------------------------------
 }
 
-BOOST_CLASS_VERSION(nodetool::peerlist_manager, 4)
+BOOST_CLASS_VERSION(nodetool::peerlist_manager, 5)
@@ -50,5 +50,14 @@ namespace boost
       a & pl.id;
       a & pl.last_seen;
     }    
+
+    template <class Archive, class ver_type>
+    inline void serialize(Archive &a,  nodetool::peer_stats& ps, const ver_type ver)
+    {
+      a & ps.rtt;
+      a & ps.throughput;
+      a & ps.fail_count;
+      a & ps.last_fail;
+    }
   }
 }
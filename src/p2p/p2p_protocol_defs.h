@@ -65,6 +65,14 @@ namespace nodetool
 
 #pragma pack(pop)
 
+  struct peer_stats
+  {
+    uint32_t rtt;         //ms, moving average of handshake round trip
+    uint64_t throughput;  //bytes per second, moving average over NOTIFY_RESPONSE_GET_OBJECTS
+    uint32_t fail_count;  //connect/handshake failures since last successful handshake
+    time_t last_fail;     //time of last failure, fail_count penalty decays from it
+  };
+
   inline
   bool operator < (const net_address& a, const net_address& b)
   {
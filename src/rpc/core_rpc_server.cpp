@@ -62,6 +62,90 @@ namespace cryptonote
       , "Port for testnet RPC server"
       , std::to_string(config::testnet::RPC_DEFAULT_PORT)
       };
+
+    const command_line::arg_descriptor<uint64_t> arg_rpc_compression_threshold = {
+        "rpc-compression-threshold"
+      , "Gzip RPC responses bigger than this size in bytes if client accepts it, 0 to disable"
+      , HTTP_DEFAULT_COMPRESSION_THRESHOLD
+      };
+
+    const command_line::arg_descriptor<uint32_t> arg_rpc_light_threads = {
+        "rpc-light-threads"
+      , "Worker threads for cheap RPC calls, 0 to run them on network threads"
+      , 2
+      };
+
+    const command_line::arg_descriptor<uint32_t> arg_rpc_heavy_threads = {
+        "rpc-heavy-threads"
+      , "Worker threads for expensive RPC calls (blocks, outputs, transactions), 0 to run them on network threads"
+      , 2
+      };
+
+    const command_line::arg_descriptor<uint32_t> arg_rpc_max_pending = {
+        "rpc-max-pending"
+      , "RPC calls allowed to wait in each worker queue, calls above it get \"503 Service Unavailable\""
+      , 100
+      };
+
+    //calls that may hold m_blockchain_lock for long or do much work, they don't delay cheap ones like /getheight
+    const char* const heavy_methods[] = {
+        "/getblocks.bin"
+      , "/getrandom_outs.bin"
+      , "/gettransactions"
+      , "/gettransactions.bin"
+      , "/sendrawtransaction"
+      , "/save_bc"
+      , "getblocktemplate"
+      , "submitblock"
+      , "getblockheadersrange"
+      , "json_rpc_batch"
+      };
+
+    //json_rpc methods that only read chain state under m_blockchain_lock and take no other lock, so a batch of
+    //them can hold m_blockchain_lock for all calls. Others (get_info, getblocktemplate...) also lock p2p or pool
+    //and would invert lock order with block handling.
+    const char* const chain_query_methods[] = {
+        "getblockcount"
+      , "on_getblockhash"
+      , "getlastblockheader"
+      , "getblockheaderbyhash"
+      , "getblockheaderbyheight"
+      , "getblockheadersrange"
+      };
+
+    //only used to pick the queue, so cheap scan instead of full json parse
+    std::string get_json_rpc_method(const std::string& body)
+    {
+      std::string::size_type pos = body.find("\"method\"");
+      if(std::string::npos == pos)
+        return std::string();
+      pos = body.find(':', pos + 8);
+      if(std::string::npos == pos)
+        return std::string();
+      pos = body.find('"', pos + 1);
+      if(std::string::npos == pos)
+        return std::string();
+      std::string::size_type end = body.find('"', pos + 1);
+      if(std::string::npos == end)
+        return std::string();
+      return body.substr(pos + 1, end - pos - 1);
+    }
+
+    bool is_heavy_method(const std::string& method)
+    {
+      for(const char* heavy: heavy_methods)
+        if(method == heavy)
+          return true;
+      return false;
+    }
+
+    bool is_chain_query_method(const std::string& method)
+    {
+      for(const char* query: chain_query_methods)
+        if(method == query)
+          return true;
+      return false;
+    }
   }
 
   //-----------------------------------------------------------------------------------
@@ -70,6 +154,10 @@ namespace cryptonote
     command_line::add_arg(desc, arg_rpc_bind_ip);
     command_line::add_arg(desc, arg_rpc_bind_port);
     command_line::add_arg(desc, arg_testnet_rpc_bind_port);
+    command_line::add_arg(desc, arg_rpc_compression_threshold);
+    command_line::add_arg(desc, arg_rpc_light_threads);
+    command_line::add_arg(desc, arg_rpc_heavy_threads);
+    command_line::add_arg(desc, arg_rpc_max_pending);
   }
   //------------------------------------------------------------------------------------------------------------------------------
   core_rpc_server::core_rpc_server(
@@ -80,6 +168,9 @@ namespace cryptonote
     : m_core(cr)
     , m_p2p(p2p)
     , m_testnet {testnet}
+    , m_light_queue(no_queue)
+    , m_heavy_queue(no_queue)
+    , m_top_block_hash(std::make_shared<crypto::hash>(null_hash))
   {}
   //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::handle_command_line(
@@ -90,6 +181,21 @@ namespace cryptonote
 
     m_bind_ip = command_line::get_arg(vm, arg_rpc_bind_ip);
     m_port = command_line::get_arg(vm, p2p_bind_arg);
+    m_net_server.get_config_object().m_compression_threshold = command_line::get_arg(vm, arg_rpc_compression_threshold);
+
+    uint32_t light_threads = command_line::get_arg(vm, arg_rpc_light_threads);
+    uint32_t heavy_threads = command_line::get_arg(vm, arg_rpc_heavy_threads);
+    uint32_t max_pending = command_line::get_arg(vm, arg_rpc_max_pending);
+    if(light_threads)
+      m_light_queue = m_workers.add_queue("RPC light", light_threads, max_pending);
+    if(heavy_threads)
+    {
+      m_heavy_queue = m_workers.add_queue("RPC heavy", heavy_threads, max_pending);
+      //one kind of expensive call can't take all heavy workers
+      for(const char* heavy: heavy_methods)
+        m_workers.set_concurrency_limit(heavy, std::max<uint32_t>(1, heavy_threads - 1));
+      m_workers.set_concurrency_limit("/save_bc", 1);
+    }
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -100,9 +206,237 @@ namespace cryptonote
     m_net_server.set_threads_prefix("RPC");
     bool r = handle_command_line(vm);
     CHECK_AND_ASSERT_MES(r, false, "Failed to process command line in core_rpc_server");
+    r = m_workers.start();
+    CHECK_AND_ASSERT_MES(r, false, "Failed to start RPC workers");
+    m_core.set_state_change_notifier(boost::bind(&core_rpc_server::on_core_state_changed, this));
     return epee::http_server_impl_base<core_rpc_server, connection_context>::init(m_port, m_bind_ip);
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::deinit()
+  {
+    //core is deinitialized right after, it must not call into stopped rpc server anymore
+    m_core.set_state_change_notifier(boost::function<void()>());
+    return epee::http_server_impl_base<core_rpc_server, connection_context>::deinit();
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::send_stop_signal()
+  {
+    epee::http_server_impl_base<core_rpc_server, connection_context>::send_stop_signal();
+
+    std::list<boost::shared_ptr<changes_waiter> > waiters;
+    CRITICAL_REGION_BEGIN(m_changes_waiters_lock);
+    waiters.swap(m_changes_waiters);
+    CRITICAL_REGION_END();
+    BOOST_FOREACH(auto& waiter, waiters)
+    {
+      waiter->timer.cancel();
+      waiter->job.clear();
+    }
+
+    //waits for handlers in progress, they use core which is deinitialized right after rpc server stop
+    m_workers.stop();
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  epee::net_utils::http::request_dispatch core_rpc_server::dispatch_http_request(
+      const epee::net_utils::http::http_request_info& query_info
+    , const epee::net_utils::http::request_job& job
+    , connection_context& cntx
+    )
+  {
+    std::string method = query_info.m_URI;
+    if(method == "/json_rpc")
+    {
+      //batch may mix any calls, so it always goes to heavy workers
+      method = epee::json_rpc::is_batch_request(query_info.m_body) ? "json_rpc_batch" : get_json_rpc_method(query_info.m_body);
+    }
+
+    //parked requests are completed from core threads, so they are parked only if there are workers to run them
+    epee::net_utils::http::request_dispatch dispatch = epee::net_utils::http::request_dispatch_inline;
+    if(no_queue != get_queue(method))
+    {
+      if(method == "/wait_for_changes")
+        dispatch = dispatch_changes_waiter(query_info, job);
+      else if(method == "getblocktemplate")
+        dispatch = dispatch_block_template_waiter(query_info, job);
+    }
+    if(epee::net_utils::http::request_dispatch_inline != dispatch)
+      return dispatch;
+
+    return post_job(method, job);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void core_rpc_server::handle_json_rpc_batch(const std::list<std::string>& methods, const boost::function<void()>& run_calls)
+  {
+    for(const std::string& method: methods)
+    {
+      if(!is_chain_query_method(method))
+      {
+        run_calls();
+        return;
+      }
+    }
+    CRITICAL_REGION_LOCAL(m_core.get_blockchain_storage());
+    run_calls();
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  size_t core_rpc_server::get_queue(const std::string& method)
+  {
+    return is_heavy_method(method) ? m_heavy_queue : m_light_queue;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  epee::net_utils::http::request_dispatch core_rpc_server::post_job(const std::string& method, const epee::net_utils::http::request_job& job)
+  {
+    size_t queue = get_queue(method);
+    if(no_queue == queue)
+      return epee::net_utils::http::request_dispatch_inline;
+    if(!m_workers.post(queue, method, boost::bind(job, true)))
+      return epee::net_utils::http::request_dispatch_rejected;
+    return epee::net_utils::http::request_dispatch_queued;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  epee::net_utils::http::request_dispatch core_rpc_server::dispatch_changes_waiter(const epee::net_utils::http::http_request_info& query_info, const epee::net_utils::http::request_job& job)
+  {
+    //request is answered right away (in regular way) if it is malformed or caller is behind already
+    boost::value_initialized<COMMAND_RPC_WAIT_FOR_CHANGES::request> req;
+    if(!epee::serialization::load_t_from_json(static_cast<COMMAND_RPC_WAIT_FOR_CHANGES::request&>(req), query_info.m_body))
+      return epee::net_utils::http::request_dispatch_inline;
+    const COMMAND_RPC_WAIT_FOR_CHANGES::request& request = req;
+    crypto::hash top_block_hash = null_hash;
+    if(request.top_block_hash.empty() || !epee::string_tools::hex_to_pod(request.top_block_hash, top_block_hash))
+      return epee::net_utils::http::request_dispatch_inline;
+    if(top_block_hash != get_top_block_hash() || request.pool_version != m_core.get_pool_version())
+      return epee::net_utils::http::request_dispatch_inline;
+
+    uint64_t timeout = request.timeout;
+    if(!timeout || timeout > COMMAND_RPC_WAIT_FOR_CHANGES_MAX_TIMEOUT)
+      timeout = COMMAND_RPC_WAIT_FOR_CHANGES_MAX_TIMEOUT;
+    return park_changes_waiter("/wait_for_changes", top_block_hash, request.pool_version, timeout, job);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  epee::net_utils::http::request_dispatch core_rpc_server::dispatch_block_template_waiter(const epee::net_utils::http::http_request_info& query_info, const epee::net_utils::http::request_job& job)
+  {
+    //caller that passes id of current template waits for a better one, others get template right away
+    boost::value_initialized<epee::json_rpc::request<COMMAND_RPC_GETBLOCKTEMPLATE::request> > req_;
+    epee::json_rpc::request<COMMAND_RPC_GETBLOCKTEMPLATE::request>& req = req_;
+    if(!epee::serialization::load_t_from_json(req, query_info.m_body) || req.params.template_id.empty())
+      return epee::net_utils::http::request_dispatch_inline;
+
+    crypto::hash top_block_hash = get_top_block_hash();
+    uint64_t pool_version = m_core.get_pool_version();
+    uint64_t timeout = COMMAND_RPC_WAIT_FOR_CHANGES_MAX_TIMEOUT;
+    //don't hold network thread while template is being built, the request will get the new one from worker
+    if(!m_block_templates_lock.tryLock())
+      return epee::net_utils::http::request_dispatch_inline;
+    {
+      epee::misc_utils::auto_scope_leave_caller unlock_handler = epee::misc_utils::create_scope_leave_handler([&](){m_block_templates_lock.unlock();});
+      auto it = m_block_templates.find(std::make_pair(req.params.wallet_address, req.params.reserve_size));
+      if(it == m_block_templates.end() || it->second.response.template_id != req.params.template_id || it->second.top_block_hash != top_block_hash)
+        return epee::net_utils::http::request_dispatch_inline;
+      if(it->second.pool_version != pool_version)
+      {
+        //pool has changed already, template gets rebuilt once refresh interval passes
+        uint64_t age = time(nullptr) - it->second.create_time;
+        if(age >= COMMAND_RPC_GETBLOCKTEMPLATE_REFRESH_INTERVAL)
+          return epee::net_utils::http::request_dispatch_inline;
+        timeout = COMMAND_RPC_GETBLOCKTEMPLATE_REFRESH_INTERVAL - age;
+      }
+    }
+    return park_changes_waiter("getblocktemplate", top_block_hash, pool_version, timeout, job);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  epee::net_utils::http::request_dispatch core_rpc_server::park_changes_waiter(const std::string& method, const crypto::hash& top_block_hash, uint64_t pool_version, uint64_t timeout, const epee::net_utils::http::request_job& job)
+  {
+    boost::shared_ptr<changes_waiter> waiter(new changes_waiter(m_net_server.get_io_service()));
+    waiter->method = method;
+    waiter->top_block_hash = top_block_hash;
+    waiter->pool_version = pool_version;
+    waiter->job = job;
+
+    CRITICAL_REGION_BEGIN(m_changes_waiters_lock);
+    if(m_changes_waiters.size() >= COMMAND_RPC_WAIT_FOR_CHANGES_MAX_WAITERS)
+    {
+      LOG_PRINT_L1("Too many long-poll requests, rejecting " << method);
+      return epee::net_utils::http::request_dispatch_rejected;
+    }
+    //timer is armed before waiter becomes visible to other threads
+    waiter->timer.expires_from_now(boost::posix_time::seconds(timeout));
+    waiter->timer.async_wait(boost::bind(&core_rpc_server::on_changes_waiter_timeout, this, waiter, boost::asio::placeholders::error));
+    m_changes_waiters.push_back(waiter);
+    CRITICAL_REGION_END();
+
+    //core state is not read under m_changes_waiters_lock, so check it once more for change that came before waiter was parked
+    if(waiter->top_block_hash != get_top_block_hash() || waiter->pool_version != m_core.get_pool_version())
+      complete_changes_waiter(waiter);
+    return epee::net_utils::http::request_dispatch_queued;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void core_rpc_server::complete_changes_waiter(const boost::shared_ptr<changes_waiter>& waiter)
+  {
+    epee::net_utils::http::request_job job;
+    CRITICAL_REGION_BEGIN(m_changes_waiters_lock);
+    auto it = std::find(m_changes_waiters.begin(), m_changes_waiters.end(), waiter);
+    if(it == m_changes_waiters.end())
+      return;
+    m_changes_waiters.erase(it);
+    job.swap(waiter->job);
+    CRITICAL_REGION_END();
+
+    waiter->timer.cancel();
+    run_job(waiter->method, job);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void core_rpc_server::on_changes_waiter_timeout(const boost::shared_ptr<changes_waiter>& waiter, const boost::system::error_code& ec)
+  {
+    if(ec == boost::asio::error::operation_aborted)
+      return;
+    complete_changes_waiter(waiter);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void core_rpc_server::on_core_state_changed()
+  {
+    //called from core threads right after block or transaction is handled, so keep it short.
+    //Top hash is published before waiters are checked, so a waiter parked meanwhile sees it in park_changes_waiter()
+    crypto::hash top_block_hash = m_core.get_tail_id();
+    uint64_t pool_version = m_core.get_pool_version();
+    std::atomic_store(&m_top_block_hash, std::make_shared<crypto::hash>(top_block_hash));
+
+    std::list<boost::shared_ptr<changes_waiter> > changed;
+    CRITICAL_REGION_BEGIN(m_changes_waiters_lock);
+    for(auto it = m_changes_waiters.begin(); it != m_changes_waiters.end();)
+    {
+      if((*it)->top_block_hash != top_block_hash || (*it)->pool_version != pool_version)
+      {
+        changed.push_back(*it);
+        it = m_changes_waiters.erase(it);
+      }else
+        ++it;
+    }
+    CRITICAL_REGION_END();
+
+    BOOST_FOREACH(auto& waiter, changed)
+    {
+      waiter->timer.cancel();
+      run_job(waiter->method, waiter->job);
+      waiter->job.clear();
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  void core_rpc_server::run_job(const std::string& method, const epee::net_utils::http::request_job& job)
+  {
+    //calling thread is core or network one, so request that workers can't take is answered with 503 instead of run here
+    if(epee::net_utils::http::request_dispatch_queued != post_job(method, job))
+    {
+      LOG_PRINT_L1("RPC workers are overloaded, rejecting parked " << method);
+      job(false);
+    }
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  crypto::hash core_rpc_server::get_top_block_hash()
+  {
+    return *std::atomic_load(&m_top_block_hash);
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::check_core_busy()
   {
     if(m_p2p.get_payload_object().get_core().get_blockchain_storage().is_storing_blockchain())
@@ -260,6 +594,19 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_transactions_fast(const COMMAND_RPC_GET_TRANSACTIONS_FAST::request& req, COMMAND_RPC_GET_TRANSACTIONS_FAST::response& res, connection_context& cntx)
+  {
+    CHECK_CORE_BUSY();
+    if(!m_core.get_transactions_blobs(req.txs_hashes, res.txs, res.missed_tx))
+    {
+      res.status = "Failed";
+      return true;
+    }
+
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_send_raw_tx(const COMMAND_RPC_SEND_RAW_TX::request& req, COMMAND_RPC_SEND_RAW_TX::response& res, connection_context& cntx)
   {
     CHECK_CORE_READY();
@@ -366,6 +713,20 @@ namespace cryptonote
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_wait_for_changes(const COMMAND_RPC_WAIT_FOR_CHANGES::request& req, COMMAND_RPC_WAIT_FOR_CHANGES::response& res, connection_context& cntx)
+  {
+    //waiting itself is done in dispatch_changes_waiter(), here current state is just reported
+    CHECK_CORE_BUSY();
+    crypto::hash top_block_hash = null_hash;
+    m_core.get_blockchain_top(res.height, top_block_hash);
+    ++res.height;
+    res.top_block_hash = epee::string_tools::pod_to_hex(top_block_hash);
+    res.pool_version = m_core.get_pool_version();
+    res.tx_pool_size = m_core.get_pool_transactions_count();
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
   bool core_rpc_server::on_getblockcount(const COMMAND_RPC_GETBLOCKCOUNT::request& req, COMMAND_RPC_GETBLOCKCOUNT::response& res, connection_context& cntx)
   {
     CHECK_CORE_BUSY();
@@ -438,6 +799,21 @@ namespace cryptonote
       return false;
     }
 
+    //callers building on the same template are served from cache, it is rebuilt
+    //for new top block or, not more often than refresh interval, for pool changes
+    CRITICAL_REGION_LOCAL(m_block_templates_lock);
+    crypto::hash top_block_hash = m_core.get_tail_id();
+    uint64_t pool_version = m_core.get_pool_version();
+    uint64_t now = time(nullptr);
+    auto key = std::make_pair(req.wallet_address, req.reserve_size);
+    auto it = m_block_templates.find(key);
+    if(it != m_block_templates.end() && it->second.top_block_hash == top_block_hash &&
+      (it->second.pool_version == pool_version || now - it->second.create_time < COMMAND_RPC_GETBLOCKTEMPLATE_REFRESH_INTERVAL))
+    {
+      res = it->second.response;
+      return true;
+    }
+
     block b = AUTO_VAL_INIT(b);
     cryptonote::blobdata blob_reserve;
     blob_reserve.resize(req.reserve_size, 0);
@@ -474,7 +850,17 @@ namespace cryptonote
       return false;
     }
     res.blocktemplate_blob = string_tools::buff_to_hex_nodelimer(block_blob);
+    res.template_id = string_tools::pod_to_hex(crypto::cn_fast_hash(block_blob.data(), block_blob.size()));
     res.status = CORE_RPC_STATUS_OK;
+
+    if(m_block_templates.size() >= COMMAND_RPC_GETBLOCKTEMPLATE_CACHE_SIZE && it == m_block_templates.end())
+      m_block_templates.clear();
+    block_template_entry& entry = m_block_templates[key];
+    //template is built on b.prev_id, which may already differ from top_block_hash read above
+    entry.top_block_hash = b.prev_id;
+    entry.pool_version = pool_version;
+    entry.create_time = now;
+    entry.response = res;
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -547,6 +933,7 @@ namespace cryptonote
     responce.hash = string_tools::pod_to_hex(hash);
     responce.difficulty = m_core.get_blockchain_storage().block_difficulty(height);
     responce.reward = get_block_reward(blk);
+    responce.block_size = 0;
     return true;
   }
   //------------------------------------------------------------------------------------------------------------------------------
@@ -558,30 +945,15 @@ namespace cryptonote
       error_resp.message = "Core is busy.";
       return false;
     }
-    uint64_t last_block_height;
-    crypto::hash last_block_hash;
-    bool have_last_block_hash = m_core.get_blockchain_top(last_block_height, last_block_hash);
-    if (!have_last_block_hash)
-    {
-      error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
-      error_resp.message = "Internal error: can't get last block hash.";
-      return false;
-    }
-    block last_block;
-    bool have_last_block = m_core.get_block_by_hash(last_block_hash, last_block);
-    if (!have_last_block)
+    uint64_t last_block_height = m_core.get_current_blockchain_height() - 1;
+    std::list<block_header_responce> headers;
+    if(!m_core.get_blockchain_storage().get_block_headers(last_block_height, last_block_height, headers) || headers.size() != 1)
     {
       error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
-      error_resp.message = "Internal error: can't get last block.";
-      return false;
-    }
-    bool responce_filled = fill_block_header_responce(last_block, false, last_block_height, last_block_hash, res.block_header);
-    if (!responce_filled)
-    {
-      error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
-      error_resp.message = "Internal error: can't produce valid response.";
+      error_resp.message = "Internal error: can't get last block header.";
       return false;
     }
+    res.block_header = headers.front();
     res.status = CORE_RPC_STATUS_OK;
     return true;
   }
@@ -616,6 +988,14 @@ namespace cryptonote
       return false;
     }
     uint64_t block_height = boost::get<txin_gen>(blk.miner_tx.vin.front()).height;
+    std::list<block_header_responce> headers;
+    if(block_height < m_core.get_current_blockchain_height() && m_core.get_block_id_by_height(block_height) == block_hash &&
+      m_core.get_blockchain_storage().get_block_headers(block_height, block_height, headers) && headers.size() == 1)
+    {
+      res.block_header = headers.front();
+      res.status = CORE_RPC_STATUS_OK;
+      return true;
+    }
     bool responce_filled = fill_block_header_responce(blk, false, block_height, block_hash, res.block_header);
     if (!responce_filled)
     {
@@ -640,20 +1020,47 @@ namespace cryptonote
       error_resp.message = std::string("To big height: ") + std::to_string(req.height) + ", current blockchain height = " +  std::to_string(m_core.get_current_blockchain_height());
       return false;
     }
-    crypto::hash block_hash = m_core.get_block_id_by_height(req.height);
-    block blk;
-    bool have_block = m_core.get_block_by_hash(block_hash, blk);
-    if (!have_block)
+    std::list<block_header_responce> headers;
+    if(!m_core.get_blockchain_storage().get_block_headers(req.height, req.height, headers) || headers.size() != 1)
     {
       error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
       error_resp.message = "Internal error: can't get block by height. Height = " + std::to_string(req.height) + '.';
       return false;
     }
-    bool responce_filled = fill_block_header_responce(blk, false, req.height, block_hash, res.block_header);
-    if (!responce_filled)
+    res.block_header = headers.front();
+    res.status = CORE_RPC_STATUS_OK;
+    return true;
+  }
+  //------------------------------------------------------------------------------------------------------------------------------
+  bool core_rpc_server::on_get_block_headers_range(const COMMAND_RPC_GET_BLOCK_HEADERS_RANGE::request& req, COMMAND_RPC_GET_BLOCK_HEADERS_RANGE::response& res, epee::json_rpc::error& error_resp, connection_context& cntx){
+    if(!check_core_busy())
+    {
+      error_resp.code = CORE_RPC_ERROR_CODE_CORE_BUSY;
+      error_resp.message = "Core is busy.";
+      return false;
+    }
+    if(req.start_height > req.end_height)
+    {
+      error_resp.code = CORE_RPC_ERROR_CODE_WRONG_PARAM;
+      error_resp.message = "Invalid range: start_height is bigger than end_height.";
+      return false;
+    }
+    if(req.end_height - req.start_height >= COMMAND_RPC_GET_BLOCK_HEADERS_RANGE_MAX_COUNT)
+    {
+      error_resp.code = CORE_RPC_ERROR_CODE_WRONG_PARAM;
+      error_resp.message = "Too big range, at most " + std::to_string(COMMAND_RPC_GET_BLOCK_HEADERS_RANGE_MAX_COUNT) + " headers per request.";
+      return false;
+    }
+    if(m_core.get_current_blockchain_height() <= req.end_height)
+    {
+      error_resp.code = CORE_RPC_ERROR_CODE_TOO_BIG_HEIGHT;
+      error_resp.message = std::string("To big height: ") + std::to_string(req.end_height) + ", current blockchain height = " +  std::to_string(m_core.get_current_blockchain_height());
+      return false;
+    }
+    if(!m_core.get_blockchain_storage().get_block_headers(req.start_height, req.end_height, res.headers))
     {
       error_resp.code = CORE_RPC_ERROR_CODE_INTERNAL_ERROR;
-      error_resp.message = "Internal error: can't produce valid response.";
+      error_resp.message = "Internal error: can't get block headers range.";
       return false;
     }
     res.status = CORE_RPC_STATUS_OK;
@@ -30,10 +30,12 @@
 
 #pragma  once 
 
+#include <memory>
 #include <boost/program_options/options_description.hpp>
 #include <boost/program_options/variables_map.hpp>
 
 #include "net/http_server_impl_base.h"
+#include "worker_queues.h"
 #include "core_rpc_server_commands_defs.h"
 #include "cryptonote_core/cryptonote_core.h"
 #include "p2p/net_node.h"
@@ -59,6 +61,17 @@ namespace cryptonote
     bool init(
         const boost::program_options::variables_map& vm
       );
+    bool send_stop_signal();
+    bool deinit();
+
+    //runs handlers on worker threads, so network threads only do I/O
+    virtual epee::net_utils::http::request_dispatch dispatch_http_request(
+        const epee::net_utils::http::http_request_info& query_info
+      , const epee::net_utils::http::request_job& job
+      , connection_context& cntx
+      );
+    //batches of plain chain queries run under one blockchain lock
+    virtual void handle_json_rpc_batch(const std::list<std::string>& methods, const boost::function<void()>& run_calls);
   private:
 
     CHAIN_HTTP_TO_MAP2(connection_context); //forward http requests to uri map
@@ -68,13 +81,15 @@ namespace cryptonote
       MAP_URI_AUTO_BIN2("/getblocks.bin", on_get_blocks, COMMAND_RPC_GET_BLOCKS_FAST)
       MAP_URI_AUTO_BIN2("/get_o_indexes.bin", on_get_indexes, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES)      
       MAP_URI_AUTO_BIN2("/getrandom_outs.bin", on_get_random_outs, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS)      
-      MAP_URI_AUTO_JON2("/gettransactions", on_get_transactions, COMMAND_RPC_GET_TRANSACTIONS)
+      MAP_URI_AUTO_JON2_STREAMED("/gettransactions", on_get_transactions, COMMAND_RPC_GET_TRANSACTIONS)
+      MAP_URI_AUTO_BIN2("/gettransactions.bin", on_get_transactions_fast, COMMAND_RPC_GET_TRANSACTIONS_FAST)
       MAP_URI_AUTO_JON2("/sendrawtransaction", on_send_raw_tx, COMMAND_RPC_SEND_RAW_TX)
       MAP_URI_AUTO_JON2("/start_mining", on_start_mining, COMMAND_RPC_START_MINING)
       MAP_URI_AUTO_JON2("/stop_mining", on_stop_mining, COMMAND_RPC_STOP_MINING)
       MAP_URI_AUTO_JON2("/mining_status", on_mining_status, COMMAND_RPC_MINING_STATUS)
       MAP_URI_AUTO_JON2("/save_bc", on_save_bc, COMMAND_RPC_SAVE_BC)
       MAP_URI_AUTO_JON2("/getinfo", on_get_info, COMMAND_RPC_GET_INFO)
+      MAP_URI_AUTO_JON2("/wait_for_changes", on_wait_for_changes, COMMAND_RPC_WAIT_FOR_CHANGES)
       BEGIN_JSON_RPC_MAP("/json_rpc")
         MAP_JON_RPC("getblockcount",             on_getblockcount,              COMMAND_RPC_GETBLOCKCOUNT)
         MAP_JON_RPC_WE("on_getblockhash",        on_getblockhash,               COMMAND_RPC_GETBLOCKHASH)
@@ -83,6 +98,7 @@ namespace cryptonote
         MAP_JON_RPC_WE("getlastblockheader",     on_get_last_block_header,      COMMAND_RPC_GET_LAST_BLOCK_HEADER)
         MAP_JON_RPC_WE("getblockheaderbyhash",   on_get_block_header_by_hash,   COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH)
         MAP_JON_RPC_WE("getblockheaderbyheight", on_get_block_header_by_height, COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT)
+        MAP_JON_RPC_WE("getblockheadersrange",   on_get_block_headers_range,    COMMAND_RPC_GET_BLOCK_HEADERS_RANGE)
         MAP_JON_RPC_WE("get_connections",        on_get_connections,            COMMAND_RPC_GET_CONNECTIONS)
         MAP_JON_RPC_WE("get_info",               on_get_info_json,              COMMAND_RPC_GET_INFO)
       END_JSON_RPC_MAP()
@@ -91,6 +107,7 @@ namespace cryptonote
     bool on_get_height(const COMMAND_RPC_GET_HEIGHT::request& req, COMMAND_RPC_GET_HEIGHT::response& res, connection_context& cntx);
     bool on_get_blocks(const COMMAND_RPC_GET_BLOCKS_FAST::request& req, COMMAND_RPC_GET_BLOCKS_FAST::response& res, connection_context& cntx);
     bool on_get_transactions(const COMMAND_RPC_GET_TRANSACTIONS::request& req, COMMAND_RPC_GET_TRANSACTIONS::response& res, connection_context& cntx);
+    bool on_get_transactions_fast(const COMMAND_RPC_GET_TRANSACTIONS_FAST::request& req, COMMAND_RPC_GET_TRANSACTIONS_FAST::response& res, connection_context& cntx);
     bool on_get_indexes(const COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::request& req, COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES::response& res, connection_context& cntx);
     bool on_send_raw_tx(const COMMAND_RPC_SEND_RAW_TX::request& req, COMMAND_RPC_SEND_RAW_TX::response& res, connection_context& cntx);
     bool on_start_mining(const COMMAND_RPC_START_MINING::request& req, COMMAND_RPC_START_MINING::response& res, connection_context& cntx);
@@ -99,6 +116,7 @@ namespace cryptonote
     bool on_get_random_outs(const COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::request& req, COMMAND_RPC_GET_RANDOM_OUTPUTS_FOR_AMOUNTS::response& res, connection_context& cntx);        
     bool on_get_info(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RPC_GET_INFO::response& res, connection_context& cntx);        
     bool on_save_bc(const COMMAND_RPC_SAVE_BC::request& req, COMMAND_RPC_SAVE_BC::response& res, connection_context& cntx);
+    bool on_wait_for_changes(const COMMAND_RPC_WAIT_FOR_CHANGES::request& req, COMMAND_RPC_WAIT_FOR_CHANGES::response& res, connection_context& cntx);
     
     //json_rpc
     bool on_getblockcount(const COMMAND_RPC_GETBLOCKCOUNT::request& req, COMMAND_RPC_GETBLOCKCOUNT::response& res, connection_context& cntx);
@@ -108,6 +126,7 @@ namespace cryptonote
     bool on_get_last_block_header(const COMMAND_RPC_GET_LAST_BLOCK_HEADER::request& req, COMMAND_RPC_GET_LAST_BLOCK_HEADER::response& res, epee::json_rpc::error& error_resp, connection_context& cntx);
     bool on_get_block_header_by_hash(const COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH::request& req, COMMAND_RPC_GET_BLOCK_HEADER_BY_HASH::response& res, epee::json_rpc::error& error_resp, connection_context& cntx);
     bool on_get_block_header_by_height(const COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT::request& req, COMMAND_RPC_GET_BLOCK_HEADER_BY_HEIGHT::response& res, epee::json_rpc::error& error_resp, connection_context& cntx);
+    bool on_get_block_headers_range(const COMMAND_RPC_GET_BLOCK_HEADERS_RANGE::request& req, COMMAND_RPC_GET_BLOCK_HEADERS_RANGE::response& res, epee::json_rpc::error& error_resp, connection_context& cntx);
     bool on_get_connections(const COMMAND_RPC_GET_CONNECTIONS::request& req, COMMAND_RPC_GET_CONNECTIONS::response& res, epee::json_rpc::error& error_resp, connection_context& cntx);
     bool on_get_info_json(const COMMAND_RPC_GET_INFO::request& req, COMMAND_RPC_GET_INFO::response& res, epee::json_rpc::error& error_resp, connection_context& cntx);
     //-----------------------
@@ -116,6 +135,39 @@ namespace cryptonote
       );
     bool check_core_busy();
     bool check_core_ready();
+
+    size_t get_queue(const std::string& method);
+    epee::net_utils::http::request_dispatch post_job(const std::string& method, const epee::net_utils::http::request_job& job);
+    void run_job(const std::string& method, const epee::net_utils::http::request_job& job);
+    //chain top as last reported by core, network threads read it instead of taking blockchain lock
+    crypto::hash get_top_block_hash();
+
+    //long-poll requests parked until core reports change or timer expires, they hold no thread meanwhile
+    struct changes_waiter
+    {
+      changes_waiter(boost::asio::io_service& io_service):timer(io_service)
+      {}
+      std::string method;
+      crypto::hash top_block_hash;
+      uint64_t pool_version;
+      epee::net_utils::http::request_job job;
+      boost::asio::deadline_timer timer;
+    };
+    epee::net_utils::http::request_dispatch dispatch_changes_waiter(const epee::net_utils::http::http_request_info& query_info, const epee::net_utils::http::request_job& job);
+    epee::net_utils::http::request_dispatch dispatch_block_template_waiter(const epee::net_utils::http::http_request_info& query_info, const epee::net_utils::http::request_job& job);
+    epee::net_utils::http::request_dispatch park_changes_waiter(const std::string& method, const crypto::hash& top_block_hash, uint64_t pool_version, uint64_t timeout, const epee::net_utils::http::request_job& job);
+    void complete_changes_waiter(const boost::shared_ptr<changes_waiter>& waiter);
+    void on_changes_waiter_timeout(const boost::shared_ptr<changes_waiter>& waiter, const boost::system::error_code& ec);
+    void on_core_state_changed();
+
+    //templates are shared by all callers with the same address and reserve size until chain top changes
+    struct block_template_entry
+    {
+      crypto::hash top_block_hash;
+      uint64_t pool_version;
+      uint64_t create_time;
+      COMMAND_RPC_GETBLOCKTEMPLATE::response response;
+    };
     
     //utils
     uint64_t get_block_reward(const block& blk);
@@ -126,5 +178,18 @@ namespace cryptonote
     std::string m_port;
     std::string m_bind_ip;
     bool m_testnet;
+
+    static const size_t no_queue = static_cast<size_t>(-1);
+    epee::worker_queues m_workers;
+    size_t m_light_queue;
+    size_t m_heavy_queue;
+
+    //replaced as a whole, read and written with std::atomic_load/std::atomic_store
+    std::shared_ptr<crypto::hash> m_top_block_hash;
+    epee::critical_section m_changes_waiters_lock;
+    std::list<boost::shared_ptr<changes_waiter> > m_changes_waiters;
+
+    epee::critical_section m_block_templates_lock;
+    std::map<std::pair<std::string, uint64_t>, block_template_entry> m_block_templates;
   };
 }
@@ -115,6 +115,31 @@ namespace cryptonote
     };
   };
 
+  //-----------------------------------------------
+  struct COMMAND_RPC_GET_TRANSACTIONS_FAST
+  {
+    struct request
+    {
+      std::list<crypto::hash> txs_hashes;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(txs_hashes)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      std::list<blobdata> txs;               //transactions blobs, in order of found hashes
+      std::list<crypto::hash> missed_tx;     //not found transactions
+      std::string status;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(txs)
+        KV_SERIALIZE_CONTAINER_POD_AS_BLOB(missed_tx)
+        KV_SERIALIZE(status)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
   //-----------------------------------------------
   struct COMMAND_RPC_GET_TX_GLOBAL_OUTPUTS_INDEXES
   {
@@ -338,6 +363,40 @@ namespace cryptonote
       END_KV_SERIALIZE_MAP()
     };
   };
+  //-----------------------------------------------
+  //long-poll: answered once top block or pool differs from what caller knows, or on timeout
+  struct COMMAND_RPC_WAIT_FOR_CHANGES
+  {
+    struct request
+    {
+      std::string top_block_hash; //empty - answer right away
+      uint64_t pool_version;
+      uint64_t timeout;           //seconds, 0 - maximum allowed
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(top_block_hash)
+        KV_SERIALIZE(pool_version)
+        KV_SERIALIZE(timeout)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      std::string status;
+      uint64_t height;
+      std::string top_block_hash;
+      uint64_t pool_version;
+      uint64_t tx_pool_size;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(status)
+        KV_SERIALIZE(height)
+        KV_SERIALIZE(top_block_hash)
+        KV_SERIALIZE(pool_version)
+        KV_SERIALIZE(tx_pool_size)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
   
   //
   struct COMMAND_RPC_GETBLOCKCOUNT
@@ -371,10 +430,12 @@ namespace cryptonote
     {
       uint64_t reserve_size;       //max 255 bytes
       std::string wallet_address;
+      std::string template_id;     //id of template caller has, if set - answer is delayed until better template exists
 
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE(reserve_size)
         KV_SERIALIZE(wallet_address)
+        KV_SERIALIZE(template_id)
       END_KV_SERIALIZE_MAP()
     };
 
@@ -384,6 +445,7 @@ namespace cryptonote
       uint64_t height;
       uint64_t reserved_offset;
       blobdata blocktemplate_blob;
+      std::string template_id;
       std::string status;
 
       BEGIN_KV_SERIALIZE_MAP()
@@ -391,6 +453,7 @@ namespace cryptonote
         KV_SERIALIZE(height)
         KV_SERIALIZE(reserved_offset)
         KV_SERIALIZE(blocktemplate_blob)
+        KV_SERIALIZE(template_id)
         KV_SERIALIZE(status)
       END_KV_SERIALIZE_MAP()
     };
@@ -423,6 +486,7 @@ namespace cryptonote
       std::string hash;
       difficulty_type difficulty;
       uint64_t reward;
+      uint64_t block_size;
       
       BEGIN_KV_SERIALIZE_MAP()
         KV_SERIALIZE(major_version)
@@ -436,6 +500,7 @@ namespace cryptonote
         KV_SERIALIZE(hash)
         KV_SERIALIZE(difficulty)
         KV_SERIALIZE(reward)
+        KV_SERIALIZE(block_size)
       END_KV_SERIALIZE_MAP()
   };
   
@@ -508,6 +573,31 @@ namespace cryptonote
 
   };
 
+  struct COMMAND_RPC_GET_BLOCK_HEADERS_RANGE
+  {
+    struct request
+    {
+      uint64_t start_height;
+      uint64_t end_height;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(start_height)
+        KV_SERIALIZE(end_height)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      std::string status;
+      std::list<block_header_responce> headers;
+
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(headers)
+        KV_SERIALIZE(status)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
   struct COMMAND_RPC_GET_CONNECTIONS
   {
     struct request
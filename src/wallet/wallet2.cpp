@@ -28,6 +28,7 @@
 // 
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
+#include <memory>
 #include <boost/archive/binary_oarchive.hpp>
 #include <boost/archive/binary_iarchive.hpp>
 
@@ -97,7 +98,8 @@ bool wallet2::get_seed(std::string& electrum_words)
   return memcmp(second.data,get_account().get_keys().m_view_secret_key.data, sizeof(crypto::secret_key)) == 0;
 }
 //----------------------------------------------------------------------------------------------------
-void wallet2::process_new_transaction(const cryptonote::transaction& tx, uint64_t height)
+//pderivation, if given, is the derivation of the tx public key from extra with the view secret key
+void wallet2::process_new_transaction(const cryptonote::transaction& tx, uint64_t height, const crypto::key_derivation* pderivation)
 {
   process_unconfirmed(tx);
   std::vector<size_t> outs;
@@ -123,7 +125,8 @@ void wallet2::process_new_transaction(const cryptonote::transaction& tx, uint64_
     }
 
     crypto::public_key tx_pub_key = pub_key_field.pub_key;
-    bool r = lookup_acc_outs(m_account.get_keys(), tx, tx_pub_key, outs, tx_money_got_in_outs);
+    bool r = pderivation ? lookup_acc_outs(m_account.get_keys(), tx, *pderivation, outs, tx_money_got_in_outs)
+                         : lookup_acc_outs(m_account.get_keys(), tx, tx_pub_key, outs, tx_money_got_in_outs);
     THROW_WALLET_EXCEPTION_IF(!r, error::acc_outs_lookup_error, tx, tx_pub_key, m_account.get_keys());
 
     if(!outs.empty() && tx_money_got_in_outs)
@@ -219,18 +222,31 @@ void wallet2::process_new_blockchain_entry(const cryptonote::block& b, cryptonot
   //optimization: seeking only for blocks that are not older then the wallet creation time plus 1 day. 1 day is for possible user incorrect time setup
   if(b.timestamp + 60*60*24 > m_account.get_createtime())
   {
-    TIME_MEASURE_START(miner_tx_handle_time);
-    process_new_transaction(b.miner_tx, height);
-    TIME_MEASURE_FINISH(miner_tx_handle_time);
-
-    TIME_MEASURE_START(txs_handle_time);
+    std::vector<cryptonote::transaction> txs(bche.txs.size());
+    size_t i = 0;
     BOOST_FOREACH(auto& txblob, bche.txs)
     {
-      cryptonote::transaction tx;
-      bool r = parse_and_validate_tx_from_blob(txblob, tx);
+      bool r = parse_and_validate_tx_from_blob(txblob, txs[i++]);
       THROW_WALLET_EXCEPTION_IF(!r, error::tx_parse_error, txblob);
-      process_new_transaction(tx, height);
     }
+
+    //derive all tx public keys of the block at once, miner tx goes first
+    std::vector<crypto::public_key> tx_pub_keys(txs.size() + 1);
+    std::vector<crypto::key_derivation> derivations(tx_pub_keys.size());
+    std::unique_ptr<bool[]> derivation_valid(new bool[tx_pub_keys.size()]);
+    tx_pub_keys[0] = get_tx_pub_key_from_extra(b.miner_tx);
+    for(i = 0; i < txs.size(); ++i)
+      tx_pub_keys[i + 1] = get_tx_pub_key_from_extra(txs[i]);
+    crypto::key_derivation_precomp view_key_precomp(m_account.get_keys().m_view_secret_key);
+    view_key_precomp.derive(tx_pub_keys.data(), tx_pub_keys.size(), derivations.data(), derivation_valid.get());
+
+    TIME_MEASURE_START(miner_tx_handle_time);
+    process_new_transaction(b.miner_tx, height, derivation_valid[0] ? &derivations[0] : NULL);
+    TIME_MEASURE_FINISH(miner_tx_handle_time);
+
+    TIME_MEASURE_START(txs_handle_time);
+    for(i = 0; i < txs.size(); ++i)
+      process_new_transaction(txs[i], height, derivation_valid[i + 1] ? &derivations[i + 1] : NULL);
     TIME_MEASURE_FINISH(txs_handle_time);
     LOG_PRINT_L2("Processed block: " << bl_id << ", height " << height << ", " <<  miner_tx_handle_time + txs_handle_time << "(" << miner_tx_handle_time << "/" << txs_handle_time <<")ms");
   }else
@@ -115,15 +115,26 @@ namespace tools
   //------------------------------------------------------------------------------------------------------------------------------
   bool wallet_rpc_server::validate_transfer(const std::list<wallet_rpc::transfer_destination> destinations, const std::string payment_id, std::vector<cryptonote::tx_destination_entry>& dsts, std::vector<uint8_t>& extra, epee::json_rpc::error& er)
   {
+    std::vector<std::string> addresses;
+    addresses.reserve(destinations.size());
     for (auto it = destinations.begin(); it != destinations.end(); it++)
+      addresses.push_back(it->address);
+
+    std::vector<cryptonote::account_public_address> addrs;
+    std::vector<bool> valid;
+    cryptonote::get_account_addresses_from_str(addrs, valid, m_wallet.testnet(), addresses);
+
+    size_t i = 0;
+    for (auto it = destinations.begin(); it != destinations.end(); it++, i++)
     {
-      cryptonote::tx_destination_entry de;
-      if(!get_account_address_from_str(de.addr, m_wallet.testnet(), it->address))
+      if(!valid[i])
       {
         er.code = WALLET_RPC_ERROR_CODE_WRONG_ADDRESS;
         er.message = std::string("WALLET_RPC_ERROR_CODE_WRONG_ADDRESS: ") + it->address;
         return false;
       }
+      cryptonote::tx_destination_entry de;
+      de.addr = addrs[i];
       de.amount = it->amount;
       dsts.push_back(de);
     }
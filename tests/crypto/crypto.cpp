@@ -55,3 +55,11 @@ void hash_to_ec(const crypto::public_key &key, crypto::ec_point &res) {
   crypto::hash_to_ec(key, tmp);
   crypto::ge_p3_tobytes(crypto::operator &(res), &tmp);
 }
+
+int fe_backend_count() {
+  return crypto::FE_BACKEND_COUNT;
+}
+
+bool select_fe_backend(int backend) {
+  return crypto::fe_backend_select(backend) == 0;
+}
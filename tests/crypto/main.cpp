@@ -62,17 +62,13 @@ bool operator !=(const key_derivation &a, const key_derivation &b) {
 
 DISABLE_GCC_WARNING(maybe-uninitialized)
 
-int main(int argc, char *argv[]) {
+static bool run_tests(const char *path) {
   fstream input;
   string cmd;
   size_t test = 0;
   bool error = false;
   setup_random();
-  if (argc != 2) {
-    cerr << "invalid arguments" << endl;
-    return 1;
-  }
-  input.open(argv[1], ios_base::in);
+  input.open(path, ios_base::in);
   for (;;) {
     ++test;
     input.exceptions(ios_base::badbit);
@@ -269,5 +265,24 @@ error:
     cerr << "Wrong result on test " << test << endl;
     error = true;
   }
+  return !error;
+}
+
+int main(int argc, char *argv[]) {
+  bool error = false;
+  if (argc != 2) {
+    cerr << "invalid arguments" << endl;
+    return 1;
+  }
+  // the same vectors have to pass with every field arithmetic backend built in
+  for (int backend = 0; backend < fe_backend_count(); backend++) {
+    if (!select_fe_backend(backend)) {
+      continue;
+    }
+    if (!run_tests(argv[1])) {
+      cerr << "Failed with field arithmetic backend " << backend << endl;
+      error = true;
+    }
+  }
   return error ? 1 : 0;
 }
@@ -34,4 +34,8 @@
 
 void setup_random(void) {
     memset(&state, 42, sizeof(union hash_state));
+    state_seeded = 1;
+#if !defined(NDEBUG)
+    curstate = 1;
+#endif
 }
@@ -0,0 +1,108 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "crypto/hash.h"
+
+using namespace std;
+using namespace crypto;
+
+namespace {
+  typedef chrono::steady_clock bench_clock;
+
+  vector<char> make_data(size_t size) {
+    vector<char> data(size);
+    uint32_t seed = 1;
+    for (size_t i = 0; i < size; i++) {
+      seed = seed * 1103515245 + 12345;
+      data[i] = static_cast<char>(seed >> 16);
+    }
+    return data;
+  }
+
+  template<class F>
+  void bench(const string &name, size_t bytes_per_call, size_t calls, F f) {
+    f();
+    bench_clock::time_point start = bench_clock::now();
+    for (size_t i = 0; i < calls; i++) {
+      f();
+    }
+    double ns = chrono::duration<double, nano>(bench_clock::now() - start).count();
+    cout << left << setw(28) << name << right << fixed << setprecision(1)
+      << setw(12) << ns / calls << " ns/call" << setw(10) << bytes_per_call * calls * 1000.0 / ns << " MB/s" << endl;
+  }
+
+  void bench_fast(size_t size, size_t calls) {
+    vector<char> data = make_data(size);
+    char hash[HASH_SIZE];
+    bench("fast " + to_string(size), size, calls, [&]() {
+      cn_fast_hash(data.data(), data.size(), hash);
+      data[0] = hash[0];
+    });
+  }
+
+  void bench_fast_x4(size_t size, size_t calls) {
+    vector<char> data = make_data(4 * size);
+    char hash[4 * HASH_SIZE];
+    bench("fast x4 " + to_string(size), 4 * size, calls, [&]() {
+      cn_fast_hash_x4(data.data(), size, hash);
+      data[0] = hash[0];
+    });
+  }
+
+  void bench_tree(size_t count, size_t calls) {
+    vector<char> data = make_data(count * HASH_SIZE);
+    char hash[HASH_SIZE];
+    bench("tree " + to_string(count), data.size(), calls, [&]() {
+      tree_hash(reinterpret_cast<const char (*)[HASH_SIZE]>(data.data()), count, hash);
+      data[0] = hash[0];
+    });
+  }
+}
+
+int main(int argc, char *argv[]) {
+  size_t scale = argc > 1 ? stoul(argv[1]) : 1;
+
+  bench_fast(32, 1000000 * scale);
+  bench_fast(64, 1000000 * scale);
+  bench_fast(1024, 100000 * scale);
+  bench_fast_x4(64, 250000 * scale);
+  bench_fast_x4(1024, 25000 * scale);
+  bench_tree(3, 500000 * scale);
+  bench_tree(16, 100000 * scale);
+  bench_tree(514, 2000 * scale);
+  bench_tree(4096, 250 * scale);
+  return 0;
+}
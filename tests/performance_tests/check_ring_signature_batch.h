@@ -0,0 +1,100 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <vector>
+
+#include "cryptonote_core/account.h"
+#include "cryptonote_core/cryptonote_basic.h"
+#include "cryptonote_core/cryptonote_format_utils.h"
+#include "crypto/crypto.h"
+
+#include "multi_tx_test_base.h"
+
+// Every call checks the same number of ring signatures over one ring, as inputs of a block
+// that reuse the same outputs would, either one by one or with crypto::ring_signature_batch
+template<size_t a_ring_size, bool a_batched>
+class test_check_ring_signature_batch : private multi_tx_test_base<a_ring_size>
+{
+public:
+  static const size_t loop_count = 10;
+  static const size_t ring_size = a_ring_size;
+  static const bool batched = a_batched;
+  static const size_t signatures_per_call = 16;
+
+  typedef multi_tx_test_base<a_ring_size> base_class;
+
+  bool init()
+  {
+    using namespace cryptonote;
+
+    if (!base_class::init())
+      return false;
+
+    const tx_source_entry& source = this->m_sources.front();
+    keypair in_ephemeral;
+    if (!generate_key_image_helper(this->m_miners[this->real_source_idx].get_keys(), source.real_out_tx_key, source.real_output_in_tx_index, in_ephemeral, m_key_image))
+      return false;
+
+    m_prefix_hashes.resize(signatures_per_call);
+    m_sigs.resize(signatures_per_call, std::vector<crypto::signature>(ring_size));
+    for (size_t i = 0; i < signatures_per_call; ++i)
+    {
+      m_prefix_hashes[i] = crypto::rand<crypto::hash>();
+      crypto::generate_ring_signature(m_prefix_hashes[i], m_key_image, this->m_public_key_ptrs, ring_size, in_ephemeral.sec, this->real_source_idx, m_sigs[i].data());
+    }
+
+    return true;
+  }
+
+  bool test()
+  {
+    if (!batched)
+    {
+      for (size_t i = 0; i < signatures_per_call; ++i)
+      {
+        if (!crypto::check_ring_signature(m_prefix_hashes[i], m_key_image, this->m_public_key_ptrs, ring_size, m_sigs[i].data()))
+          return false;
+      }
+      return true;
+    }
+
+    // only keys shared inside of the batch count, not the ones left from the previous call
+    m_batch.clear_cache();
+    for (size_t i = 0; i < signatures_per_call; ++i)
+      m_batch.add(m_prefix_hashes[i], m_key_image, this->m_public_key_ptrs, ring_size, m_sigs[i].data());
+    return m_batch.verify();
+  }
+
+private:
+  crypto::key_image m_key_image;
+  std::vector<crypto::hash> m_prefix_hashes;
+  std::vector<std::vector<crypto::signature> > m_sigs;
+  crypto::ring_signature_batch m_batch;
+};
@@ -35,8 +35,10 @@
 #include "cryptonote_core/cryptonote_format_utils.h"
 
 #include "multi_tx_test_base.h"
+#include "performance_utils.h"
 
-template<size_t a_in_count, size_t a_out_count>
+// a_thread_count is passed to construct_tx, 0 uses all cores
+template<size_t a_in_count, size_t a_out_count, size_t a_thread_count = 0>
 class test_construct_tx : private multi_tx_test_base<a_in_count>
 {
   static_assert(0 < a_in_count, "in_count must be greater than 0");
@@ -46,6 +48,7 @@ public:
   static const size_t loop_count = (a_in_count + a_out_count < 100) ? 100 : 10;
   static const size_t in_count  = a_in_count;
   static const size_t out_count = a_out_count;
+  static const size_t thread_count = a_thread_count;
 
   typedef multi_tx_test_base<a_in_count> base_class;
 
@@ -68,10 +71,22 @@ public:
 
   bool test()
   {
-    return cryptonote::construct_tx(this->m_miners[this->real_source_idx].get_keys(), this->m_sources, m_destinations, std::vector<uint8_t>(), m_tx, 0);
+    if (1 == thread_count)
+      return construct();
+
+    // construct_tx threads inherit the affinity of the main thread, which is pinned to one core
+    reset_thread_affinity();
+    bool r = construct();
+    set_process_affinity(1);
+    return r;
   }
 
 private:
+  bool construct()
+  {
+    return cryptonote::construct_tx(this->m_miners[this->real_source_idx].get_keys(), this->m_sources, m_destinations, std::vector<uint8_t>(), m_tx, 0, thread_count);
+  }
+
   cryptonote::account_base m_alice;
   std::vector<cryptonote::tx_destination_entry> m_destinations;
   cryptonote::transaction m_tx;
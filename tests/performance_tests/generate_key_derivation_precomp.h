@@ -0,0 +1,68 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <cstddef>
+
+#include "crypto/crypto.h"
+#include "cryptonote_core/cryptonote_basic.h"
+
+#include "single_tx_test_base.h"
+
+// derives batch_size tx public keys per call, compare with test_generate_key_derivation
+template<size_t batch_size>
+class test_generate_key_derivation_precomp : public single_tx_test_base
+{
+public:
+  static const size_t loop_count = 1000 / batch_size;
+
+  bool init()
+  {
+    if (!single_tx_test_base::init())
+      return false;
+
+    for (size_t i = 0; i < batch_size; ++i)
+    {
+      crypto::secret_key sec;
+      crypto::generate_keys(m_tx_pub_keys[i], sec);
+    }
+    return true;
+  }
+
+  bool test()
+  {
+    crypto::key_derivation_precomp precomp(m_bob.get_keys().m_view_secret_key);
+    crypto::key_derivation recv_derivations[batch_size];
+    bool valid[batch_size];
+    return batch_size == precomp.derive(m_tx_pub_keys, batch_size, recv_derivations, valid);
+  }
+
+private:
+  crypto::public_key m_tx_pub_keys[batch_size];
+};
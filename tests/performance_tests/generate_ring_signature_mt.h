@@ -0,0 +1,108 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include <vector>
+
+#include <boost/thread/thread.hpp>
+
+#include "cryptonote_core/account.h"
+#include "cryptonote_core/cryptonote_basic.h"
+#include "cryptonote_core/cryptonote_format_utils.h"
+#include "crypto/crypto.h"
+
+#include "multi_tx_test_base.h"
+#include "performance_utils.h"
+
+// Every call makes the same number of ring signatures, split between a_thread_count threads,
+// so time per call shows how signing scales with threads
+template<size_t a_ring_size, size_t a_thread_count>
+class test_generate_ring_signature_mt : private multi_tx_test_base<a_ring_size>
+{
+  static_assert(0 < a_thread_count, "thread_count must be greater than 0");
+
+public:
+  static const size_t loop_count = 10;
+  static const size_t ring_size = a_ring_size;
+  static const size_t thread_count = a_thread_count;
+  static const size_t signatures_per_call = 96;
+
+  typedef multi_tx_test_base<a_ring_size> base_class;
+
+  bool init()
+  {
+    using namespace cryptonote;
+
+    if (!base_class::init())
+      return false;
+
+    const tx_source_entry& source = this->m_sources.front();
+    if (!generate_key_image_helper(this->m_miners[this->real_source_idx].get_keys(), source.real_out_tx_key, source.real_output_in_tx_index, m_in_ephemeral, m_key_image))
+      return false;
+
+    m_prefix_hash = crypto::rand<crypto::hash>();
+    return true;
+  }
+
+  bool test()
+  {
+    std::vector<char> results(thread_count, 0);
+    boost::thread_group threads;
+    for (size_t i = 0; i < thread_count; ++i)
+      threads.create_thread(boost::bind(&test_generate_ring_signature_mt::sign, this, signatures_per_call / thread_count + (i < signatures_per_call % thread_count ? 1 : 0), boost::ref(results[i])));
+    threads.join_all();
+
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+      if (!results[i])
+        return false;
+    }
+    return true;
+  }
+
+private:
+  void sign(size_t count, char& result)
+  {
+    // main thread is pinned to one core, workers have to be spread over all of them
+    reset_thread_affinity();
+
+    std::vector<crypto::signature> sigs(ring_size);
+    for (size_t i = 0; i < count; ++i)
+    {
+      crypto::generate_ring_signature(m_prefix_hash, m_key_image, this->m_public_key_ptrs, ring_size, m_in_ephemeral.sec, this->real_source_idx, sigs.data());
+      if (!crypto::check_ring_signature(m_prefix_hash, m_key_image, this->m_public_key_ptrs, ring_size, sigs.data()))
+        return;
+    }
+    result = 1;
+  }
+
+  cryptonote::keypair m_in_ephemeral;
+  crypto::key_image m_key_image;
+  crypto::hash m_prefix_hash;
+};
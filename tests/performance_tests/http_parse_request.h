@@ -0,0 +1,75 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#pragma once
+
+#include "include_base_utils.h"
+#include "net/http_request_parser.h"
+
+template<size_t chunk_size>
+class test_http_parse_request
+{
+public:
+  static const size_t loop_count = 100000;
+
+  bool init()
+  {
+    m_request =
+      "POST /json_rpc HTTP/1.1\r\n"
+      "Host: 127.0.0.1:18082\r\n"
+      "User-Agent: curl/7.35.0\r\n"
+      "Accept: */*\r\n"
+      "Content-Type: application/json\r\n"
+      "Content-Length: 60\r\n"
+      "\r\n"
+      "{\"jsonrpc\":\"2.0\",\"id\":\"0\",\"method\":\"getbalance\",\"params\":{}}";
+    return true;
+  }
+
+  bool test()
+  {
+    epee::net_utils::http::http_request_parser parser;
+    epee::net_utils::http::http_request_info info;
+    const char* ptr = m_request.data();
+    const char* end = m_request.data() + m_request.size();
+    epee::net_utils::http::http_request_parser::parse_result res = epee::net_utils::http::http_request_parser::parse_need_more;
+    while(ptr != end && epee::net_utils::http::http_request_parser::parse_need_more == res)
+    {
+      const char* chunk_end = (0 == chunk_size || static_cast<size_t>(end - ptr) < chunk_size) ? end : ptr + chunk_size;
+      res = parser.parse(ptr, chunk_end, info);
+    }
+
+    size_t len = 0;
+    return epee::net_utils::http::http_request_parser::parse_done == res &&
+      epee::net_utils::http::http_request_parser::get_content_length(info.m_header_info.m_content_length, len) &&
+      static_cast<size_t>(end - ptr) == len;
+  }
+
+private:
+  std::string m_request;
+};
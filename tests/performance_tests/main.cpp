@@ -33,13 +33,19 @@
 
 // tests
 #include "construct_tx.h"
+#include "chacha.h"
 #include "check_ring_signature.h"
+#include "check_ring_signature_batch.h"
 #include "cn_slow_hash.h"
 #include "derive_public_key.h"
 #include "derive_secret_key.h"
+#include "fe_backend.h"
 #include "generate_key_derivation.h"
+#include "generate_key_derivation_precomp.h"
 #include "generate_key_image.h"
 #include "generate_key_image_helper.h"
+#include "generate_ring_signature_mt.h"
+#include "http_parse_request.h"
 #include "is_out_to_acc.h"
 
 int main(int argc, char** argv)
@@ -71,20 +77,46 @@ int main(int argc, char** argv)
   TEST_PERFORMANCE2(test_construct_tx, 100, 10);
   TEST_PERFORMANCE2(test_construct_tx, 100, 100);
 
+  TEST_PERFORMANCE3(test_construct_tx, 10, 2, 1);
+  TEST_PERFORMANCE3(test_construct_tx, 100, 2, 1);
+
   TEST_PERFORMANCE1(test_check_ring_signature, 1);
   TEST_PERFORMANCE1(test_check_ring_signature, 2);
   TEST_PERFORMANCE1(test_check_ring_signature, 10);
   TEST_PERFORMANCE1(test_check_ring_signature, 100);
 
+  TEST_PERFORMANCE2(test_check_ring_signature_batch, 10, false);
+  TEST_PERFORMANCE2(test_check_ring_signature_batch, 10, true);
+
+  TEST_PERFORMANCE2(test_fe_backend, FE_BACKEND_REF10, test_check_ring_signature<10>);
+  if (fe_backend_available(FE_BACKEND_INT128))
+    TEST_PERFORMANCE2(test_fe_backend, FE_BACKEND_INT128, test_check_ring_signature<10>);
+  TEST_PERFORMANCE2(test_fe_backend, FE_BACKEND_REF10, test_generate_key_derivation);
+  if (fe_backend_available(FE_BACKEND_INT128))
+    TEST_PERFORMANCE2(test_fe_backend, FE_BACKEND_INT128, test_generate_key_derivation);
+
+  TEST_PERFORMANCE2(test_generate_ring_signature_mt, 10, 1);
+  TEST_PERFORMANCE2(test_generate_ring_signature_mt, 10, 2);
+  TEST_PERFORMANCE2(test_generate_ring_signature_mt, 10, 4);
+  TEST_PERFORMANCE2(test_generate_ring_signature_mt, 10, 8);
+
   TEST_PERFORMANCE0(test_is_out_to_acc);
   TEST_PERFORMANCE0(test_generate_key_image_helper);
   TEST_PERFORMANCE0(test_generate_key_derivation);
+  TEST_PERFORMANCE1(test_generate_key_derivation_precomp, 1);
+  TEST_PERFORMANCE1(test_generate_key_derivation_precomp, 32);
   TEST_PERFORMANCE0(test_generate_key_image);
   TEST_PERFORMANCE0(test_derive_public_key);
   TEST_PERFORMANCE0(test_derive_secret_key);
 
   TEST_PERFORMANCE0(test_cn_slow_hash);
 
+  TEST_PERFORMANCE2(test_chacha, CHACHA8_ROUNDS, 4 * 1024 * 1024);
+  TEST_PERFORMANCE2(test_chacha, CHACHA20_ROUNDS, 4 * 1024 * 1024);
+
+  TEST_PERFORMANCE1(test_http_parse_request, 0);
+  TEST_PERFORMANCE1(test_http_parse_request, 16);
+
   std::cout << "Tests finished. Elapsed time: " << timer.elapsed_ms() / 1000 << " sec" << std::endl;
 
   return 0;
@@ -60,6 +60,24 @@ void set_process_affinity(int core)
 #endif
 }
 
+void reset_thread_affinity()
+{
+#if defined (__APPLE__) || defined(__FreeBSD__) || defined(BOOST_WINDOWS)
+    return;
+#elif defined(BOOST_HAS_PTHREADS)
+  cpu_set_t cpuset;
+  CPU_ZERO(&cpuset);
+  for (int i = 0; i < CPU_SETSIZE; ++i)
+  {
+    CPU_SET(i, &cpuset);
+  }
+  if (0 != ::pthread_setaffinity_np(::pthread_self(), sizeof(cpuset), &cpuset))
+  {
+    std::cout << "pthread_setaffinity_np - ERROR" << std::endl;
+  }
+#endif
+}
+
 void set_thread_high_priority()
 {
 #if defined(__APPLE__) || defined(__FreeBSD__)
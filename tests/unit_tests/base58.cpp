@@ -30,9 +30,12 @@
 
 #include "gtest/gtest.h"
 
+#include <chrono>
 #include <cstdint>
+#include <iostream>
 
 #include "common/base58.cpp"
+#include "cryptonote_core/account.h"
 #include "cryptonote_core/cryptonote_basic_impl.h"
 #include "serialization/binary_utils.h"
 
@@ -537,3 +540,176 @@ TEST(get_account_address_from_str, parses_old_address_format)
   cryptonote::account_public_address addr;
   ASSERT_TRUE(cryptonote::get_account_address_from_str(addr, false, "002391bbbb24dea6fd95232e97594a27769d0153d053d2102b789c498f57a2b00b69cd6f2f5c529c1660f2f4a2b50178d6640c20ce71fe26373041af97c5b10236fc"));
 }
+
+TEST(base58_encode_buffer, matches_string_version)
+{
+  std::string data;
+  for (size_t size = 0; size <= 3 * base58::full_block_size + 1; ++size)
+  {
+    std::string enc = base58::encode(data);
+    ASSERT_EQ(base58::encoded_size(size), enc.size());
+
+    std::string enc_buf(enc.size() + 1, '!');
+    base58::encode(data.data(), size, &enc_buf[0]);
+    ASSERT_EQ(enc, enc_buf.substr(0, enc.size()));
+    ASSERT_EQ('!', enc_buf.back());
+
+    size_t dec_size;
+    ASSERT_TRUE(base58::decoded_size(enc.size(), dec_size));
+    ASSERT_EQ(size, dec_size);
+    std::string dec(dec_size + 1, '!');
+    ASSERT_TRUE(base58::decode(enc.data(), enc.size(), &dec[0]));
+    ASSERT_EQ(data, dec.substr(0, size));
+    ASSERT_EQ('!', dec.back());
+
+    data.push_back(static_cast<char>(size * 37 + 11));
+  }
+}
+
+TEST(base58_decode_buffer, fails_on_invalid_input)
+{
+  size_t size;
+  ASSERT_FALSE(base58::decoded_size(1, size));
+  ASSERT_FALSE(base58::decoded_size(base58::full_encoded_block_size + 4, size));
+
+  char data[base58::full_block_size];
+  ASSERT_FALSE(base58::decode("1111", 4, data));
+  ASSERT_FALSE(base58::decode("zzzzzzzzzzz", 11, data));
+  ASSERT_FALSE(base58::decode("0uT7GAdgbA8", 11, data));
+}
+
+namespace
+{
+  std::string test_addr_str()
+  {
+    return base58::encode_addr(config::CRYPTONOTE_PUBLIC_ADDRESS_BASE58_PREFIX, test_serialized_keys);
+  }
+}
+
+TEST(base58_decode_addr_buffer, handles_valid_address)
+{
+  std::string addr_str = test_addr_str();
+  char data[64];
+  uint64_t tag;
+  ASSERT_TRUE(base58::decode_addr(addr_str.data(), addr_str.size(), tag, data, sizeof(data)));
+  ASSERT_EQ(config::CRYPTONOTE_PUBLIC_ADDRESS_BASE58_PREFIX, tag);
+  ASSERT_EQ(test_serialized_keys, std::string(data, sizeof(data)));
+}
+
+TEST(base58_decode_addr_buffer, fails_on_wrong_data_size)
+{
+  std::string addr_str = test_addr_str();
+  char data[65];
+  uint64_t tag;
+  ASSERT_FALSE(base58::decode_addr(addr_str.data(), addr_str.size(), tag, data, 63));
+  ASSERT_FALSE(base58::decode_addr(addr_str.data(), addr_str.size(), tag, data, 65));
+}
+
+TEST(base58_decode_addr_buffer, fails_on_invalid_checksum)
+{
+  std::string addr_str = test_addr_str();
+  addr_str[addr_str.size() - 2] = addr_str[addr_str.size() - 2] == '2' ? '3' : '2';
+
+  char data[64];
+  uint64_t tag;
+  ASSERT_FALSE(base58::decode_addr(addr_str.data(), addr_str.size(), tag, data, sizeof(data)));
+}
+
+TEST(get_account_addresses_from_str, handles_valid_invalid_and_repeated_addresses)
+{
+  std::string wrong_prefix = base58::encode_addr(0, test_serialized_keys);
+  std::vector<std::string> strs;
+  strs.push_back(test_addr_str());
+  strs.push_back(wrong_prefix);
+  strs.push_back(test_addr_str());
+  strs.push_back("");
+  strs.push_back(wrong_prefix);
+
+  std::vector<cryptonote::account_public_address> adrs;
+  std::vector<bool> valid;
+  ASSERT_EQ(2, cryptonote::get_account_addresses_from_str(adrs, valid, false, strs));
+  ASSERT_EQ(strs.size(), adrs.size());
+  ASSERT_EQ(strs.size(), valid.size());
+
+  cryptonote::account_public_address expected;
+  ASSERT_TRUE(cryptonote::get_account_address_from_str(expected, false, test_addr_str()));
+  for (size_t i = 0; i < strs.size(); ++i)
+  {
+    ASSERT_EQ(i == 0 || i == 2, valid[i]);
+    if (valid[i])
+    {
+      ASSERT_EQ(expected.m_spend_public_key, adrs[i].m_spend_public_key);
+      ASSERT_EQ(expected.m_view_public_key, adrs[i].m_view_public_key);
+    }
+  }
+}
+
+// Benchmarks, run with --gtest_also_run_disabled_tests
+namespace
+{
+  template<class t_func>
+  void print_time_per_call(const char* name, size_t count, t_func f)
+  {
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t i = 0; i < count; ++i)
+      f(i);
+    std::chrono::duration<double, std::nano> elapsed = std::chrono::steady_clock::now() - start;
+    std::cout << name << ": " << elapsed.count() / count << " ns/call" << std::endl;
+  }
+}
+
+TEST(base58_bench, DISABLED_encode_decode_address)
+{
+  const size_t count = 200000;
+  std::string addr_str = test_addr_str();
+  std::string data = MAKE_STR("\x12") + test_serialized_keys + "\x01\x02\x03\x04";
+  std::string enc = base58::encode(data);
+  char enc_buf[128];
+  char dec_buf[128];
+  std::string dec;
+
+  print_time_per_call("encode, std::string", count, [&](size_t) { enc = base58::encode(data); });
+  print_time_per_call("encode, buffer", count, [&](size_t) { base58::encode(data.data(), data.size(), enc_buf); });
+  print_time_per_call("decode, std::string", count, [&](size_t) { ASSERT_TRUE(base58::decode(enc, dec)); });
+  print_time_per_call("decode, buffer", count, [&](size_t) { ASSERT_TRUE(base58::decode(enc.data(), enc.size(), dec_buf)); });
+
+  uint64_t tag;
+  std::string addr_data;
+  char addr_buf[64];
+  print_time_per_call("decode_addr, std::string", count, [&](size_t) { ASSERT_TRUE(base58::decode_addr(addr_str, tag, addr_data)); });
+  print_time_per_call("decode_addr, buffer", count, [&](size_t) { ASSERT_TRUE(base58::decode_addr(addr_str.data(), addr_str.size(), tag, addr_buf, sizeof(addr_buf))); });
+}
+
+TEST(base58_bench, DISABLED_parse_addresses)
+{
+  // 1000 payouts to 100 distinct addresses
+  const size_t count = 1000;
+  std::vector<std::string> strs;
+  for (size_t i = 0; i < count; ++i)
+  {
+    cryptonote::account_base acc;
+    if (i < 100)
+    {
+      acc.generate();
+      strs.push_back(acc.get_public_address_str(false));
+    }
+    else
+    {
+      strs.push_back(strs[i % 100]);
+    }
+  }
+
+  cryptonote::account_public_address adr;
+  print_time_per_call("get_account_address_from_str, per address", 1, [&](size_t)
+  {
+    for (size_t i = 0; i < count; ++i)
+      ASSERT_TRUE(cryptonote::get_account_address_from_str(adr, false, strs[i]));
+  });
+
+  std::vector<cryptonote::account_public_address> adrs;
+  std::vector<bool> valid;
+  print_time_per_call("get_account_addresses_from_str, whole batch", 1, [&](size_t)
+  {
+    ASSERT_EQ(count, cryptonote::get_account_addresses_from_str(adrs, valid, false, strs));
+  });
+}
@@ -0,0 +1,372 @@
+// Copyright (c) 2014, The Monero Project
+//
+// All rights reserved.
+//
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+//
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+//
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+//
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+//
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <atomic>
+#include <ctime>
+#include <map>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+#include <boost/filesystem.hpp>
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "file_io_utils.h"
+#include "misc_language.h"
+#include "common/boost_serialization_helper.h"
+#include "cryptonote_core/account.h"
+#include "cryptonote_core/blockchain_storage.h"
+#include "cryptonote_core/blockchain_storage_boost_serialization.h"
+#include "cryptonote_core/cryptonote_boost_serialization.h"
+#include "cryptonote_core/cryptonote_format_utils.h"
+#include "cryptonote_core/miner.h"
+#include "cryptonote_core/tx_pool.h"
+
+using namespace cryptonote;
+
+namespace
+{
+  // spending transactions go into the block at spend_height, stored chains are chain_height blocks high,
+  // and concurrent_blocks more are added while one of them is being stored
+  const size_t spend_height = CRYPTONOTE_MINED_MONEY_UNLOCK_WINDOW + 2;
+  const size_t chain_height = spend_height + 4;
+  const size_t concurrent_blocks = 12;
+
+  struct test_chain
+  {
+    tx_memory_pool pool;
+    blockchain_storage bs;
+    std::string dir;
+
+    // pool and storage refer to each other, as in cryptonote::core, only the address of bs is taken here
+    test_chain(const std::string& dir_ = std::string())
+      : pool(*&bs)
+      , bs(pool)
+      , dir(dir_.empty() ? (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string() : dir_)
+      , own_dir(dir_.empty())
+    {
+      if (own_dir)
+        boost::filesystem::create_directories(dir);
+    }
+
+    ~test_chain()
+    {
+      if (own_dir)
+        boost::filesystem::remove_all(dir);
+    }
+
+    std::string file_path() const
+    {
+      return dir + "/" CRYPTONOTE_BLOCKCHAINDATA_FILENAME;
+    }
+
+    // boost's own archive of the storage, serialize() writes it with ar & for every container
+    std::string serialize()
+    {
+      std::string path = dir + "/native.bin";
+      std::string data;
+      if (!tools::serialize_obj_to_file(bs, path) || !epee::file_io_utils::load_file_to_string(path, data))
+        return std::string();
+      boost::filesystem::remove(path);
+      return data;
+    }
+
+    std::string load_stored()
+    {
+      std::string data;
+      epee::file_io_utils::load_file_to_string(file_path(), data);
+      return data;
+    }
+
+  private:
+    bool own_dir;
+  };
+
+  class blockchain_storage_store : public ::testing::Test
+  {
+  protected:
+    // One chain with spending transactions is mined for all tests, with native archives of every height.
+    // An alternative block at chain_height - 1 and a double spending block on top of chain_height blocks
+    // are mined aside, for chains that have alternative and invalid blocks.
+    static void SetUpTestCase()
+    {
+      test_chain c;
+      ASSERT_TRUE(c.bs.init(c.dir));
+      std::list<block> genesis;
+      ASSERT_TRUE(c.bs.get_blocks(0, 1, genesis));
+      s_blocks.push_back(genesis.front());
+      s_archives.push_back(c.serialize());
+
+      account_base miner;
+      miner.generate();
+      uint64_t timestamp = time(NULL) - (chain_height + concurrent_blocks + 1) * DIFFICULTY_TARGET;
+      while (s_blocks.size() != chain_height + concurrent_blocks)
+      {
+        if (s_blocks.size() == spend_height)
+        {
+          for (size_t i = 1; i <= 2; ++i)
+          {
+            transaction tx;
+            ASSERT_NO_FATAL_FAILURE(make_spending_tx(c, miner, s_blocks[i].miner_tx, DEFAULT_FEE, tx));
+            tx_verification_context tvc = AUTO_VAL_INIT(tvc);
+            ASSERT_TRUE(c.pool.add_tx(tx, tvc, false));
+            ASSERT_FALSE(tvc.m_verifivation_failed);
+          }
+        }
+
+        timestamp += DIFFICULTY_TARGET;
+        if (s_blocks.size() == chain_height - 1)
+          ASSERT_NO_FATAL_FAILURE(mine_block(c, miner, timestamp, "alternative", NULL, s_alt_block));
+        if (s_blocks.size() == chain_height)
+        {
+          // spends the miner output of block 1 again
+          transaction tx;
+          ASSERT_NO_FATAL_FAILURE(make_spending_tx(c, miner, s_blocks[1].miner_tx, 2 * DEFAULT_FEE, tx));
+          std::vector<crypto::hash> tx_hashes(1, get_transaction_hash(tx));
+          ASSERT_NO_FATAL_FAILURE(mine_block(c, miner, timestamp, "invalid", &tx_hashes, s_invalid_block));
+        }
+
+        block b;
+        ASSERT_NO_FATAL_FAILURE(mine_block(c, miner, timestamp, blobdata(), NULL, b));
+        block_verification_context bvc = AUTO_VAL_INIT(bvc);
+        ASSERT_TRUE(c.bs.add_new_block(b, bvc));
+        ASSERT_TRUE(bvc.m_added_to_main_chain);
+        s_blocks.push_back(b);
+        s_archives.push_back(c.serialize());
+      }
+      ASSERT_EQ(2, s_blocks[spend_height].tx_hashes.size());
+    }
+
+    static void TearDownTestCase()
+    {
+      s_blocks.clear();
+      s_txs.clear();
+      s_archives.clear();
+    }
+
+    // block on top of c, with the transactions of tx_hashes instead of the pool ones if given
+    static void mine_block(test_chain& c, const account_base& miner, uint64_t timestamp, const blobdata& ex_nonce,
+      const std::vector<crypto::hash>* tx_hashes, block& b)
+    {
+      difficulty_type diffic;
+      uint64_t height;
+      ASSERT_TRUE(c.bs.create_block_template(b, miner.get_keys().m_account_address, diffic, height, ex_nonce));
+      if (tx_hashes)
+        b.tx_hashes = *tx_hashes;
+      b.timestamp = timestamp;
+      while (!miner::find_nonce_for_given_block(b, diffic, height))
+        b.timestamp++;
+    }
+
+    static void make_spending_tx(test_chain& c, const account_base& miner, const transaction& miner_tx, uint64_t fee, transaction& tx)
+    {
+      size_t out_index = 0;
+      for (size_t i = 1; i < miner_tx.vout.size(); ++i)
+      {
+        if (miner_tx.vout[out_index].amount < miner_tx.vout[i].amount)
+          out_index = i;
+      }
+      std::vector<uint64_t> global_indexes;
+      ASSERT_TRUE(c.bs.get_tx_outputs_gindexs(get_transaction_hash(miner_tx), global_indexes));
+
+      tx_source_entry src;
+      src.outputs.push_back(std::make_pair(global_indexes[out_index], boost::get<txout_to_key>(miner_tx.vout[out_index].target).key));
+      src.real_output = 0;
+      src.real_out_tx_key = get_tx_pub_key_from_extra(miner_tx);
+      src.real_output_in_tx_index = out_index;
+      src.amount = miner_tx.vout[out_index].amount;
+      std::vector<tx_source_entry> sources(1, src);
+      std::vector<tx_destination_entry> destinations(1, tx_destination_entry(src.amount - fee, miner.get_keys().m_account_address));
+
+      ASSERT_TRUE(construct_tx(miner.get_keys(), sources, destinations, std::vector<uint8_t>(), tx, 0));
+      s_txs[get_transaction_hash(tx)] = tx;
+    }
+
+    // adds block with its transactions, as if it was received from a peer
+    static bool add_block(test_chain& c, const block& b, block_verification_context& bvc)
+    {
+      for (const crypto::hash& tx_id : b.tx_hashes)
+      {
+        tx_verification_context tvc = AUTO_VAL_INIT(tvc);
+        if (!c.pool.add_tx(s_txs[tx_id], tvc, true))
+          return false;
+      }
+      return c.bs.add_new_block(b, bvc);
+    }
+
+    // adds mined blocks [begin, end) to the main chain
+    static bool add_blocks(test_chain& c, size_t begin, size_t end)
+    {
+      for (size_t i = begin; i != end; ++i)
+      {
+        block_verification_context bvc = AUTO_VAL_INIT(bvc);
+        if (!add_block(c, s_blocks[i], bvc) || !bvc.m_added_to_main_chain)
+          return false;
+      }
+      return true;
+    }
+
+    // stored archive must load back to the chain of c at some height. Unordered containers are filled
+    // in archive order on load, so the loaded chain is not expected to archive to the same bytes.
+    static void check_loads_back(test_chain& c, uint64_t& height)
+    {
+      test_chain loaded(c.dir);
+      ASSERT_TRUE(loaded.bs.init(loaded.dir));
+      height = loaded.bs.get_current_blockchain_height();
+      ASSERT_GE(s_blocks.size(), height);
+      ASSERT_EQ(get_block_hash(s_blocks[height - 1]), loaded.bs.get_tail_id());
+      size_t txs_count = 0;
+      for (size_t i = 0; i != height; ++i)
+        txs_count += 1 + s_blocks[i].tx_hashes.size();
+      ASSERT_EQ(txs_count, loaded.bs.get_total_transactions());
+      ASSERT_EQ(c.bs.get_alternative_blocks_count(), loaded.bs.get_alternative_blocks_count());
+      ASSERT_EQ(c.bs.have_block(get_block_hash(s_invalid_block)), loaded.bs.have_block(get_block_hash(s_invalid_block)));
+    }
+
+    static std::vector<block> s_blocks;
+    static block s_alt_block;
+    static block s_invalid_block;
+    static std::unordered_map<crypto::hash, transaction> s_txs;
+    static std::vector<std::string> s_archives; // native archive of the chain of height i + 1
+  };
+
+  std::vector<block> blockchain_storage_store::s_blocks;
+  block blockchain_storage_store::s_alt_block;
+  block blockchain_storage_store::s_invalid_block;
+  std::unordered_map<crypto::hash, transaction> blockchain_storage_store::s_txs;
+  std::vector<std::string> blockchain_storage_store::s_archives;
+}
+
+TEST_F(blockchain_storage_store, snapshot_of_genesis_only_chain_matches_native_archive)
+{
+  // no spent keys, alternative or invalid blocks, and one transaction and amount
+  test_chain c;
+  ASSERT_TRUE(c.bs.init(c.dir));
+  ASSERT_TRUE(c.bs.store_blockchain());
+  std::string stored = c.load_stored();
+  ASSERT_FALSE(stored.empty());
+  ASSERT_EQ(c.serialize(), stored);
+  ASSERT_EQ(s_archives[0], stored);
+  uint64_t height = 0;
+  check_loads_back(c, height);
+  ASSERT_EQ(1, height);
+}
+
+TEST_F(blockchain_storage_store, snapshot_matches_native_archive_and_loads_back)
+{
+  test_chain c;
+  ASSERT_TRUE(c.bs.init(c.dir));
+  ASSERT_TRUE(add_blocks(c, 1, chain_height));
+  ASSERT_TRUE(c.bs.store_blockchain());
+  std::string stored = c.load_stored();
+  ASSERT_EQ(c.serialize(), stored);
+  ASSERT_EQ(s_archives[chain_height - 1], stored);
+  uint64_t height = 0;
+  check_loads_back(c, height);
+  ASSERT_EQ(chain_height, height);
+
+  test_chain loaded(c.dir);
+  ASSERT_TRUE(loaded.bs.init(loaded.dir));
+  for (const auto& tx : s_txs)
+  {
+    bool in_chain = s_invalid_block.tx_hashes.front() != tx.first;
+    ASSERT_EQ(in_chain, loaded.bs.have_tx(tx.first));
+    ASSERT_TRUE(loaded.bs.have_tx_keyimg_as_spent(boost::get<txin_to_key>(tx.second.vin[0]).k_image));
+  }
+}
+
+TEST_F(blockchain_storage_store, snapshot_with_alternative_and_invalid_blocks_matches_native_archive)
+{
+  test_chain c;
+  ASSERT_TRUE(c.bs.init(c.dir));
+  ASSERT_TRUE(add_blocks(c, 1, chain_height));
+
+  block_verification_context bvc = AUTO_VAL_INIT(bvc);
+  ASSERT_TRUE(add_block(c, s_alt_block, bvc));
+  ASSERT_FALSE(bvc.m_added_to_main_chain);
+  ASSERT_FALSE(bvc.m_verifivation_failed);
+  ASSERT_EQ(1, c.bs.get_alternative_blocks_count());
+
+  bvc = AUTO_VAL_INIT(bvc);
+  ASSERT_FALSE(add_block(c, s_invalid_block, bvc));
+  ASSERT_TRUE(bvc.m_verifivation_failed);
+  ASSERT_TRUE(c.bs.have_block(get_block_hash(s_invalid_block)));
+  ASSERT_EQ(chain_height, c.bs.get_current_blockchain_height());
+
+  ASSERT_TRUE(c.bs.store_blockchain());
+  std::string stored = c.load_stored();
+  ASSERT_EQ(c.serialize(), stored);
+  ASSERT_NE(s_archives[chain_height - 1], stored);
+  uint64_t height = 0;
+  check_loads_back(c, height);
+  ASSERT_EQ(chain_height, height);
+}
+
+TEST_F(blockchain_storage_store, snapshot_of_growing_chain_matches_native_archive_at_snapshot_height)
+{
+  test_chain c;
+  ASSERT_TRUE(c.bs.init(c.dir));
+  ASSERT_TRUE(add_blocks(c, 1, chain_height));
+
+  std::atomic<bool> added(false);
+  bool add_res = false;
+  std::thread adder([&] {
+    add_res = add_blocks(c, chain_height, s_blocks.size());
+    added = true;
+  });
+
+  // every store, whenever the blocks came in while it was written, is the native archive of one height
+  size_t stores = 0;
+  bool store_res = true;
+  do
+  {
+    store_res = c.bs.store_blockchain();
+    if (!store_res)
+      break;
+    std::string stored = c.load_stored();
+    uint64_t height = 0;
+    check_loads_back(c, height);
+    if (HasFatalFailure())
+      break;
+    EXPECT_EQ(s_archives[height - 1], stored);
+    ++stores;
+  } while (!added);
+  adder.join();
+  if (HasFatalFailure())
+    return;
+  ASSERT_TRUE(store_res);
+  ASSERT_TRUE(add_res);
+  ASSERT_LT(0, stores);
+
+  ASSERT_TRUE(c.bs.store_blockchain());
+  std::string stored = c.load_stored();
+  ASSERT_EQ(c.serialize(), stored);
+  ASSERT_EQ(s_archives.back(), stored);
+}
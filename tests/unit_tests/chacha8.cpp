@@ -28,10 +28,17 @@
 // 
 // Parts of this file are originally copyright (c) 2012-2013 The Cryptonote developers
 
+#include <sstream>
 #include <string>
+#include <vector>
+#include <boost/filesystem.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/vector.hpp>
 
 #include "gtest/gtest.h"
 
+#include "include_base_utils.h"
+#include "common/boost_serialization_helper.h"
 #include "crypto/chacha8.h"
 
 namespace
@@ -108,3 +115,131 @@ TEST_CHACHA8(0)
 TEST_CHACHA8(1)
 TEST_CHACHA8(2)
 TEST_CHACHA8(3)
+
+namespace
+{
+  std::string make_text(size_t size)
+  {
+    std::string text(size, 0);
+    for (size_t i = 0; i < size; ++i)
+      text[i] = static_cast<char>(i * 7 + 3);
+    return text;
+  }
+
+  crypto::chacha8_key make_key()
+  {
+    crypto::chacha8_key key;
+    for (size_t i = 0; i < sizeof(key.data); ++i)
+      key.data[i] = static_cast<uint8_t>(i);
+    return key;
+  }
+}
+
+TEST(chacha20, is_correct)
+{
+  // first two blocks of keystream for the all zero key and iv
+  static const uint8_t expected[] = {
+    0x76, 0xb8, 0xe0, 0xad, 0xa0, 0xf1, 0x3d, 0x90, 0x40, 0x5d, 0x6a, 0xe5, 0x53, 0x86, 0xbd, 0x28,
+    0xbd, 0xd2, 0x19, 0xb8, 0xa0, 0x8d, 0xed, 0x1a, 0xa8, 0x36, 0xef, 0xcc, 0x8b, 0x77, 0x0d, 0xc7,
+    0xda, 0x41, 0x59, 0x7c, 0x51, 0x57, 0x48, 0x8d, 0x77, 0x24, 0xe0, 0x3f, 0xb8, 0xd8, 0x4a, 0x37,
+    0x6a, 0x43, 0xb8, 0xf4, 0x15, 0x18, 0xa1, 0x1c, 0xc3, 0x87, 0xb6, 0x69, 0xb2, 0xee, 0x65, 0x86,
+    0x9f, 0x07, 0xe7, 0xbe, 0x55, 0x51, 0x38, 0x7a, 0x98, 0xba, 0x97, 0x7c, 0x73, 0x2d, 0x08, 0x0d,
+    0xcb, 0x0f, 0x29, 0xa0, 0x48, 0xe3, 0x65, 0x69, 0x12, 0xc6, 0x53, 0x3e, 0x32, 0xee, 0x7a, 0xed,
+    0x29, 0xb7, 0x21, 0x76, 0x9c, 0xe6, 0x4e, 0x43, 0xd5, 0x71, 0x33, 0xb0, 0x74, 0xd8, 0x39, 0xd5,
+    0x31, 0xed, 0x1f, 0x28, 0x51, 0x0a, 0xfb, 0x45, 0xac, 0xe1, 0x0a, 0x1f, 0x4b, 0x79, 0x4d, 0x6f};
+  crypto::chacha8_key key = {};
+  crypto::chacha8_iv iv = {};
+  std::string zeros(sizeof(expected), 0);
+  std::string buf(sizeof(expected), 0);
+  crypto::chacha20(zeros.data(), zeros.size(), key, iv, &buf[0]);
+  ASSERT_EQ(std::string(reinterpret_cast<const char*>(expected), sizeof(expected)), buf);
+}
+
+TEST(chacha_ctx, matches_one_call_for_any_chunking)
+{
+  crypto::chacha8_key key = make_key();
+  crypto::chacha8_iv iv = {{1, 2, 3, 4, 5, 6, 7, 8}};
+  std::string text = make_text(3000);
+  std::string expected(text.size(), 0);
+  crypto::chacha8(text.data(), text.size(), key, iv, &expected[0]);
+
+  static const size_t chunks[] = {1, 7, 63, 64, 65, 255, 256, 513, 3000};
+  for (size_t chunk : chunks)
+  {
+    crypto::chacha_ctx ctx;
+    crypto::chacha_init(ctx, key, iv);
+    std::string buf = text;
+    for (size_t off = 0; off < buf.size(); off += chunk)
+      crypto::chacha_crypt(&ctx, &buf[off], std::min(chunk, buf.size() - off), &buf[off]);
+    ASSERT_EQ(expected, buf) << "chunk " << chunk;
+  }
+}
+
+TEST(chacha_ctx, block_counter_carries)
+{
+  crypto::chacha8_key key = make_key();
+  crypto::chacha8_iv iv = {};
+  crypto::chacha_ctx ctx_many;
+  crypto::chacha_init(ctx_many, key, iv, CHACHA20_ROUNDS);
+  ctx_many.input[12] = 0xfffffffd;
+  crypto::chacha_ctx ctx_single = ctx_many;
+
+  // 16 blocks in one call go through the multi block code, one block per call doesn't
+  std::string text = make_text(16 * CHACHA_BLOCK_SIZE);
+  std::string many(text.size(), 0), single(text.size(), 0);
+  crypto::chacha_crypt(&ctx_many, text.data(), text.size(), &many[0]);
+  for (size_t off = 0; off < text.size(); off += CHACHA_BLOCK_SIZE)
+    crypto::chacha_crypt(&ctx_single, text.data() + off, CHACHA_BLOCK_SIZE, &single[off]);
+  ASSERT_EQ(single, many);
+  ASSERT_EQ(1u, ctx_many.input[13]);
+  ASSERT_EQ(13u, ctx_many.input[12]);
+}
+
+TEST(chacha_streambuf, round_trips)
+{
+  crypto::chacha8_key key = make_key();
+  crypto::chacha8_iv iv = {{8, 7, 6, 5, 4, 3, 2, 1}};
+  std::string text = make_text(1000);
+  std::string expected(text.size(), 0);
+  crypto::chacha8(text.data(), text.size(), key, iv, &expected[0]);
+
+  std::stringbuf sink;
+  {
+    tools::chacha_ostreambuf crypted_buf(sink, key, iv, CHACHA8_ROUNDS, 100);
+    std::ostream out(&crypted_buf);
+    out.write(text.data(), 10);
+    out.put(text[10]);
+    out.write(text.data() + 11, text.size() - 11);
+    out.flush();
+    ASSERT_TRUE(out.good());
+  }
+  ASSERT_EQ(expected, sink.str());
+
+  std::stringbuf source(sink.str());
+  tools::chacha_istreambuf crypted_buf(source, key, iv, CHACHA8_ROUNDS, 100);
+  std::istream in(&crypted_buf);
+  std::string decrypted(text.size(), 0);
+  in.read(&decrypted[0], decrypted.size());
+  ASSERT_EQ(text.size(), in.gcount());
+  ASSERT_EQ(text, decrypted);
+  ASSERT_EQ(std::char_traits<char>::eof(), in.get());
+}
+
+TEST(chacha_streambuf, serializes_obj_to_crypted_file)
+{
+  std::vector<std::string> obj;
+  for (size_t i = 0; i < 1000; ++i)
+    obj.push_back(make_text(i % 300));
+  crypto::chacha8_key key = make_key();
+  std::string file_path = (boost::filesystem::temp_directory_path() / boost::filesystem::unique_path()).string();
+
+  ASSERT_TRUE(tools::serialize_obj_to_crypted_file(obj, file_path, key));
+  std::vector<std::string> loaded;
+  ASSERT_TRUE(tools::unserialize_obj_from_crypted_file(loaded, file_path, key));
+  ASSERT_EQ(obj, loaded);
+
+  key.data[0] ^= 1;
+  loaded.clear();
+  ASSERT_FALSE(tools::unserialize_obj_from_crypted_file(loaded, file_path, key) && obj == loaded);
+  boost::filesystem::remove(file_path);
+}
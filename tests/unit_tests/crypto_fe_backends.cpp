@@ -0,0 +1,189 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+
+extern "C" {
+#include "crypto/crypto-ops.h"
+}
+
+namespace
+{
+  // Runs the same operations with every field arithmetic backend and compares them with ref10
+  class fe_backends : public ::testing::Test
+  {
+  protected:
+    virtual void SetUp()
+    {
+      m_default_backend = fe_backend_current();
+    }
+
+    virtual void TearDown()
+    {
+      fe_backend_select(m_default_backend);
+    }
+
+    struct results
+    {
+      bool key_valid;
+      crypto::public_key pub;
+      bool derivation_valid;
+      crypto::key_derivation derivation;
+      crypto::public_key derived;
+      crypto::key_image image;
+    };
+
+    static results compute(const crypto::secret_key& sec, const crypto::public_key& other)
+    {
+      results res;
+      memset(&res, 0, sizeof(res));
+      res.key_valid = crypto::check_key(other);
+      crypto::secret_key_to_public_key(sec, res.pub);
+      res.derivation_valid = crypto::generate_key_derivation(other, sec, res.derivation);
+      if (res.derivation_valid)
+        crypto::derive_public_key(res.derivation, 7, res.pub, res.derived);
+      crypto::generate_key_image(res.pub, sec, res.image);
+      return res;
+    }
+
+    void expect_same_as_ref10(const crypto::secret_key& sec, const crypto::public_key& other)
+    {
+      ASSERT_EQ(0, fe_backend_select(FE_BACKEND_REF10));
+      results expected = compute(sec, other);
+      for (int backend = 0; backend < FE_BACKEND_COUNT; ++backend)
+      {
+        if (backend == FE_BACKEND_REF10 || !fe_backend_available(backend))
+          continue;
+        ASSERT_EQ(0, fe_backend_select(backend));
+        results actual = compute(sec, other);
+        ASSERT_EQ(expected.key_valid, actual.key_valid) << "backend " << backend;
+        ASSERT_EQ(expected.derivation_valid, actual.derivation_valid) << "backend " << backend;
+        ASSERT_EQ(0, memcmp(&expected, &actual, sizeof(results))) << "backend " << backend;
+      }
+    }
+
+    int m_default_backend;
+  };
+}
+
+TEST_F(fe_backends, ref10_is_always_available)
+{
+  ASSERT_TRUE(fe_backend_available(FE_BACKEND_REF10));
+  ASSERT_FALSE(fe_backend_available(FE_BACKEND_COUNT));
+  ASSERT_EQ(-1, fe_backend_select(FE_BACKEND_COUNT));
+}
+
+TEST_F(fe_backends, key_operations_match_ref10)
+{
+  for (size_t i = 0; i < 100; ++i)
+  {
+    crypto::public_key pub, other;
+    crypto::secret_key sec, other_sec;
+    crypto::generate_keys(pub, sec);
+    crypto::generate_keys(other, other_sec);
+    expect_same_as_ref10(sec, other);
+  }
+}
+
+TEST_F(fe_backends, random_points_match_ref10)
+{
+  crypto::public_key pub;
+  crypto::secret_key sec;
+  crypto::generate_keys(pub, sec);
+  for (size_t i = 0; i < 100; ++i)
+    expect_same_as_ref10(sec, crypto::rand<crypto::public_key>());
+}
+
+TEST_F(fe_backends, extreme_encodings_match_ref10)
+{
+  crypto::public_key pub;
+  crypto::secret_key sec;
+  crypto::generate_keys(pub, sec);
+
+  // y near 0, 2^255 - 19 and 2^255 - 1, with both signs of x
+  const unsigned char low_bytes[] = {0x00, 0x01, 0x02, 0xec, 0xed, 0xee, 0xff};
+  for (size_t i = 0; i < sizeof(low_bytes); ++i)
+  {
+    for (int high = 0; high < 2; ++high)
+    {
+      for (int sign = 0; sign < 2; ++sign)
+      {
+        crypto::public_key key;
+        unsigned char* data = reinterpret_cast<unsigned char*>(&key);
+        memset(data, high ? 0xff : 0x00, sizeof(key));
+        data[0] = low_bytes[i];
+        data[31] = (high ? 0x7f : 0x00) | (sign ? 0x80 : 0x00);
+        expect_same_as_ref10(sec, key);
+      }
+    }
+  }
+}
+
+TEST_F(fe_backends, ring_signatures_verify_across_backends)
+{
+  const size_t ring_size = 5;
+  const size_t real_index = 3;
+  std::vector<crypto::public_key> pubs(ring_size);
+  std::vector<const crypto::public_key*> pub_ptrs(ring_size);
+  std::vector<crypto::secret_key> secs(ring_size);
+  for (size_t i = 0; i < ring_size; ++i)
+  {
+    crypto::generate_keys(pubs[i], secs[i]);
+    pub_ptrs[i] = &pubs[i];
+  }
+  crypto::key_image image;
+  crypto::generate_key_image(pubs[real_index], secs[real_index], image);
+
+  for (int signer = 0; signer < FE_BACKEND_COUNT; ++signer)
+  {
+    if (!fe_backend_available(signer))
+      continue;
+    ASSERT_EQ(0, fe_backend_select(signer));
+    crypto::hash prefix_hash = crypto::rand<crypto::hash>();
+    std::vector<crypto::signature> sigs(ring_size);
+    crypto::generate_ring_signature(prefix_hash, image, pub_ptrs, secs[real_index], real_index, sigs.data());
+
+    for (int checker = 0; checker < FE_BACKEND_COUNT; ++checker)
+    {
+      if (!fe_backend_available(checker))
+        continue;
+      ASSERT_EQ(0, fe_backend_select(checker));
+      ASSERT_TRUE(crypto::check_ring_signature(prefix_hash, image, pub_ptrs, sigs.data())) << signer << " -> " << checker;
+      sigs[1].r.data[5] ^= 4;
+      ASSERT_FALSE(crypto::check_ring_signature(prefix_hash, image, pub_ptrs, sigs.data())) << signer << " -> " << checker;
+      sigs[1].r.data[5] ^= 4;
+    }
+  }
+}
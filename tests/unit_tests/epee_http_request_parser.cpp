@@ -0,0 +1,530 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "net/http_protocol_handler.h"
+#include "net/http_server_cp2.h"
+#ifdef HTTP_ENABLE_GZIP
+#include "gzip_encoding.h"
+#endif
+
+using namespace epee::net_utils::http;
+
+namespace
+{
+  const uint32_t test_server_port = 5627;
+
+  const char test_request[] =
+    "\r\n"
+    "POST /json_rpc?a=1&b=2#frag HTTP/1.1\r\n"
+    "Host: 127.0.0.1:18081\r\n"
+    "content-length:   9  \r\n"
+    "Content-Type: application/json\r\n"
+    "X-Folded: first\r\n"
+    "\t second\r\n"
+    "Connection: keep-alive\r\n"
+    "\r\n"
+    "{\"id\":10}";
+
+  void check_request(const http_request_info& info)
+  {
+    ASSERT_EQ(http_method_post, info.m_http_method);
+    ASSERT_EQ("POST", info.m_http_method_str);
+    ASSERT_EQ("/json_rpc?a=1&b=2#frag", info.m_URI);
+    ASSERT_EQ("/json_rpc", info.m_uri_content.m_path);
+    ASSERT_EQ("a=1&b=2", info.m_uri_content.m_query);
+    ASSERT_EQ("frag", info.m_uri_content.m_fragment);
+    ASSERT_EQ(2, info.m_uri_content.m_query_params.size());
+    ASSERT_EQ(1, info.m_http_ver_hi);
+    ASSERT_EQ(1, info.m_http_ver_lo);
+    ASSERT_EQ("POST /json_rpc?a=1&b=2#frag HTTP/1.1\r\n", info.m_full_request_str);
+    ASSERT_EQ("127.0.0.1:18081", info.m_header_info.m_host);
+    ASSERT_EQ("9", info.m_header_info.m_content_length);
+    ASSERT_EQ("application/json", info.m_header_info.m_content_type);
+    ASSERT_EQ("keep-alive", info.m_header_info.m_connection);
+    ASSERT_EQ(1, info.m_header_info.m_etc_fields.size());
+    ASSERT_EQ("X-Folded", info.m_header_info.m_etc_fields.front().first);
+    ASSERT_EQ("first second", info.m_header_info.m_etc_fields.front().second);
+    ASSERT_EQ(info.m_full_request_buf_size, info.m_request_head.size());
+    ASSERT_EQ(0, info.m_request_head.find("Host: "));
+  }
+
+  http_request_parser::parse_result parse(const std::string& data, http_request_info& info)
+  {
+    http_request_parser parser;
+    const char* ptr = data.data();
+    return parser.parse(ptr, data.data() + data.size(), info);
+  }
+
+  struct test_endpoint: public epee::net_utils::i_service_endpoint
+  {
+    test_endpoint():m_queued(0), m_max_queued(0)
+    {}
+
+    virtual bool do_send(const void* ptr, size_t cb)
+    {
+      m_sent.append((const char*)ptr, cb);
+      m_max_queued = std::max(m_max_queued, ++m_queued);
+      return true;
+    }
+    //pretends that connection writes queued packets out while sender waits
+    virtual bool wait_send_que(size_t max_count){ m_queued = std::min(m_queued, max_count); return true; }
+    virtual bool close(){ return true; }
+    virtual bool call_run_once_service_io(){ return true; }
+    virtual bool request_callback(){ return true; }
+    virtual boost::asio::io_service& get_io_service(){ return m_io_service; }
+    virtual bool add_ref(){ return true; }
+    virtual bool release(){ return true; }
+
+    boost::asio::io_service m_io_service;
+    std::string m_sent;
+    size_t m_queued;
+    size_t m_max_queued;
+  };
+
+  struct test_server_handler: public i_http_server_handler<epee::net_utils::connection_context_base>
+  {
+    test_server_handler():m_streamed_body_size(0)
+    {}
+
+    virtual bool handle_http_request(const http_request_info& query_info, http_response_info& response, epee::net_utils::connection_context_base& conn_context)
+    {
+      m_requests.push_back(query_info);
+      if(m_streamed_body_size)
+      {
+        size_t size = m_streamed_body_size;
+        response.m_body_writer = [size](std::ostream& strm)
+        {
+          std::string piece(1000, 'x');
+          for(size_t written = 0; written < size; written += piece.size())
+            strm.write(piece.data(), std::min(piece.size(), size - written));
+          return true;
+        };
+        return true;
+      }
+      response.m_body = m_response_body.empty() ? query_info.m_body : m_response_body;
+      return true;
+    }
+
+    std::vector<http_request_info> m_requests;
+    std::string m_response_body;
+    size_t m_streamed_body_size;
+  };
+
+  //returns false if body is not a complete chunked body
+  bool decode_chunked_body(const std::string& body, std::string& decoded, size_t* pchunks_count = NULL)
+  {
+    size_t pos = 0;
+    size_t chunks_count = 0;
+    while(true)
+    {
+      size_t eol = body.find("\r\n", pos);
+      if(std::string::npos == eol)
+        return false;
+      size_t len = std::stoul(body.substr(pos, eol - pos), nullptr, 16);
+      pos = eol + 2;
+      if(!len)
+      {
+        if(pchunks_count)
+          *pchunks_count = chunks_count;
+        return body.substr(pos) == "\r\n";
+      }
+      if(body.size() < pos + len + 2 || body.substr(pos + len, 2) != "\r\n")
+        return false;
+      decoded.append(body, pos, len);
+      pos += len + 2;
+      ++chunks_count;
+    }
+  }
+
+  struct test_dispatching_handler: public test_server_handler
+  {
+    test_dispatching_handler():m_dispatch(request_dispatch_queued)
+    {}
+
+    virtual request_dispatch dispatch_http_request(const http_request_info& query_info, const request_job& job, epee::net_utils::connection_context_base& conn_context)
+    {
+      if(request_dispatch_queued == m_dispatch)
+        m_jobs.push_back(job);
+      return m_dispatch;
+    }
+
+    request_dispatch m_dispatch;
+    std::list<request_job> m_jobs;
+  };
+
+#ifdef HTTP_ENABLE_GZIP
+  struct test_target_handler: public epee::net_utils::i_target_handler
+  {
+    virtual bool handle_target_data(std::string& piece_of_transfer)
+    {
+      m_data += piece_of_transfer;
+      piece_of_transfer.clear();
+      return true;
+    }
+
+    std::string m_data;
+  };
+#endif
+}
+
+TEST(http_request_parser, parses_whole_request)
+{
+  std::string data = test_request;
+  http_request_parser parser;
+  http_request_info info;
+  const char* ptr = data.data();
+  ASSERT_EQ(http_request_parser::parse_done, parser.parse(ptr, data.data() + data.size(), info));
+  check_request(info);
+  ASSERT_EQ("{\"id\":10}", std::string(ptr, data.data() + data.size()));
+}
+
+TEST(http_request_parser, parses_request_fed_byte_by_byte)
+{
+  std::string data = test_request;
+  http_request_parser parser;
+  http_request_info info;
+  const char* ptr = data.data();
+  http_request_parser::parse_result res = http_request_parser::parse_need_more;
+  for(size_t i = 0; i != data.size() && http_request_parser::parse_need_more == res; ++i)
+    res = parser.parse(ptr, data.data() + i + 1, info);
+  ASSERT_EQ(http_request_parser::parse_done, res);
+  check_request(info);
+  ASSERT_EQ("{\"id\":10}", std::string(ptr, data.data() + data.size()));
+}
+
+TEST(http_request_parser, accepts_bare_lf_line_ends)
+{
+  http_request_info info;
+  ASSERT_EQ(http_request_parser::parse_done, parse("get / http/1.0\nHost:x\n\n", info));
+  ASSERT_EQ(http_method_get, info.m_http_method);
+  ASSERT_EQ(1, info.m_http_ver_hi);
+  ASSERT_EQ(0, info.m_http_ver_lo);
+  ASSERT_EQ("x", info.m_header_info.m_host);
+}
+
+TEST(http_request_parser, rejects_malformed_requests)
+{
+  http_request_info info;
+  ASSERT_EQ(http_request_parser::parse_error, parse("GET /\r\n\r\n", info));
+  info.clear();
+  ASSERT_EQ(http_request_parser::parse_error, parse("GET / FTP/1.1\r\n\r\n", info));
+  info.clear();
+  ASSERT_EQ(http_request_parser::parse_error, parse("GET  / HTTP/1.1\r\n\r\n", info));
+  info.clear();
+  ASSERT_EQ(http_request_parser::parse_error, parse("GET / HTTP/1.1\r\nBad Header\r\n\r\n", info));
+  info.clear();
+  ASSERT_EQ(http_request_parser::parse_error, parse("GET / HTTP/1.1\r\n folded: x\r\n\r\n", info));
+  info.clear();
+  ASSERT_EQ(http_request_parser::parse_need_more, parse("GET / HTTP/1.1\r\nHost: x\r\n", info));
+}
+
+TEST(http_request_parser, rejects_too_long_request_line)
+{
+  http_request_info info;
+  std::string data = "GET /" + std::string(HTTP_MAX_URI_LEN, 'a');
+  ASSERT_EQ(http_request_parser::parse_error, parse(data, info));
+}
+
+TEST(http_request_parser, content_length)
+{
+  size_t len = 1;
+  ASSERT_TRUE(http_request_parser::get_content_length("0", len));
+  ASSERT_EQ(0, len);
+  ASSERT_TRUE(http_request_parser::get_content_length(" 1234 ", len));
+  ASSERT_EQ(1234, len);
+  ASSERT_FALSE(http_request_parser::get_content_length("", len));
+  ASSERT_FALSE(http_request_parser::get_content_length("-1", len));
+  ASSERT_FALSE(http_request_parser::get_content_length("12a", len));
+  ASSERT_FALSE(http_request_parser::get_content_length("99999999999999999999999", len));
+}
+
+TEST(http_request_parser, handler_serves_pipelined_requests)
+{
+  test_endpoint endpoint;
+  test_server_handler server_handler;
+  custum_handler_config<epee::net_utils::connection_context_base> config;
+  config.m_phandler = &server_handler;
+  epee::net_utils::connection_context_base context;
+  http_custom_handler<epee::net_utils::connection_context_base> handler(&endpoint, config, context);
+
+  std::string data = std::string(test_request) + "GET /getheight HTTP/1.1\r\n\r\n" + test_request;
+  for(size_t i = 0; i < data.size(); i += 7)
+    ASSERT_TRUE(handler.handle_recv(data.data() + i, std::min<size_t>(7, data.size() - i)));
+
+  ASSERT_EQ(3, server_handler.m_requests.size());
+  check_request(server_handler.m_requests[0]);
+  ASSERT_EQ("{\"id\":10}", server_handler.m_requests[0].m_body);
+  ASSERT_EQ("/getheight", server_handler.m_requests[1].m_uri_content.m_path);
+  ASSERT_TRUE(server_handler.m_requests[1].m_body.empty());
+  check_request(server_handler.m_requests[2]);
+  ASSERT_EQ("{\"id\":10}", server_handler.m_requests[2].m_body);
+}
+
+TEST(http_request_dispatch, pipelined_responses_keep_order)
+{
+  test_endpoint endpoint;
+  test_dispatching_handler server_handler;
+  custum_handler_config<epee::net_utils::connection_context_base> config;
+  config.m_phandler = &server_handler;
+  epee::net_utils::connection_context_base context;
+  http_custom_handler<epee::net_utils::connection_context_base> handler(&endpoint, config, context);
+
+  std::string data = std::string(test_request) + "GET /getheight HTTP/1.1\r\n\r\n";
+  ASSERT_TRUE(handler.handle_recv(data.data(), data.size()));
+  //second request waits until first one is answered
+  ASSERT_EQ(1, server_handler.m_jobs.size());
+  ASSERT_TRUE(server_handler.m_requests.empty());
+  ASSERT_TRUE(endpoint.m_sent.empty());
+
+  server_handler.m_jobs.front()(true);
+  server_handler.m_jobs.pop_front();
+  ASSERT_EQ(1, server_handler.m_requests.size());
+  check_request(server_handler.m_requests[0]);
+  ASSERT_NE(std::string::npos, endpoint.m_sent.find("{\"id\":10}"));
+  ASSERT_EQ(1, server_handler.m_jobs.size());
+
+  server_handler.m_jobs.front()(true);
+  server_handler.m_jobs.pop_front();
+  ASSERT_EQ(2, server_handler.m_requests.size());
+  ASSERT_EQ("/getheight", server_handler.m_requests[1].m_uri_content.m_path);
+  ASSERT_TRUE(server_handler.m_jobs.empty());
+}
+
+TEST(http_request_dispatch, rejected_request_gets_503)
+{
+  test_endpoint endpoint;
+  test_dispatching_handler server_handler;
+  server_handler.m_dispatch = request_dispatch_rejected;
+  custum_handler_config<epee::net_utils::connection_context_base> config;
+  config.m_phandler = &server_handler;
+  epee::net_utils::connection_context_base context;
+  http_custom_handler<epee::net_utils::connection_context_base> handler(&endpoint, config, context);
+
+  std::string request = "GET /getheight HTTP/1.1\r\n\r\n";
+  ASSERT_TRUE(handler.handle_recv(request.data(), request.size()));
+  ASSERT_TRUE(server_handler.m_requests.empty());
+  ASSERT_EQ(0, endpoint.m_sent.find("HTTP/1.1 503 Service Unavailable\r\n"));
+
+  //handler is ready for next request
+  server_handler.m_dispatch = request_dispatch_inline;
+  ASSERT_TRUE(handler.handle_recv(request.data(), request.size()));
+  ASSERT_EQ(1, server_handler.m_requests.size());
+}
+
+TEST(http_request_dispatch, queued_request_can_be_rejected_later)
+{
+  test_endpoint endpoint;
+  test_dispatching_handler server_handler;
+  custum_handler_config<epee::net_utils::connection_context_base> config;
+  config.m_phandler = &server_handler;
+  epee::net_utils::connection_context_base context;
+  http_custom_handler<epee::net_utils::connection_context_base> handler(&endpoint, config, context);
+
+  std::string request = "GET /getheight HTTP/1.1\r\n\r\n";
+  ASSERT_TRUE(handler.handle_recv(request.data(), request.size()));
+  ASSERT_EQ(1, server_handler.m_jobs.size());
+
+  server_handler.m_jobs.front()(false);
+  server_handler.m_jobs.pop_front();
+  ASSERT_TRUE(server_handler.m_requests.empty());
+  ASSERT_EQ(0, endpoint.m_sent.find("HTTP/1.1 503 Service Unavailable\r\n"));
+
+  //handler is ready for next request
+  server_handler.m_dispatch = request_dispatch_inline;
+  ASSERT_TRUE(handler.handle_recv(request.data(), request.size()));
+  ASSERT_EQ(1, server_handler.m_requests.size());
+}
+
+TEST(http_response_streaming, body_writer_is_sent_chunked)
+{
+  test_endpoint endpoint;
+  test_server_handler server_handler;
+  server_handler.m_streamed_body_size = HTTP_RESPONSE_CHUNK_SIZE * 2 + 100;
+  custum_handler_config<epee::net_utils::connection_context_base> config;
+  config.m_phandler = &server_handler;
+  epee::net_utils::connection_context_base context;
+  http_custom_handler<epee::net_utils::connection_context_base> handler(&endpoint, config, context);
+
+  std::string request = "GET /getheight HTTP/1.1\r\n\r\n";
+  ASSERT_TRUE(handler.handle_recv(request.data(), request.size()));
+  size_t header_end = endpoint.m_sent.find("\r\n\r\n");
+  ASSERT_NE(std::string::npos, header_end);
+  std::string header = endpoint.m_sent.substr(0, header_end + 2);
+  ASSERT_NE(std::string::npos, header.find("Transfer-Encoding: chunked\r\n"));
+  ASSERT_EQ(std::string::npos, header.find("Content-Length"));
+
+  std::string body;
+  ASSERT_TRUE(decode_chunked_body(endpoint.m_sent.substr(header_end + 4), body));
+  ASSERT_EQ(std::string(server_handler.m_streamed_body_size, 'x'), body);
+
+  //connection is usable for next request
+  endpoint.m_sent.clear();
+  server_handler.m_streamed_body_size = 0;
+  ASSERT_TRUE(handler.handle_recv(request.data(), request.size()));
+  ASSERT_NE(std::string::npos, endpoint.m_sent.find("Content-Length: 0\r\n"));
+}
+
+TEST(http_response_streaming, body_generation_waits_for_send_queue)
+{
+  test_endpoint endpoint;
+  test_server_handler server_handler;
+  server_handler.m_streamed_body_size = HTTP_RESPONSE_CHUNK_SIZE * (ABSTRACT_SERVER_SEND_QUE_MAX_COUNT + 100);
+  custum_handler_config<epee::net_utils::connection_context_base> config;
+  config.m_phandler = &server_handler;
+  epee::net_utils::connection_context_base context;
+  http_custom_handler<epee::net_utils::connection_context_base> handler(&endpoint, config, context);
+
+  std::string request = "GET /getheight HTTP/1.1\r\n\r\n";
+  ASSERT_TRUE(handler.handle_recv(request.data(), request.size()));
+  ASSERT_LE(endpoint.m_max_queued, HTTP_RESPONSE_MAX_QUEUED_CHUNKS + 1);
+
+  size_t header_end = endpoint.m_sent.find("\r\n\r\n");
+  ASSERT_NE(std::string::npos, header_end);
+  std::string body;
+  size_t chunks_count = 0;
+  ASSERT_TRUE(decode_chunked_body(endpoint.m_sent.substr(header_end + 4), body, &chunks_count));
+  ASSERT_GT(chunks_count, ABSTRACT_SERVER_SEND_QUE_MAX_COUNT);
+  ASSERT_EQ(server_handler.m_streamed_body_size, body.size());
+  ASSERT_EQ(std::string::npos, body.find_first_not_of('x'));
+}
+
+TEST(http_response_streaming, server_streams_more_chunks_than_send_queue_holds)
+{
+  test_server_handler server_handler;
+  server_handler.m_streamed_body_size = HTTP_RESPONSE_CHUNK_SIZE * (ABSTRACT_SERVER_SEND_QUE_MAX_COUNT + 100);
+  epee::net_utils::boosted_tcp_server<http_custom_handler<epee::net_utils::connection_context_base> > server;
+  server.get_config_object().m_phandler = &server_handler;
+  ASSERT_TRUE(server.init_server(test_server_port, "127.0.0.1"));
+  ASSERT_TRUE(server.run_server(2, false));
+
+  boost::asio::io_service io_service;
+  boost::asio::ip::tcp::socket socket(io_service);
+  socket.connect(boost::asio::ip::tcp::endpoint(boost::asio::ip::address::from_string("127.0.0.1"), test_server_port));
+  std::string request = "GET /getheight HTTP/1.1\r\n\r\n";
+  boost::asio::write(socket, boost::asio::buffer(request));
+  //reader is slower than body generation, so chunks have to wait for the socket
+  epee::misc_utils::sleep_no_w(200);
+
+  static const std::string last_chunk = "\r\n0\r\n\r\n";
+  std::string response;
+  std::vector<char> buff(1024 * 1024);
+  boost::system::error_code ec;
+  while(response.size() < last_chunk.size() || response.compare(response.size() - last_chunk.size(), last_chunk.size(), last_chunk))
+  {
+    size_t cb = socket.read_some(boost::asio::buffer(buff), ec);
+    ASSERT_FALSE(ec) << ec.message() << ", received " << response.size();
+    response.append(buff.data(), cb);
+  }
+
+  size_t header_end = response.find("\r\n\r\n");
+  ASSERT_NE(std::string::npos, header_end);
+  std::string body;
+  size_t chunks_count = 0;
+  ASSERT_TRUE(decode_chunked_body(response.substr(header_end + 4), body, &chunks_count));
+  ASSERT_GT(chunks_count, ABSTRACT_SERVER_SEND_QUE_MAX_COUNT);
+  ASSERT_EQ(server_handler.m_streamed_body_size, body.size());
+
+  server.send_stop_signal();
+  ASSERT_TRUE(server.timed_wait_server_stop(5 * 1000));
+}
+
+TEST(http_response_streaming, http10_client_gets_content_length)
+{
+  test_endpoint endpoint;
+  test_server_handler server_handler;
+  server_handler.m_streamed_body_size = 1000;
+  custum_handler_config<epee::net_utils::connection_context_base> config;
+  config.m_phandler = &server_handler;
+  config.m_compression_threshold = 0;
+  epee::net_utils::connection_context_base context;
+  http_custom_handler<epee::net_utils::connection_context_base> handler(&endpoint, config, context);
+
+  std::string request = "GET /getheight HTTP/1.0\r\n\r\n";
+  ASSERT_TRUE(handler.handle_recv(request.data(), request.size()));
+  ASSERT_NE(std::string::npos, endpoint.m_sent.find("Content-Length: 1000\r\n"));
+  ASSERT_EQ(std::string::npos, endpoint.m_sent.find("chunked"));
+  ASSERT_EQ(endpoint.m_sent.size() - 1000, endpoint.m_sent.find(std::string(1000, 'x')));
+}
+
+TEST(http_content_encoding, accept_encoding_negotiation)
+{
+  ASSERT_TRUE(is_content_encoding_accepted("gzip", "gzip"));
+  ASSERT_TRUE(is_content_encoding_accepted("deflate, GZIP;q=0.5", "gzip"));
+  ASSERT_TRUE(is_content_encoding_accepted("*", "gzip"));
+  ASSERT_TRUE(is_content_encoding_accepted("*;q=0, gzip", "gzip"));
+  ASSERT_FALSE(is_content_encoding_accepted("", "gzip"));
+  ASSERT_FALSE(is_content_encoding_accepted("identity", "gzip"));
+  ASSERT_FALSE(is_content_encoding_accepted("gzip;q=0", "gzip"));
+  ASSERT_FALSE(is_content_encoding_accepted("gzip; q=0.000, *", "gzip"));
+  ASSERT_FALSE(is_content_encoding_accepted("xgzip", "gzip"));
+}
+
+#ifdef HTTP_ENABLE_GZIP
+TEST(http_content_encoding, handler_gzips_big_responses_only)
+{
+  test_endpoint endpoint;
+  test_server_handler server_handler;
+  custum_handler_config<epee::net_utils::connection_context_base> config;
+  config.m_phandler = &server_handler;
+  epee::net_utils::connection_context_base context;
+  http_custom_handler<epee::net_utils::connection_context_base> handler(&endpoint, config, context);
+
+  server_handler.m_response_body.assign(HTTP_DEFAULT_COMPRESSION_THRESHOLD * 4, 'a');
+  std::string request = "GET /getblocks.bin HTTP/1.1\r\nAccept-Encoding: gzip, deflate\r\n\r\n";
+  ASSERT_TRUE(handler.handle_recv(request.data(), request.size()));
+
+  std::string::size_type head_end = endpoint.m_sent.find("\r\n\r\n");
+  ASSERT_NE(std::string::npos, head_end);
+  std::string head = endpoint.m_sent.substr(0, head_end + 4);
+  ASSERT_NE(std::string::npos, head.find("Content-Encoding:gzip\r\n"));
+
+  test_target_handler target;
+  epee::net_utils::content_encoding_gzip decoder(&target);
+  std::string body = endpoint.m_sent.substr(head_end + 4);
+  ASSERT_LT(body.size(), server_handler.m_response_body.size());
+  ASSERT_NE(std::string::npos, head.find("Content-Length: " + std::to_string(body.size()) + "\r\n"));
+  ASSERT_TRUE(decoder.update_in(body));
+  ASSERT_EQ(server_handler.m_response_body, target.m_data);
+
+  //client did not ask for it
+  endpoint.m_sent.clear();
+  request = "GET /getblocks.bin HTTP/1.1\r\n\r\n";
+  ASSERT_TRUE(handler.handle_recv(request.data(), request.size()));
+  ASSERT_EQ(std::string::npos, endpoint.m_sent.find("Content-Encoding"));
+
+  //too small to bother
+  endpoint.m_sent.clear();
+  server_handler.m_response_body = "{\"status\":\"OK\"}";
+  request = "GET /getheight HTTP/1.1\r\nAccept-Encoding: gzip\r\n\r\n";
+  ASSERT_TRUE(handler.handle_recv(request.data(), request.size()));
+  ASSERT_EQ(std::string::npos, endpoint.m_sent.find("Content-Encoding"));
+}
+#endif
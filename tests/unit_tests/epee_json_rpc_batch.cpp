@@ -0,0 +1,162 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "net/http_protocol_handler.h"
+#include "net/http_server_handlers_map2.h"
+
+using namespace epee::net_utils::http;
+
+namespace
+{
+  struct COMMAND_TEST_ADD
+  {
+    struct request
+    {
+      uint64_t a;
+      uint64_t b;
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(a)
+        KV_SERIALIZE(b)
+      END_KV_SERIALIZE_MAP()
+    };
+
+    struct response
+    {
+      uint64_t sum;
+      BEGIN_KV_SERIALIZE_MAP()
+        KV_SERIALIZE(sum)
+      END_KV_SERIALIZE_MAP()
+    };
+  };
+
+  class test_json_rpc_server: public i_http_server_handler<epee::net_utils::connection_context_base>
+  {
+  public:
+    test_json_rpc_server():m_batches(0)
+    {}
+
+    CHAIN_HTTP_TO_MAP2(epee::net_utils::connection_context_base);
+
+    BEGIN_URI_MAP2()
+      BEGIN_JSON_RPC_MAP("/json_rpc")
+        MAP_JON_RPC_WE("add", on_add, COMMAND_TEST_ADD)
+      END_JSON_RPC_MAP()
+    END_URI_MAP2()
+
+    virtual void handle_json_rpc_batch(const std::list<std::string>& methods, const boost::function<void()>& run_calls)
+    {
+      ++m_batches;
+      m_batch_methods = methods;
+      run_calls();
+    }
+
+    bool on_add(const COMMAND_TEST_ADD::request& req, COMMAND_TEST_ADD::response& res, epee::json_rpc::error& error_resp, epee::net_utils::connection_context_base& cntx)
+    {
+      if(req.a == 0)
+      {
+        error_resp.code = -1;
+        error_resp.message = "zero";
+        return false;
+      }
+      res.sum = req.a + req.b;
+      return true;
+    }
+
+    std::string call(const std::string& body)
+    {
+      http_request_info query;
+      query.m_URI = "/json_rpc";
+      query.m_body = body;
+      http_response_info response;
+      epee::net_utils::connection_context_base context;
+      handle_http_request(query, response, context);
+      EXPECT_EQ(200, response.m_response_code);
+      return response.m_body;
+    }
+
+    size_t m_batches;
+    std::list<std::string> m_batch_methods;
+  };
+
+  std::string strip_spaces(std::string s)
+  {
+    s.erase(std::remove_if(s.begin(), s.end(), ::isspace), s.end());
+    return s;
+  }
+}
+
+TEST(json_rpc_batch, single_request_is_not_wrapped)
+{
+  test_json_rpc_server server;
+  std::string body = strip_spaces(server.call("{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"add\",\"params\":{\"a\":2,\"b\":3}}"));
+  ASSERT_EQ("{\"id\":1,\"jsonrpc\":\"2.0\",\"result\":{\"sum\":5}}", body);
+  ASSERT_EQ(0, server.m_batches);
+}
+
+TEST(json_rpc_batch, responses_keep_order_and_ids)
+{
+  test_json_rpc_server server;
+  std::string body = strip_spaces(server.call(
+    " [{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"add\",\"params\":{\"a\":2,\"b\":3}},"
+    "{\"jsonrpc\":\"2.0\",\"id\":\"x\",\"method\":\"nope\"},"
+    "{\"jsonrpc\":\"2.0\",\"id\":3,\"method\":\"add\",\"params\":{\"a\":0,\"b\":3}},"
+    "{\"jsonrpc\":\"2.0\",\"id\":4},"
+    "{\"jsonrpc\":\"2.0\",\"id\":5,\"method\":\"add\",\"params\":{\"a\":10,\"b\":1}}]"));
+  ASSERT_EQ(
+    "[{\"id\":1,\"jsonrpc\":\"2.0\",\"result\":{\"sum\":5}},"
+    "{\"error\":{\"code\":-32601,\"message\":\"Methodnotfound\"},\"id\":\"x\",\"jsonrpc\":\"2.0\"},"
+    "{\"error\":{\"code\":-1,\"message\":\"zero\"},\"id\":3,\"jsonrpc\":\"2.0\"},"
+    "{\"error\":{\"code\":-32600,\"message\":\"InvalidRequest\"},\"id\":4,\"jsonrpc\":\"2.0\"},"
+    "{\"id\":5,\"jsonrpc\":\"2.0\",\"result\":{\"sum\":11}}]", body);
+
+  ASSERT_EQ(1, server.m_batches);
+  std::list<std::string> methods = {"add", "nope", "add", "", "add"};
+  ASSERT_EQ(methods, server.m_batch_methods);
+}
+
+TEST(json_rpc_batch, invalid_batches_get_single_error)
+{
+  test_json_rpc_server server;
+  std::string body = strip_spaces(server.call("[1,2]"));
+  ASSERT_NE(std::string::npos, body.find("-32600")) << body;
+  ASSERT_EQ('{', body[0]);
+
+  body = strip_spaces(server.call("[{\"id\"::1}]"));
+  ASSERT_NE(std::string::npos, body.find("-32700")) << body;
+
+  std::string big = "[";
+  for(size_t i = 0; i <= JSON_RPC_MAX_BATCH_SIZE; ++i)
+    big += std::string(i ? "," : "") + "{\"jsonrpc\":\"2.0\",\"id\":1,\"method\":\"add\",\"params\":{\"a\":2,\"b\":3}}";
+  big += "]";
+  body = strip_spaces(server.call(big));
+  ASSERT_NE(std::string::npos, body.find("-32600")) << body;
+  ASSERT_EQ(0, server.m_batches);
+}
@@ -0,0 +1,143 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <sstream>
+#include "include_base_utils.h"
+#include "serialization/keyvalue_serialization.h"
+#include "storages/portable_storage_template_helper.h"
+#include "storages/json_stream_writer.h"
+
+namespace
+{
+  //fields are declared in name order, so portable_storage (which sorts them) gives the same text
+  struct test_item
+  {
+    std::string name;
+    uint64_t value;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(name)
+      KV_SERIALIZE(value)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct test_empty
+  {
+    BEGIN_KV_SERIALIZE_MAP()
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct test_response
+  {
+    std::list<uint64_t> amounts;
+    test_empty empty;
+    bool flag;
+    std::list<test_item> items;
+    std::list<test_item> no_items;
+    test_item single;
+    std::string status;
+    int64_t total;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(amounts)
+      KV_SERIALIZE(empty)
+      KV_SERIALIZE(flag)
+      KV_SERIALIZE(items)
+      KV_SERIALIZE(no_items)
+      KV_SERIALIZE(single)
+      KV_SERIALIZE(status)
+      KV_SERIALIZE(total)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  test_response make_response()
+  {
+    test_response r;
+    r.amounts = {1, 20, 300};
+    r.flag = true;
+    test_item item;
+    for(uint64_t i = 0; i < 3; ++i)
+    {
+      item.name = "item \"" + std::to_string(i) + "\"\n";
+      item.value = i * 1000;
+      r.items.push_back(item);
+    }
+    r.single.name = "single";
+    r.single.value = 7;
+    r.status = "OK";
+    r.total = -5;
+    return r;
+  }
+
+  std::string stream_to_string(const test_response& r, bool insert_newlines)
+  {
+    std::stringstream ss;
+    EXPECT_TRUE(epee::serialization::store_t_to_json_stream(r, ss, 0, insert_newlines));
+    return ss.str();
+  }
+}
+
+TEST(json_stream_writer, matches_portable_storage_output)
+{
+  test_response r = make_response();
+  std::string expected;
+  ASSERT_TRUE(epee::serialization::store_t_to_json(r, expected));
+  ASSERT_EQ(expected, stream_to_string(r, true));
+
+  ASSERT_TRUE(epee::serialization::store_t_to_json(r, expected, 0, false));
+  ASSERT_EQ(expected, stream_to_string(r, false));
+}
+
+TEST(json_stream_writer, output_loads_back)
+{
+  test_response r = make_response();
+  test_response loaded;
+  ASSERT_TRUE(epee::serialization::load_t_from_json(loaded, stream_to_string(r, true)));
+  ASSERT_EQ(r.amounts, loaded.amounts);
+  ASSERT_EQ(r.items.size(), loaded.items.size());
+  ASSERT_EQ(r.items.back().name, loaded.items.back().name);
+  ASSERT_EQ(r.items.back().value, loaded.items.back().value);
+  ASSERT_EQ(r.single.value, loaded.single.value);
+  ASSERT_EQ(r.total, loaded.total);
+}
+
+TEST(json_stream_writer, writer_owns_moved_struct)
+{
+  boost::function<bool(std::ostream&)> writer;
+  std::string expected;
+  {
+    test_response r = make_response();
+    ASSERT_TRUE(epee::serialization::store_t_to_json(r, expected));
+    writer = epee::serialization::make_json_stream_writer(r);
+  }
+  std::stringstream ss;
+  ASSERT_TRUE(writer(ss));
+  ASSERT_EQ(expected, ss.str());
+}
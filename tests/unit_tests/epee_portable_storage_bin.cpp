@@ -0,0 +1,268 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "include_base_utils.h"
+#include "cryptonote_protocol/cryptonote_protocol_defs.h"
+#include "storages/portable_storage_template_helper.h"
+
+namespace
+{
+  struct test_inner
+  {
+    std::string zeta;
+    uint64_t alpha;
+    std::list<std::string> strings;
+    double fraction;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(zeta)
+      KV_SERIALIZE(alpha)
+      KV_SERIALIZE(strings)
+      KV_SERIALIZE(fraction)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  struct test_outer
+  {
+    uint32_t z;
+    std::vector<test_inner> items;
+    test_inner single;
+    std::vector<uint64_t> numbers;
+    bool flag;
+    int8_t negative;
+    std::list<crypto::hash> hashes;
+    std::string status;
+    std::vector<test_inner> empty;
+
+    BEGIN_KV_SERIALIZE_MAP()
+      KV_SERIALIZE(z)
+      KV_SERIALIZE(items)
+      KV_SERIALIZE(single)
+      KV_SERIALIZE(numbers)
+      KV_SERIALIZE(flag)
+      KV_SERIALIZE(negative)
+      KV_SERIALIZE_CONTAINER_POD_AS_BLOB(hashes)
+      KV_SERIALIZE(status)
+      KV_SERIALIZE(empty)
+    END_KV_SERIALIZE_MAP()
+  };
+
+  test_outer make_test_outer(size_t items_count)
+  {
+    test_outer o;
+    o.z = 7;
+    o.flag = true;
+    o.negative = -3;
+    o.status = "OK";
+    for(size_t i = 0; i < items_count; ++i)
+    {
+      test_inner in;
+      in.zeta = std::string(i, 'x');
+      in.alpha = i * 1000000007ull;
+      in.fraction = i / 3.0;
+      for(size_t j = 0; j < i % 5; ++j)
+        in.strings.push_back(std::to_string(j));
+      o.items.push_back(in);
+      o.numbers.push_back(i);
+      crypto::hash h = AUTO_VAL_INIT(h);
+      *reinterpret_cast<size_t*>(&h) = i;
+      o.hashes.push_back(h);
+    }
+    if(items_count)
+      o.single = o.items.back();
+    return o;
+  }
+
+  template<class t_struct>
+  std::string store_via_portable_storage(t_struct& s)
+  {
+    epee::serialization::portable_storage ps;
+    s.store(ps);
+    std::string buff;
+    ps.store_to_binary(buff);
+    return buff;
+  }
+}
+
+TEST(portable_storage_bin, writer_output_matches_portable_storage)
+{
+  for(size_t count: {0, 1, 63, 64, 1000})
+  {
+    test_outer o = make_test_outer(count);
+    std::string expected = store_via_portable_storage(o);
+    std::string buff;
+    ASSERT_TRUE(epee::serialization::store_t_to_binary(o, buff));
+    ASSERT_EQ(expected, buff);
+  }
+}
+
+TEST(portable_storage_bin, reader_loads_portable_storage_output)
+{
+  test_outer o = make_test_outer(100);
+  std::string buff = store_via_portable_storage(o);
+
+  test_outer r;
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(r, buff));
+  ASSERT_EQ(o.z, r.z);
+  ASSERT_EQ(o.items.size(), r.items.size());
+  ASSERT_EQ(o.items[42].zeta, r.items[42].zeta);
+  ASSERT_EQ(o.items[42].alpha, r.items[42].alpha);
+  ASSERT_EQ(o.items[42].strings, r.items[42].strings);
+  ASSERT_EQ(o.items[42].fraction, r.items[42].fraction);
+  ASSERT_EQ(o.single.zeta, r.single.zeta);
+  ASSERT_EQ(o.numbers, r.numbers);
+  ASSERT_EQ(o.flag, r.flag);
+  ASSERT_EQ(o.negative, r.negative);
+  ASSERT_TRUE(o.hashes == r.hashes);
+  ASSERT_EQ(o.status, r.status);
+  ASSERT_TRUE(r.empty.empty());
+}
+
+TEST(portable_storage_bin, get_objects_roundtrip)
+{
+  cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request req;
+  req.current_blockchain_height = 123456;
+  for(size_t i = 0; i < 200; ++i)
+  {
+    cryptonote::block_complete_entry bce;
+    bce.block = std::string(100 + i, char(i));
+    for(size_t j = 0; j < i % 7; ++j)
+      bce.txs.push_back(std::string(300 + j, char(j)));
+    req.blocks.push_back(bce);
+  }
+  req.missed_ids.push_back(crypto::hash());
+
+  std::string buff;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(req, buff));
+  ASSERT_EQ(store_via_portable_storage(req), buff);
+
+  cryptonote::NOTIFY_RESPONSE_GET_OBJECTS::request r;
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(r, buff));
+  ASSERT_EQ(req.current_blockchain_height, r.current_blockchain_height);
+  ASSERT_EQ(req.blocks.size(), r.blocks.size());
+  ASSERT_EQ(req.blocks.back().block, r.blocks.back().block);
+  ASSERT_EQ(req.blocks.back().txs, r.blocks.back().txs);
+  ASSERT_EQ(1, r.missed_ids.size());
+}
+
+TEST(portable_storage_bin, reader_rejects_truncated_blob)
+{
+  test_outer o = make_test_outer(10);
+  std::string buff;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(o, buff));
+  for(size_t len = 0; len < buff.size(); ++len)
+  {
+    epee::serialization::portable_storage_bin_reader reader;
+    ASSERT_FALSE(reader.load_from_binary(buff.substr(0, len)));
+  }
+}
+
+TEST(portable_storage_bin, writer_rejects_duplicate_names)
+{
+  epee::serialization::portable_storage_bin_writer writer;
+  ASSERT_TRUE(writer.set_value("b", uint64_t(1), nullptr));
+  ASSERT_TRUE(writer.set_value("a", uint64_t(2), nullptr));
+  ASSERT_TRUE(writer.set_value("b", uint64_t(3), nullptr));
+  std::string buff;
+  ASSERT_FALSE(writer.store_to_binary(buff));
+}
+
+TEST(portable_storage_bin, reader_skips_arrays_of_arrays)
+{
+  using namespace epee::serialization;
+  array_entry_t<uint64_t> numbers;
+  numbers.insert_next_value(1);
+  numbers.insert_next_value(2);
+  array_entry_t<std::string> strings;
+  strings.insert_next_value("abc");
+  array_entry_t<array_entry> nested;
+  nested.insert_next_value(array_entry(numbers));
+  nested.insert_next_value(array_entry(strings));
+
+  portable_storage ps;
+  ASSERT_TRUE(ps.set_value("nested", array_entry(nested), nullptr));
+  ASSERT_TRUE(ps.set_value("z", uint32_t(7), nullptr));
+  std::string bin;
+  ASSERT_TRUE(ps.store_to_binary(bin));
+
+  portable_storage loaded;
+  ASSERT_TRUE(loaded.load_from_binary(bin));
+  std::string bin2;
+  ASSERT_TRUE(loaded.store_to_binary(bin2));
+  ASSERT_EQ(bin, bin2);
+
+  portable_storage_bin_reader reader;
+  ASSERT_TRUE(reader.load_from_binary(bin));
+  uint32_t z = 0;
+  ASSERT_TRUE(reader.get_value("z", z, nullptr));
+  ASSERT_EQ(7, z);
+  storage_entry se;
+  ASSERT_TRUE(reader.get_value("nested", se, nullptr));
+  const array_entry_t<array_entry>& arrays = boost::get<array_entry_t<array_entry> >(boost::get<array_entry>(se));
+  ASSERT_EQ(2, arrays.m_array.size());
+  const array_entry_t<uint64_t>& first = boost::get<array_entry_t<uint64_t> >(arrays.m_array.front());
+  ASSERT_EQ(2, first.m_array.size());
+  ASSERT_EQ(2, first.m_array.back());
+  const array_entry_t<std::string>& second = boost::get<array_entry_t<std::string> >(arrays.m_array.back());
+  ASSERT_EQ("abc", second.m_array.front());
+}
+
+TEST(portable_storage_arena, tree_roundtrip_and_copies_outlive_storage)
+{
+  test_outer o = make_test_outer(100);
+  std::string bin = store_via_portable_storage(o);
+
+  epee::serialization::storage_entry copied;
+  std::string json;
+  {
+    epee::serialization::portable_storage ps;
+    ASSERT_TRUE(ps.load_from_binary(bin));
+    std::string bin2;
+    ASSERT_TRUE(ps.store_to_binary(bin2));
+    ASSERT_EQ(bin, bin2);
+    ASSERT_TRUE(ps.get_value("single", copied, nullptr));
+    ASSERT_TRUE(ps.dump_as_json(json));
+  }
+  ASSERT_EQ(typeid(epee::serialization::section), copied.type());
+  const epee::serialization::section& sec = boost::get<epee::serialization::section>(copied);
+  ASSERT_EQ(4, sec.m_entries.size());
+  ASSERT_EQ(o.single.zeta, boost::get<std::string>(sec.m_entries.find("zeta")->second));
+
+  ASSERT_FALSE(json.empty());
+
+  cryptonote::block_complete_entry bce;
+  bce.block = "block";
+  bce.txs.push_back("tx1");
+  bce.txs.push_back("tx2");
+  cryptonote::block_complete_entry bce2;
+  ASSERT_TRUE(epee::serialization::load_t_from_json(bce2, epee::serialization::store_t_to_json(bce)));
+  ASSERT_EQ(bce.block, bce2.block);
+  ASSERT_EQ(bce.txs, bce2.txs);
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include "net/rate_limiter.h"
+
+using epee::net_utils::token_bucket;
+
+TEST(token_bucket, unlimited_never_delays)
+{
+  token_bucket b;
+  ASSERT_EQ(0, b.consume(100000000));
+  ASSERT_EQ(0, b.consume(100000000));
+}
+
+TEST(token_bucket, delays_when_burst_is_spent)
+{
+  token_bucket b;
+  b.set_rate(1000);
+  uint64_t now = epee::misc_utils::get_tick_count();
+
+  ASSERT_EQ(0, b.consume(600, now));
+  ASSERT_EQ(201, b.consume(600, now));
+
+  // debt is paid by time
+  ASSERT_EQ(100, b.consume(100, now + 201));
+  ASSERT_EQ(0, b.consume(0, now + 300));
+}
+
+TEST(token_bucket, packet_bigger_than_burst_passes_and_delays_next)
+{
+  token_bucket b;
+  b.set_rate(1000);
+  uint64_t now = epee::misc_utils::get_tick_count();
+
+  ASSERT_EQ(4001, b.consume(5000, now));
+  ASSERT_LT(0, b.consume(1, now + 3000));
+  ASSERT_EQ(0, b.consume(1, now + 5000));
+}
+
+TEST(token_bucket, idle_time_refills_only_up_to_burst)
+{
+  token_bucket b;
+  b.set_rate(1000);
+  uint64_t now = epee::misc_utils::get_tick_count();
+
+  ASSERT_EQ(0, b.consume(1000, now));
+  ASSERT_EQ(0, b.consume(1000, now + 60000));
+  ASSERT_EQ(1001, b.consume(1000, now + 60000));
+}
+
+TEST(token_bucket, slow_rate_is_not_rounded_to_zero)
+{
+  token_bucket b;
+  b.set_rate(10);
+  uint64_t now = epee::misc_utils::get_tick_count();
+
+  ASSERT_EQ(0, b.consume(10, now));
+  // refill is asked every 50ms, 10 B/s must still produce a byte every 100ms
+  for(uint64_t t = 50; t <= 1000; t += 50)
+    b.consume(0, now + t);
+  ASSERT_EQ(0, b.consume(10, now + 1000));
+}
@@ -0,0 +1,95 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include "gtest/gtest.h"
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <boost/chrono.hpp>
+
+#include "include_base_utils.h"
+#include "worker_queues.h"
+
+TEST(worker_queues, concurrency_limit_lets_other_tasks_pass)
+{
+  epee::worker_queues workers;
+  size_t queue_id = workers.add_queue("test", 2, 0);
+  workers.set_concurrency_limit("slow", 1);
+  ASSERT_TRUE(workers.start());
+
+  std::mutex lock;
+  std::condition_variable cv;
+  bool release_slow = false;
+  std::atomic<int> slow_running(0), slow_max(0), done(0);
+  auto slow_task = [&]()
+  {
+    int running = ++slow_running;
+    if(running > slow_max)
+      slow_max = running;
+    std::unique_lock<std::mutex> l(lock);
+    cv.wait(l, [&](){return release_slow;});
+    --slow_running;
+    ++done;
+  };
+  ASSERT_TRUE(workers.post(queue_id, "slow", slow_task));
+  ASSERT_TRUE(workers.post(queue_id, "slow", slow_task));
+  ASSERT_TRUE(workers.post(queue_id, "fast", [&](){++done;}));
+
+  //fast task is served by second thread while second slow task waits for the first one
+  for(size_t i = 0; i < 1000 && done != 1; i++)
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+  ASSERT_EQ(1, done);
+  ASSERT_EQ(1, workers.get_pending_count(queue_id));
+
+  {
+    std::unique_lock<std::mutex> l(lock);
+    release_slow = true;
+  }
+  cv.notify_all();
+  for(size_t i = 0; i < 1000 && done != 3; i++)
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+  ASSERT_EQ(3, done);
+  ASSERT_EQ(1, slow_max);
+  workers.stop();
+}
+
+TEST(worker_queues, queues_are_fixed_once_started)
+{
+  epee::worker_queues workers;
+  size_t queue_id = workers.add_queue("test", 1, 0);
+  ASSERT_TRUE(workers.start());
+  ASSERT_TRUE(epee::worker_queues::invalid_queue == workers.add_queue("late", 1, 0));
+
+  std::atomic<int> done(0);
+  ASSERT_TRUE(workers.post(queue_id, "task", [&](){++done;}));
+  for(size_t i = 0; i < 1000 && done != 1; i++)
+    boost::this_thread::sleep_for(boost::chrono::milliseconds(1));
+  ASSERT_EQ(1, done);
+  workers.stop();
+}
@@ -0,0 +1,128 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <cstddef>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+
+namespace
+{
+  crypto::public_key make_invalid_key()
+  {
+    crypto::public_key key;
+    unsigned char b = 0;
+    do
+    {
+      memset(&key, b++, sizeof(key));
+    } while (crypto::check_key(key));
+    return key;
+  }
+
+  class key_derivation_precomp_test : public ::testing::Test
+  {
+  protected:
+    virtual void SetUp()
+    {
+      crypto::public_key view_pub;
+      crypto::generate_keys(view_pub, m_view_sec);
+    }
+
+    std::vector<crypto::public_key> make_keys(size_t count)
+    {
+      std::vector<crypto::public_key> keys(count);
+      crypto::secret_key sec;
+      for (size_t i = 0; i < count; ++i)
+        crypto::generate_keys(keys[i], sec);
+      return keys;
+    }
+
+    crypto::secret_key m_view_sec;
+  };
+}
+
+TEST_F(key_derivation_precomp_test, single_matches_generate_key_derivation)
+{
+  crypto::key_derivation_precomp precomp(m_view_sec);
+  std::vector<crypto::public_key> keys = make_keys(8);
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    crypto::key_derivation expected, actual;
+    ASSERT_TRUE(crypto::generate_key_derivation(keys[i], m_view_sec, expected));
+    ASSERT_TRUE(precomp.derive(keys[i], actual));
+    ASSERT_EQ(0, memcmp(&expected, &actual, sizeof(expected)));
+  }
+}
+
+TEST_F(key_derivation_precomp_test, batch_matches_generate_key_derivation)
+{
+  crypto::key_derivation_precomp precomp(m_view_sec);
+  // more than one normalization chunk, last one partial
+  std::vector<crypto::public_key> keys = make_keys(75);
+  std::vector<crypto::key_derivation> derivations(keys.size());
+  std::unique_ptr<bool[]> valid(new bool[keys.size()]);
+  ASSERT_EQ(keys.size(), precomp.derive(keys.data(), keys.size(), derivations.data(), valid.get()));
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    crypto::key_derivation expected;
+    ASSERT_TRUE(crypto::generate_key_derivation(keys[i], m_view_sec, expected));
+    ASSERT_TRUE(valid[i]);
+    ASSERT_EQ(0, memcmp(&expected, &derivations[i], sizeof(expected)));
+  }
+}
+
+TEST_F(key_derivation_precomp_test, invalid_keys_are_reported)
+{
+  crypto::key_derivation_precomp precomp(m_view_sec);
+  std::vector<crypto::public_key> keys = make_keys(40);
+  crypto::public_key invalid = make_invalid_key();
+  keys[0] = invalid;
+  keys[17] = invalid;
+  keys[39] = invalid;
+
+  crypto::key_derivation derivation;
+  ASSERT_FALSE(precomp.derive(invalid, derivation));
+
+  std::vector<crypto::key_derivation> derivations(keys.size());
+  std::unique_ptr<bool[]> valid(new bool[keys.size()]);
+  ASSERT_EQ(keys.size() - 3, precomp.derive(keys.data(), keys.size(), derivations.data(), valid.get()));
+  for (size_t i = 0; i < keys.size(); ++i)
+  {
+    crypto::key_derivation expected;
+    bool expected_valid = crypto::generate_key_derivation(keys[i], m_view_sec, expected);
+    ASSERT_EQ(expected_valid, valid[i]);
+    if (expected_valid)
+    {
+      ASSERT_EQ(0, memcmp(&expected, &derivations[i], sizeof(expected)));
+    }
+  }
+}
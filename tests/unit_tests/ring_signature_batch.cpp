@@ -0,0 +1,178 @@
+// Copyright (c) 2014, The Monero Project
+// 
+// All rights reserved.
+// 
+// Redistribution and use in source and binary forms, with or without modification, are
+// permitted provided that the following conditions are met:
+// 
+// 1. Redistributions of source code must retain the above copyright notice, this list of
+//    conditions and the following disclaimer.
+// 
+// 2. Redistributions in binary form must reproduce the above copyright notice, this list
+//    of conditions and the following disclaimer in the documentation and/or other
+//    materials provided with the distribution.
+// 
+// 3. Neither the name of the copyright holder nor the names of its contributors may be
+//    used to endorse or promote products derived from this software without specific
+//    prior written permission.
+// 
+// THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS "AS IS" AND ANY
+// EXPRESS OR IMPLIED WARRANTIES, INCLUDING, BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF
+// MERCHANTABILITY AND FITNESS FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL
+// THE COPYRIGHT HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+// SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+// PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS; OR BUSINESS
+// INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY, WHETHER IN CONTRACT,
+// STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE OR OTHERWISE) ARISING IN ANY WAY OUT OF
+// THE USE OF THIS SOFTWARE, EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+
+#include <algorithm>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "crypto/crypto.h"
+
+namespace
+{
+  class ring_signature_batch_test : public ::testing::Test
+  {
+  protected:
+    static const size_t ring_size = 4;
+    static const size_t real_index = 1;
+
+    virtual void SetUp()
+    {
+      for (size_t i = 0; i < ring_size; ++i)
+      {
+        crypto::generate_keys(m_pubs[i], m_secs[i]);
+        m_pub_ptrs[i] = &m_pubs[i];
+      }
+      crypto::generate_key_image(m_pubs[real_index], m_secs[real_index], m_image);
+    }
+
+    std::vector<crypto::signature> sign(const crypto::hash& prefix_hash)
+    {
+      std::vector<crypto::signature> sigs(ring_size);
+      crypto::generate_ring_signature(prefix_hash, m_image, m_pub_ptrs, ring_size, m_secs[real_index], real_index, sigs.data());
+      return sigs;
+    }
+
+    crypto::public_key m_pubs[ring_size];
+    crypto::secret_key m_secs[ring_size];
+    const crypto::public_key* m_pub_ptrs[ring_size];
+    crypto::key_image m_image;
+  };
+}
+
+TEST_F(ring_signature_batch_test, accepts_valid_signatures_with_shared_keys)
+{
+  crypto::ring_signature_batch batch;
+  for (size_t i = 0; i < 5; ++i)
+  {
+    crypto::hash prefix_hash = crypto::rand<crypto::hash>();
+    std::vector<crypto::signature> sigs = sign(prefix_hash);
+    ASSERT_TRUE(crypto::check_ring_signature(prefix_hash, m_image, m_pub_ptrs, ring_size, sigs.data()));
+    batch.add(prefix_hash, m_image, m_pub_ptrs, ring_size, sigs.data());
+  }
+  ASSERT_EQ(5, batch.size());
+  ASSERT_TRUE(batch.verify());
+  ASSERT_EQ(0, batch.size());
+
+  // cached ring members are used by the next batch
+  crypto::hash prefix_hash = crypto::rand<crypto::hash>();
+  std::vector<crypto::signature> sigs = sign(prefix_hash);
+  batch.add(prefix_hash, m_image, m_pub_ptrs, ring_size, sigs.data());
+  ASSERT_TRUE(batch.verify());
+}
+
+TEST_F(ring_signature_batch_test, reports_first_bad_signature)
+{
+  crypto::ring_signature_batch batch;
+  for (size_t i = 0; i < 4; ++i)
+  {
+    crypto::hash prefix_hash = crypto::rand<crypto::hash>();
+    std::vector<crypto::signature> sigs = sign(prefix_hash);
+    if (i == 2)
+    {
+      // signature of another message
+      prefix_hash = crypto::rand<crypto::hash>();
+      ASSERT_FALSE(crypto::check_ring_signature(prefix_hash, m_image, m_pub_ptrs, ring_size, sigs.data()));
+    }
+    batch.add(prefix_hash, m_image, m_pub_ptrs, ring_size, sigs.data());
+  }
+  size_t failed_index = 0;
+  ASSERT_FALSE(batch.verify(&failed_index));
+  ASSERT_EQ(2, failed_index);
+  ASSERT_EQ(0, batch.size());
+}
+
+TEST_F(ring_signature_batch_test, rejects_invalid_ring_member)
+{
+  crypto::hash prefix_hash = crypto::rand<crypto::hash>();
+  std::vector<crypto::signature> sigs = sign(prefix_hash);
+
+  crypto::public_key bad_key;
+  do
+  {
+    bad_key = crypto::rand<crypto::public_key>();
+  } while (crypto::check_key(bad_key));
+  const crypto::public_key* pubs[ring_size];
+  std::copy(m_pub_ptrs, m_pub_ptrs + ring_size, pubs);
+  pubs[0] = &bad_key;
+
+  crypto::ring_signature_batch batch;
+  batch.add(prefix_hash, m_image, pubs, ring_size, sigs.data());
+  ASSERT_FALSE(batch.verify());
+
+  // same key is rejected again when it comes from the cache
+  batch.add(prefix_hash, m_image, pubs, ring_size, sigs.data());
+  ASSERT_FALSE(batch.verify());
+}
+
+TEST_F(ring_signature_batch_test, shared_cache_keeps_ring_members)
+{
+  crypto::ring_member_cache cache(16);
+  {
+    crypto::ring_signature_batch batch(&cache);
+    crypto::hash prefix_hash = crypto::rand<crypto::hash>();
+    std::vector<crypto::signature> sigs = sign(prefix_hash);
+    batch.add(prefix_hash, m_image, m_pub_ptrs, ring_size, sigs.data());
+    ASSERT_TRUE(batch.verify());
+  }
+  ASSERT_EQ(4, cache.size());
+
+  crypto::ring_signature_batch batch(&cache);
+  crypto::hash prefix_hash = crypto::rand<crypto::hash>();
+  std::vector<crypto::signature> sigs = sign(prefix_hash);
+  batch.add(prefix_hash, m_image, m_pub_ptrs, ring_size, sigs.data());
+  ASSERT_TRUE(batch.verify());
+  ASSERT_EQ(4, cache.size());
+
+  cache.clear();
+  ASSERT_EQ(0, cache.size());
+}
+
+TEST_F(ring_signature_batch_test, small_cache_evicts_and_stays_correct)
+{
+  for (size_t max_count = 0; max_count < 4; ++max_count)
+  {
+    crypto::ring_member_cache cache(max_count);
+    crypto::ring_signature_batch batch(&cache);
+    for (size_t i = 0; i < 3; ++i)
+    {
+      crypto::hash prefix_hash = crypto::rand<crypto::hash>();
+      std::vector<crypto::signature> sigs = sign(prefix_hash);
+      batch.add(prefix_hash, m_image, m_pub_ptrs, ring_size, sigs.data());
+    }
+    crypto::hash prefix_hash = crypto::rand<crypto::hash>();
+    std::vector<crypto::signature> sigs = sign(prefix_hash);
+    sigs[0].c.data[0] ^= 1;
+    batch.add(prefix_hash, m_image, m_pub_ptrs, ring_size, sigs.data());
+
+    size_t failed_index = 0;
+    ASSERT_FALSE(batch.verify(&failed_index));
+    ASSERT_EQ(3, failed_index);
+    ASSERT_LE(cache.size(), max_count + 1);
+  }
+}
@@ -82,3 +82,129 @@ TEST(peer_list, merge_peer_lists)
 
 
 }
+
+TEST(peer_list, peer_stats_scoring)
+{
+  nodetool::peerlist_manager plm;
+  plm.init(false);
+  nodetool::net_address fast = AUTO_VAL_INIT(fast), slow = AUTO_VAL_INIT(slow), flaky = AUTO_VAL_INIT(flaky), unknown = AUTO_VAL_INIT(unknown);
+  fast.ip = MAKE_IP(123,43,12,1); fast.port = 8080;
+  slow.ip = MAKE_IP(123,43,12,2); slow.port = 8080;
+  flaky.ip = MAKE_IP(123,43,12,3); flaky.port = 8080;
+  unknown.ip = MAKE_IP(123,43,12,4); unknown.port = 8080;
+
+  nodetool::peerlist_entry ple = AUTO_VAL_INIT(ple);
+  ple.adr = fast;
+  ASSERT_TRUE(plm.append_with_peer_white(ple));
+  ple.adr = slow;
+  ASSERT_TRUE(plm.append_with_peer_white(ple));
+  ple.adr = flaky;
+  ASSERT_TRUE(plm.append_with_peer_gray(ple));
+  ple.adr = unknown;
+  ASSERT_TRUE(plm.append_with_peer_white(ple));
+
+  nodetool::peer_stats ps = AUTO_VAL_INIT(ps);
+  ASSERT_FALSE(plm.get_peer_stats(fast, ps));
+
+  ASSERT_TRUE(plm.set_peer_rtt(fast, 40));
+  ASSERT_TRUE(plm.add_peer_throughput(fast, 2000000, 1000));
+  ASSERT_TRUE(plm.set_peer_rtt(slow, 400));
+  ASSERT_TRUE(plm.add_peer_throughput(slow, 20000, 1000));
+  ASSERT_TRUE(plm.set_peer_rtt(flaky, 40));
+  ASSERT_TRUE(plm.add_peer_throughput(flaky, 2000000, 1000));
+  ASSERT_TRUE(plm.set_peer_unreachable(flaky));
+  ASSERT_TRUE(plm.set_peer_unreachable(flaky));
+
+  ASSERT_TRUE(plm.get_peer_stats(fast, ps));
+  ASSERT_EQ(40, ps.rtt);
+  ASSERT_EQ(2000000, ps.throughput);
+  ASSERT_EQ(0, ps.fail_count);
+
+  ASSERT_TRUE(plm.set_peer_rtt(fast, 80));
+  ASSERT_TRUE(plm.get_peer_stats(fast, ps));
+  ASSERT_EQ(50, ps.rtt);
+
+  ASSERT_TRUE(plm.get_peer_stats(flaky, ps));
+  ASSERT_EQ(2, ps.fail_count);
+
+  ASSERT_LT(plm.get_peer_score(fast), plm.get_peer_score(unknown));
+  ASSERT_LT(plm.get_peer_score(unknown), plm.get_peer_score(slow));
+  ASSERT_LT(plm.get_peer_score(fast), plm.get_peer_score(flaky));
+
+  // a completed handshake clears failures
+  ASSERT_TRUE(plm.set_peer_rtt(flaky, 40));
+  ASSERT_TRUE(plm.get_peer_stats(flaky, ps));
+  ASSERT_EQ(0, ps.fail_count);
+  ASSERT_LT(plm.get_peer_score(flaky), plm.get_peer_score(unknown));
+}
+
+TEST(peer_list, peer_stats_only_for_listed_peers)
+{
+  nodetool::peerlist_manager plm;
+  plm.init(false);
+  nodetool::net_address unlisted = AUTO_VAL_INIT(unlisted);
+  unlisted.ip = MAKE_IP(123,43,12,1);
+  unlisted.port = 8080;
+
+  nodetool::peer_stats ps = AUTO_VAL_INIT(ps);
+  ASSERT_TRUE(plm.set_peer_unreachable(unlisted));
+  ASSERT_TRUE(plm.set_peer_rtt(unlisted, 40));
+  ASSERT_TRUE(plm.add_peer_throughput(unlisted, 2000000, 1000));
+  ASSERT_FALSE(plm.get_peer_stats(unlisted, ps));
+
+  //stats go away with the entry once it is trimmed from the list
+  nodetool::peerlist_entry ple = AUTO_VAL_INIT(ple);
+  ple.adr = unlisted;
+  ple.last_seen = 1;
+  ASSERT_TRUE(plm.append_with_peer_gray(ple));
+  ASSERT_TRUE(plm.set_peer_unreachable(unlisted));
+  ASSERT_TRUE(plm.get_peer_stats(unlisted, ps));
+  ASSERT_EQ(1, ps.fail_count);
+
+  std::list<nodetool::peerlist_entry> newer;
+  for(size_t i = 0; i < P2P_LOCAL_GRAY_PEERLIST_LIMIT; ++i)
+  {
+    uint32_t hi = (i >> 8) & 0xff, lo = i & 0xff;
+    ple.adr.ip = MAKE_IP(124, 1, hi, lo);
+    ple.last_seen = 2 + i;
+    newer.push_back(ple);
+  }
+  ASSERT_TRUE(plm.merge_peerlist(newer));
+  ASSERT_EQ(P2P_LOCAL_GRAY_PEERLIST_LIMIT, plm.get_gray_peers_count());
+  ASSERT_FALSE(plm.get_peer_stats(unlisted, ps));
+}
+
+TEST(peer_list, peer_stats_serialization)
+{
+  nodetool::peerlist_manager plm;
+  plm.init(false);
+  nodetool::peerlist_entry ple = AUTO_VAL_INIT(ple);
+  ple.adr.ip = MAKE_IP(123,43,12,1);
+  ple.adr.port = 8080;
+  ple.id = 121241;
+  ple.last_seen = 34345;
+  ASSERT_TRUE(plm.append_with_peer_white(ple));
+  ASSERT_TRUE(plm.set_peer_rtt(ple.adr, 120));
+  ASSERT_TRUE(plm.add_peer_throughput(ple.adr, 300000, 1000));
+  ASSERT_TRUE(plm.set_peer_unreachable(ple.adr));
+
+  std::stringstream ss;
+  {
+    boost::archive::binary_oarchive a(ss);
+    a << plm;
+  }
+  nodetool::peerlist_manager loaded;
+  loaded.init(false);
+  {
+    boost::archive::binary_iarchive a(ss);
+    a >> loaded;
+  }
+
+  ASSERT_EQ(1, loaded.get_white_peers_count());
+  nodetool::peer_stats ps = AUTO_VAL_INIT(ps);
+  ASSERT_TRUE(loaded.get_peer_stats(ple.adr, ps));
+  ASSERT_EQ(120, ps.rtt);
+  ASSERT_EQ(300000, ps.throughput);
+  ASSERT_EQ(1, ps.fail_count);
+  ASSERT_EQ(plm.get_peer_score(ple.adr), loaded.get_peer_score(ple.adr));
+}
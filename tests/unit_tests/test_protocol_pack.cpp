@@ -32,6 +32,7 @@
 
 #include "include_base_utils.h"
 #include "cryptonote_protocol/cryptonote_protocol_defs.h"
+#include "rpc/core_rpc_server_commands_defs.h"
 #include "storages/portable_storage_template_helper.h"
 
 TEST(protocol_pack, protocol_pack_command) 
@@ -53,3 +54,20 @@ TEST(protocol_pack, protocol_pack_command)
     ASSERT_TRUE(r.total_height == 3);
   }
 }
+
+TEST(protocol_pack, get_transactions_fast_keeps_raw_blobs)
+{
+  std::string buff;
+  cryptonote::COMMAND_RPC_GET_TRANSACTIONS_FAST::response r;
+  r.txs.push_back(std::string("\x01\x00\xff", 3));
+  r.txs.push_back(std::string(1000, '\x02'));
+  r.missed_tx.push_back(crypto::cn_fast_hash("a", 1));
+  r.status = CORE_RPC_STATUS_OK;
+  ASSERT_TRUE(epee::serialization::store_t_to_binary(r, buff));
+
+  cryptonote::COMMAND_RPC_GET_TRANSACTIONS_FAST::response r2;
+  ASSERT_TRUE(epee::serialization::load_t_from_binary(r2, buff));
+  ASSERT_TRUE(r.txs == r2.txs);
+  ASSERT_TRUE(r.missed_tx == r2.missed_tx);
+  ASSERT_EQ(r.status, r2.status);
+}